@@ -0,0 +1,56 @@
+// C/MRI Example
+//
+// Example making a two-head signal and two block detectors part of a JMRI layout. In JMRI, 
+// add a C/MRI connection on the Arduino's serial port at 19200 baud, with an SMINI at node 
+// address 0. Output bits 1-3 are head 1 green, yellow and red, and 4-6 are head 2 (JMRI numbers
+// bits from 1, the sketch from 0). Input bits 1 and 2 are the detectors on A0 and A1.
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+#include "signalCMRI.h"
+
+// create an instance of the signal, and a C/MRI node (address 0) attached to it and the serial port
+linesideSignal signals;
+signalCMRI cmri(signals, Serial, 0);
+
+// perform initialization
+void setup() {   
+ 
+  Serial.begin(19200);
+  
+  signals.setupSignal();  // initialize the library
+     
+  // Define signals: mast, head, lamp, anode, cathode, color
+  signals.addLamp(1, 1, 1, 2, 3, LSS_GREEN); // first head
+  signals.addLamp(1, 1, 2, 2, 4, LSS_YELLOW);
+  signals.addLamp(1, 1, 3, 2, 5, LSS_RED);
+  signals.addLamp(1, 2, 1, 2, 6, LSS_GREEN); // second head
+  signals.addLamp(1, 2, 2, 2, 7, LSS_YELLOW);
+  signals.addLamp(1, 2, 3, 2, 8, LSS_RED);
+  
+  // Map output bits to head colors: bit, mast, head, color
+  cmri.mapHead(0, 1, 1, LSS_GREEN);
+  cmri.mapHead(1, 1, 1, LSS_YELLOW);
+  cmri.mapHead(2, 1, 1, LSS_RED);
+  cmri.mapHead(3, 1, 2, LSS_GREEN);
+  cmri.mapHead(4, 1, 2, LSS_YELLOW);
+  cmri.mapHead(5, 1, 2, LSS_RED);
+  
+  // Map input bits to detector pins: bit, pin
+  cmri.mapInput(0, A0);
+  cmri.mapInput(1, A1);
+} // setup
+	
+// loop keeps the lamps lit and handles a few bytes of C/MRI traffic each time around.
+void loop() {
+  signals.updateSignals();
+  cmri.update();
+} // loop
@@ -0,0 +1,155 @@
+// Capacity Planner
+//
+// Compile and run this program with a Serial Monitor window open and it will report how
+// the library would run each of the layouts below on each of the boards below: the cycle
+// time, how long each LED is lit (and its share of the time), how often each LED is lit,
+// how close the flash rate comes to the rate asked for, and the SRAM the lamps take.
+// Anything likely to flicker or run late is flagged.
+//
+// No LEDs need to be wired, and the boards don't need to be the one it runs on: the
+// results come from linesideSignal::planCapacity, which uses the library's own timing code.
+//
+// Edit the boards and layouts to suit. For a board, the mode and write times are the
+// _modeTime and _writeTime that printTimes reports (enable LSS_DEBUG_REPORTING in the
+// library and run one of the other examples on it). The loop time is one trip around your
+// loop(), including the call to updateSignals. printTimes also reports the overhead it
+// measures, which is a good check on the estimate made here.
+//
+// A layout is a number of masts, each with the same number of heads and lamps per head.
+// One lamp per head is taken as lit, as for a signal showing an aspect.
+//
+// Warnings:
+//   flicker   - the cycle is long enough that LEDs may appear to flicker
+//   stretched - LEDs are down to LSS_LED_MIN, so the cycle is longer than asked for
+//   overrun   - LEDs are lit for less than one trip around loop(), so they stay lit late
+//   flash     - the flash rate is well off the rate asked for, or too fast to ramp
+//   too long  - the cycle is longer than the library allows
+//   sram      - the lamps won't leave room for much else
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+
+// microseconds of the library's own code each time it moves from one LED to the next,
+// at 16 MHz (it scales with the clock)
+#define CODE_TIME 60
+
+// board profiles: name, clock (MHz), mode time, write time, loop time (usec), SRAM (bytes)
+struct boardProfile {
+  const char *name;
+  int mhz;
+  int modeTime;
+  int writeTime;
+  int loopTime;
+  int sram;
+};
+
+boardProfile boards[] = {
+  { "Uno / Nano / Pro Mini 16 MHz", 16, 8, 8, 150, 2048 },
+  { "Pro Mini 8 MHz", 8, 16, 16, 300, 2048 },
+  { "ATmega168 8 MHz", 8, 16, 16, 300, 1024 }
+};
+
+// layouts: name, masts, heads per mast, lamps per head
+struct signalLayout {
+  const char *name;
+  int masts;
+  int heads;
+  int lamps;
+};
+
+signalLayout layouts[] = {
+  { "two 3-head masts", 2, 3, 3 },
+  { "three 3-head masts", 3, 3, 3 },
+  { "four 3-head masts", 4, 3, 3 },
+  { "six 2-head masts", 6, 2, 3 },
+  { "eight 1-head dwarfs", 8, 1, 3 }
+};
+
+// the cycle time and flash rate to plan for (as for setCycleTime and setFlashRate)
+int cycleTime = LSS_CYCLE_TIME;
+int flashRate = LSS_FLASH_FPM;
+
+// report one layout on one board
+void planLayout(boardProfile &board, signalLayout &layout) {
+  signalPlan plan;
+  int overhead;
+  int lit;
+  int total;
+
+  // estimate the time taken to change from one LED to the next: the old cathode is turned
+  // off and the new one on (a mode change and a write each), plus the library's own code
+  overhead = (2 * (board.modeTime + board.writeTime)) + ((CODE_TIME * 16) / board.mhz);
+  lit = layout.masts * layout.heads;
+  total = lit * layout.lamps;
+
+  linesideSignal::planCapacity(plan, total, lit, cycleTime, flashRate, overhead, board.loopTime);
+
+  Serial.print(F("  "));Serial.print(layout.name);
+  Serial.print(F(" (")); Serial.print(total);Serial.print(F(" lamps, "));
+  Serial.print(lit);Serial.println(F(" lit)"));
+
+  Serial.print(F("    cycle "));Serial.print(plan.cycleTime);
+  Serial.print(F(" usec, each LED "));Serial.print(plan.pulseTime);
+  Serial.print(F(" usec ("));Serial.print(plan.duty / 10);Serial.print(F("."));Serial.print(plan.duty % 10);
+  Serial.print(F("%), "));Serial.print(plan.refresh);Serial.println(F(" Hz"));
+
+  Serial.print(F("    flash "));
+  if (plan.flashPeriod > 0) {
+    Serial.print(60000000.0 / plan.flashPeriod, 1);
+    Serial.print(F(" FPM for ")); Serial.print(flashRate);
+    Serial.print(F(" ("));
+    if (plan.flashError >= 0) Serial.print(F("+"));
+    Serial.print(plan.flashError / 10.0, 1);Serial.print(F("%)"));
+  } else {
+    Serial.print(F("too fast to ramp"));
+  }
+  Serial.print(F(", SRAM "));Serial.print(plan.sram);
+  Serial.print(F(" of "));Serial.println(board.sram);
+
+  if ((plan.warnings != LSS_PLAN_OK) || (plan.sram > (board.sram / 2))) {
+    Serial.print(F("    warnings:"));
+    if (plan.warnings & LSS_PLAN_FLICKER) Serial.print(F(" flicker"));
+    if (plan.warnings & LSS_PLAN_STRETCHED) Serial.print(F(" stretched"));
+    if (plan.warnings & LSS_PLAN_OVERRUN) Serial.print(F(" overrun"));
+    if (plan.warnings & LSS_PLAN_FLASH) Serial.print(F(" flash"));
+    if (plan.warnings & LSS_PLAN_TOO_LONG) Serial.print(F(" too-long"));
+    if (plan.sram > (board.sram / 2)) Serial.print(F(" sram"));
+    Serial.println();
+  }
+} // planLayout
+
+// perform initialization - and report on every layout for every board
+void setup() {
+  int b, l;
+
+  delay(5000);          // give the user time to open the serial window
+  Serial.begin(9600);
+
+#if defined (__AVR_ATmega32U4__)
+  while(!Serial);        // For Leonardo, wait for serial port
+#endif
+
+  Serial.print(F("CapacityPlanner: cycle "));Serial.print(cycleTime);
+  Serial.print(F(" usec, flash "));Serial.print(flashRate);Serial.println(F(" FPM"));
+
+  for (b = 0; b < int(sizeof(boards) / sizeof(boards[0])); b++) {
+    Serial.println();
+    Serial.println(boards[b].name);
+    for (l = 0; l < int(sizeof(layouts) / sizeof(layouts[0])); l++) {
+      planLayout(boards[b], layouts[l]);
+    }
+  }
+
+} // setup
+
+void loop() {
+  // do nothing, forever
+} // loop
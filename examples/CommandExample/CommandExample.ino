@@ -0,0 +1,56 @@
+// Command Example
+//
+// Example controlling a three-head signal from the serial monitor (or another program).
+// Set the serial monitor to 115200 baud with "Newline" line endings, then type commands such as:
+//   H 1 1 3      (mast 1, head 1 green)
+//   H 1 2 2 1    (mast 1, head 2 flashing yellow)
+//   D 1 3        (mast 1, head 3 dark)
+//   Q 1 2        (what color is mast 1, head 2?)
+// See signalCommand.h for the full list, and for the binary form used by other programs.
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+#include "signalCommand.h"
+
+// create an instance of the signal, and a command reader attached to it and the serial port
+linesideSignal signals;
+signalCommand commands(signals, Serial);
+
+// perform initialization
+void setup() {   
+ 
+  Serial.begin(115200);
+  
+  signals.setupSignal();  // initialize the library
+     
+  // Define signals: mast, head, lamp, anode, cathode, color
+  signals.addLamp(1, 1, 1, 2, 3, LSS_GREEN); // first head
+  signals.addLamp(1, 1, 2, 2, 4, LSS_YELLOW);
+  signals.addLamp(1, 1, 3, 2, 5, LSS_RED);
+  signals.addLamp(1, 2, 1, 2, 6, LSS_GREEN); // second head
+  signals.addLamp(1, 2, 2, 2, 7, LSS_YELLOW);
+  signals.addLamp(1, 2, 3, 2, 8, LSS_RED);
+  signals.addLamp(1, 3, 1, 2, 9, LSS_GREEN); // third head
+  signals.addLamp(1, 3, 2, 2, 10, LSS_YELLOW);
+  signals.addLamp(1, 3, 3, 2, 11, LSS_RED);
+  
+  // start with stop showing
+  signals.setHeadColor(1, 1, LSS_RED);
+  signals.setHeadColor(1, 2, LSS_RED);
+  signals.setHeadColor(1, 3, LSS_RED);
+} // setup
+	
+// loop just keeps the lamps lit and reads a few bytes of any command each time around.
+// Never wait for a whole command to arrive in loop(), as the lamps will flicker while you wait.
+void loop() {
+  signals.updateSignals();
+  commands.update();
+} // loop
@@ -0,0 +1,52 @@
+// DCC Example
+//
+// Example setting a two-head signal from DCC. The track signal is connected through an 
+// opto-isolator to pin 2 (see any "Arduino DCC decoder" circuit).
+//
+// Head 1 follows extended accessory (signal) address 101: send aspect 1 for red, 2 for yellow,
+// 3 for green, or add 16 to flash. Head 2 follows turnout address 5: green when closed,
+// yellow when thrown.
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+#include "signalDCC.h"
+
+// create an instance of the signal, and a DCC decoder attached to it
+linesideSignal signals;
+signalDCC dcc(signals);
+
+// perform initialization
+void setup() {   
+ 
+  signals.setupSignal();  // initialize the library
+     
+  // Define signals: mast, head, lamp, anode, cathode, color
+  signals.addLamp(1, 1, 1, 3, 4, LSS_GREEN); // first head
+  signals.addLamp(1, 1, 2, 3, 5, LSS_YELLOW);
+  signals.addLamp(1, 1, 3, 3, 6, LSS_RED);
+  signals.addLamp(1, 2, 1, 3, 7, LSS_GREEN); // second head
+  signals.addLamp(1, 2, 2, 3, 8, LSS_YELLOW);
+  signals.addLamp(1, 2, 3, 3, 9, LSS_RED);
+  
+  // start with stop showing until we hear otherwise
+  signals.setHeadColor(1, 1, LSS_RED);
+  signals.setHeadColor(1, 2, LSS_RED);
+  
+  dcc.setupDCC(2);  // DCC input on pin 2
+  dcc.addAspect(101, 1, 1); // address, mast, head
+  dcc.addAccessory(5, 1, 2, LSS_GREEN, LSS_YELLOW); // address, mast, head, closed color, thrown color
+} // setup
+	
+// loop keeps the lamps lit and acts on one DCC packet (if any have arrived) each time around.
+void loop() {
+  signals.updateSignals();
+  dcc.update();
+} // loop
@@ -0,0 +1,128 @@
+// Dual Core Example
+//
+// Gives one core of a dual-core board over to the LEDs, so nothing the rest of the sketch does
+// (printing, networking, long calculations) can make them flicker. The LED core does nothing but
+// call updateSignals. The other core runs the sketch, which changes the signals with queueCommand
+// and sees what they show with readState; neither ever waits for the other.
+//
+// Uncomment both LSS_USE_QUEUE and LSS_USE_SNAPSHOT in linesideSignal.h before running this.
+// Uncomment LSS_DEBUG_REPORTING as well for the printTimes report: how long commands take to get
+// from one core to the other (queue latency), and how evenly the LED core goes round (the cycle
+// times). Its figures are read without stopping the LED core, so may now and then be garbled.
+//
+// This is written for the RP2040 (Raspberry Pi Pico, with the Earle Philhower core), where
+// setup1 and loop1 run on the second core, and for the ESP32, where the LEDs get a task of their
+// own on core 0 (loop runs on core 1).
+//
+// Signals are the first mast of SignalExample. Every 3 seconds the top head steps to the next
+// aspect, and every second the lit lamps are printed.
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+
+// create an instance of the signal
+linesideSignal signals;
+
+volatile boolean ready = false;	// set once the lamps are added, and the LED core can start
+
+byte aspect = 0;			// the aspect shown by the top head
+unsigned long lastStep = 0;	// millis() of the last change of aspect
+unsigned long lastPrint = 0;	// millis() the lamps were last printed
+
+// the LED core: nothing but updateSignals, as fast as it will go
+#if defined(ARDUINO_ARCH_RP2040)
+void setup1() {
+  while (!ready) ; // the lamps are added by setup, on the other core
+} // setup1
+
+void loop1() {
+  signals.updateSignals();
+} // loop1
+#elif defined(ESP32)
+void ledTask(void *unused) {
+  for (;;) signals.updateSignals(); // never gives the core up, see disableCore0WDT in setup
+} // ledTask
+#else
+#error "This example is for the RP2040 or the ESP32"
+#endif
+
+// queue a change of head color for the LED core
+void queueHead(byte mast, byte head, byte color) {
+  byte args[4];
+
+  args[0] = mast;
+  args[1] = head;
+  args[2] = color;
+  args[3] = 0; // not flashing
+  if (!signals.queueCommand(LSS_CMD_HEAD, args, 4)) Serial.println(F("queue full"));
+} // queueHead
+
+// print the lamps the LED core is showing
+void printLamps() {
+  byte state[LSS_SNAPSHOT_BYTES];
+  int len;
+  int n;
+
+  len = signals.readState(state, sizeof(state));
+  Serial.print(millis());Serial.print(F(": lit"));
+  for (n = 0; n < len; n += LSS_STATE_RECORD) { // mast, head, lamp, flags
+    Serial.print(' ');Serial.print(state[n]);Serial.print('/');Serial.print(state[n + 1]);Serial.print('/');Serial.print(state[n + 2]);
+    if (state[n + 3] & LSS_STATE_FLASH) Serial.print('*');
+  }
+  Serial.println();
+} // printLamps
+
+// perform initialization
+void setup() {
+
+  Serial.begin(115200);
+
+  signals.setupSignal();  // initialize the library
+
+  // Define signals: mast, head, lamp, anode, cathode, color
+  signals.addLamp(1, 1, 1, 2, 3, LSS_GREEN); // first mast, first head
+  signals.addLamp(1, 1, 2, 2, 4, LSS_YELLOW);
+  signals.addLamp(1, 1, 3, 2, 5, LSS_RED);
+  signals.addLamp(1, 2, 1, 2, 6, LSS_GREEN); // first mast, second head
+  signals.addLamp(1, 2, 2, 2, 7, LSS_YELLOW);
+  signals.addLamp(1, 2, 3, 2, 8, LSS_RED);
+  signals.addLamp(1, 3, 1, 2, 9, LSS_GREEN); // first mast, third head
+  signals.addLamp(1, 3, 2, 2, 10, LSS_YELLOW);
+  signals.addLamp(1, 3, 3, 2, 11, LSS_RED);
+
+  // Set initial color: mast, head, color (updateSignals isn't running yet, so no need to queue these)
+  signals.setHeadColor(1, 1, LSS_RED);
+  signals.setHeadColor(1, 2, LSS_RED);
+  signals.setHeadColor(1, 3, LSS_RED);
+
+  // from here on, only queueCommand, readState and printTimes are used on this core
+  ready = true;
+#if defined(ESP32)
+  disableCore0WDT(); // the LED task keeps core 0 busy, so its idle task never gets to feed the watchdog
+  xTaskCreatePinnedToCore(ledTask, "leds", 4096, NULL, 1, NULL, 0);
+#endif
+} // setup
+
+void loop() {
+  const byte colors[] = { LSS_RED, LSS_YELLOW, LSS_GREEN, LSS_YELLOW };
+
+  if ((millis() - lastStep) >= 3000) {
+    lastStep = millis();
+    aspect = (aspect + 1) % 4;
+    queueHead(1, 1, colors[aspect]);
+  }
+
+  if ((millis() - lastPrint) >= 1000) {
+    lastPrint = millis();
+    printLamps();
+    signals.printTimes(); // with LSS_DEBUG_REPORTING
+  }
+} // loop
@@ -0,0 +1,100 @@
+// Effect Example
+//
+// Shows keyframe effects, played in place of the usual ramp as lamps light and go out: a
+// searchlight's roundel bouncing as it settles on a new aspect, incandescent bulbs warming up
+// and cooling down, and the contacts of a flasher relay bouncing at the start of each flash.
+//
+// Uncomment LSS_USE_EFFECTS in linesideSignal.h before running this. Without it, setEffect does
+// nothing and the lamps simply ramp.
+//
+// Each effect is a table of keyframes kept in PROGMEM: a level (LSS_FX_OFF, LSS_FX_LOW,
+// LSS_FX_QUARTER, LSS_FX_HALF or LSS_FX_FULL) and how many steps to hold it, ending with
+// LSS_FX_END. A step is a quarter of a ramp division, 25 milliseconds at the default 60 FPM. When
+// an effect ends the ramp takes over again, so a rise should last at least the ramp's 12 steps.
+//
+// Signals are the first mast of SignalExample: the top head is the searchlight, the middle
+// head has incandescent bulbs, and the bottom head's red flashes from a relay (without the ramp).
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+
+// the searchlight's roundel swings past the new color and back a few times before it settles
+const byte bounce[] PROGMEM = {
+  LSS_FX_FULL, 2, LSS_FX_LOW, 1, LSS_FX_FULL, 2, LSS_FX_QUARTER, 1,
+  LSS_FX_FULL, 2, LSS_FX_HALF, 1, LSS_FX_FULL, 3, LSS_FX_END
+};
+
+// a bulb's filament glows dull red, then brightens, taking a little longer than the ramp
+const byte warmUp[] PROGMEM = {
+  LSS_FX_LOW, 3, LSS_FX_QUARTER, 3, LSS_FX_HALF, 4, LSS_FX_FULL, 2, LSS_FX_END
+};
+
+// and fades as it cools, with a dull glow at the end
+const byte coolDown[] PROGMEM = {
+  LSS_FX_HALF, 2, LSS_FX_QUARTER, 3, LSS_FX_LOW, 7, LSS_FX_END
+};
+
+// the relay contacts bounce as they close
+const byte relayClose[] PROGMEM = {
+  LSS_FX_FULL, 1, LSS_FX_OFF, 1, LSS_FX_FULL, 1, LSS_FX_LOW, 1, LSS_FX_FULL, 2, LSS_FX_END
+};
+
+byte aspect = 0;	// the aspect shown by the top two heads
+
+// create an instance of the signal
+linesideSignal signals;
+
+// change the aspect of the top two heads
+// This is a task, called by updateSignals every 4 seconds (see addTask in setup).
+void nextAspect() {
+  const byte colors[] = { LSS_RED, LSS_YELLOW, LSS_GREEN, LSS_YELLOW };
+
+  aspect = (aspect + 1) % 4;
+  signals.setHeadColor(1, 1, colors[aspect]);
+  signals.setHeadColor(1, 2, colors[(aspect + 2) % 4]);
+} // nextAspect
+
+// perform initialization
+void setup() {
+  byte lamp;
+
+  signals.setupSignal();  // initialize the library
+
+  // Define signals: mast, head, lamp, anode, cathode, color
+  signals.addLamp(1, 1, 1, 2, 3, LSS_GREEN); // first mast, first head
+  signals.addLamp(1, 1, 2, 2, 4, LSS_YELLOW);
+  signals.addLamp(1, 1, 3, 2, 5, LSS_RED);
+  signals.addLamp(1, 2, 1, 2, 6, LSS_GREEN); // first mast, second head
+  signals.addLamp(1, 2, 2, 2, 7, LSS_YELLOW);
+  signals.addLamp(1, 2, 3, 2, 8, LSS_RED);
+  signals.addLamp(1, 3, 1, 2, 9, LSS_GREEN); // first mast, third head
+  signals.addLamp(1, 3, 2, 2, 10, LSS_YELLOW);
+  signals.addLamp(1, 3, 3, 2, 11, LSS_RED);
+
+  // Give the lamps their effects: mast, head, lamp, rise, fall (NULL leaves it to the ramp)
+  for (lamp = 1; lamp <= 3; lamp++) {
+    signals.setEffect(1, 1, lamp, bounce, NULL); // the searchlight goes out as usual
+    signals.setEffect(1, 2, lamp, warmUp, coolDown);
+  }
+  signals.setRamp(1, 3, 3, false); // a relay switches the lamp hard on and off
+  signals.setEffect(1, 3, 3, relayClose, NULL);
+
+  // Set initial color: mast, head, color
+  signals.setHeadColor(1, 1, LSS_RED);
+  signals.setHeadColor(1, 2, LSS_GREEN);
+  signals.setHeadColor(1, 3, LSS_RED, true);
+
+  signals.addTask(nextAspect, 4000L, 100);
+} // setup
+
+void loop() {
+  signals.updateSignals();  // update LED states (and change the aspect)
+} // loop
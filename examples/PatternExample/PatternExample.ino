@@ -0,0 +1,70 @@
+// Pattern Example
+//
+// Drives the LEDs from a timer interrupt rather than from loop(), so the LED timing doesn't depend
+// on how long the rest of the sketch takes. updateSignals is still called from loop(), but only to
+// keep the pattern of lit LEDs up to date (and to run tasks); the interrupt plays it out.
+//
+// Uncomment LSS_USE_PATTERN in linesideSignal.h before running this. The patterns take over a
+// kilobyte of SRAM, so this is meant for 32-bit boards. This is written for a Teensy (3.x or 4.x),
+// using its IntervalTimer. On other boards, use whatever calls a function at a fixed interval:
+// for example a TimerInterrupt or TimerOne library, or the hardware timer API of an ESP32 or
+// RP2040 core. Call usePattern before starting the timer.
+//
+// Signals are the first mast of SignalExample, with the top head flashing.
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+
+#define TICK 25		// microseconds between calls to playPattern
+
+// create an instance of the signal
+linesideSignal signals;
+
+// the timer
+IntervalTimer ledTimer;
+
+// called from the timer interrupt every TICK microseconds
+void playLEDs() {
+  signals.playPattern();
+} // playLEDs
+
+// perform initialization
+void setup() {
+
+  signals.setupSignal();  // initialize the library
+
+  // Define signals: mast, head, lamp, anode, cathode, color
+  signals.addLamp(1, 1, 1, 2, 3, LSS_GREEN); // first mast, first head
+  signals.addLamp(1, 1, 2, 2, 4, LSS_YELLOW);
+  signals.addLamp(1, 1, 3, 2, 5, LSS_RED);
+  signals.addLamp(1, 2, 1, 2, 6, LSS_GREEN); // first mast, second head
+  signals.addLamp(1, 2, 2, 2, 7, LSS_YELLOW);
+  signals.addLamp(1, 2, 3, 2, 8, LSS_RED);
+  signals.addLamp(1, 3, 1, 2, 9, LSS_GREEN); // first mast, third head
+  signals.addLamp(1, 3, 2, 2, 10, LSS_YELLOW);
+  signals.addLamp(1, 3, 3, 2, 11, LSS_RED);
+
+  // Set initial color: mast, head, color
+  signals.setHeadColor(1, 1, LSS_YELLOW, true);
+  signals.setHeadColor(1, 2, LSS_RED);
+  signals.setHeadColor(1, 3, LSS_RED);
+
+  signals.updateSignals(); // let the library discharge the new pins first
+
+  signals.usePattern(TICK);
+  ledTimer.begin(playLEDs, TICK);
+} // setup
+
+void loop() {
+  signals.updateSignals();  // keep the pattern up to date
+
+  // the rest of the sketch can take its time here; the LEDs won't flicker
+} // loop
@@ -0,0 +1,67 @@
+// Queue Example
+//
+// Changes a signal from an interrupt: a detector on pin 2 turns the signal red the moment a
+// train enters the block, and back to green when it leaves. The interrupt can't call
+// setHeadColor itself, since updateSignals may be part way through the lamps when it arrives,
+// so it queues the command with queueCommand and updateSignals carries it out when a LED's slot
+// has time to spare.
+//
+// Uncomment LSS_USE_QUEUE in linesideSignal.h before running this. Without it, queueCommand
+// always returns false and the signal stays green.
+//
+// The same works from the other core of a dual-core board (ESP32 or RP2040): one core, and only
+// one, queues commands while the other runs updateSignals.
+//
+// Uses a three-lamp head with common anode on pin 4 and cathodes on 5 (green), 6 (yellow) and
+// 7 (red), and a detector that pulls pin 2 LOW while the block is occupied.
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+
+#define DETECTOR 2	// detector input (an interrupt pin), LOW while occupied
+
+// create an instance of the signal
+linesideSignal signals;
+
+volatile unsigned int dropped = 0;	// commands the queue had no room for
+
+// called from the interrupt whenever the detector changes
+void detectorChanged() {
+  byte args[4];
+
+  args[0] = 1; // mast
+  args[1] = 1; // head
+  args[2] = (digitalRead(DETECTOR) == LOW) ? LSS_RED : LSS_GREEN;
+  args[3] = 0; // not flashing
+  if (!signals.queueCommand(LSS_CMD_HEAD, args, 4)) dropped++;
+} // detectorChanged
+
+// perform initialization
+void setup() {
+
+  signals.setupSignal();  // initialize the library
+
+  // Define signals: mast, head, lamp, anode, cathode, color
+  signals.addLamp(1, 1, 1, 4, 5, LSS_GREEN);
+  signals.addLamp(1, 1, 2, 4, 6, LSS_YELLOW);
+  signals.addLamp(1, 1, 3, 4, 7, LSS_RED);
+
+  pinMode(DETECTOR, INPUT_PULLUP);
+
+  // Set initial color: mast, head, color
+  signals.setHeadColor(1, 1, (digitalRead(DETECTOR) == LOW) ? LSS_RED : LSS_GREEN);
+
+  attachInterrupt(digitalPinToInterrupt(DETECTOR), detectorChanged, CHANGE);
+} // setup
+
+void loop() {
+  signals.updateSignals();  // update LED states (and carry out queued commands)
+} // loop
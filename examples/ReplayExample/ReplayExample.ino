@@ -0,0 +1,136 @@
+// Replay Example
+//
+// Records a minute of signal changes, then plays them back over and over with the same timing,
+// so the same session can be repeated exactly: for comparing the timing figures of printTimes
+// between changes to a sketch or the library, or to watch the same sequence of aspects again.
+//
+// The session here is made up by a task standing in for trains: every so often a "train" passes
+// the signals, dropping each head to red in turn and then clearing it back through yellow to
+// green, with quiet spells in between. In a real sketch the calls would come from detectors,
+// a panel or a computer, and would be recorded in just the same way.
+//
+// The recording is printed in hex once it's made, so it can be saved, or copied from the serial
+// monitor into a file for extras/host/replayTool, which replays it on a simulated clock (a
+// session of hours in seconds) and reports its timing.
+//
+// Uncomment LSS_USE_RECORD in linesideSignal.h before running this (and LSS_DEBUG_REPORTING too,
+// for printTimes to have something to say).
+//
+// Signals are the first mast of SignalExample.
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+
+#define SESSION 60000L	// milliseconds to record
+#define LOG_BYTES 400	// room for the recording (8 or 9 bytes a call)
+
+// create an instance of the signal
+linesideSignal signals;
+
+byte recording[LOG_BYTES];
+int recorded = 0;			// bytes recorded, once it has finished
+byte trainHead = 0;			// the head the train has reached, or 0 for none
+byte trainTask = LSS_NO_TASK;	// the task moving it
+byte newTrainTask = LSS_NO_TASK;	// the task bringing trains along
+long replays = 0;			// times the recording has been played back
+
+// the train moves on: the head it has passed clears to yellow, and the next drops to red
+// This is a task, called by updateSignals every 2 seconds while a train is passing.
+void moveTrain() {
+  if (trainHead > 0) signals.setHeadColor(1, trainHead, LSS_YELLOW);
+  if (trainHead > 1) signals.setHeadColor(1, trainHead - 1, LSS_GREEN);
+  if (trainHead < 3) {
+    trainHead++;
+    signals.setHeadColor(1, trainHead, LSS_RED);
+  } else { // gone
+    signals.setHeadColor(1, trainHead, LSS_GREEN);
+    trainHead = 0;
+    signals.cancelTask(trainTask);
+  }
+} // moveTrain
+
+// a train comes along, if there isn't one already
+// This is a task, called by updateSignals every 15 seconds while recording.
+void newTrain() {
+  if (trainHead == 0) trainTask = signals.addTask(moveTrain, 2000L, 300);
+} // newTrain
+
+// print the recording, in hex
+void printRecording() {
+  int n;
+
+  Serial.print(F("recorded "));Serial.print(recorded);Serial.println(F(" bytes:"));
+  for (n = 0; n < recorded; n++) {
+    if (recording[n] < 0x10) Serial.print('0');
+    Serial.print(recording[n], HEX);
+    Serial.print(((n % 16) == 15) ? '\n' : ' ');
+  }
+  Serial.println();
+} // printRecording
+
+// put the heads back as they were when recording started, and play the recording
+void startReplay() {
+  signals.setHeadColor(1, 1, LSS_GREEN);
+  signals.setHeadColor(1, 2, LSS_GREEN);
+  signals.setHeadColor(1, 3, LSS_GREEN);
+  signals.replay(recording, recorded);
+} // startReplay
+
+// end the recording, and start playing it back
+// This is a task, run once by updateSignals when the session is over.
+void endSession() {
+  signals.cancelTask(newTrainTask); // no more trains, the recording brings them from now on
+  signals.cancelTask(trainTask);
+  trainHead = 0;
+  recorded = signals.stopRecord();
+  printRecording();
+  startReplay();
+} // endSession
+
+// perform initialization
+void setup() {
+
+  Serial.begin(115200);
+
+  signals.setupSignal();  // initialize the library
+
+  // Define signals: mast, head, lamp, anode, cathode, color
+  signals.addLamp(1, 1, 1, 2, 3, LSS_GREEN); // first mast, first head
+  signals.addLamp(1, 1, 2, 2, 4, LSS_YELLOW);
+  signals.addLamp(1, 1, 3, 2, 5, LSS_RED);
+  signals.addLamp(1, 2, 1, 2, 6, LSS_GREEN); // first mast, second head
+  signals.addLamp(1, 2, 2, 2, 7, LSS_YELLOW);
+  signals.addLamp(1, 2, 3, 2, 8, LSS_RED);
+  signals.addLamp(1, 3, 1, 2, 9, LSS_GREEN); // first mast, third head
+  signals.addLamp(1, 3, 2, 2, 10, LSS_YELLOW);
+  signals.addLamp(1, 3, 3, 2, 11, LSS_RED);
+
+  // Set initial color: mast, head, color
+  signals.setHeadColor(1, 1, LSS_GREEN);
+  signals.setHeadColor(1, 2, LSS_GREEN);
+  signals.setHeadColor(1, 3, LSS_GREEN);
+
+  signals.startRecord(recording, LOG_BYTES); // from here on
+
+  newTrainTask = signals.addTask(newTrain, 15000L, 100);
+  signals.addTask(endSession, SESSION, 2000, false); // once
+} // setup
+
+void loop() {
+  signals.updateSignals();  // update LED states (and make the changes, or replay them)
+
+  if ((recorded > 0) && !signals.isReplaying()) { // a playback has finished
+    replays++;
+    Serial.print(F("replay "));Serial.print(replays);Serial.println(F(" done"));
+    signals.printTimes(); // the timing of that session, with LSS_DEBUG_REPORTING
+    startReplay(); // and again
+  }
+} // loop
@@ -16,10 +16,37 @@
 // create an instance of the signal
 linesideSignal signals;
 
-long lastChange = 0; // time recorded for the prior change 
-long timeToWait = 10000L; // start with them lit for 10 seconds
 int nextColor = 1;
 
+// change the top head color on the first two masts
+// This is a task, called by updateSignals every 10 seconds (see addTask in setup), so we don't
+// need to keep track of the time ourselves.
+void changeColors() {
+  switch (nextColor) {
+    case 0:
+      signals.setHeadColor(1, 1, LSS_GREEN);
+      signals.setHeadColor(2, 1, LSS_RED);
+      nextColor = 1;
+    break;
+
+    case 1:
+      signals.setHeadColor(1, 1, LSS_RED);
+      signals.setHeadColor(2, 1, LSS_GREEN);
+      nextColor = 2;
+    break;
+    
+    case 2:
+      signals.setHeadColor(1, 1, LSS_YELLOW);
+      signals.setHeadColor(2, 1, LSS_YELLOW);
+      nextColor = 0;
+    break;
+    
+    default:
+      nextColor = 0;
+    break;
+  } // switch
+} // changeColors
+
 // perform initialization
 void setup() {   
  
@@ -68,45 +95,16 @@ void setup() {
   signals.setHeadColor(3, 1, LSS_GREEN);
   signals.setHeadColor(3, 2, LSS_YELLOW);
   signals.setHeadColor(3, 3, LSS_RED);
+  
+  // change colors every 10 seconds (10000 milliseconds); the task takes under 200 microseconds
+  signals.addTask(changeColors, 10000L, 200);
 } // setup
 	
 // loop continues cycling, although most times around nothing happens except the call to updateSignals, which quickly returns
 // periodically, updateSignals will do a little extra work to change to the next LED in its list of lit ones.  With nine LEDs
 // lit, that's roughly every quarter millisecond.
 //
-// At very long interfaces (tens of thousands of cycles) the switch will be executed to change which LEDs should be lit.
+// At very long intervals (every ten seconds) updateSignals also runs the changeColors task, when the lit LED has time to spare.
 void loop() {
-  long thisLoop; // temporary time stamp for current time
-		
-  signals.updateSignals();  // update LED states if required
-		
-  thisLoop = long(millis());
-  if ((thisLoop - lastChange) > timeToWait) { // every N seconds (roughly) change top head color on firs two masts masts
-    lastChange = thisLoop;
-  
-    switch (nextColor) {
-      case 0:
-        signals.setHeadColor(1, 1, LSS_GREEN);
-        signals.setHeadColor(2, 1, LSS_RED);
-        nextColor = 1;
-      break;
-
-      case 1:
-        signals.setHeadColor(1, 1, LSS_RED);
-        signals.setHeadColor(2, 1, LSS_GREEN);
-        nextColor = 2;
-      break;
-      
-      case 2:
-        signals.setHeadColor(1, 1, LSS_YELLOW);
-        signals.setHeadColor(2, 1, LSS_YELLOW);
-        nextColor = 0;
-      break;
-      
-      default:
-        nextColor = 0;
-      break;
-    } // switch
-  } // if time to do something
+  signals.updateSignals();  // update LED states if required (and run any tasks that are due)
 } // loop
-
@@ -0,0 +1,182 @@
+// Trace Example
+//
+// Records what the library does with the LED pins and prints it as a VCD (value change dump)
+// file, to be viewed as a waveform in GTKWave or a similar viewer. This shows the charlieplex
+// timing directly: each anode and cathode pin (HIGH, LOW or Z, as LSS_PIN_HIGH, LSS_PIN_GROUND
+// and LSS_PIN_Z), plus markers for the LED whose slot it is, the ramp division, and the number
+// of lamps lit.
+//
+// The events are recorded with setTrace. Printing is far slower than the events arrive, so they
+// are kept in a buffer while the signals run and printed once it is full (the LEDs stop changing
+// while it prints, and one may stay lit). A capture starts 3 seconds after startup, just after
+// the top head changes color, so it catches the ramp. Copy everything from "$date" to the end of
+// the Serial Monitor into a file named something like trace.vcd, and open that in the viewer.
+//
+// The buffer holds CAPTURE_EVENTS events, about 30 milliseconds with these signals. Each event
+// takes 5 bytes, so keep this modest, particularly with a large number of lamps.
+//
+// This uses the same wiring as SignalExample, but only its first mast.
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+
+#define CAPTURE_EVENTS 200	// events recorded in one capture
+#define FIRST_PIN 2			// lowest pin used by the signals
+#define LAST_PIN 11			// highest pin used by the signals
+
+// create an instance of the signal
+linesideSignal signals;
+
+// one recorded event, as passed to the trace function, with the microseconds since the last one
+struct traceEvent {
+  unsigned int delta;
+  byte event;
+  byte arg1;
+  byte arg2;
+};
+
+traceEvent events[CAPTURE_EVENTS];
+int eventCount = 0;
+unsigned long lastStamp = 0;
+boolean printed = false;
+
+// record one event - called by the library from inside updateSignals, so it must be quick
+void recordEvent(byte event, byte arg1, byte arg2) {
+  unsigned long now = micros();
+
+  if (eventCount >= CAPTURE_EVENTS) return; // full, and waiting to be printed
+  if (eventCount == 0) lastStamp = now; // the first event is at time 0
+  events[eventCount].delta = (unsigned int)(now - lastStamp);
+  events[eventCount].event = event;
+  events[eventCount].arg1 = arg1;
+  events[eventCount].arg2 = arg2;
+  lastStamp = now;
+  eventCount++;
+} // recordEvent
+
+// start a capture, just after changing the top head so the ramp shows
+// This is a task, run once by updateSignals 3 seconds after startup (see addTask in setup).
+void startCapture() {
+  signals.setHeadColor(1, 1, LSS_GREEN);
+  eventCount = 0;
+  signals.setTrace(recordEvent);
+} // startCapture
+
+// the VCD identifier of a pin (a single printable character)
+char pinId(byte pin) {
+  return char('A' + pin);
+} // pinId
+
+// print a number as a VCD vector value of a marker
+void printVector(byte value, char id) {
+  int bit;
+
+  Serial.print('b');
+  for (bit = 7; bit >= 0; bit--) Serial.print(((value >> bit) & 1) ? '1' : '0');
+  Serial.print(' ');Serial.println(id);
+} // printVector
+
+// print the capture as a VCD file
+void printCapture() {
+  int i;
+  byte pin;
+  unsigned long stamp;
+
+  Serial.println(F("$date linesideSignal capture $end"));
+  Serial.println(F("$timescale 1us $end"));
+  Serial.println(F("$scope module linesideSignal $end"));
+  for (pin = FIRST_PIN; pin <= LAST_PIN; pin++) {
+    Serial.print(F("$var wire 1 "));Serial.print(pinId(pin));Serial.print(F(" pin"));Serial.print(pin);Serial.println(F(" $end"));
+  }
+  Serial.println(F("$var wire 8 ! slot_anode $end"));
+  Serial.println(F("$var wire 8 \" slot_cathode $end"));
+  Serial.println(F("$var wire 8 # division $end"));
+  Serial.println(F("$var wire 8 $ lamps_lit $end"));
+  Serial.println(F("$upscope $end"));
+  Serial.println(F("$enddefinitions $end"));
+
+  // unknown until the first change is seen
+  Serial.println(F("#0"));
+  Serial.println(F("$dumpvars"));
+  for (pin = FIRST_PIN; pin <= LAST_PIN; pin++) {
+    Serial.print('x');Serial.println(pinId(pin));
+  }
+  Serial.println(F("bx !"));
+  Serial.println(F("bx \""));
+  Serial.println(F("bx #"));
+  Serial.println(F("bx $"));
+  Serial.println(F("$end"));
+
+  stamp = 0;
+  for (i = 0; i < eventCount; i++) {
+    if (events[i].delta != 0) { // a new time (events can share one, and the first is at #0)
+      stamp += events[i].delta;
+      Serial.print('#');Serial.println(stamp);
+    }
+    switch (events[i].event) {
+      case LSS_TRACE_PIN:
+        if (events[i].arg2 == LSS_PIN_HIGH) Serial.print('1');
+        else if (events[i].arg2 == LSS_PIN_GROUND) Serial.print('0');
+        else Serial.print('z');
+        Serial.println(pinId(events[i].arg1));
+      break;
+
+      case LSS_TRACE_SLOT:
+        printVector(events[i].arg1, '!');
+        printVector(events[i].arg2, '"');
+      break;
+
+      case LSS_TRACE_DIV:
+        printVector(events[i].arg1, '#');
+      break;
+
+      case LSS_TRACE_LAMPS:
+        printVector(events[i].arg1, '$');
+      break;
+    } // switch
+  } // for
+} // printCapture
+
+// perform initialization
+void setup() {
+
+  Serial.begin(115200);
+
+  signals.setupSignal();  // initialize the library
+
+  // Define signals: mast, head, lamp, anode, cathode, color
+  signals.addLamp(1, 1, 1, 2, 3, LSS_GREEN); // first mast, first head
+  signals.addLamp(1, 1, 2, 2, 4, LSS_YELLOW);
+  signals.addLamp(1, 1, 3, 2, 5, LSS_RED);
+  signals.addLamp(1, 2, 1, 2, 6, LSS_GREEN); // first mast, second head
+  signals.addLamp(1, 2, 2, 2, 7, LSS_YELLOW);
+  signals.addLamp(1, 2, 3, 2, 8, LSS_RED);
+  signals.addLamp(1, 3, 1, 2, 9, LSS_GREEN); // first mast, third head
+  signals.addLamp(1, 3, 2, 2, 10, LSS_YELLOW);
+  signals.addLamp(1, 3, 3, 2, 11, LSS_RED);
+
+  // Set initial color: mast, head, color
+  signals.setHeadColor(1, 1, LSS_RED);
+  signals.setHeadColor(1, 2, LSS_YELLOW);
+  signals.setHeadColor(1, 3, LSS_RED, true);
+
+  signals.addTask(startCapture, 3000L, 100, false); // once, after 3 seconds
+} // setup
+
+void loop() {
+  signals.updateSignals();  // update LED states (and start the capture)
+
+  if ((eventCount >= CAPTURE_EVENTS) && !printed) { // the capture is full, print it
+    signals.setTrace(NULL);
+    printCapture();
+    printed = true;
+  }
+} // loop
@@ -0,0 +1,110 @@
+// Verify Example
+//
+// Exercises the library with a stream of random lamp changes and reports what LSS_DEBUG_VERIFY
+// finds, for checking changes made to the library itself (to the ramp, the lamp flags or the
+// order lamps are visited in). The pins are checked on every call so that only the right LED
+// is ever lit, and the pin safety net is watched (with LSS_DEBUG_VERIFY a trip is counted and
+// the signals carry on, rather than halting, so it is reported here). Which LED should be lit
+// in each slot is checked on a PC, against a model of its own, by extras/host/diffTest.
+//
+// Uncomment LSS_DEBUG_VERIFY in linesideSignal.h before running this (and LSS_DEBUG_REPORTING too,
+// for printTimes to give the detail). Without it, getVerifyErrors always returns 0.
+//
+// The changes are random, but start from a fixed seed, so the same run can be repeated by using
+// the same seed (printed at the start). Change SEED for a different run. Anything other than
+// "errors=0" means the library lit the wrong LED, or the safety net tripped.
+//
+// Uses two masts of two three-lamp heads, common anode: pins 2 - 5 for the anodes and 6 - 11
+// for the cathodes (or run it with nothing wired).
+//
+// This Arduino sketch (program) is released to the public domain.
+//
+// This sketch is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+#include <Arduino.h>
+
+// include the library
+#include "linesideSignal.h"
+
+#define SEED 1	// random seed, the same seed gives the same changes
+
+// create an instance of the signal
+linesideSignal signals;
+
+long changes = 0;	// changes made so far
+
+// make one random change to a random lamp or head
+// This is a task, called by updateSignals every quarter second (see addTask in setup).
+void randomChange() {
+  byte mast = random(1, 3);
+  byte head = random(1, 3);
+  byte lamp = random(1, 4);
+
+  switch (random(7)) {
+    case 0:
+      signals.setHeadColor(mast, head, random(LSS_RED, LSS_GREEN + 1), (random(3) == 0));
+    break;
+
+    case 1:
+      signals.setLamp(mast, head, lamp, (random(2) == 0), (random(3) == 0));
+    break;
+
+    case 2:
+      signals.clearHead(mast, head);
+    break;
+
+    case 3:
+      signals.setAlternate(mast, head, lamp, (random(2) == 0));
+    break;
+
+    case 4:
+      signals.setRamp(mast, head, lamp, (random(4) != 0));
+    break;
+
+    case 5:
+      signals.setFlashRate(random(30, 150));
+    break;
+
+    default:
+      signals.setLampColor(mast, head, lamp, random(LSS_RED, LSS_GREEN + 1), (random(2) == 0));
+    break;
+  } // switch
+  changes++;
+} // randomChange
+
+// report the problems found so far
+// This is a task too, called every 10 seconds.
+void report() {
+  Serial.print(F("changes="));Serial.print(changes);
+  Serial.print(F(", errors="));Serial.println(signals.getVerifyErrors());
+  signals.printTimes(); // the detail, with LSS_DEBUG_REPORTING
+} // report
+
+// perform initialization
+void setup() {
+  byte mast, head, lamp;
+
+  Serial.begin(9600);
+  Serial.print(F("VerifyExample: seed="));Serial.println(SEED);
+  randomSeed(SEED);
+
+  signals.setupSignal();  // initialize the library
+
+  // Define signals: mast, head, lamp, anode, cathode, color (lamp 1 red, 2 yellow, 3 green)
+  for (mast = 1; mast <= 2; mast++) {
+    for (head = 1; head <= 2; head++) {
+      for (lamp = 1; lamp <= 3; lamp++) {
+        signals.addLamp(mast, head, lamp, 2 + ((mast - 1) * 2) + (head - 1), 5 + lamp + ((mast - 1) * 3), lamp);
+      }
+    }
+  }
+
+  signals.addTask(randomChange, 250L, 200);
+  signals.addTask(report, 10000L, 500);
+} // setup
+
+void loop() {
+  signals.updateSignals();  // update LED states (and make the changes)
+} // loop
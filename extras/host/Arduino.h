@@ -0,0 +1,265 @@
+/*  Arduino.h (host)
+	Just enough of the Arduino core to build linesideSignal and its companion classes on a PC,
+	for the test and measurement programs in extras/host (see the Makefile there).
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    Released into the public domain.
+
+    Each simulated Arduino is a hostBoard, with its own microsecond clock, pins, serial port
+    and EEPROM. The Arduino functions act on the board made current on the calling thread (see
+    hostBoard::use), so a program can run several boards, each on whichever thread steps it.
+
+    The clock is simulated. It only moves when something is done that takes time on a 16 MHz
+    AVR (the HOST_COST_ times below), or when the program moves it on with advance() to stand
+    for the rest of the sketch's loop(). The same run therefore gives the same results on any
+    PC, however busy. A board can instead follow the PC's own clock (realTime), for the tests
+    that run two threads against each other.
+*/
+
+#ifndef	Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// an Uno's pins: 0 - 13 digital, A0 - A7 analog (A6 and A7 are analog only on a Nano)
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define NUM_DIGITAL_PINS 20
+#define NUM_ANALOG_INPUTS 8
+#define F_CPU 16000000L
+#define ARDUINO 10600
+#define digitalPinToInterrupt(p) (p)
+#define _BV(bit) (1 << (bit))
+
+// there is no flash memory, tables stay in RAM
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p) (*(void * const *)(p))
+
+// HOST_PINS = pins on each board (enough for a Mega, and the LSS_NOT_PIN checks)
+// HOST_RX = bytes of serial input a board can have waiting
+// HOST_EEPROM = bytes of EEPROM on each board (as an Uno)
+// HOST_SERIAL_BUFFER = bytes the Arduino's serial port holds until read (see transmit)
+#define HOST_PINS 80
+#define HOST_RX 4096
+#define HOST_EEPROM 1024
+#define HOST_SERIAL_BUFFER 64
+
+// simulated time taken by each call on a 16 MHz AVR, in microseconds (measured on an Uno):
+// HOST_COST_MICROS = micros() or millis(), which stop interrupts to read the timer
+// HOST_COST_PIN = pinMode or digitalWrite, with the pin lookups
+// HOST_COST_ANALOG = analogRead, which waits for the conversion (13 ADC clocks at 125 kHz)
+// HOST_TIMER1_QUARTERS = quarter microseconds to read TCNT1 (a few instructions)
+#define HOST_COST_MICROS 4
+#define HOST_COST_PIN 4
+#define HOST_COST_ANALOG 110
+#define HOST_TIMER1_QUARTERS 1
+
+// hostBoard
+// One simulated Arduino.
+//
+// The fields are public so test programs can set up inputs (input, analog, the serial port)
+// and look at outputs (mode and level of each pin, the serial output, the counts of calls).
+//
+class hostBoard
+{
+  public:
+	unsigned long us;		// the simulated clock, in microseconds (what micros() returns)
+	int quarters;			// and quarter microseconds, for the cheaper calls
+	boolean realTime;		// follow the PC's clock instead (see setRealTime)
+	boolean costs;			// charge the HOST_COST_ times for each call (true unless realTime)
+
+	byte mode[HOST_PINS];	// INPUT, OUTPUT or INPUT_PULLUP
+	byte level[HOST_PINS];	// HIGH or LOW as last written
+	byte input[HOST_PINS];	// what digitalRead returns for a pin that isn't an output
+	int analog[HOST_PINS];	// what analogRead returns (0 - 1023)
+	void (*pinHook)(hostBoard *board, byte pin);	// called after each pinMode and digitalWrite, or NULL
+	void (*interrupt[HOST_PINS])();	// routines given to attachInterrupt
+	boolean interruptsOn;	// false between noInterrupts and interrupts
+
+	// a signal on one input pin (see setEdges): at each edge the pin changes and its
+	// attachInterrupt routine is called, taking its time from whatever it interrupted
+	byte edgePin;
+	const unsigned long *edges;	// times of the edges, in order
+	long edgeCount;
+	long nextEdge;			// the next to come
+	unsigned long lateEdges;	// edges whose routine ran late, as interrupts were off
+	unsigned long worstLate;	// the latest of them, in microseconds
+	boolean inInterrupt;	// an interrupt routine is running
+
+	// counts of calls (not kept for a realTime board, which may be used from several threads)
+	unsigned long microsCalls;	// micros() and millis()
+	unsigned long timer1Reads;	// reads of TCNT1
+	unsigned long pinModes;
+	unsigned long pinWrites;
+	unsigned long analogReads;
+	unsigned long delayed;		// microseconds spent in delay and delayMicroseconds
+
+	// the serial port
+	byte rx[HOST_RX];		// input waiting to be read, from rxTail up to rxHead
+	int rxHead;
+	int rxTail;
+	std::string output;		// everything written to it (see takeOutput)
+	boolean echo;			// copy the output to the PC's standard output as well
+	unsigned long baud;		// line speed for transmit
+	std::string line;		// bytes given to transmit, still on their way
+	unsigned long lineDue;	// when the first of them arrives
+	int rxMost;				// most bytes ever waiting to be read, from transmit
+	unsigned long rxLost;	// bytes transmit lost, as more than HOST_SERIAL_BUFFER were waiting
+
+	byte eeprom[HOST_EEPROM];
+
+	// Timer1 registers (for LSS_USE_TIMER1), counting at 2 MHz from the simulated clock
+	byte tccr1a;
+	byte tccr1b;
+	byte timsk1;
+
+	unsigned long randomState;	// for random(), so each board's numbers don't depend on the others
+
+	void *user;				// for the program's own use
+
+	hostBoard();
+	void use();
+	static hostBoard *current();
+	void setRealTime(boolean on);
+	unsigned long now();
+	void advance(unsigned long usec);
+	void charge(int usec);
+	void setEdges(byte pin, const unsigned long *times, long count);
+	void runTo(unsigned long target);
+	void send(const char *text);
+	void send(const byte *data, int len);
+	void transmit(const char *text);
+	void transmit(const byte *data, int len);
+	void deliver();
+	std::string takeOutput();
+	boolean lit(byte anode, byte cathode);
+	int litCount(byte firstPin, byte lastPin);
+	uint16_t timer1();
+	unsigned long nextRandom();
+
+  private:
+	long long _realStart;	// PC clock (nanoseconds) when realTime was set
+}; // hostBoard
+
+// the Arduino functions, acting on hostBoard::current()
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int usec);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void attachInterrupt(uint8_t num, void (*isr)(), int mode);
+void detachInterrupt(uint8_t num);
+void noInterrupts();
+void interrupts();
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+#define TCCR1A (hostBoard::current()->tccr1a)
+#define TCCR1B (hostBoard::current()->tccr1b)
+#define TIMSK1 (hostBoard::current()->timsk1)
+#define TCNT1 (hostBoard::current()->timer1())
+#define CS11 1
+
+// Print
+// Formats numbers and text for write(), as the Arduino one does.
+//
+class Print
+{
+  public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t *buf, size_t len);
+	size_t write(const char *str);
+	virtual int availableForWrite();
+
+	size_t print(const char *str);
+	size_t print(char c);
+	size_t print(unsigned char n, int base = DEC);
+	size_t print(int n, int base = DEC);
+	size_t print(unsigned int n, int base = DEC);
+	size_t print(long n, int base = DEC);
+	size_t print(unsigned long n, int base = DEC);
+	size_t print(double n, int digits = 2);
+	size_t println(const char *str);
+	size_t println(char c);
+	size_t println(unsigned char n, int base = DEC);
+	size_t println(int n, int base = DEC);
+	size_t println(unsigned int n, int base = DEC);
+	size_t println(long n, int base = DEC);
+	size_t println(unsigned long n, int base = DEC);
+	size_t println(double n, int digits = 2);
+	size_t println();
+
+  private:
+	size_t _printNumber(unsigned long n, int base);
+}; // Print
+
+// Stream
+class Stream : public Print
+{
+  public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+}; // Stream
+
+// HardwareSerial
+// The serial port of the current board: reads its rx bytes, writes to its output.
+//
+class HardwareSerial : public Stream
+{
+  public:
+	void begin(unsigned long baud);
+	operator bool();
+	size_t write(uint8_t c);
+	using Print::write;
+	int availableForWrite();
+	int available();
+	int read();
+	int peek();
+}; // HardwareSerial
+
+extern HardwareSerial Serial;
+
+#endif
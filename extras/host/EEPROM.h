@@ -0,0 +1,23 @@
+/*  EEPROM.h (host)
+	The EEPROM of the current hostBoard (see Arduino.h).
+
+    Released into the public domain.
+*/
+
+#ifndef	EEPROM_h
+#define EEPROM_h
+
+#include "Arduino.h"
+
+class EEPROMClass
+{
+  public:
+	uint8_t read(int address);
+	void write(int address, uint8_t value);
+	void update(int address, uint8_t value);
+	uint16_t length();
+}; // EEPROMClass
+
+extern EEPROMClass EEPROM;
+
+#endif
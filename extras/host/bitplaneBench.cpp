@@ -0,0 +1,160 @@
+// bitplaneBench
+//
+// Compares the lamp list with the bit planes (LSS_USE_BITPLANES) with 64 lamps, on the host.
+//
+// Two instances of 32 lamps each (16 masts of four lamps on pins 2 - 19) are set up, and a 65th
+// lamp is added on pins already in use. For 20 simulated seconds the masts are changed every
+// 250 ms (steady, flashing, and flashing on the other half of the cycle) while loop() calls
+// updateSignals, with 20 - 120 microseconds for the rest of the sketch. Every pin change from
+// then on is hashed with the time it happened, and the PC time per call of updateSignals is printed (this
+// depends on the PC: use it to compare the two builds, not as a measure of an Arduino), with
+// the size of a lamp here and on an AVR.
+//
+// The Makefile builds this twice, as bitplaneBench (with LSS_USE_BITPLANES) and bitplaneList
+// (without), and make check runs both and fails if the hashes differ. The 65th lamp is never
+// lit, so it only shows as taken or left out; with the bit planes it must be left out, as the
+// pool is full (the two end-of-list lamps don't count).
+//
+// Usage: bitplaneBench [-q]	(-q prints only the hash)
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#define MASTS 16
+#define LAMPS 4			// per mast
+#define RUN_TIME 20000000UL	// simulated microseconds
+#define CHANGE_TIME 250000UL	// between changes to the masts
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// FNV-1a hash of every pin change, with its time from the end of setup
+static unsigned long long traceHash = 14695981039346656037ULL;
+static unsigned long traceStart;
+static unsigned long pinChanges;
+
+static void hashByte(byte b)
+{
+	traceHash ^= b;
+	traceHash *= 1099511628211ULL;
+} // hashByte
+
+static void hashPin(hostBoard *board, byte pin)
+{
+	unsigned long t = board->now() - traceStart;
+	int n;
+
+	for (n = 0; n < 4; n++) hashByte(byte(t >> (n * 8)));
+	hashByte(pin);
+	hashByte(board->mode[pin]);
+	hashByte(board->level[pin]);
+	pinChanges++;
+} // hashPin
+
+int main(int argc, char **argv)
+{
+	boolean quiet = (argc > 1) && (strcmp(argv[1], "-q") == 0);
+	hostBoard board;
+	linesideSignal first, second;
+	linesideSignal *sig;
+	int mast, lamp, anode, cathode;
+	unsigned long start, changed;
+	long calls = 0;
+	double seconds = 0;
+	byte color;
+	boolean lateTaken = true;
+	boolean failed = false;
+
+	board.echo = false;
+	board.use();
+	first.setupSignal();
+	second.setupSignal();
+	anode = 2;
+	cathode = 2;
+	for (mast = 1; mast <= MASTS; mast++) { // four LEDs each, on the next pairs of pins 2 - 19
+		sig = (mast <= (MASTS / 2)) ? &first : &second;
+		for (lamp = 1; lamp <= LAMPS; lamp++) {
+			if (++cathode == anode) cathode++;
+			if (cathode > 19) {
+				anode++;
+				cathode = (anode == 2) ? 3 : 2;
+			}
+			sig->addLamp(mast, 1, lamp, anode, cathode, lamp); // red, yellow, green, lunar
+		}
+	}
+#if defined(LSS_USE_BITPLANES)
+	second.addLamp(MASTS + 1, 1, 1, 2, 3, LSS_RED);
+	lateTaken = (signalLamp::_lampTotal > (MASTS * LAMPS));
+#else
+	second.addLamp(MASTS + 1, 1, 1, 2, 3, LSS_RED); // taken, as the list has no limit
+#endif
+	board.pinHook = hashPin; // from here on, as addLamp sets the pins of the 65th (if taken) to inputs, which takes time
+	traceStart = board.now();
+
+	start = board.now();
+	changed = start - CHANGE_TIME;
+	while ((board.now() - start) < RUN_TIME) {
+		if ((board.now() - changed) >= CHANGE_TIME) { // change a mast
+			changed = board.now();
+			mast = 1 + int(board.nextRandom() % MASTS);
+			sig = (mast <= (MASTS / 2)) ? &first : &second;
+			color = byte(1 + (board.nextRandom() % LAMPS)); // the lamp of that color
+			switch (board.nextRandom() % 4) {
+				case 0:
+					sig->setHeadColor(mast, 1, LSS_DARK);
+				break;
+				case 1:
+					sig->setAlternate(mast, 1, color, false);
+					sig->setHeadColor(mast, 1, color, true);
+				break;
+				case 2:
+					sig->setAlternate(mast, 1, color, true);
+					sig->setHeadColor(mast, 1, color, true);
+				break;
+				default:
+					sig->setHeadColor(mast, 1, color);
+				break;
+			}
+		}
+		std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+		first.updateSignals();
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count();
+		calls++;
+		board.advance(loopTime());
+	}
+
+	if (quiet) {
+		printf("%016llx\n", traceHash);
+		return(0);
+	}
+#if defined(LSS_USE_BITPLANES)
+	printf("bit planes (LSS_USE_BITPLANES, LSS_MAX_LAMPS %d):\n", LSS_MAX_LAMPS);
+#else
+	printf("lamp list:\n");
+#endif
+	printf("  %d lamps in two instances, a 65th %s\n", MASTS * LAMPS, lateTaken ? "taken" : "left out (pool full)");
+	printf("  %ld calls of updateSignals in %.0f s simulated: %.0f ns each (PC time)\n", calls, RUN_TIME / 1e6, seconds * 1e9 / calls);
+	printf("  %lu pin changes, hash %016llx\n", pinChanges, traceHash);
+	printf("  signalLamp here: %d bytes", int(sizeof(signalLamp)));
+#if defined(LSS_USE_BITPLANES)
+	printf(" in the pool; on an AVR 8 bytes, plus one bit in each of %d planes\n", LSS_SL_MAX + 1);
+	if (lateTaken) {
+		printf("FAIL: the 65th lamp was taken\n");
+		failed = true;
+	}
+#else
+	printf(" each allocated; on an AVR 10 bytes, plus a 2-byte heap header\n");
+#endif
+	return(failed ? 1 : 0);
+} // main
@@ -0,0 +1,272 @@
+// capacityPlanner
+//
+// The CapacityPlanner example as a PC program: reports what the library would do with each
+// of a table of layouts on each of a table of boards, from linesideSignal::planCapacity (the
+// library's own timing code). The boards, layouts and estimate of the overhead are those of
+// examples/CapacityPlanner; edit both to suit.
+//
+// With -s, each layout is also run for RUN_TIME on a simulated Uno (with the HOST_COST_ times
+// of Arduino.h, which are cheaper than a real Uno's pin calls, and the board's loop time
+// added to each call of updateSignals), one lamp lit on each head. The cycle time, the time
+// the first LED is lit each cycle and the flash rate seen there are printed under the plan for
+// that board, with the plan worked out again for the overhead seen (the cycle less the time
+// the LEDs are lit, for each change). That shows how closely the plan follows the running
+// signals; it doesn't check a real board. The plan takes no account of a slot running on to
+// the first call of updateSignals after it ends, so with long loops (or many lamps, and short
+// slots) the simulated cycle is longer than planned, and the flash slower.
+//
+// Each simulated layout runs on a board of its own, in a process of its own (see hostProcess.h).
+//
+// A single layout can be given instead of the table: masts, heads per mast and lamps per
+// head, and optionally the cycle time and flash rate.
+//
+// Usage: capacityPlanner [-s] [masts heads lamps [cycle [rate]]]
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include "hostProcess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CODE_TIME 60		// microseconds of the library's own code for each change of LED, at 16 MHz
+#define RUN_TIME 4000000UL	// simulated microseconds for -s
+#define FIRST_PIN 2			// the simulated layouts are charlieplexed on pins 2 - 19
+#define LAST_PIN 19
+
+// board profiles: name, clock (MHz), mode time, write time, loop time (usec), SRAM (bytes)
+struct boardProfile {
+	const char *name;
+	int mhz;
+	int modeTime;
+	int writeTime;
+	int loopTime;
+	int sram;
+};
+
+static boardProfile boards[] = {
+	{ "Uno / Nano / Pro Mini 16 MHz", 16, 8, 8, 150, 2048 },
+	{ "Pro Mini 8 MHz", 8, 16, 16, 300, 2048 },
+	{ "ATmega168 8 MHz", 8, 16, 16, 300, 1024 }
+};
+
+// layouts: name, masts, heads per mast, lamps per head
+struct signalLayout {
+	const char *name;
+	int masts;
+	int heads;
+	int lamps;
+};
+
+static signalLayout layouts[] = {
+	{ "two 3-head masts", 2, 3, 3 },
+	{ "three 3-head masts", 3, 3, 3 },
+	{ "four 3-head masts", 4, 3, 3 },
+	{ "six 2-head masts", 6, 2, 3 },
+	{ "eight 1-head dwarfs", 8, 1, 3 }
+};
+
+static int cycleTime = LSS_CYCLE_TIME;
+static int flashRate = LSS_FLASH_FPM;
+
+// printPlan
+//
+// Print one plan, as the example does.
+static void printPlan(const signalPlan &plan, int sram)
+{
+	printf("    cycle %ld usec, each LED %ld usec (%d.%d%%), %d Hz\n", plan.cycleTime, plan.pulseTime, plan.duty / 10, plan.duty % 10, plan.refresh);
+	printf("    flash ");
+	if (plan.flashPeriod > 0) {
+		printf("%.1f FPM for %d (%+.1f%%)", 60000000.0 / plan.flashPeriod, flashRate, plan.flashError / 10.0);
+	} else {
+		printf("too fast to ramp");
+	}
+	printf(", SRAM %d of %d\n", plan.sram, sram);
+
+	if ((plan.warnings != LSS_PLAN_OK) || (plan.sram > (sram / 2))) {
+		printf("    warnings:");
+		if (plan.warnings & LSS_PLAN_FLICKER) printf(" flicker");
+		if (plan.warnings & LSS_PLAN_STRETCHED) printf(" stretched");
+		if (plan.warnings & LSS_PLAN_OVERRUN) printf(" overrun");
+		if (plan.warnings & LSS_PLAN_FLASH) printf(" flash");
+		if (plan.warnings & LSS_PLAN_TOO_LONG) printf(" too-long");
+		if (plan.sram > (sram / 2)) printf(" sram");
+		printf("\n");
+	}
+} // printPlan
+
+// from setTrace, for -s: the slots of the first lit lamp and the starts of ramp division 0
+static byte watchAnode, watchCathode;
+static unsigned long firstSlot, lastSlot, slots;
+static unsigned long firstDiv, lastDiv, divs;
+static boolean counting;
+
+// from the pins, for -s: how long the first lamp's LED is lit
+static unsigned long litAt, litTime;
+
+static void watchPins(hostBoard *board, byte pin)
+{
+	if ((pin != watchAnode) && (pin != watchCathode)) return;
+	if (board->lit(watchAnode, watchCathode)) {
+		if (litAt == 0) litAt = board->now();
+	} else if (litAt != 0) {
+		if (counting) litTime += board->now() - litAt;
+		litAt = 0;
+	}
+} // watchPins
+
+void traceRun(byte event, byte arg1, byte arg2)
+{
+	unsigned long t = hostBoard::current()->now();
+
+	if (!counting) return;
+	if ((event == LSS_TRACE_SLOT) && (arg1 == watchAnode) && (arg2 == watchCathode)) {
+		if (firstSlot == 0) firstSlot = t;
+		else slots++;
+		lastSlot = t;
+	} else if ((event == LSS_TRACE_DIV) && (arg1 == 0)) {
+		if (firstDiv == 0) firstDiv = t;
+		else divs++;
+		lastDiv = t;
+	}
+} // traceRun
+
+// runLayout
+//
+// Run a layout on a simulated Uno and print what it does, with the plan for the overhead seen.
+static void runLayout(const boardProfile &board, const signalLayout &layout)
+{
+	hostBoard host;
+	linesideSignal signals;
+	signalPlan plan;
+	unsigned long start, cycle, pulse;
+	int mast, head, lamp, anode, cathode, lit, overhead;
+
+	host.echo = false;
+	host.use();
+	signals.setupSignal();
+	signals.setCycleTime(cycleTime);
+	signals.setFlashRate(flashRate);
+	anode = FIRST_PIN;
+	cathode = FIRST_PIN;
+	for (mast = 1; mast <= layout.masts; mast++) {
+		for (head = 1; head <= layout.heads; head++) {
+			for (lamp = 1; lamp <= layout.lamps; lamp++) { // on the next pair of pins
+				if (++cathode == anode) cathode++;
+				if (cathode > LAST_PIN) {
+					anode++;
+					cathode = (anode == FIRST_PIN) ? FIRST_PIN + 1 : FIRST_PIN;
+				}
+				signals.addLamp(mast, head, lamp, anode, cathode, lamp);
+				if ((mast == 1) && (head == 1) && (lamp == 1)) {
+					watchAnode = anode;
+					watchCathode = cathode;
+				}
+			}
+			signals.setHeadColor(mast, head, 1); // one lamp lit, steady
+		}
+	}
+	signals.setTrace(traceRun);
+	host.pinHook = watchPins;
+	firstSlot = lastSlot = slots = 0;
+	firstDiv = lastDiv = divs = 0;
+	litAt = litTime = 0;
+	counting = false;
+
+	start = host.now();
+	while ((host.now() - start) < RUN_TIME) {
+		counting = ((host.now() - start) >= (RUN_TIME / 4)); // leave out starting up
+		signals.updateSignals();
+		host.advance(board.loopTime);
+	}
+	if (slots == 0) {
+		printf("    simulated Uno: the first lamp was never lit\n");
+		return;
+	}
+
+	// the first lamp flashes, so only its lit slots count towards the time it is lit
+	lit = layout.masts * layout.heads;
+	cycle = (lastSlot - firstSlot) / slots;
+	pulse = litTime / (slots + 1);
+	overhead = int(cycle / lit) - int(pulse);
+	printf("    simulated Uno: cycle %lu usec, each LED %lu usec, flash %.1f FPM, overhead %d usec\n", cycle, pulse,
+		divs ? ((60000000.0 * divs) / (lastDiv - firstDiv)) : 0.0, overhead);
+	linesideSignal::planCapacity(plan, lit * layout.lamps, lit, cycleTime, flashRate, overhead, board.loopTime);
+	printf("    planned for that overhead: cycle %ld usec, each LED %ld usec, flash %.1f FPM\n", plan.cycleTime, plan.pulseTime,
+		(plan.flashPeriod > 0) ? (60000000.0 / plan.flashPeriod) : 0.0);
+} // runLayout
+
+// simulate
+//
+// Run a layout on a board of its own, in a process of its own, as each layout starts from a reset.
+static void simulate(const boardProfile &board, const signalLayout &layout)
+{
+	hostProcess process;
+
+	if (process.start()) {
+		runLayout(board, layout);
+		process.finish(0);
+	}
+	process.wait();
+} // simulate
+
+// planLayout
+//
+// Report one layout on one board.
+static void planLayout(const boardProfile &board, const signalLayout &layout, boolean simulated)
+{
+	signalPlan plan;
+	int overhead;
+	int lit;
+	int total;
+
+	// the old cathode is turned off and the new one on (a mode change and a write each), plus the library's own code
+	overhead = (2 * (board.modeTime + board.writeTime)) + ((CODE_TIME * 16) / board.mhz);
+	lit = layout.masts * layout.heads;
+	total = lit * layout.lamps;
+
+	linesideSignal::planCapacity(plan, total, lit, cycleTime, flashRate, overhead, board.loopTime);
+	printf("  %s (%d lamps, %d lit)\n", layout.name, total, lit);
+	printPlan(plan, board.sram);
+	if (simulated) simulate(board, layout);
+} // planLayout
+
+int main(int argc, char **argv)
+{
+	boolean simulated = false;
+	signalLayout one = { "layout", 0, 0, 0 };
+	int arg = 1;
+	int b, l;
+
+	if ((argc > arg) && (strcmp(argv[arg], "-s") == 0)) {
+		simulated = true;
+		arg++;
+	}
+	if (argc > arg + 2) {
+		one.masts = atoi(argv[arg]);
+		one.heads = atoi(argv[arg + 1]);
+		one.lamps = atoi(argv[arg + 2]);
+		if (argc > arg + 3) cycleTime = atoi(argv[arg + 3]);
+		if (argc > arg + 4) flashRate = atoi(argv[arg + 4]);
+		if ((one.masts < 1) || (one.heads < 1) || (one.lamps < 1)) {
+			printf("usage: capacityPlanner [-s] [masts heads lamps [cycle [rate]]]\n");
+			return(1);
+		}
+	} else if (argc > arg) {
+		printf("usage: capacityPlanner [-s] [masts heads lamps [cycle [rate]]]\n");
+		return(1);
+	}
+
+	printf("capacityPlanner: cycle %d usec, flash %d FPM\n", cycleTime, flashRate);
+	for (b = 0; b < int(sizeof(boards) / sizeof(boards[0])); b++) {
+		printf("\n%s\n", boards[b].name);
+		if (one.masts > 0) {
+			planLayout(boards[b], one, simulated && (b == 0));
+		} else {
+			for (l = 0; l < int(sizeof(layouts) / sizeof(layouts[0])); l++) planLayout(boards[b], layouts[l], simulated && (b == 0));
+		}
+	}
+	return(0);
+} // main
@@ -0,0 +1,249 @@
+// cmriMaster
+//
+// A simulated C/MRI master (as JMRI) polling signalCMRI on a simulated Uno, measuring how
+// long the node takes to answer while it runs a full load of lamps.
+//
+// The node has 24 heads of three lamps (72 LEDs charlieplexed on pins 3 - 12). Output bit n
+// sets head n+1 green and bit n+24 sets it red; input bits 0 - 5 are pins A0 - A5. The master
+// polls back to back for 10 simulated seconds: a transmit (T) message whenever it changes an
+// output (one head every poll), then a poll (P), then it waits for the receive (R) message. The
+// inputs are changed every 50 ms.
+//
+// For each line speed, with the lamps dark and then with all 24 heads lit, this prints the
+// node's latency (from the last byte of the poll arriving to the reply being written, which
+// includes up to one loop() of the sketch, 20 - 120 microseconds here), the round trip as the
+// master sees it (with both messages on the wire), and the longest LED slot. The test fails if
+// a reply is missing, wrong or late (LATENCY_LIMIT), or a head doesn't end up as the outputs
+// say once the last change has had time to be shown.
+//
+// Usage: cmriMaster
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include "signalCMRI.h"
+#include "hostProcess.h"
+#include <stdio.h>
+#include <string>
+
+#define NODE 5				// the node's address
+#define HEADS 24
+#define RUN_TIME 10000000L	// simulated microseconds for each case
+#define REPLY_TIMEOUT 50000L	// microseconds the master waits for a reply
+#define LATENCY_LIMIT 1000L	// microseconds the node may take to answer
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// slot starts, from setTrace
+static unsigned long lastSlot;
+static unsigned long longestSlot;
+
+void traceSlot(byte event, byte arg1, byte arg2)
+{
+	unsigned long t;
+
+	if (event != LSS_TRACE_SLOT) return;
+	t = hostBoard::current()->now();
+	if ((lastSlot != 0) && ((t - lastSlot) > longestSlot)) longestSlot = t - lastSlot;
+	lastSlot = t;
+} // traceSlot
+
+// a message from the master: SYN SYN STX address type data ETX, with DLE before data bytes
+// that could be taken for STX, ETX or DLE
+static std::string message(char type, const byte *data, int count)
+{
+	std::string m;
+	int n;
+
+	m += char(LSS_CMRI_SYN);
+	m += char(LSS_CMRI_SYN);
+	m += char(LSS_CMRI_STX);
+	m += char(NODE + LSS_CMRI_ADDR);
+	m += type;
+	for (n = 0; n < count; n++) {
+		if ((data[n] == LSS_CMRI_STX) || (data[n] == LSS_CMRI_ETX) || (data[n] == LSS_CMRI_DLE)) m += char(LSS_CMRI_DLE);
+		m += char(data[n]);
+	}
+	m += char(LSS_CMRI_ETX);
+	return(m);
+} // message
+
+// masterSend
+//
+// Send a message down the line to the node.
+static void masterSend(hostBoard &board, const std::string &m)
+{
+	board.transmit((const byte *)m.data(), int(m.size()));
+} // masterSend
+
+// replyInputs
+//
+// Take the input bits from a receive message, or return false if it isn't a whole one.
+static boolean replyInputs(const std::string &reply, byte *inputs)
+{
+	size_t pos;
+	int count = 0;
+
+	pos = reply.find(char(LSS_CMRI_STX));
+	if ((pos == std::string::npos) || (reply.size() < pos + 3)) return(false);
+	if ((byte(reply[pos + 1]) != NODE + LSS_CMRI_ADDR) || (reply[pos + 2] != 'R')) return(false);
+	for (pos += 3; pos < reply.size(); pos++) {
+		if (byte(reply[pos]) == LSS_CMRI_ETX) return(count == LSS_CMRI_IN_BYTES);
+		if (byte(reply[pos]) == LSS_CMRI_DLE) pos++;
+		if ((pos < reply.size()) && (count < LSS_CMRI_IN_BYTES)) inputs[count++] = byte(reply[pos]);
+	}
+	return(false);
+} // replyInputs
+
+// runCase
+//
+// Poll for RUN_TIME at a line speed, with the heads lit or not. Returns the number of problems.
+static int runCase(unsigned long baud, boolean lit)
+{
+	hostBoard board;
+	linesideSignal signals;
+	signalCMRI node(signals, Serial, NODE);
+	byte outputs[LSS_CMRI_OUT_BYTES];
+	byte inputs[LSS_CMRI_IN_BYTES];
+	byte want;
+	unsigned long charTime = 10000000UL / baud;
+	unsigned long start, pollEnd, sentAt, latency;
+	unsigned long worstLatency = 0, worstTrip = 0, inputsChanged = 0;
+	double totalLatency = 0;
+	long polls = 0, missing = 0, wrong = 0, heads = 0;
+	int head, pin, anode, cathode, n;
+	std::string reply;
+	int problems;
+
+	board.echo = false;
+	board.baud = baud;
+	board.use();
+	signals.setupSignal();
+	anode = 3;
+	cathode = 3;
+	for (head = 0; head < HEADS; head++) { // three LEDs each, on the next pairs of pins 3 - 12
+		for (n = 1; n <= 3; n++) {
+			if (++cathode == anode) cathode++;
+			if (cathode > 12) {
+				anode++;
+				cathode = (anode == 3) ? 4 : 3;
+			}
+			signals.addLamp(head + 1, 1, n, anode, cathode, (n == 1) ? LSS_GREEN : ((n == 2) ? LSS_YELLOW : LSS_RED));
+		}
+		node.mapHead(head, head + 1, 1, LSS_GREEN);
+		node.mapHead(head + HEADS, head + 1, 1, LSS_RED);
+	}
+	for (pin = 0; pin < 6; pin++) {
+		node.mapInput(pin, A0 + pin);
+		board.input[A0 + pin] = HIGH;
+	}
+	signals.setTrace(traceSlot);
+	lastSlot = 0;
+	longestSlot = 0;
+
+	memset(outputs, 0, sizeof(outputs));
+	if (lit) for (head = 0; head < HEADS; head++) outputs[(head + HEADS) >> 3] |= 1 << ((head + HEADS) & 7); // all red
+
+	start = board.now();
+	head = 0;
+	while ((board.now() - start) < RUN_TIME) {
+		if (lit) { // change a head: red to green, or back
+			n = head % HEADS;
+			outputs[n >> 3] ^= 1 << (n & 7);
+			outputs[(n + HEADS) >> 3] ^= 1 << ((n + HEADS) & 7);
+			head++;
+		}
+		if (lit || (polls == 0)) masterSend(board, message('T', outputs, LSS_CMRI_OUT_BYTES));
+		if ((board.now() - inputsChanged) >= 50000UL) { // the sensors change now and then
+			inputsChanged = board.now();
+			for (pin = 0; pin < 6; pin++) board.input[A0 + pin] = (board.nextRandom() & 1) ? HIGH : LOW;
+		}
+		sentAt = board.now();
+		masterSend(board, message('P', NULL, 0));
+		pollEnd = board.lineDue + ((board.line.size() - 1) * charTime); // when its last byte arrives
+		polls++;
+
+		// run the sketch until the reply is written, or the master gives up
+		reply.clear();
+		latency = 0;
+		while (((board.now() - sentAt) < REPLY_TIMEOUT) && !replyInputs(reply, inputs)) {
+			signals.updateSignals();
+			node.update();
+			if ((latency == 0) && !board.output.empty()) latency = board.now() - pollEnd;
+			if ((board.now() - start) < 100000L) longestSlot = 0; // leave out starting up
+			reply += board.takeOutput();
+			board.advance(loopTime());
+		}
+		if (!replyInputs(reply, inputs)) {
+			missing++;
+			continue;
+		}
+		if (latency > worstLatency) worstLatency = latency;
+		totalLatency += latency;
+		if ((pollEnd + latency + (reply.size() * charTime) - sentAt) > worstTrip) worstTrip = pollEnd + latency + (reply.size() * charTime) - sentAt;
+		while (long(board.now() - (pollEnd + latency + (reply.size() * charTime))) < 0) { // the master reads the rest of the reply
+			signals.updateSignals();
+			node.update();
+			board.advance(loopTime());
+		}
+
+		for (pin = 0, want = 0; pin < 6; pin++) if (board.input[A0 + pin] == LOW) want |= 1 << pin;
+		if (((board.now() - inputsChanged) > 5000UL) && (inputs[0] != want)) wrong++; // stale for more than a few loops
+	} // while
+
+	start = board.now();
+	while ((board.now() - start) < 2000000UL) { // let the last outputs be acted on, and the heads change over
+		signals.updateSignals();
+		node.update();
+		board.advance(loopTime());
+	}
+	for (head = 0; head < HEADS; head++) {
+		if (outputs[head >> 3] & (1 << (head & 7))) want = LSS_GREEN;
+		else if (outputs[(head + HEADS) >> 3] & (1 << ((head + HEADS) & 7))) want = LSS_RED;
+		else want = LSS_DARK;
+		if (signals.getHeadColor(head + 1, 1) != want) heads++;
+	}
+
+	printf("  %6lu baud, %-9s %5ld polls, latency mean %4.0f us, worst %4lu us, round trip worst %5lu us, longest slot %4lu us",
+		baud, lit ? "24 lit" : "dark", polls, (polls > missing) ? (totalLatency / (polls - missing)) : 0.0,
+		worstLatency, worstTrip, longestSlot);
+	problems = int(missing + wrong + heads) + ((worstLatency > LATENCY_LIMIT) ? 1 : 0);
+	if (problems > 0) {
+		printf("  FAIL (%ld missing, %ld wrong, %ld heads wrong)\n", missing, wrong, heads);
+	} else {
+		printf("  ok\n");
+	}
+	return(problems);
+} // runCase
+
+// runBoard
+//
+// Run a case on a board of its own, from a reset (see hostProcess.h). Returns the number of
+// problems (up to 255).
+static int runBoard(unsigned long baud, boolean lit)
+{
+	hostProcess process;
+
+	if (process.start()) process.finish(runCase(baud, lit));
+	return(process.wait());
+} // runBoard
+
+int main()
+{
+	int problems = 0;
+
+	printf("C/MRI polls of an SMINI node, %ld s simulated for each:\n", RUN_TIME / 1000000L);
+	problems += runBoard(19200, false);
+	problems += runBoard(19200, true);
+	problems += runBoard(115200, false);
+	problems += runBoard(115200, true);
+	return((problems > 0) ? 1 : 0);
+} // main
@@ -0,0 +1,217 @@
+// commandBench
+//
+// Throughput of signalCommand, measured on the host.
+//
+// First the parser alone: 100000 text and 100000 binary commands are fed to it as fast as the
+// PC can, and the PC time per command printed (this depends on the PC: use it to compare one
+// version of the parser with another).
+//
+// Then in a sketch's loop(), on a simulated Uno with 12 LEDs (4 lit, 1 flashing): a PC sends
+// commands back to back at 115200 baud for 10 simulated seconds, while loop() calls
+// updateSignals and update, with 20 - 120 microseconds for the rest of the sketch. For each
+// kind of traffic this prints the commands carried out per second, the most bytes ever
+// waiting in the Arduino's 64-byte receive buffer (and any lost), and the longest loop() and
+// LED slot after the first 100 ms. The queries change nothing, so any change in the longest
+// slot from the quiet line is the parser's doing.
+//
+// The simulated clock only counts the calls that take time on an AVR (micros, the pins); the
+// parsing itself isn't timed, so the first part is the measure of that.
+//
+// Usage: commandBench
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include "signalCommand.h"
+#include "hostProcess.h"
+#include <stdio.h>
+#include <chrono>
+
+#define PARSE_COMMANDS 100000L
+#define RUN_TIME 10000000L	// simulated microseconds of traffic for each kind
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// slot starts, from setTrace
+static unsigned long lastSlot;
+static unsigned long longestSlot;
+
+void traceSlot(byte event, byte arg1, byte arg2)
+{
+	unsigned long t;
+
+	if (event != LSS_TRACE_SLOT) return;
+	t = hostBoard::current()->now();
+	if ((lastSlot != 0) && ((t - lastSlot) > longestSlot)) longestSlot = t - lastSlot;
+	lastSlot = t;
+} // traceSlot
+
+// four masts of three lamps: greens on the first two, a flashing yellow, and a red
+static void addMasts(linesideSignal &signals)
+{
+	int mast;
+
+	signals.setupSignal();
+	for (mast = 1; mast <= 4; mast++) {
+		signals.addLamp(mast, 1, 1, mast + 1, 6, LSS_GREEN);
+		signals.addLamp(mast, 1, 2, mast + 1, 7, LSS_YELLOW);
+		signals.addLamp(mast, 1, 3, mast + 1, 8, LSS_RED);
+	}
+	signals.setHeadColor(1, 1, LSS_GREEN);
+	signals.setHeadColor(2, 1, LSS_GREEN);
+	signals.setHeadColor(3, 1, LSS_YELLOW, true);
+	signals.setHeadColor(4, 1, LSS_RED);
+} // addMasts
+
+// one command, in text or binary
+static int makeCommand(byte *out, boolean binary, boolean query, long n)
+{
+	byte mast = byte(1 + (n % 4));
+	byte color = byte(1 + ((n / 4) % 3)); // green, yellow, red
+	byte args[4];
+	byte count, op, check, i;
+	int len = 0;
+
+	if (!binary) {
+		if (query) return(sprintf((char *)out, "Q %d 1\n", mast));
+		return(sprintf((char *)out, "H %d 1 %d\n", mast, color));
+	}
+	args[0] = mast;
+	args[1] = 1;
+	if (query) {
+		op = LSS_CMD_QHEAD;
+		count = 2;
+	} else {
+		op = LSS_CMD_HEAD;
+		args[2] = color;
+		args[3] = 0;
+		count = 4;
+	}
+	out[len++] = LSS_CMD_FRAME;
+	out[len++] = op;
+	out[len++] = count;
+	check = op ^ count;
+	for (i = 0; i < count; i++) {
+		out[len++] = args[i];
+		check ^= args[i];
+	}
+	out[len++] = check;
+	return(len);
+} // makeCommand
+
+// the parser alone, on the PC
+static void parseBench(boolean binary)
+{
+	hostBoard board;
+	linesideSignal signals;
+	signalCommand commands(signals, Serial);
+	byte buf[32];
+	long n;
+	int len, i;
+	long bytes = 0;
+	double seconds;
+
+	board.echo = false;
+	board.use();
+	addMasts(signals);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (n = 0; n < PARSE_COMMANDS; n++) {
+		len = makeCommand(buf, binary, false, n);
+		for (i = 0; i < len; i++) commands.feed(buf[i]);
+		bytes += len;
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("  %-7s %ld commands, %ld bytes: %.0f ns per command, %.1f ns per byte (PC time, with setHeadColor)\n",
+		binary ? "binary" : "text", PARSE_COMMANDS, bytes, seconds * 1e9 / PARSE_COMMANDS, seconds * 1e9 / bytes);
+} // parseBench
+
+// a loop() with the line busy (kind: 0 quiet, 1 text queries, 2 binary queries, 3 text
+// head colors, 4 binary head colors)
+static void loopBench(int kind)
+{
+	static const char *names[] = {"quiet line", "text queries", "binary queries", "text head colors", "binary head colors"};
+	hostBoard board;
+	linesideSignal signals;
+	signalCommand commands(signals, Serial);
+	byte buf[32];
+	long sent = 0;
+	int len = 1;
+	long replies = 0;
+	unsigned long start, before, longestLoop = 0;
+	std::string out;
+	size_t pos;
+	long done;
+
+	board.echo = false;
+	board.use();
+	addMasts(signals);
+	signals.setTrace(traceSlot);
+	lastSlot = 0;
+	longestSlot = 0;
+
+	start = board.now();
+	while ((board.now() - start) < RUN_TIME) {
+		if ((kind != 0) && (board.line.size() < 64)) { // keep the line busy
+			len = makeCommand(buf, (kind == 2) || (kind == 4), kind <= 2, sent);
+			board.transmit(buf, len);
+			sent++;
+		}
+		before = board.now();
+		signals.updateSignals();
+		commands.update();
+		if ((before - start) < 100000L) longestSlot = 0; // leave out starting up (see startupTest)
+		else if ((board.now() - before) > longestLoop) longestLoop = board.now() - before;
+		board.advance(loopTime());
+		out = board.takeOutput();
+		for (pos = 0; pos < out.size(); pos++) if ((out[pos] == '\n') || ((byte)out[pos] == LSS_CMD_FRAME)) replies++;
+	}
+
+	// commands carried out: the queries answered, or for the others those fully read
+	done = replies;
+	if (kind >= 3) done = sent - long((board.line.size() + (board.rxHead - board.rxTail) + len - 1) / len);
+	printf("  %-18s %6.0f commands/s, most waiting %2d bytes, %lu lost, longest loop %4lu us, longest slot %4lu us\n",
+		names[kind], done / (RUN_TIME / 1e6), board.rxMost, board.rxLost, longestLoop, longestSlot);
+} // loopBench
+
+// each run starts with a freshly reset Arduino: a board in a process of its own (see hostProcess.h)
+static void parseBoard(boolean binary)
+{
+	hostProcess process;
+
+	if (process.start()) {
+		parseBench(binary);
+		process.finish(0);
+	}
+	process.wait();
+} // parseBoard
+
+static void loopBoard(int kind)
+{
+	hostProcess process;
+
+	if (process.start()) {
+		loopBench(kind);
+		process.finish(0);
+	}
+	process.wait();
+} // loopBoard
+
+int main()
+{
+	int kind;
+
+	printf("parser alone (PC time):\n");
+	parseBoard(false);
+	parseBoard(true);
+	printf("in loop(), 115200 baud, %ld s simulated:\n", RUN_TIME / 1000000L);
+	for (kind = 0; kind <= 4; kind++) loopBoard(kind);
+	return(0);
+} // main
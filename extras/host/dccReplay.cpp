@@ -0,0 +1,166 @@
+// dccReplay
+//
+// Plays a recorded DCC signal into signalDCC on a simulated Uno, and checks the heads it sets.
+//
+// The file gives the time between edges of the signal, in microseconds, and "! mast head
+// color [flash]" lines saying what the heads must show by that point (see dccCapture.txt).
+// Each edge changes the DCC pin at its time and calls the decoder's interrupt routine, which
+// takes its time from whatever it interrupted, while loop() runs updateSignals and the
+// decoder's update (with 20 - 120 microseconds for the rest of the sketch).
+//
+// Mast 1 (green, yellow and red lamps) follows extended accessory (signal) address 101, and
+// mast 2 (green and red) follows basic accessory 12: green when closed, red when thrown.
+//
+// Usage: dccReplay [file]	(dccCapture.txt if none given)
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include "signalDCC.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define DCC_PIN 2
+#define START_TIME 50000UL	// microseconds after reset the signal starts
+
+// a check from the file
+struct replayCheck {
+	long edge;				// edges played before it
+	int line;				// in the file
+	byte mast;
+	byte head;
+	byte color;
+	boolean flash;
+};
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// the lamp of a color on our masts
+static byte lampFor(byte color)
+{
+	if (color == LSS_GREEN) return(1);
+	if (color == LSS_YELLOW) return(2);
+	return(3);
+} // lampFor
+
+// readCapture
+//
+// Read the file into the edge times (from START_TIME) and the checks. Returns false if it
+// can't be read.
+static boolean readCapture(const char *name, std::vector<unsigned long> &edges, std::vector<replayCheck> &checks)
+{
+	FILE *f;
+	char text[512];
+	char *p, *end;
+	unsigned long t = START_TIME;
+	unsigned long width;
+	int line = 0;
+	int mast, head, color;
+	char flash[16];
+	replayCheck check;
+
+	f = fopen(name, "r");
+	if (f == NULL) return(false);
+	while (fgets(text, sizeof(text), f) != NULL) {
+		line++;
+		if (text[0] == '#') continue;
+		if (text[0] == '!') {
+			flash[0] = 0;
+			if (sscanf(text + 1, "%d %d %d %15s", &mast, &head, &color, flash) < 3) {
+				printf("%s:%d: expected ! mast head color [flash]\n", name, line);
+				fclose(f);
+				return(false);
+			}
+			check.edge = long(edges.size());
+			check.line = line;
+			check.mast = byte(mast);
+			check.head = byte(head);
+			check.color = byte(color);
+			check.flash = (strcmp(flash, "flash") == 0);
+			checks.push_back(check);
+			continue;
+		}
+		for (p = text; ; p = end) {
+			width = strtoul(p, &end, 10);
+			if (end == p) break;
+			t += width;
+			edges.push_back(t);
+		}
+	} // while
+	fclose(f);
+	return(true);
+} // readCapture
+
+int main(int argc, char **argv)
+{
+	const char *name = (argc > 1) ? argv[1] : "dccCapture.txt";
+	std::vector<unsigned long> edges;
+	std::vector<replayCheck> checks;
+	hostBoard board;
+	linesideSignal signals;
+	signalDCC dcc(signals);
+	unsigned long due;
+	int loops;
+	boolean flashing;
+	byte color;
+	int failed = 0;
+	size_t n;
+
+	if (!readCapture(name, edges, checks)) {
+		printf("can't read %s\n", name);
+		return(1);
+	}
+
+	board.echo = false;
+	board.use();
+	signals.setupSignal();
+	signals.addLamp(1, 1, 1, 4, 5, LSS_GREEN);
+	signals.addLamp(1, 1, 2, 4, 6, LSS_YELLOW);
+	signals.addLamp(1, 1, 3, 4, 7, LSS_RED);
+	signals.addLamp(2, 1, 1, 8, 9, LSS_GREEN);
+	signals.addLamp(2, 1, 3, 8, 10, LSS_RED);
+	dcc.setupDCC(DCC_PIN);
+	dcc.addAspect(101, 1, 1);
+	dcc.addAccessory(12, 2, 1, LSS_GREEN, LSS_RED);
+	board.setEdges(DCC_PIN, edges.data(), long(edges.size()));
+
+	printf("%s: %lu edges, %.3f s of DCC\n", name, (unsigned long)edges.size(),
+		edges.empty() ? 0.0 : (edges.back() - START_TIME) / 1e6);
+	for (n = 0; n < checks.size(); n++) {
+		// run until the last edge before the check has been played
+		due = (checks[n].edge > 0) ? edges[checks[n].edge - 1] : 0;
+		while (long(board.now() - due) <= 0) {
+			signals.updateSignals();
+			dcc.update();
+			board.advance(loopTime());
+		}
+		for (loops = 0; loops < 10; loops++) { // and for the packets waiting to be taken
+			signals.updateSignals();
+			dcc.update();
+			board.advance(loopTime());
+		}
+
+		color = signals.getHeadColor(checks[n].mast, checks[n].head);
+		flashing = signals.isLampFlashing(checks[n].mast, checks[n].head, lampFor(color));
+		printf("  line %3d at %8.3f ms: mast %d head %d shows %d%s", checks[n].line, (board.now() - START_TIME) / 1000.0,
+			checks[n].mast, checks[n].head, color, flashing ? " flashing" : "");
+		if ((color != checks[n].color) || (flashing != checks[n].flash)) {
+			printf("  FAIL (expected %d%s)\n", checks[n].color, checks[n].flash ? " flashing" : "");
+			failed++;
+		} else {
+			printf("  ok\n");
+		}
+	}
+	printf("%ld edges played, %lu with interrupts off (latest by %lu us), %d of %lu checks failed\n",
+		board.nextEdge, board.lateEdges, board.worstLate, failed, (unsigned long)checks.size());
+	return((failed > 0) ? 1 : 0);
+} // main
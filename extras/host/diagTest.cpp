@@ -0,0 +1,149 @@
+// diagTest
+//
+// Checks the LED diagnostics (LSS_USE_LED_DIAG) against a simulated ADC on a simulated Uno.
+//
+// Four masts each show one lamp: mast 1 has a good LED on cathode A0 (the ADC reads 600, the
+// supply less its forward voltage), mast 2 an open one on A1 (20, held down by the pull-down),
+// mast 3 a shorted one on A2 (1010), and mast 4 a good LED on digital pin 6, which can't be
+// read. After the signals have run for two seconds each lamp must have the fault its reading
+// shows; then the open LED is mended (A1 reads 600) and, two seconds later, its fault must
+// have cleared.
+//
+// The pins are watched throughout: each time an analog cathode is let go while its lamp is
+// lit, it must be grounded again within DARK_LIMIT microseconds (by the next call of
+// updateSignals, which reads the ADC). The time each LED is lit is added up, and the good LED
+// on A0, which is sampled, must get within SHARE_TOLERANCE tenths of a percent of the light of the one on
+// pin 6, which isn't, as the slot is lengthened by the time the LED was dark (without that
+// it gets about 0.7% less).
+//
+// There are no ADC registers on the host, so the library reads with analogRead here (which
+// charges the time of a conversion); the start and read of the conversion on an AVR is not
+// exercised.
+//
+// Usage: diagTest
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+
+#define RUN_TIME 2000000UL	// simulated microseconds before each check
+#define DARK_LIMIT 400UL	// microseconds a sampled LED may be dark
+#define SHARE_TOLERANCE 5	// tenths of a percent
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// the lamps: anode, cathode, and what the ADC reads on the cathode while it is lit
+static const byte anodes[4] = {2, 3, 4, 5};
+static const byte cathodes[4] = {A0, A1, A2, 6};
+
+// when each analog cathode was let go, or 0
+static unsigned long floatedAt[HOST_PINS];
+static unsigned long samples;
+static unsigned long longestDark;
+
+static void watchPins(hostBoard *board, byte pin)
+{
+	int lamp;
+
+	for (lamp = 0; lamp < 3; lamp++) { // the anode turned off, so the cathode was let go for a change of lamps
+		if ((pin == anodes[lamp]) && !((board->mode[pin] == OUTPUT) && (board->level[pin] == HIGH))) floatedAt[cathodes[lamp]] = 0;
+	}
+	if ((pin < A0) || (pin > A2)) return;
+	if ((board->mode[pin] == INPUT) && (board->level[anodes[pin - A0]] == HIGH) && (board->mode[anodes[pin - A0]] == OUTPUT)) {
+		if (floatedAt[pin] == 0) floatedAt[pin] = board->now(); // let go while lit (or going dark)
+	} else if ((board->mode[pin] == OUTPUT) && (floatedAt[pin] != 0)) {
+		samples++;
+		if ((board->now() - floatedAt[pin]) > longestDark) longestDark = board->now() - floatedAt[pin];
+		floatedAt[pin] = 0;
+	}
+} // watchPins
+
+// run the signals for a time, adding up how long each LED is lit
+static void run(hostBoard &board, linesideSignal &signals, unsigned long *litTime)
+{
+	unsigned long start = board.now();
+	unsigned long step;
+	int lamp;
+
+	while ((board.now() - start) < RUN_TIME) {
+		signals.updateSignals();
+		step = loopTime();
+		for (lamp = 0; lamp < 4; lamp++) if (board.lit(anodes[lamp], cathodes[lamp])) litTime[lamp] += step;
+		board.advance(step);
+	}
+} // run
+
+// check
+//
+// Compare the fault of each lamp with what it should be. Returns the number that differ.
+static int check(linesideSignal &signals, const byte *want)
+{
+	static const char *names[3] = {"none", "open", "short"};
+	byte fault;
+	int mast, wrong = 0;
+
+	for (mast = 1; mast <= 4; mast++) {
+		fault = signals.getLampFault(mast, 1, 1);
+		printf("  mast %d (cathode %s): %-5s", mast, (mast < 4) ? ((mast == 1) ? "A0" : ((mast == 2) ? "A1" : "A2")) : "6 ", names[fault]);
+		if (fault != want[mast - 1]) {
+			printf("  FAIL, should be %s\n", names[want[mast - 1]]);
+			wrong++;
+		} else {
+			printf("  ok\n");
+		}
+	}
+	return(wrong);
+} // check
+
+int main()
+{
+	hostBoard board;
+	linesideSignal signals;
+	unsigned long litTime[4] = {0, 0, 0, 0};
+	static const byte faulty[4] = {LSS_FAULT_NONE, LSS_FAULT_OPEN, LSS_FAULT_SHORT, LSS_FAULT_NONE};
+	static const byte mended[4] = {LSS_FAULT_NONE, LSS_FAULT_NONE, LSS_FAULT_SHORT, LSS_FAULT_NONE};
+	int mast, problems = 0;
+	long share;
+
+	board.echo = false;
+	board.use();
+	board.analog[A0] = 600;
+	board.analog[A1] = 20;
+	board.analog[A2] = 1010;
+	signals.setupSignal();
+	for (mast = 1; mast <= 4; mast++) {
+		signals.addLamp(mast, 1, 1, anodes[mast - 1], cathodes[mast - 1], LSS_GREEN);
+		signals.setHeadColor(mast, 1, LSS_GREEN);
+	}
+	board.pinHook = watchPins;
+
+	printf("after %lu s, A0 good, A1 open, A2 shorted:\n", RUN_TIME / 1000000UL);
+	run(board, signals, litTime);
+	problems += check(signals, faulty);
+
+	board.analog[A1] = 600;
+	printf("after %lu s more, with A1 mended:\n", RUN_TIME / 1000000UL);
+	run(board, signals, litTime);
+	problems += check(signals, mended);
+
+	share = long((litTime[0] * 1000.0) / litTime[3]); // in tenths of a percent
+	printf("%lu samples, longest dark %lu us; the LED on A0 lit %ld.%ld%% as long as the one on pin 6\n", samples, longestDark, share / 10, share % 10);
+	if ((samples == 0) || (longestDark > DARK_LIMIT)) {
+		printf("FAIL: a sampled LED was left dark\n");
+		problems++;
+	}
+	if ((share < 1000 - SHARE_TOLERANCE) || (share > 1000 + SHARE_TOLERANCE)) {
+		printf("FAIL: the sampled LED lost light\n");
+		problems++;
+	}
+	return((problems > 0) ? 1 : 0);
+} // main
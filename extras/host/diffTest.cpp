@@ -0,0 +1,283 @@
+// diffTest
+//
+// Checks which LED the library lights, call by call, against a model of its own, on a
+// simulated Uno, with a seeded stream of random changes (as VerifyExample makes).
+//
+// The model knows nothing of the library's lamp flags or its ramp code. It keeps what the
+// changes asked for (which lamps are shown, flashing, alternating, ramped) and works out, from
+// the ramp division (LSS_TRACE_DIV) and its own count of passes through the lamps, whether
+// the lamp whose slot it is (LSS_TRACE_SLOT) should be lit. A ramp cycle is LSS_NUM_DIV
+// divisions, and in each a lamp has a level, from the table below: dark, lit, or lit on 1 of
+// 6, 1 of 4 or 1 of 2 passes, on the first pass of each group while rising and the last
+// while falling. After every call of updateSignals the pins must show that lamp's LED lit,
+// or no LED, as the model says, and never more than one LED.
+//
+// Changes only settle once a lamp has finished starting or stopping, which the model doesn't
+// follow: calls are only compared once SETTLE_CYCLES ramp cycles have started since the last
+// change. The pass count is taken up from the start of a ramp cycle, where the library starts
+// it again from 0.
+//
+// Built with LSS_DEBUG_VERIFY, so the library's own checks (one LED, the pin safety net) are
+// counted too, with getVerifyErrors. The test fails on any difference, or any of those.
+//
+// Usage: diffTest [seed [seconds]]	(-v after them lists each difference)
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MASTS 2
+#define HEADS 2				// per mast
+#define LAMPS 3				// per head: red, yellow, green
+#define CHANGE_TIME 5000000UL	// simulated microseconds between changes
+#define SETTLE_CYCLES 3		// ramp cycles to wait after a change
+#define FIRST_PIN 2
+#define LAST_PIN 11
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// the model's lamps: what the changes asked for, and the pins
+struct modelLamp {
+	byte anode;
+	byte cathode;
+	boolean shown;
+	boolean flashing;
+	boolean alternate;
+	boolean ramp;
+};
+
+static modelLamp lamps[MASTS][HEADS][LAMPS];
+
+// levels in each division of the ramp cycle: 0 dark, 4 lit, 1 - 3 lit on one pass in 6, 4 or 2
+// (+ rising, on the first pass of each group; - falling, on the last). The extra entry is the
+// call in which the cycle starts again (the library reports it as division LSS_NUM_DIV), where
+// every shown lamp is lit.
+static const signed char flashLevels[2][2][LSS_NUM_DIV + 1] = {
+	{ // flashing
+		{ 0, 4, 4, 4, 4, 4, 0, 0, 0, 0, 4 },		// no ramp
+		{ 1, 2, 3, 4, 4, 4, -3, -2, -1, 0, 4 }	// ramp
+	},
+	{ // alternating, the same shifted by half a flash
+		{ 4, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4 },
+		{ 4, -3, -2, -1, 0, 1, 2, 3, 4, 4, 4 }
+	}
+};
+
+// modelLit
+//
+// Whether a lamp is lit on a pass in a division.
+static boolean modelLit(const modelLamp &lamp, int div, long pass)
+{
+	static const int groups[4] = {1, 6, 4, 2};
+	int level;
+
+	if (!lamp.shown) return(false);
+	if (!lamp.flashing) return(true);
+	level = flashLevels[lamp.alternate ? 1 : 0][lamp.ramp ? 1 : 0][div];
+	if (level == 0) return(false);
+	if ((level == 4) || (level == -4)) return(true);
+	if (level > 0) return((pass % groups[level]) == 0);
+	return((pass % groups[-level]) == (groups[-level] - 1));
+} // modelLit
+
+// findLamp
+//
+// The model's lamp on a pair of pins, or NULL.
+static modelLamp *findLamp(byte anode, byte cathode)
+{
+	int mast, head, lamp;
+
+	for (mast = 0; mast < MASTS; mast++) {
+		for (head = 0; head < HEADS; head++) {
+			for (lamp = 0; lamp < LAMPS; lamp++) {
+				if ((lamps[mast][head][lamp].anode == anode) && (lamps[mast][head][lamp].cathode == cathode)) return(&lamps[mast][head][lamp]);
+			}
+		}
+	}
+	return(NULL);
+} // findLamp
+
+// from setTrace: the slot, the division and the passes
+static modelLamp *slotLamp;		// the lamp whose slot it is
+static boolean newSlot;			// a slot started in this call
+static boolean passStarted;		// and it began a pass through the lamps
+static modelLamp *seenLamps[MASTS * HEADS * LAMPS];	// lamps with slots so far in this pass
+static int seenCount;
+static int division = -1;		// not known yet
+static long passes;				// since the start of the ramp cycle
+static int cyclesSinceChange;	// ramp cycles started since the last change
+
+void traceModel(byte event, byte arg1, byte arg2)
+{
+	int n;
+
+	if (event == LSS_TRACE_SLOT) {
+		slotLamp = findLamp(arg1, arg2);
+		newSlot = true;
+		passStarted = (seenCount == 0);
+		for (n = 0; n < seenCount; n++) if (seenLamps[n] == slotLamp) passStarted = true; // back to a lamp already seen
+		if (passStarted) seenCount = 0;
+		seenLamps[seenCount++] = slotLamp;
+	} else if (event == LSS_TRACE_DIV) {
+		division = arg1;
+		if (division >= LSS_NUM_DIV) { // the cycle starts again
+			passes = 0;
+			cyclesSinceChange++;
+		}
+	}
+} // traceModel
+
+// goDark
+//
+// Turn a lamp off in the model. A lamp that goes dark stops flashing and alternating.
+static void goDark(modelLamp &lamp)
+{
+	lamp.shown = false;
+	lamp.flashing = false;
+	lamp.alternate = false;
+} // goDark
+
+// change
+//
+// Make one random change, to the signals and the model alike.
+static void change(hostBoard &board, linesideSignal &signals, boolean verbose)
+{
+	int mast = int(board.nextRandom() % MASTS);
+	int head = int(board.nextRandom() % HEADS);
+	int lamp = int(board.nextRandom() % LAMPS);
+	int color, n;
+	boolean on;
+
+	switch (board.nextRandom() % 6) {
+		case 0:
+		case 1:
+			color = LSS_RED + int(board.nextRandom() % LAMPS);
+			on = ((board.nextRandom() % 3) == 0);
+			signals.setHeadColor(mast + 1, head + 1, color, on);
+			if (verbose) printf("setHeadColor(%d, %d, %d, %d)\n", mast + 1, head + 1, color, on);
+			for (n = 0; n < LAMPS; n++) if (n != color - LSS_RED) goDark(lamps[mast][head][n]);
+			lamps[mast][head][color - LSS_RED].shown = true;
+			lamps[mast][head][color - LSS_RED].flashing = on;
+		break;
+		case 2:
+			signals.clearHead(mast + 1, head + 1);
+			if (verbose) printf("clearHead(%d, %d)\n", mast + 1, head + 1);
+			for (n = 0; n < LAMPS; n++) goDark(lamps[mast][head][n]);
+		break;
+		case 3:
+			on = ((board.nextRandom() % 2) == 0);
+			signals.setAlternate(mast + 1, head + 1, lamp + 1, on);
+			if (verbose) printf("setAlternate(%d, %d, %d, %d)\n", mast + 1, head + 1, lamp + 1, on);
+			lamps[mast][head][lamp].shown = true;
+			lamps[mast][head][lamp].flashing = true;
+			lamps[mast][head][lamp].alternate = on;
+		break;
+		case 4:
+			on = ((board.nextRandom() % 4) != 0);
+			signals.setRamp(mast + 1, head + 1, lamp + 1, on);
+			if (verbose) printf("setRamp(%d, %d, %d, %d)\n", mast + 1, head + 1, lamp + 1, on);
+			lamps[mast][head][lamp].ramp = on;
+		break;
+		default:
+			n = 40 + int(board.nextRandom() % 81);
+			signals.setFlashRate(n);
+			if (verbose) printf("setFlashRate(%d)\n", n);
+		break;
+	} // switch
+	cyclesSinceChange = 0;
+} // change
+
+int main(int argc, char **argv)
+{
+	hostBoard board;
+	linesideSignal signals;
+	unsigned long runTime = 600000000UL;
+	unsigned long start, changed;
+	long calls = 0, compared = 0, slots = 0, differences = 0, extraLit = 0;
+	boolean verbose = false, actual, expected;
+	modelLamp *lit;
+	int mast, head, lamp, pin, n;
+
+	for (n = 1; n < argc; n++) if (strcmp(argv[n], "-v") == 0) verbose = true;
+	if ((argc > 1) && (argv[1][0] != '-')) board.randomState = strtoul(argv[1], NULL, 10);
+	if ((argc > 2) && (argv[2][0] != '-')) runTime = strtoul(argv[2], NULL, 10) * 1000000UL;
+
+	board.echo = false;
+	board.use();
+	signals.setupSignal();
+	for (mast = 0; mast < MASTS; mast++) { // common anode: one anode per head, a cathode per lamp of the mast
+		for (head = 0; head < HEADS; head++) {
+			for (lamp = 0; lamp < LAMPS; lamp++) {
+				lamps[mast][head][lamp].anode = FIRST_PIN + (mast * HEADS) + head;
+				lamps[mast][head][lamp].cathode = FIRST_PIN + (MASTS * HEADS) + (mast * LAMPS) + lamp;
+				lamps[mast][head][lamp].ramp = true;
+				signals.addLamp(mast + 1, head + 1, lamp + 1, lamps[mast][head][lamp].anode, lamps[mast][head][lamp].cathode, LSS_RED + lamp);
+			}
+		}
+	}
+	signals.setTrace(traceModel);
+
+	printf("diffTest: seed %lu, %lu s simulated, a change every %lu s\n", board.randomState, runTime / 1000000UL, CHANGE_TIME / 1000000UL);
+	start = board.now();
+	changed = start - CHANGE_TIME;
+	while ((board.now() - start) < runTime) {
+		if ((board.now() - changed) >= CHANGE_TIME) {
+			changed = board.now();
+			if (verbose) printf("%9lu us: ", board.now() - start);
+			change(board, signals, verbose);
+		}
+		newSlot = false;
+		signals.updateSignals();
+		calls++;
+
+		// the LED lit now, if any (more than one is always wrong)
+		lit = NULL;
+		for (pin = 0, n = 0; pin < MASTS * HEADS * LAMPS; pin++) {
+			modelLamp *m = &lamps[0][0][0] + pin;
+			if (board.lit(m->anode, m->cathode)) {
+				lit = m;
+				n++;
+			}
+		}
+		if (board.litCount(FIRST_PIN, LAST_PIN) > 1) extraLit++;
+
+		if ((slotLamp != NULL) && (division >= 0) && (cyclesSinceChange >= SETTLE_CYCLES)) {
+			expected = modelLit(*slotLamp, division, passes);
+			actual = (lit == slotLamp);
+			compared++;
+			if (newSlot) slots++;
+			if ((actual != expected) || ((lit != NULL) && (lit != slotLamp))) {
+				differences++;
+				if (verbose) {
+					printf("  %9lu us: lamp %d/%d/%d (%s%s%s%s), division %d, pass %ld: %s, should be %s\n", board.now() - start,
+						int(slotLamp - &lamps[0][0][0]) / (HEADS * LAMPS) + 1, (int(slotLamp - &lamps[0][0][0]) / LAMPS) % HEADS + 1,
+						int(slotLamp - &lamps[0][0][0]) % LAMPS + 1, slotLamp->shown ? "shown" : "dark", slotLamp->flashing ? " flashing" : "",
+						slotLamp->alternate ? " alternate" : "", slotLamp->ramp ? " ramp" : "", division, passes,
+						(lit == NULL) ? "dark" : ((lit == slotLamp) ? "lit" : "another lit"), expected ? "lit" : "dark");
+				}
+			}
+		}
+		if (newSlot && passStarted) passes++; // the pass count goes up after the call that began a pass
+		board.advance(loopTime());
+	}
+
+	printf("  %ld calls, %ld compared (%ld slots started), %ld differ from the model\n", calls, compared, slots, differences);
+	printf("  %ld calls with more than one LED lit, %u problems found by LSS_DEBUG_VERIFY\n", extraLit, signals.getVerifyErrors());
+	if ((compared == 0) || (differences > 0) || (extraLit > 0) || (signals.getVerifyErrors() > 0)) {
+		printf("FAIL\n");
+		return(1);
+	}
+	printf("ok\n");
+	return(0);
+} // main
@@ -0,0 +1,181 @@
+// dualCoreTest
+//
+// The DualCoreExample on a PC, with a std::thread for each core: the LED thread does nothing but
+// call updateSignals, and the sketch thread changes the heads with queueCommand (LSS_USE_QUEUE)
+// and sees what they show with readState (LSS_USE_SNAPSHOT). The board follows the PC's clock
+// (realTime), as the threads run against each other.
+//
+// The sketch thread makes ROUND_TRIPS round trips: it queues the next color for the top head,
+// then reads the lamps until they show it. The lamps don't ramp, so the change shows as soon as
+// the command is carried out. Every read must be well formed: whole records, each a lamp that
+// exists with no flags but LSS_STATE_FLASH and LSS_STATE_ALT, one lit lamp on each of the two
+// lower heads (which don't change) and no more than one on the top head (which can read as dark
+// while it changes). Fails on any read that isn't, or a round trip that takes longer than
+// TRIP_LIMIT: a queued command is carried out in the next slot, and a copy made straight after,
+// so it mustn't be left for the copy made at the next ramp division.
+//
+// Prints the latency of the round trips (queueCommand to seeing the change), and the jitter of
+// the LED thread: the time from each LED's slot starting to the next, taken from the pins. On a
+// PC both depend on how the threads are scheduled (on one core, they take turns), so they are
+// printed but not checked; on a dual-core board the LED core has a core to itself.
+//
+// Usage: dualCoreTest [round trips]
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <thread>
+
+#define ROUND_TRIPS 3000L
+#define TRIP_LIMIT 50000UL	// microseconds, half a ramp division at the default flash rate
+
+static linesideSignal signals;
+static volatile boolean stopping;
+
+// from the pins, on the LED thread: the time from each slot starting to the next
+static byte litPin;
+static unsigned long slotAt, slots;
+static unsigned long shortest = 0xFFFFFFFFUL, longest;
+static double slotSum, slotSquares;
+
+static void watchPins(hostBoard *board, byte pin)
+{
+	unsigned long now, length;
+
+	if ((pin < 3) || (pin > 11)) return; // only the cathodes
+	if (!board->lit(2, pin)) {
+		if (pin == litPin) litPin = 0;
+		return;
+	}
+	if (pin == litPin) return; // already lit
+	litPin = pin;
+	now = board->now();
+	if (slotAt != 0) {
+		length = now - slotAt;
+		slots++;
+		slotSum += length;
+		slotSquares += double(length) * length;
+		if (length < shortest) shortest = length;
+		if (length > longest) longest = length;
+	}
+	slotAt = now;
+} // watchPins
+
+// the LED core
+static void ledCore(hostBoard *board)
+{
+	board->use();
+	while (!stopping) signals.updateSignals();
+} // ledCore
+
+// wellFormed
+//
+// Returns true if what readState gave is a lit lamp for each of the lower heads, no more than one
+// for the top head, and nothing else.
+static boolean wellFormed(const byte *state, int len)
+{
+	byte heads = 0;
+	int n;
+
+	if ((len % LSS_STATE_RECORD) != 0) return(false);
+	for (n = 0; n < len; n += LSS_STATE_RECORD) { // mast, head, lamp, flags
+		if ((state[n] != 1) || (state[n + 1] < 1) || (state[n + 1] > 3) || (state[n + 2] < 1) || (state[n + 2] > 3)) return(false);
+		if ((state[n + 3] & ~(LSS_STATE_FLASH | LSS_STATE_ALT)) != 0) return(false);
+		if (heads & (1 << state[n + 1])) return(false); // two lamps on one head
+		heads |= (1 << state[n + 1]);
+	}
+	return((heads & 0x0C) == 0x0C); // heads 2 and 3
+} // wellFormed
+
+// shows
+//
+// Returns true if what readState gave has the lamp lit on the head.
+static boolean shows(const byte *state, int len, byte head, byte lamp)
+{
+	int n;
+
+	for (n = 0; n < len; n += LSS_STATE_RECORD) if ((state[n + 1] == head) && (state[n + 2] == lamp)) return(true);
+	return(false);
+} // shows
+
+int main(int argc, char **argv)
+{
+	static const byte colors[3] = {LSS_GREEN, LSS_YELLOW, LSS_RED}; // lamps 1 - 3
+	hostBoard board;
+	byte state[LSS_SNAPSHOT_BYTES];
+	byte shown[2] = {0, 3}; // the lamp lit on the top head
+	byte args[4];
+	long trips = ROUND_TRIPS, trip, reads = 0, malformed = 0, late = 0, full = 0;
+	unsigned long start, latency, total = 0, most = 0;
+	int len, head, lamp;
+	double mean;
+
+	if (argc > 1) trips = atol(argv[1]);
+	board.echo = false;
+	board.use();
+	board.setRealTime(true);
+	signals.setupSignal();
+	for (head = 1; head <= 3; head++) { // the first mast of SignalExample
+		for (lamp = 1; lamp <= 3; lamp++) {
+			signals.addLamp(1, head, lamp, 2, (3 * head) + lamp - 1, colors[lamp - 1]);
+			signals.setRamp(1, head, lamp, false);
+		}
+		signals.setHeadColor(1, head, LSS_RED);
+	}
+	board.pinHook = watchPins;
+	std::thread leds(ledCore, &board);
+	start = board.now();
+	while ((signals.readState(state, sizeof(state)) == 0) && ((board.now() - start) < 2000000UL)) std::this_thread::yield(); // the first copy is made once the pins are drained
+	if (signals.readState(state, sizeof(state)) == 0) trips = 0; // never made
+
+	for (trip = 0; trip < trips; trip++) {
+		head = 1;
+		lamp = (shown[head] % 3) + 1; // the next color
+		args[0] = 1;
+		args[1] = head;
+		args[2] = colors[lamp - 1];
+		args[3] = 0; // not flashing
+		start = board.now();
+		while (!signals.queueCommand(LSS_CMD_HEAD, args, 4)) {
+			full++;
+			std::this_thread::yield();
+		}
+		do {
+			len = signals.readState(state, sizeof(state));
+			reads++;
+			if (!wellFormed(state, len)) {
+				if (malformed++ < 10) printf("FAIL: read %ld malformed, %d bytes\n", reads, len);
+			}
+			if (shows(state, len, head, lamp)) break;
+			std::this_thread::yield(); // the rest of the sketch, and on one core, the LED thread's turn
+		} while ((board.now() - start) < TRIP_LIMIT);
+		latency = board.now() - start;
+		if (latency >= TRIP_LIMIT) { // lost, no use going on
+			late++;
+			break;
+		}
+		total += latency;
+		if (latency > most) most = latency;
+		shown[head] = lamp;
+	}
+	stopping = true;
+	leds.join();
+	board.pinHook = NULL;
+
+	printf("%ld round trips, %ld reads, %ld malformed; latency %lu us on average, the longest %lu us; the queue was full %ld times\n",
+		trip, reads, malformed, (trip > 0) ? (total / trip) : 0, most, full);
+	if (slots > 0) {
+		mean = slotSum / slots;
+		printf("%lu LED slots: %.0f us on average, %lu - %lu us, jitter (standard deviation) %.0f us\n",
+			slots, mean, shortest, longest, sqrt((slotSquares / slots) - (mean * mean)));
+	}
+	if ((malformed > 0) || (late > 0) || (trip == 0)) {
+		printf("FAIL: %ld reads malformed, %ld round trips over %lu ms\n", malformed, late, TRIP_LIMIT / 1000UL);
+		return(1);
+	}
+	return(0);
+} // main
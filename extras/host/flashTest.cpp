@@ -0,0 +1,91 @@
+// flashTest
+//
+// Checks that a flashing lamp keeps its flash length when other lamps light or go dark partway
+// through a flash, on a simulated Uno.
+//
+// Mast 1 flashes yellow at the default rate (LSS_FLASH_FPM, so each flash should take 60000 /
+// LSS_FLASH_FPM ms from the start of one to the start of the next). Four more heads are lit
+// partway through the fourth flash and put out again partway through the eighth, which changes
+// the time each LED gets in the cycle. The start of each flash is taken from the pins: the
+// first slot with the flashing LED lit after it has been dark for at least a tenth of a flash.
+// This prints the length of each flash, and fails if any differs from the rate by more than
+// FLASH_TOLERANCE percent.
+//
+// It uses nothing newer than setupSignal, addLamp, setHeadColor and updateSignals, so it can
+// be built against an older version with make LIBDIR=dir, to compare (that will fail the test).
+// Versions before the loop average was checked for zero divide by it on the first call, which
+// stops the program on a PC (but not on an AVR): guard that line in the older copy first.
+//
+// Usage: flashTest
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FLASHES 12
+#define FLASH_TOLERANCE 5	// percent
+#define FLASH_ANODE 2
+#define FLASH_CATHODE 8
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+int main()
+{
+	hostBoard board;
+	linesideSignal signals;
+	unsigned long flashTime = 60000000UL / LSS_FLASH_FPM; // microseconds from one flash to the next
+	unsigned long starts[FLASHES + 1];
+	unsigned long lastLit = 0, length;
+	int flashes = 0;
+	int mast;
+	boolean failed = false;
+
+	board.echo = false;
+	board.use();
+	signals.setupSignal();
+	for (mast = 1; mast <= 5; mast++) { // green, yellow and red on cathodes 7 - 9, with the anode on pin mast + 1
+		signals.addLamp(mast, 1, 1, mast + 1, 7, LSS_GREEN);
+		signals.addLamp(mast, 1, 2, mast + 1, 8, LSS_YELLOW);
+		signals.addLamp(mast, 1, 3, mast + 1, 9, LSS_RED);
+	}
+	signals.setHeadColor(1, 1, LSS_YELLOW, true);
+
+	while (flashes <= FLASHES) {
+		board.advance(loopTime());
+		signals.updateSignals();
+		if (!board.lit(FLASH_ANODE, FLASH_CATHODE)) continue;
+		if ((lastLit == 0) || ((board.now() - lastLit) > (flashTime / 10))) { // a new flash
+			starts[flashes++] = board.now();
+			if (flashes == 4) { // partway through it (once the ramp is on its way up), light four heads
+				for (mast = 2; mast <= 5; mast++) signals.setHeadColor(mast, 1, (mast & 1) ? LSS_RED : LSS_GREEN);
+			}
+			if (flashes == 8) { // and put them out again
+				for (mast = 2; mast <= 5; mast++) signals.setHeadColor(mast, 1, LSS_DARK);
+			}
+		}
+		lastLit = board.now();
+	}
+
+	printf("flashing yellow at %d a minute (%lu ms each), four heads lit in flash 4 and out in flash 8:\n", LSS_FLASH_FPM, flashTime / 1000);
+	for (mast = 1; mast < FLASHES; mast++) { // the first starts with the lamp, rather than a flash
+		length = starts[mast + 1] - starts[mast];
+		printf("  flash %2d: %5lu ms", mast, length / 1000);
+		if ((length * 100UL < flashTime * (100UL - FLASH_TOLERANCE)) || (length * 100UL > flashTime * (100UL + FLASH_TOLERANCE))) {
+			printf("  FAIL\n");
+			failed = true;
+		} else {
+			printf("  ok\n");
+		}
+	}
+	return(failed ? 1 : 0);
+} // main
@@ -0,0 +1,574 @@
+/*  hostArduino.cpp
+	The Arduino functions for a PC, acting on simulated boards (see Arduino.h).
+
+    Released into the public domain.
+*/
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include <stdio.h>
+#include <chrono>
+
+static hostBoard _defaultBoard;	// used by any thread that hasn't picked one
+static thread_local hostBoard *_currentBoard = NULL;
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+// PC clock, in nanoseconds
+static long long _hostNanos()
+{
+	return(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+} // hostNanos
+
+/************************ hostBoard ******************************/
+
+// constructor - a board just after reset: all pins inputs, reading LOW, EEPROM erased
+hostBoard::hostBoard()
+{
+	int pin;
+
+	us = 0;
+	quarters = 0;
+	realTime = false;
+	costs = true;
+	for (pin = 0; pin < HOST_PINS; pin++) {
+		mode[pin] = INPUT;
+		level[pin] = LOW;
+		input[pin] = LOW;
+		analog[pin] = 0;
+		interrupt[pin] = NULL;
+	}
+	pinHook = NULL;
+	interruptsOn = true;
+	edgePin = 0;
+	edges = NULL;
+	edgeCount = 0;
+	nextEdge = 0;
+	lateEdges = 0;
+	worstLate = 0;
+	inInterrupt = false;
+	microsCalls = 0;
+	timer1Reads = 0;
+	pinModes = 0;
+	pinWrites = 0;
+	analogReads = 0;
+	delayed = 0;
+	rxHead = 0;
+	rxTail = 0;
+	echo = true;
+	baud = 115200;
+	lineDue = 0;
+	rxMost = 0;
+	rxLost = 0;
+	memset(eeprom, 0xFF, sizeof(eeprom));
+	tccr1a = 0;
+	tccr1b = 0;
+	timsk1 = 0;
+	randomState = 1;
+	user = NULL;
+	_realStart = 0;
+} // constructor
+
+// use
+//
+// Make this the board the Arduino functions act on, for the calling thread.
+void hostBoard::use()
+{
+	_currentBoard = this;
+} // use
+
+// current
+//
+// The board the Arduino functions act on, for the calling thread.
+hostBoard *hostBoard::current()
+{
+	return((_currentBoard != NULL) ? _currentBoard : &_defaultBoard);
+} // current
+
+// setRealTime
+//
+// Follow the PC's clock from now on (carrying on from the simulated time), or go back to
+// simulated time. Nothing is charged for calls on a realTime board.
+void hostBoard::setRealTime(boolean on)
+{
+	if (on == realTime) return;
+
+	if (on) {
+		_realStart = _hostNanos();
+	} else {
+		us = now();
+	}
+	realTime = on;
+	costs = !on;
+} // setRealTime
+
+// now
+//
+// The clock, without charging for reading it.
+unsigned long hostBoard::now()
+{
+	if (realTime) return(us + (unsigned long)((_hostNanos() - _realStart) / 1000));
+	return(us);
+} // now
+
+// advance
+//
+// Move the simulated clock on, for time spent outside the library (the rest of loop(), or
+// a board waiting for something). On a realTime board, wait that long.
+void hostBoard::advance(unsigned long usec)
+{
+	unsigned long start;
+
+	if (realTime) {
+		start = now();
+		while ((now() - start) < usec) {}
+		return;
+	}
+	runTo(us + usec);
+} // advance
+
+// charge
+//
+// The time a call takes, if costs are being charged.
+void hostBoard::charge(int usec)
+{
+	if (costs) runTo(us + usec);
+} // charge
+
+// setEdges
+//
+// Play a signal into an input pin: it changes level at each of the times given (simulated
+// microseconds, in order), calling the routine attachInterrupt gave for the pin. The times
+// are kept, not copied.
+void hostBoard::setEdges(byte pin, const unsigned long *times, long count)
+{
+	edgePin = pin;
+	edges = times;
+	edgeCount = count;
+	nextEdge = 0;
+} // setEdges
+
+// runTo
+//
+// Move the simulated clock on to target, stopping at each edge due on the way (see setEdges)
+// to run its interrupt routine. The routine's time is added on, as it is taken from the code
+// it interrupted. Edges that came while interrupts were off are run now, late.
+void hostBoard::runTo(unsigned long target)
+{
+	unsigned long edge;
+	unsigned long from;
+
+	while (!inInterrupt && interruptsOn && (nextEdge < edgeCount) && (long(edges[nextEdge] - target) <= 0)) {
+		edge = edges[nextEdge++];
+		if (long(edge - us) > 0) {
+			us = edge;
+		} else if (us != edge) {
+			lateEdges++;
+			if ((us - edge) > worstLate) worstLate = us - edge;
+		}
+		if (edgePin < HOST_PINS) input[edgePin] = (input[edgePin] == LOW) ? HIGH : LOW;
+		from = us;
+		if ((edgePin < HOST_PINS) && (interrupt[edgePin] != NULL)) {
+			inInterrupt = true;
+			interrupt[edgePin]();
+			inInterrupt = false;
+		}
+		target += us - from;
+	}
+	if (long(target - us) > 0) us = target;
+} // runTo
+
+// send
+//
+// Put bytes in the serial input, as if they had arrived on the port.
+void hostBoard::send(const char *text)
+{
+	send((const byte *)text, int(strlen(text)));
+} // send
+
+void hostBoard::send(const byte *data, int len)
+{
+	int n;
+
+	if (rxTail == rxHead) { // empty, start again at the front
+		rxTail = 0;
+		rxHead = 0;
+	}
+	if ((rxHead + len) > HOST_RX) { // move what's left to the front to make room
+		memmove(rx, &rx[rxTail], rxHead - rxTail);
+		rxHead -= rxTail;
+		rxTail = 0;
+	}
+	for (n = 0; (n < len) && (rxHead < HOST_RX); n++) rx[rxHead++] = data[n];
+} // send
+
+// transmit
+//
+// Send bytes down the serial line at baud, as a PC would: each arrives a character time
+// (10 bits) after the one before, or after now if the line is idle. Bytes are put in the
+// serial input as the clock reaches them (see deliver), and as on the Arduino, are lost if
+// HOST_SERIAL_BUFFER are already waiting.
+void hostBoard::transmit(const char *text)
+{
+	transmit((const byte *)text, int(strlen(text)));
+} // transmit
+
+void hostBoard::transmit(const byte *data, int len)
+{
+	deliver();
+	if (line.empty()) lineDue = now() + (10000000UL / baud);
+	line.append((const char *)data, len);
+} // transmit
+
+// deliver
+//
+// Move the bytes transmit has sent that have arrived by now into the serial input. The
+// serial port does this itself before each available, read or peek.
+void hostBoard::deliver()
+{
+	unsigned long t = now();
+	size_t n = 0;
+	byte c;
+
+	while ((n < line.size()) && (long(t - lineDue) >= 0)) {
+		c = byte(line[n++]);
+		if ((rxHead - rxTail) >= HOST_SERIAL_BUFFER) {
+			rxLost++;
+		} else {
+			send(&c, 1);
+			if ((rxHead - rxTail) > rxMost) rxMost = rxHead - rxTail;
+		}
+		lineDue += 10000000UL / baud;
+	}
+	if (n > 0) line.erase(0, n);
+} // deliver
+
+// takeOutput
+//
+// Everything written to the serial port since the last call.
+std::string hostBoard::takeOutput()
+{
+	std::string out;
+
+	out.swap(output);
+	return(out);
+} // takeOutput
+
+// lit
+//
+// Returns true if an LED from anode to cathode would be lit: the anode driven HIGH and the
+// cathode driven LOW.
+boolean hostBoard::lit(byte anode, byte cathode)
+{
+	if ((anode >= HOST_PINS) || (cathode >= HOST_PINS)) return(false);
+	return((mode[anode] == OUTPUT) && (level[anode] == HIGH) && (mode[cathode] == OUTPUT) && (level[cathode] == LOW));
+} // lit
+
+// litCount
+//
+// The number of LEDs lit among the pins firstPin - lastPin, taking every pair as an LED.
+int hostBoard::litCount(byte firstPin, byte lastPin)
+{
+	int anode, cathode;
+	int count = 0;
+
+	for (anode = firstPin; anode <= lastPin; anode++) {
+		for (cathode = firstPin; cathode <= lastPin; cathode++) {
+			if ((anode != cathode) && lit(anode, cathode)) count++;
+		}
+	}
+	return(count);
+} // litCount
+
+// timer1
+//
+// TCNT1, running at 2 MHz from the clock once TCCR1B has started it.
+uint16_t hostBoard::timer1()
+{
+	if (!realTime) {
+		timer1Reads++;
+		quarters += HOST_TIMER1_QUARTERS;
+		if (costs && (quarters >= 4)) {
+			runTo(us + (quarters / 4));
+			quarters %= 4;
+		}
+	}
+	if (tccr1b == 0) return(0); // stopped
+	return(uint16_t((now() * 2) + (quarters / 2)));
+} // timer1
+
+// nextRandom
+//
+// The board's own random numbers, so each board's sequence doesn't depend on the others.
+unsigned long hostBoard::nextRandom()
+{
+	randomState = (randomState * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(randomState >> 8);
+} // nextRandom
+
+/************************ Arduino functions ******************************/
+
+unsigned long micros()
+{
+	hostBoard *board = hostBoard::current();
+
+	if (!board->realTime) board->microsCalls++;
+	board->charge(HOST_COST_MICROS);
+	return(board->now());
+} // micros
+
+unsigned long millis()
+{
+	return(micros() / 1000);
+} // millis
+
+void delay(unsigned long ms)
+{
+	hostBoard *board = hostBoard::current();
+
+	if (!board->realTime) board->delayed += ms * 1000;
+	board->advance(ms * 1000);
+} // delay
+
+void delayMicroseconds(unsigned int usec)
+{
+	hostBoard *board = hostBoard::current();
+
+	if (!board->realTime) board->delayed += usec;
+	board->advance(usec);
+} // delayMicroseconds
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	hostBoard *board = hostBoard::current();
+
+	if (pin >= HOST_PINS) return;
+	board->mode[pin] = mode;
+	if (mode != OUTPUT) board->level[pin] = LOW; // as on an AVR, INPUT clears the pull-up
+	if (!board->realTime) board->pinModes++;
+	board->charge(HOST_COST_PIN);
+	if (board->pinHook != NULL) board->pinHook(board, pin);
+} // pinMode
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	hostBoard *board = hostBoard::current();
+
+	if (pin >= HOST_PINS) return;
+	board->level[pin] = (val == LOW) ? LOW : HIGH;
+	if (!board->realTime) board->pinWrites++;
+	board->charge(HOST_COST_PIN);
+	if (board->pinHook != NULL) board->pinHook(board, pin);
+} // digitalWrite
+
+int digitalRead(uint8_t pin)
+{
+	hostBoard *board = hostBoard::current();
+
+	if (pin >= HOST_PINS) return(LOW);
+	board->charge(HOST_COST_PIN);
+	if (board->mode[pin] == OUTPUT) return(board->level[pin]);
+	return(board->input[pin]);
+} // digitalRead
+
+int analogRead(uint8_t pin)
+{
+	hostBoard *board = hostBoard::current();
+
+	if ((pin < A0) && (pin < NUM_ANALOG_INPUTS)) pin += A0; // channel numbers, as analogRead(0)
+	if (pin >= HOST_PINS) return(0);
+	if (!board->realTime) board->analogReads++;
+	board->charge(HOST_COST_ANALOG);
+	return(board->analog[pin]);
+} // analogRead
+
+void attachInterrupt(uint8_t num, void (*isr)(), int mode)
+{
+	if (num < HOST_PINS) hostBoard::current()->interrupt[num] = isr;
+} // attachInterrupt
+
+void detachInterrupt(uint8_t num)
+{
+	if (num < HOST_PINS) hostBoard::current()->interrupt[num] = NULL;
+} // detachInterrupt
+
+void noInterrupts()
+{
+	hostBoard::current()->interruptsOn = false;
+} // noInterrupts
+
+void interrupts()
+{
+	hostBoard *board = hostBoard::current();
+
+	board->interruptsOn = true;
+	board->runTo(board->us); // any edges held up
+} // interrupts
+
+long random(long howBig)
+{
+	if (howBig <= 0) return(0);
+	return(long(hostBoard::current()->nextRandom() % (unsigned long)howBig));
+} // random
+
+long random(long howSmall, long howBig)
+{
+	if (howSmall >= howBig) return(howSmall);
+	return(howSmall + random(howBig - howSmall));
+} // random
+
+void randomSeed(unsigned long seed)
+{
+	if (seed != 0) hostBoard::current()->randomState = seed;
+} // randomSeed
+
+/************************ Print ******************************/
+
+size_t Print::write(const uint8_t *buf, size_t len)
+{
+	size_t n;
+
+	for (n = 0; n < len; n++) write(buf[n]);
+	return(len);
+} // write
+
+size_t Print::write(const char *str)
+{
+	return(write((const uint8_t *)str, strlen(str)));
+} // write
+
+int Print::availableForWrite()
+{
+	return(0);
+} // availableForWrite
+
+size_t Print::_printNumber(unsigned long n, int base)
+{
+	char buf[8 * sizeof(long) + 1];
+	char *str = &buf[sizeof(buf) - 1];
+	char c;
+
+	if (base < 2) base = 10;
+	*str = '\0';
+	do {
+		c = char(n % base);
+		n /= base;
+		*--str = (c < 10) ? (c + '0') : (c + 'A' - 10);
+	} while (n != 0);
+	return(write(str));
+} // printNumber
+
+size_t Print::print(const char *str) { return(write(str)); }
+size_t Print::print(char c) { return(write(uint8_t(c))); }
+size_t Print::print(unsigned char n, int base) { return(print((unsigned long)n, base)); }
+size_t Print::print(int n, int base) { return(print(long(n), base)); }
+size_t Print::print(unsigned int n, int base) { return(print((unsigned long)n, base)); }
+
+size_t Print::print(long n, int base)
+{
+	size_t len = 0;
+
+	if (base != 10) return(_printNumber((unsigned long)n, base));
+	if (n < 0) {
+		len = print('-');
+		n = -n;
+	}
+	return(len + _printNumber((unsigned long)n, 10));
+} // print
+
+size_t Print::print(unsigned long n, int base) { return(_printNumber(n, base)); }
+
+size_t Print::print(double n, int digits)
+{
+	char buf[48];
+
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return(write(buf));
+} // print
+
+size_t Print::println(const char *str) { return(print(str) + println()); }
+size_t Print::println(char c) { return(print(c) + println()); }
+size_t Print::println(unsigned char n, int base) { return(print(n, base) + println()); }
+size_t Print::println(int n, int base) { return(print(n, base) + println()); }
+size_t Print::println(unsigned int n, int base) { return(print(n, base) + println()); }
+size_t Print::println(long n, int base) { return(print(n, base) + println()); }
+size_t Print::println(unsigned long n, int base) { return(print(n, base) + println()); }
+size_t Print::println(double n, int digits) { return(print(n, digits) + println()); }
+size_t Print::println() { return(write("\r\n")); }
+
+/************************ HardwareSerial ******************************/
+
+void HardwareSerial::begin(unsigned long baud) {}
+
+HardwareSerial::operator bool()
+{
+	return(true);
+} // bool
+
+size_t HardwareSerial::write(uint8_t c)
+{
+	hostBoard *board = hostBoard::current();
+
+	board->output += char(c);
+	if (board->echo && (c != '\r')) putchar(c); // leaving out println's, which the PC doesn't want
+	return(1);
+} // write
+
+int HardwareSerial::availableForWrite()
+{
+	return(63); // an empty transmit buffer, as the simulated line is never slow
+} // availableForWrite
+
+int HardwareSerial::available()
+{
+	hostBoard *board = hostBoard::current();
+
+	board->deliver();
+
+	return(board->rxHead - board->rxTail);
+} // available
+
+int HardwareSerial::read()
+{
+	hostBoard *board = hostBoard::current();
+
+	board->deliver();
+
+	if (board->rxTail >= board->rxHead) return(-1);
+	return(board->rx[board->rxTail++]);
+} // read
+
+int HardwareSerial::peek()
+{
+	hostBoard *board = hostBoard::current();
+
+	board->deliver();
+
+	if (board->rxTail >= board->rxHead) return(-1);
+	return(board->rx[board->rxTail]);
+} // peek
+
+/************************ EEPROM ******************************/
+
+uint8_t EEPROMClass::read(int address)
+{
+	if ((address < 0) || (address >= HOST_EEPROM)) return(0xFF);
+	return(hostBoard::current()->eeprom[address]);
+} // read
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+	if ((address < 0) || (address >= HOST_EEPROM)) return;
+	hostBoard::current()->eeprom[address] = value;
+} // write
+
+void EEPROMClass::update(int address, uint8_t value)
+{
+	write(address, value);
+} // update
+
+uint16_t EEPROMClass::length()
+{
+	return(HOST_EEPROM);
+} // length
@@ -0,0 +1,157 @@
+/*  hostProcess.cpp
+	A simulated Arduino in a process of its own (see hostProcess.h).
+
+    Released into the public domain.
+*/
+
+#include "hostProcess.h"
+#include <stdio.h>
+#include <set>
+#include <mutex>
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+// the program's ends of the pipes to every process not yet waited for: a new process closes
+// them, so it doesn't hold another's pipe open and each sees the program finish
+static std::set<int> _programEnds;
+static std::mutex _programLock;	// wait may be called from several threads
+
+// constructor - no process yet
+hostProcess::hostProcess()
+{
+	isChild = false;
+	_toChild[0] = _toChild[1] = -1;
+	_toParent[0] = _toParent[1] = -1;
+	_pid = 0;
+} // hostProcess constructor
+
+// destructor - a process not waited for is waited for now, so none is left behind
+hostProcess::~hostProcess()
+{
+	if (!isChild && (_pid != 0)) wait();
+} // hostProcess destructor
+
+// start
+//
+// Fork the process. Returns true in the new process, which goes on to run its board and ends
+// with finish, and false in the program. Anything waiting to be printed is printed first, or
+// both would print it. Ends the program if the process can't be made.
+boolean hostProcess::start()
+{
+#if defined(_WIN32)
+	fprintf(stderr, "hostProcess: simulating a board in a process of its own needs fork(), which this PC doesn't have\n");
+	exit(2);
+#else
+	fflush(stdout);
+	fflush(stderr);
+	if ((pipe(_toChild) != 0) || (pipe(_toParent) != 0) || ((_pid = long(fork())) < 0)) {
+		perror("hostProcess");
+		exit(2);
+	}
+	isChild = (_pid == 0);
+	if (isChild) { // each end keeps the ends of the pipes it uses
+		close(_toChild[1]);
+		close(_toParent[0]);
+		for (std::set<int>::iterator end = _programEnds.begin(); end != _programEnds.end(); ++end) close(*end);
+		_programEnds.clear();
+	} else {
+		close(_toChild[0]);
+		close(_toParent[1]);
+		std::lock_guard<std::mutex> hold(_programLock);
+		_programEnds.insert(_toChild[1]);
+		_programEnds.insert(_toParent[0]);
+	}
+#endif
+	return(isChild);
+} // start
+
+// send
+//
+// Send bytes to the other end, which takes them with receive.
+void hostProcess::send(const void *data, size_t len)
+{
+#if !defined(_WIN32)
+	const char *next = (const char *)data;
+	ssize_t done;
+
+	while (len > 0) {
+		done = write(isChild ? _toParent[1] : _toChild[1], next, len);
+		if (done <= 0) {
+			perror("hostProcess");
+			exit(2);
+		}
+		next += done;
+		len -= done;
+	}
+#endif
+} // send
+
+// receive
+//
+// Take bytes sent from the other end, waiting until there are len of them. Returns false if
+// the other end finished (or closed its end) first.
+boolean hostProcess::receive(void *data, size_t len)
+{
+#if !defined(_WIN32)
+	char *next = (char *)data;
+	ssize_t done;
+
+	while (len > 0) {
+		done = read(isChild ? _toChild[0] : _toParent[0], next, len);
+		if (done <= 0) return(false);
+		next += done;
+		len -= done;
+	}
+	return(true);
+#else
+	return(false);
+#endif
+} // receive
+
+// finish
+//
+// End the process (only in the process), with a status for wait: 0 - 255, more is taken as
+// 255. Its output is printed first.
+void hostProcess::finish(int status)
+{
+#if !defined(_WIN32)
+	fflush(stdout);
+	fflush(stderr);
+	close(_toChild[0]);
+	close(_toParent[1]);
+	_exit((status < 0) ? 255 : ((status > 255) ? 255 : status));
+#endif
+} // finish
+
+// wait
+//
+// Wait for the process to end (only in the program), and return its status from finish, or 255
+// if it ended any other way (reported).
+int hostProcess::wait()
+{
+#if !defined(_WIN32)
+	int status;
+	boolean finished;
+
+	if (_pid == 0) return(255); // none
+	{
+		std::lock_guard<std::mutex> hold(_programLock);
+		_programEnds.erase(_toChild[1]);
+		_programEnds.erase(_toParent[0]);
+	}
+	close(_toChild[1]);
+	close(_toParent[0]);
+	finished = ((waitpid(pid_t(_pid), &status, 0) == pid_t(_pid)) && WIFEXITED(status));
+	_pid = 0;
+	if (!finished) {
+		fprintf(stderr, "hostProcess: a board's process ended without finishing\n");
+		return(255);
+	}
+	return(WEXITSTATUS(status));
+#else
+	return(255);
+#endif
+} // wait
@@ -0,0 +1,45 @@
+/*  hostProcess.h
+	A simulated Arduino in a process of its own, for the host programs that run several boards,
+	or one board after another each from a reset.
+
+    Released into the public domain.
+
+    The instances of linesideSignal on a board share its LED pins, and what they share (whose
+    turn it is with the pins, the pins still to discharge, and so on) is kept in static members,
+    as an Arduino only ever runs one board. On a PC each board gets them to itself by running in
+    a process of its own: start forks one, which runs its board and ends with finish; the program
+    and the process talk through a pipe each way with send and receive, and the program picks up
+    the status the process finished with from wait. Each process has its own copy of whatever the
+    program had set up when it was started. Any number may run at once; start them before the
+    program starts any threads (fork copies only the thread that calls it), after which they
+    can be talked to and waited for from any thread, one thread to a process at a time.
+
+    This needs fork and pipe, so runs on Linux and macOS (and Windows under WSL or Cygwin), but
+    not with MinGW, where start reports the problem and ends the program.
+*/
+
+#ifndef	hostProcess_h
+#define hostProcess_h
+
+#include "Arduino.h"
+
+class hostProcess
+{
+  public:
+	boolean isChild;		// true in the process start made
+
+	hostProcess();
+	~hostProcess();
+	boolean start();
+	void send(const void *data, size_t len);
+	boolean receive(void *data, size_t len);
+	void finish(int status);
+	int wait();
+
+  private:
+	int _toChild[2];		// pipe from the program to the process
+	int _toParent[2];		// and back
+	long _pid;				// the process, in the program (0 once waited for)
+}; // hostProcess
+
+#endif
@@ -0,0 +1,547 @@
+// layoutSim
+//
+// Runs a whole layout's signal controllers together on the PC: each controller is a simulated
+// Arduino of its own (a hostBoard in a process of its own, see hostProcess.h) with its own
+// clock, pins and instance of linesideSignal, and they are run in parallel, handed out in
+// slices by a pool of std::threads. The
+// layout is read from a file (clubLayout.txt is an example), which gives each controller's
+// masts, the aspects its heads are set to and when, and the tasks it runs, and the program
+// prints a report on each controller's timing.
+//
+// The controllers are run in slices of SLICE simulated microseconds. Each worker thread keeps
+// its own list of controllers waiting for a slice, and takes them in turn from the front, so
+// they keep close together in simulated time; a worker with none left takes the last from
+// another's list (work stealing), so the threads keep busy whichever controllers take the
+// longest. A thread runs a slice by asking the controller's process to run to the slice's end,
+// and waiting for its counts back, so a controller's state stays in its process whichever
+// thread hands it its slices.
+//
+// Each controller's clock is simulated, as in the other host programs, and is given to the
+// library with setClock so the tasks run on it too. Between calls of updateSignals the clock
+// is moved on by the controller's loop time. The aspects are set with applyCommand, as a
+// command from a layout computer would be. From setTrace and the tasks, the report gives for
+// each controller its lamps, the calls of updateSignals, the LED slots and their mean and
+// longest length, the flash rate, the commands carried out, the tasks run (and the runs
+// expected from their intervals) and their overruns, and the slices it was run in, the times it
+// moved between threads and the PC time it took. Fails if a controller's LEDs were never lit,
+// a command was refused, or a task didn't run as often as its interval says.
+//
+// The layout file has one item a line; # starts a comment:
+//
+//	controller NAME LOOP [COPIES]	a controller, whose loop() takes LOOP microseconds besides
+//									updateSignals; with COPIES, that many alike (NAME1, NAME2 ...)
+//	cycle US						the controller's cycle time (setCycleTime)
+//	rate FPM						and flash rate (setFlashRate)
+//	mast HEADS LAMPS				a mast of HEADS heads of LAMPS lamps, colors 1 - LAMPS from
+//									the top; the masts are numbered in order, and the lamps
+//									charlieplexed on pins 2 - 19 in order
+//	aspect SECONDS MAST HEAD COLOR	set a head at that time; a color is red, yellow, green,
+//									lunar or a number, with * after it to flash
+//	sequence SECONDS MAST HEAD COLOR ...
+//									set a head to each of the colors in turn, one every SECONDS,
+//									for the whole run
+//	task MS COST [TIME]				a task (addTask) every MS milliseconds, COST microseconds,
+//									which takes TIME (half of COST if not given)
+//
+// Usage: layoutSim [-j threads] [file [seconds]]
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include "hostProcess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define RUN_TIME 3600UL		// simulated seconds, if not given
+#define SLICE 1000000UL		// simulated microseconds a controller runs for each time it is taken
+#define FIRST_PIN 2			// the lamps are charlieplexed on pins 2 - 19
+#define LAST_PIN 19
+#define MAX_TASKS 4			// on each controller
+#define LINE_LENGTH 200
+#define FLASHING 0x80		// with a color in the layout file: the head flashes
+
+// a change of aspect, once or over and over
+struct simChange {
+	unsigned long at;		// simulated microseconds from the start, of the next
+	unsigned long period;	// between them, or 0 for once
+	byte mast;
+	byte head;
+	std::vector<byte> colors;	// in turn, with FLASHING set to flash
+	size_t next;
+};
+
+struct simTask {
+	long interval;			// milliseconds
+	int cost;				// microseconds
+	int time;				// microseconds each run takes
+	unsigned long runs;
+	unsigned long added;	// simulated microseconds when it was added
+};
+
+// what a controller's process sends back after each slice, for the report
+struct simCounts {
+	unsigned long now;		// its simulated clock
+	int lamps;
+	unsigned long calls;
+	unsigned long slots, slotAt, slotSum, longestSlot;
+	unsigned long divs, firstDiv, lastDiv;
+	unsigned long commands, refused;
+	unsigned int overruns;	// getTaskOverruns
+	double pcTime;			// seconds of PC time its slices took
+};
+
+// one controller of the layout
+struct simController {
+	char name[40];
+	int loopTime;
+	int cycle;
+	int rate;
+	std::vector<byte> masts;	// heads, lamps for each
+	std::vector<simChange> changes;
+	simTask tasks[MAX_TASKS];
+	int taskCount;
+
+	hostProcess process;	// runs the controller (board and signals are only used there)
+	hostBoard board;
+	linesideSignal signals;
+	int worker;				// the worker that ran its last slice, or -1
+
+	// for the report
+	simCounts counts;		// from its process
+	unsigned long slices, moves;
+	boolean lost;			// its process ended before its time was run
+};
+
+// a worker thread, with its list of controllers waiting for a slice
+struct simWorker {
+	std::mutex lock;
+	std::deque<simController *> waiting;
+	unsigned long slices;
+	unsigned long steals;
+};
+
+static std::vector<simController *> controllers;
+static std::vector<simWorker *> workers;
+static std::atomic<int> unfinished;
+static unsigned long runTime = RUN_TIME * 1000000UL;
+static simController *running;	// the controller run by this process
+
+// from setTrace: the LED slots and the flashes
+static void traceController(byte event, byte arg1, byte arg2)
+{
+	simCounts &c = running->counts;
+	unsigned long now = running->board.now();
+
+	if (event == LSS_TRACE_SLOT) {
+		if (c.slotAt != 0) {
+			c.slots++;
+			c.slotSum += now - c.slotAt;
+			if ((now - c.slotAt) > c.longestSlot) c.longestSlot = now - c.slotAt;
+		}
+		c.slotAt = now;
+	} else if ((event == LSS_TRACE_DIV) && (arg1 == 0)) {
+		if (c.firstDiv == 0) c.firstDiv = now;
+		else c.divs++;
+		c.lastDiv = now;
+	}
+} // traceController
+
+// the tasks: count the run, and take the time it takes
+static void taskRan(int n)
+{
+	running->tasks[n].runs++;
+	running->board.charge(running->tasks[n].time);
+} // taskRan
+
+static void task0() { taskRan(0); }
+static void task1() { taskRan(1); }
+static void task2() { taskRan(2); }
+static void task3() { taskRan(3); }
+static void (*taskRoutines[MAX_TASKS])() = { task0, task1, task2, task3 };
+
+// parseColor
+//
+// A color from the layout file, with FLASHING set if it ends in *; 0 if it isn't one.
+static byte parseColor(const char *word)
+{
+	static const char *names[] = { "red", "yellow", "green", "lunar" }; // LSS_RED - LSS_LUNAR
+	char plain[20];
+	byte flash = 0;
+	int n;
+
+	strncpy(plain, word, sizeof(plain) - 1);
+	plain[sizeof(plain) - 1] = 0;
+	n = strlen(plain);
+	if ((n > 0) && (plain[n - 1] == '*')) {
+		plain[n - 1] = 0;
+		flash = FLASHING;
+	}
+	for (n = 0; n < 4; n++) if (strcmp(plain, names[n]) == 0) return(byte(n + 1) | flash);
+	n = atoi(plain);
+	if ((n < 1) || (n >= FLASHING)) return(0);
+	return(byte(n) | flash);
+} // parseColor
+
+// readLayout
+//
+// Read the layout file into controllers. Prints what is wrong and returns false if it can't.
+static boolean readLayout(const char *file)
+{
+	FILE *f = fopen(file, "r");
+	char line[LINE_LENGTH];
+	char *words[20];
+	std::vector<simController *> group;	// the copies the items are for
+	simChange change;
+	simTask *task;
+	int lineNo = 0, count, n, copies;
+	size_t g;
+
+	if (f == NULL) {
+		printf("layoutSim: can't open %s\n", file);
+		return(false);
+	}
+	while (fgets(line, sizeof(line), f) != NULL) {
+		lineNo++;
+		if (strchr(line, '#') != NULL) *strchr(line, '#') = 0;
+		count = 0;
+		for (words[0] = strtok(line, " \t\r\n"); (words[count] != NULL) && (count < 19); words[count] = strtok(NULL, " \t\r\n")) count++;
+		if (count == 0) continue;
+
+		if ((strcmp(words[0], "controller") == 0) && ((count == 3) || (count == 4))) {
+			copies = (count == 4) ? atoi(words[3]) : 1;
+			if ((copies < 1) || (atoi(words[2]) < 1)) goto bad;
+			group.clear();
+			for (n = 1; n <= copies; n++) {
+				simController *c = new simController();
+				if (copies == 1) snprintf(c->name, sizeof(c->name), "%s", words[1]);
+				else snprintf(c->name, sizeof(c->name), "%s%d", words[1], n);
+				c->loopTime = atoi(words[2]);
+				c->cycle = LSS_CYCLE_TIME;
+				c->rate = LSS_FLASH_FPM;
+				c->worker = -1;
+				controllers.push_back(c);
+				group.push_back(c);
+			}
+			continue;
+		}
+		if (group.empty()) goto bad; // nothing to put it on
+
+		if ((strcmp(words[0], "cycle") == 0) && (count == 2)) {
+			for (g = 0; g < group.size(); g++) group[g]->cycle = atoi(words[1]);
+		} else if ((strcmp(words[0], "rate") == 0) && (count == 2)) {
+			for (g = 0; g < group.size(); g++) group[g]->rate = atoi(words[1]);
+		} else if ((strcmp(words[0], "mast") == 0) && (count == 3)) {
+			if ((atoi(words[1]) < 1) || (atoi(words[2]) < 1)) goto bad;
+			for (g = 0; g < group.size(); g++) {
+				group[g]->masts.push_back(byte(atoi(words[1])));
+				group[g]->masts.push_back(byte(atoi(words[2])));
+			}
+		} else if (((strcmp(words[0], "aspect") == 0) && (count == 5)) || ((strcmp(words[0], "sequence") == 0) && (count >= 5))) {
+			change.at = (unsigned long)(atof(words[1]) * 1000000.0);
+			change.period = (words[0][0] == 's') ? change.at : 0;
+			change.mast = byte(atoi(words[2]));
+			change.head = byte(atoi(words[3]));
+			change.colors.clear();
+			change.next = 0;
+			for (n = 4; n < count; n++) {
+				if (parseColor(words[n]) == 0) goto bad;
+				change.colors.push_back(parseColor(words[n]));
+			}
+			if ((change.mast < 1) || (change.head < 1) || ((words[0][0] == 's') && (change.period == 0))) goto bad;
+			for (g = 0; g < group.size(); g++) group[g]->changes.push_back(change);
+		} else if ((strcmp(words[0], "task") == 0) && ((count == 3) || (count == 4))) {
+			for (g = 0; g < group.size(); g++) {
+				if ((group[g]->taskCount == MAX_TASKS) || (atol(words[1]) < 1)) goto bad;
+				task = &group[g]->tasks[group[g]->taskCount++];
+				task->interval = atol(words[1]);
+				task->cost = atoi(words[2]);
+				task->time = (count == 4) ? atoi(words[3]) : (task->cost / 2);
+			}
+		} else {
+			goto bad;
+		}
+	}
+	fclose(f);
+	if (controllers.empty()) {
+		printf("layoutSim: no controllers in %s\n", file);
+		return(false);
+	}
+	return(true);
+
+bad:
+	printf("layoutSim: %s line %d isn't right\n", file, lineNo);
+	fclose(f);
+	return(false);
+} // readLayout
+
+// setUp
+//
+// Set up a controller on its board, in its process: its lamps on pins 2 - 19 in order, the
+// first lamp of each head lit, and its tasks.
+static boolean setUp(simController *c)
+{
+	int anode = FIRST_PIN, cathode = FIRST_PIN;
+	int mast, head, lamp, n;
+
+	c->board.echo = false;
+	c->board.use();
+	running = c;
+	c->signals.setupSignal();
+	c->signals.setClock(micros); // so the tasks count from the simulated clock too
+	c->signals.setCycleTime(c->cycle);
+	c->signals.setFlashRate(c->rate);
+	for (mast = 1; mast <= int(c->masts.size() / 2); mast++) {
+		for (head = 1; head <= c->masts[2 * (mast - 1)]; head++) {
+			for (lamp = 1; lamp <= c->masts[(2 * (mast - 1)) + 1]; lamp++) { // on the next pair of pins
+				if (++cathode == anode) cathode++;
+				if (cathode > LAST_PIN) {
+					anode++;
+					cathode = (anode == FIRST_PIN) ? FIRST_PIN + 1 : FIRST_PIN;
+				}
+				if (anode > LAST_PIN) {
+					printf("layoutSim: %s has more lamps than pins %d - %d can take\n", c->name, FIRST_PIN, LAST_PIN);
+					return(false);
+				}
+				c->signals.addLamp(mast, head, lamp, anode, cathode, lamp);
+				c->counts.lamps++;
+			}
+			c->signals.setHeadColor(mast, head, 1);
+		}
+	}
+	for (n = 0; n < c->taskCount; n++) {
+		c->tasks[n].added = c->board.now();
+		if (c->signals.addTask(taskRoutines[n], c->tasks[n].interval, c->tasks[n].cost) == LSS_NO_TASK) {
+			printf("layoutSim: %s can't add task %d\n", c->name, n + 1);
+			return(false);
+		}
+	}
+	c->signals.setTrace(traceController);
+	return(true);
+} // setUp
+
+// the PC time used by the controller's process, in seconds (or the time passed, where that can't be had)
+static double threadTime()
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec now;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return(now.tv_sec + (now.tv_nsec / 1e9));
+#else
+	return(std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+} // threadTime
+
+// runController
+//
+// In the controller's process: run it to end (simulated microseconds), and count what it did.
+static void runController(simController *c, unsigned long end)
+{
+	double began = threadTime();
+	byte args[4];
+	size_t n;
+
+	while (c->board.now() < end) {
+		for (n = 0; n < c->changes.size(); n++) { // the changes due, as commands
+			simChange &change = c->changes[n];
+			if (((change.period == 0) && (change.next > 0)) || (c->board.now() < change.at)) continue; // done, or not due
+			args[0] = change.mast;
+			args[1] = change.head;
+			args[2] = change.colors[change.next % change.colors.size()] & ~FLASHING;
+			args[3] = (change.colors[change.next % change.colors.size()] & FLASHING) ? 1 : 0;
+			if (c->signals.applyCommand(LSS_CMD_HEAD, args, 4)) c->counts.commands++;
+			else c->counts.refused++;
+			change.next++;
+			if (change.period != 0) change.at += change.period;
+		}
+		c->signals.updateSignals();
+		c->counts.calls++;
+		c->board.advance(c->loopTime);
+	}
+	c->counts.now = c->board.now();
+	c->counts.overruns = c->signals.getTaskOverruns();
+	c->counts.pcTime += threadTime() - began;
+} // runController
+
+// serve
+//
+// The controller's process: set it up, say whether that worked, then run each slice asked for
+// and send back its counts and tasks, until its time is run or the program finishes.
+static void serve(simController *c)
+{
+	unsigned long end;
+	boolean ready = setUp(c);
+
+	c->counts.now = c->board.now();
+	c->process.send(&ready, sizeof(ready));
+	if (!ready) c->process.finish(1);
+	while ((c->counts.now < runTime) && c->process.receive(&end, sizeof(end))) {
+		runController(c, end);
+		c->process.send(&c->counts, sizeof(c->counts));
+		c->process.send(c->tasks, sizeof(c->tasks));
+	}
+	c->process.finish(0);
+} // serve
+
+// runSlice
+//
+// Run a controller for SLICE simulated microseconds, or to the end of the run, in its process.
+// Returns true if it has more to run.
+static boolean runSlice(simController *c, int worker)
+{
+	unsigned long end = c->counts.now + SLICE;
+
+	if (end > runTime) end = runTime;
+	c->process.send(&end, sizeof(end));
+	if (!c->process.receive(&c->counts, sizeof(c->counts)) || !c->process.receive(c->tasks, sizeof(c->tasks))) {
+		c->lost = true;
+		c->process.wait();
+		return(false);
+	}
+
+	c->slices++;
+	if ((c->worker >= 0) && (c->worker != worker)) c->moves++;
+	c->worker = worker;
+	if (c->counts.now < runTime) return(true);
+	if (c->process.wait() != 0) c->lost = true;
+	return(false);
+} // runSlice
+
+// takeWork
+//
+// The next controller for a worker: the first of its own, or else the last of another's.
+static simController *takeWork(int me)
+{
+	simController *c = NULL;
+	size_t n, other;
+
+	{
+		std::lock_guard<std::mutex> hold(workers[me]->lock);
+		if (!workers[me]->waiting.empty()) {
+			c = workers[me]->waiting.front();
+			workers[me]->waiting.pop_front();
+			return(c);
+		}
+	}
+	for (n = 1; n < workers.size(); n++) {
+		other = (me + n) % workers.size();
+		std::lock_guard<std::mutex> hold(workers[other]->lock);
+		if (!workers[other]->waiting.empty()) {
+			c = workers[other]->waiting.back();
+			workers[other]->waiting.pop_back();
+			workers[me]->steals++;
+			return(c);
+		}
+	}
+	return(NULL);
+} // takeWork
+
+// work
+//
+// A worker thread: run slices until every controller has run its time.
+static void work(int me)
+{
+	simController *c;
+
+	while (unfinished > 0) {
+		c = takeWork(me);
+		if (c == NULL) { // nothing to take, but some are still running
+			std::this_thread::yield();
+			continue;
+		}
+		workers[me]->slices++;
+		if (runSlice(c, me)) {
+			std::lock_guard<std::mutex> hold(workers[me]->lock);
+			workers[me]->waiting.push_back(c);
+		} else {
+			unfinished--;
+		}
+	}
+} // work
+
+int main(int argc, char **argv)
+{
+	const char *file = "clubLayout.txt";
+	std::vector<std::thread> threads;
+	std::chrono::steady_clock::time_point start;
+	unsigned long expected, runs, calls = 0;
+	int threadCount = std::thread::hardware_concurrency();
+	int arg = 1, n, t, problems = 0;
+	double seconds, pcTime = 0;
+	boolean ready;
+	simController *c;
+
+	if ((argc > arg + 1) && (strcmp(argv[arg], "-j") == 0)) {
+		threadCount = atoi(argv[arg + 1]);
+		arg += 2;
+	}
+	if (argc > arg) file = argv[arg++];
+	if (argc > arg) runTime = strtoul(argv[arg++], NULL, 10) * 1000000UL;
+	if ((argc > arg) || (threadCount < 1) || (runTime == 0)) {
+		printf("usage: layoutSim [-j threads] [file [seconds]]\n");
+		return(1);
+	}
+	if (!readLayout(file)) return(1);
+	for (n = 0; n < int(controllers.size()); n++) { // a process for each, before any threads
+		c = controllers[n];
+		if (c->process.start()) serve(c);
+		if (!c->process.receive(&ready, sizeof(ready)) || !ready) return(1);
+	}
+
+	// deal the controllers out, and let the threads go
+	for (t = 0; t < threadCount; t++) workers.push_back(new simWorker());
+	for (n = 0; n < int(controllers.size()); n++) workers[n % threadCount]->waiting.push_back(controllers[n]);
+	unfinished = controllers.size();
+	start = std::chrono::steady_clock::now();
+	for (t = 0; t < threadCount; t++) threads.push_back(std::thread(work, t));
+	for (t = 0; t < threadCount; t++) threads[t].join();
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%s: %d controllers for %lu simulated s on %d threads\n\n", file, int(controllers.size()), runTime / 1000000UL, threadCount);
+	printf("%-12s %5s %10s %9s %7s %7s %6s %8s %14s %8s %6s %5s %7s\n", "controller", "lamps", "calls", "slots",
+		"slot us", "longest", "FPM", "commands", "tasks run", "overruns", "slices", "moves", "PC s");
+	for (n = 0; n < int(controllers.size()); n++) {
+		c = controllers[n];
+		expected = runs = 0;
+		for (t = 0; t < c->taskCount; t++) {
+			expected += (runTime - c->tasks[t].added) / (1000UL * c->tasks[t].interval);
+			runs += c->tasks[t].runs;
+		}
+		printf("%-12s %5d %10lu %9lu %7lu %7lu %6.1f %8lu %6lu of %-5lu %8u %6lu %5lu %7.2f\n", c->name, c->counts.lamps, c->counts.calls,
+			c->counts.slots, c->counts.slots ? (c->counts.slotSum / c->counts.slots) : 0, c->counts.longestSlot,
+			c->counts.divs ? ((60000000.0 * c->counts.divs) / (c->counts.lastDiv - c->counts.firstDiv)) : 0.0,
+			c->counts.commands, runs, expected, c->counts.overruns, c->slices, c->moves, c->counts.pcTime);
+		if (c->lost) {
+			printf("FAIL: %s's process ended before its time was run\n", c->name);
+			problems++;
+		}
+		if (c->counts.slots == 0) {
+			printf("FAIL: %s never lit a LED\n", c->name);
+			problems++;
+		}
+		if (c->counts.refused > 0) {
+			printf("FAIL: %s refused %lu commands\n", c->name, c->counts.refused);
+			problems++;
+		}
+		if ((runs + c->taskCount < expected) || (runs > expected)) {
+			printf("FAIL: %s ran its tasks %lu times, for %lu\n", c->name, runs, expected);
+			problems++;
+		}
+		calls += c->counts.calls;
+		pcTime += c->counts.pcTime;
+	}
+	printf("\n");
+	for (t = 0; t < threadCount; t++) printf("thread %d: %lu slices, %lu of them stolen\n", t, workers[t]->slices, workers[t]->steals);
+	printf("%lu calls of updateSignals in %.2f s (%.2f s of slices), %.0f simulated s for each PC s\n", calls, seconds, pcTime,
+		(double(runTime / 1000000UL) * controllers.size()) / seconds);
+	return((problems > 0) ? 1 : 0);
+} // main
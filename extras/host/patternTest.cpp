@@ -0,0 +1,197 @@
+// patternTest
+//
+// Compares the LEDs driven from a timer interrupt (LSS_USE_PATTERN) with the same signals driven
+// from updateSignals, on a simulated Uno.
+//
+// The signals are the PatternExample's (the first mast of SignalExample, the top head flashing
+// yellow) with a second mast of one red lamp. They run twice, each on a board of its own in a
+// process of its own (see hostProcess.h): once polled, then with usePattern(TICK) and playPattern
+// called every TICK microseconds, through the simulated board's edge interrupts (which cut into
+// whatever is running, updateSignals included, unless interrupts are off). Both runs settle for
+// a second and are then measured for FLASHES whole flashes, taking each LED's time lit from the
+// pins.
+//
+// Fails if two LEDs are ever lit at once, or if any LED's duty (the share of the time it is
+// lit) with the pattern differs from its polled duty by more than DUTY_TOLERANCE tenths of a
+// percent of the time.
+//
+// Usage: patternTest [-v]
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include "hostProcess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TICK 25				// microseconds between calls to playPattern
+#define SETTLE_TIME 1000000UL	// simulated microseconds before measuring
+#define FLASHES 5
+#define DUTY_TOLERANCE 5	// tenths of a percent
+#define TIMER_PIN 40		// the simulated pin whose edges stand in for the timer
+#define LEDS 10
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// the LEDs: the nine of mast 1 on anode 2, and mast 2's on anode 12
+static const byte anodes[LEDS] = {2, 2, 2, 2, 2, 2, 2, 2, 2, 12};
+static const byte cathodes[LEDS] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13};
+static const byte colors[3] = {LSS_GREEN, LSS_YELLOW, LSS_RED};
+
+// from the pins: the LED lit, since when, and the time each has been lit
+static int litLED;
+static unsigned long litAt;
+static unsigned long litTime[LEDS];
+static unsigned long doubled;	// pin changes that left more than one LED lit
+static boolean measuring;
+
+static void watchPins(hostBoard *board, byte pin)
+{
+	int led, now = -1;
+
+	for (led = 0; led < LEDS; led++) {
+		if (!board->lit(anodes[led], cathodes[led])) continue;
+		if (now >= 0) doubled++;
+		now = led;
+	}
+	if (now == litLED) return;
+	if ((litLED >= 0) && measuring) litTime[litLED] += board->now() - litAt;
+	litLED = now;
+	litAt = board->now();
+} // watchPins
+
+static linesideSignal *patterned;
+static unsigned long plays;
+
+static void playLEDs()
+{
+	patterned->playPattern();
+	plays++;
+} // playLEDs
+
+// runSignals
+//
+// Run the signals, polled or from the pattern, and work out each LED's duty in tenths of a
+// percent.
+static void runSignals(boolean pattern, long *duty)
+{
+	static unsigned long ticks[((SETTLE_TIME + (FLASHES + 1) * (60000000UL / LSS_FLASH_FPM)) / TICK) + 1];
+	hostBoard board;
+	linesideSignal signals;
+	unsigned long start, measureTime = FLASHES * (60000000UL / LSS_FLASH_FPM);
+	long n;
+	int led;
+
+	board.echo = false;
+	board.use();
+	signals.setupSignal();
+	for (led = 0; led < LEDS; led++) {
+		if (led < 9) signals.addLamp(1, (led / 3) + 1, (led % 3) + 1, anodes[led], cathodes[led], colors[led % 3]);
+		else signals.addLamp(2, 1, 1, anodes[led], cathodes[led], LSS_RED);
+	}
+	signals.setHeadColor(1, 1, LSS_YELLOW, true);
+	signals.setHeadColor(1, 2, LSS_RED);
+	signals.setHeadColor(1, 3, LSS_RED);
+	signals.setHeadColor(2, 1, LSS_RED);
+	signals.updateSignals(); // let the library discharge the new pins first
+
+	if (pattern) {
+		signals.usePattern(TICK);
+		patterned = &signals;
+		start = board.now();
+		for (n = 0; n < long(sizeof(ticks) / sizeof(ticks[0])); n++) ticks[n] = start + ((n + 1) * TICK);
+		attachInterrupt(TIMER_PIN, playLEDs, CHANGE);
+		board.setEdges(TIMER_PIN, ticks, n);
+	}
+	litLED = -1;
+	memset(litTime, 0, sizeof(litTime));
+	doubled = 0;
+	measuring = false;
+	board.pinHook = watchPins;
+
+	start = board.now();
+	while ((board.now() - start) < SETTLE_TIME) {
+		signals.updateSignals();
+		board.advance(loopTime());
+	}
+	measuring = true;
+	litAt = board.now();
+	start = board.now();
+	while ((board.now() - start) < measureTime) {
+		signals.updateSignals();
+		board.advance(loopTime());
+	}
+	if (litLED >= 0) litTime[litLED] += board.now() - litAt;
+	measureTime = board.now() - start;
+	measuring = false;
+
+	board.pinHook = NULL;
+	detachInterrupt(TIMER_PIN);
+	for (led = 0; led < LEDS; led++) duty[led] = long((litTime[led] * 1000.0) / measureTime);
+	if (pattern) printf("pattern: playPattern called %lu times\n", plays);
+	if (pattern && board.lateEdges) printf("pattern: %lu calls of playPattern late (interrupts off), the latest by %lu us\n", board.lateEdges, board.worstLate);
+} // runSignals
+
+// run
+//
+// Run the signals on a board of its own, in a process of its own, which sends back each LED's
+// duty and the times more than one was lit (left in doubled).
+static void run(boolean pattern, long *duty)
+{
+	hostProcess process;
+
+	if (process.start()) {
+		runSignals(pattern, duty);
+		process.send(duty, LEDS * sizeof(duty[0]));
+		process.send(&doubled, sizeof(doubled));
+		process.finish(0);
+	}
+	if (!process.receive(duty, LEDS * sizeof(duty[0])) || !process.receive(&doubled, sizeof(doubled))) {
+		printf("FAIL: the %s run ended early\n", pattern ? "pattern" : "polled");
+		exit(1);
+	}
+	process.wait();
+} // run
+
+int main(int argc, char **argv)
+{
+	long polled[LEDS], pattern[LEDS];
+	unsigned long polledDoubled, worst = 0;
+	boolean verbose = ((argc > 1) && (strcmp(argv[1], "-v") == 0));
+	int led, problems = 0;
+	long diff;
+
+	run(false, polled);
+	polledDoubled = doubled;
+	run(true, pattern);
+
+	printf("duty of each LED over %d flashes, polled and from the pattern (tick %d us):\n", FLASHES, TICK);
+	for (led = 0; led < LEDS; led++) {
+		diff = pattern[led] - polled[led];
+		if (labs(diff) > long(worst)) worst = labs(diff);
+		if (verbose || (labs(diff) > DUTY_TOLERANCE) || (polled[led] > 0)) {
+			printf("  A%-2d C%-2d %3ld.%ld%% %3ld.%ld%%", anodes[led], cathodes[led], polled[led] / 10, polled[led] % 10, pattern[led] / 10, pattern[led] % 10);
+			if (labs(diff) > DUTY_TOLERANCE) {
+				printf("  FAIL\n");
+				problems++;
+			} else {
+				printf("  ok\n");
+			}
+		}
+	}
+	printf("largest difference %lu.%lu%%, more than one LED lit %lu times polled and %lu from the pattern\n", worst / 10, worst % 10, polledDoubled, doubled);
+	if ((polledDoubled > 0) || (doubled > 0)) {
+		printf("FAIL: two LEDs lit at once\n");
+		problems++;
+	}
+	return((problems > 0) ? 1 : 0);
+} // main
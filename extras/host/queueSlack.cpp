@@ -0,0 +1,109 @@
+// queueSlack
+//
+// Keeps the command queue (LSS_USE_QUEUE) full while updateSignals runs on a simulated Uno, and
+// checks that no LED slot would be made late by the commands: on a real board each takes about
+// LSS_COMMAND_COST, so must be carried out at least that long before the slot ends. The host
+// runs a command in no time, so each is checked against the slot it ran in: the slot ends at the
+// first call after its time, so the time from the end of the call that carried out a command to
+// the start of the next slot is the most the command could have had. Less than LSS_COMMAND_COST
+// and the LED would have been late, by the difference.
+//
+// The queue is topped up before each call, so it is never empty, and the commands it then takes
+// are the ones the call before carried out. Each sets the ramp of a lamp as it already is, so the
+// lamps and their timing stay the same however many are carried out. The three heads show one
+// lamp each, with 20 - 120 us loops from the same random numbers each time. Fails on any slot
+// made late, or if fewer commands are carried out than there are slots (the queue starved).
+//
+// Usage: queueSlack
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+
+#define RUN_TIME 20000000UL	// simulated microseconds
+#define SETTLE 2000000UL	// before counting (the lamps light after about a second)
+#define HEADS 3
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+static hostBoard board;
+static linesideSignal signals;
+static boolean slotStarted;
+
+static void traceSlots(byte event, byte arg1, byte arg2)
+{
+	if (event == LSS_TRACE_SLOT) slotStarted = true;
+} // traceSlots
+
+int main()
+{
+	static const byte ramp[4] = {1, 1, 1, true}; // mast, head, lamp, ramp: as it is
+	unsigned long start, began, ended = 0, commandEnd = 0;
+	unsigned long slots = 0, commands = 0, late = 0, slack, leastSlack = 0xFFFFFFFFUL, worstLate = 0;
+	boolean counting = false, filled = false;
+	int taken, head;
+
+	board.echo = false;
+	board.use();
+	signals.setupSignal();
+	for (head = 1; head <= HEADS; head++) {
+		signals.addLamp(1, head, 1, 2, 3 + head, LSS_RED);
+		signals.addLamp(1, head, 2, 2, 6 + head, LSS_GREEN);
+		signals.setHeadColor(1, head, LSS_GREEN);
+	}
+	signals.setTrace(traceSlots);
+
+	start = board.now();
+	while ((board.now() - start) < RUN_TIME) {
+		for (taken = 0; signals.queueCommand(LSS_CMD_RAMP, ramp, 4); taken++) {}
+		if (filled && (taken > 0)) { // the call before carried some out
+			commandEnd = ended;
+			if (counting) commands += taken;
+		}
+		filled = true;
+
+		began = board.now();
+		slotStarted = false;
+		signals.updateSignals();
+		ended = board.now();
+		if (slotStarted) {
+			if (counting) slots++;
+			if (counting && (commandEnd != 0)) {
+				slack = began - commandEnd;
+				if (slack < leastSlack) leastSlack = slack;
+				if (slack < LSS_COMMAND_COST) {
+					late++;
+					if ((LSS_COMMAND_COST - slack) > worstLate) worstLate = LSS_COMMAND_COST - slack;
+				}
+			}
+			commandEnd = 0;
+		}
+		counting = ((board.now() - start) >= SETTLE);
+		board.advance(loopTime());
+	}
+
+	printf("%lu commands carried out in %lu LED slots; the least time left after one %lu us (LSS_COMMAND_COST %d)\n",
+		commands, slots, leastSlack, LSS_COMMAND_COST);
+	if (slots == 0) {
+		printf("FAIL: no LED slots\n");
+		return(1);
+	}
+	if (late > 0) {
+		printf("FAIL: %lu slots would have been late, by up to %lu us\n", late, worstLate);
+		return(1);
+	}
+	if (commands < slots) {
+		printf("FAIL: the queue was left waiting\n");
+		return(1);
+	}
+	return(0);
+} // main
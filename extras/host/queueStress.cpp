@@ -0,0 +1,115 @@
+// queueStress
+//
+// Sends COMMANDS commands through the command queue (LSS_USE_QUEUE) from a second thread, as
+// an interrupt or the other core of a board would, while the main thread calls updateSignals,
+// and checks that every one is carried out, once, in order and intact.
+//
+// The board follows the PC's clock (realTime), as the threads run against each other. There
+// are MASTS masts of one three-lamp head, and command n sets mast n % MASTS to the color
+// (n / MASTS) % 3 of red, yellow and green, so each command changes the head it names. The
+// producer queues them as fast as the queue takes them, trying again when it is full. After
+// each call of updateSignals the main thread reads every head: at most one may have changed,
+// and only to what the next command sets it to (a head reads as dark for a moment while it
+// changes, which is let pass).
+//
+// Usage: queueStress [commands]
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#define COMMANDS 100000L
+#define MASTS 8
+#define TIME_LIMIT 20000000UL	// microseconds
+
+static const byte colors[3] = {LSS_RED, LSS_YELLOW, LSS_GREEN};
+
+static linesideSignal signals;
+static long commands = COMMANDS;
+static unsigned long fulls;	// times the producer found the queue full
+
+// what command n does
+static byte commandMast(long n)
+{
+	return(byte((n % MASTS) + 1));
+} // commandMast
+
+static byte commandColor(long n)
+{
+	return(colors[(n / MASTS) % 3]);
+} // commandColor
+
+// produce
+//
+// The second thread: queue every command, in order.
+static void produce(hostBoard *board)
+{
+	byte args[4];
+	long n;
+
+	board->use();
+	for (n = 0; n < commands; n++) {
+		args[0] = commandMast(n);
+		args[1] = 1;
+		args[2] = commandColor(n);
+		args[3] = false; // not flashing
+		while (!signals.queueCommand(LSS_CMD_HEAD, args, 4)) {
+			fulls++;
+			std::this_thread::yield();
+		}
+	}
+} // produce
+
+int main(int argc, char **argv)
+{
+	hostBoard board;
+	byte shown[MASTS + 1], color;
+	long next = 0, calls = 0, wrong = 0;
+	unsigned long start;
+	int mast, changed;
+
+	if (argc > 1) commands = atol(argv[1]);
+	board.echo = false;
+	board.use();
+	board.setRealTime(true);
+	signals.setupSignal();
+	for (mast = 1; mast <= MASTS; mast++) { // anodes 2 - 9, cathodes 10 - 12
+		signals.addLamp(mast, 1, 1, mast + 1, 10, LSS_RED);
+		signals.addLamp(mast, 1, 2, mast + 1, 11, LSS_YELLOW);
+		signals.addLamp(mast, 1, 3, mast + 1, 12, LSS_GREEN);
+		signals.setHeadColor(mast, 1, LSS_GREEN); // what no first command sets
+		shown[mast] = LSS_GREEN;
+	}
+
+	std::thread producer(produce, &board);
+	start = board.now();
+	while ((next < commands) && ((board.now() - start) < TIME_LIMIT)) {
+		signals.updateSignals();
+		calls++;
+		changed = 0;
+		for (mast = 1; mast <= MASTS; mast++) {
+			color = signals.getHeadColor(mast, 1);
+			if ((color == shown[mast]) || (color == LSS_DARK)) continue; // dark only while it changes
+			changed++;
+			if ((mast != commandMast(next)) || (color != commandColor(next)) || (changed > 1)) {
+				if (wrong++ < 10) printf("FAIL: after command %ld, mast %d changed to %d\n", next, mast, color);
+			}
+			shown[mast] = color;
+		}
+		if (changed > 0) next++;
+		else std::this_thread::yield(); // the rest of loop(), which lets the producer run on a PC with one core
+	}
+	producer.join();
+
+	printf("%ld of %ld commands carried out in %lu ms, over %ld calls of updateSignals; the queue was full %lu times\n",
+		next, commands, (board.now() - start) / 1000UL, calls, fulls);
+	if ((next < commands) || (wrong > 0)) {
+		printf("FAIL: %ld commands out of order or changed\n", wrong);
+		return(1);
+	}
+	return(0);
+} // main
@@ -0,0 +1,327 @@
+// replayTool
+//
+// Replays a recording made with startRecord (LSS_USE_RECORD), as the ReplayExample prints it in
+// hex, on a simulated Uno with that example's signals (the first mast of SignalExample: edit
+// setUp to match the sketch that made the recording), and reports the timing of the session:
+// the calls replayed and the time they span, the calls of updateSignals and the longest, the LED
+// slots with their mean and longest length and their jitter, and the flash rate seen. The
+// simulated clock runs the whole session, however long, in a moment, and with 20 - 120 us loops
+// from the same random numbers each time, so a session can be replayed against one version of
+// the library and then another and the figures compared.
+//
+// Without a file it checks itself: the ReplayExample's trains run for SESSION, recorded, and
+// the recording is then replayed while recording again. Each head must change to the same colors
+// in the same order, each within TOLERANCE of the time it did when recorded, and the second
+// recording must hold only the one call made outside the replay (the calls replayed aren't
+// recorded again).
+//
+// Usage: replayTool [file]	(- for standard input)
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <vector>
+
+#define SESSION 60000000UL	// simulated microseconds recorded for the check
+#define SETTLE 2000000UL	// simulated microseconds run before replaying (the lamps light after about a second)
+#define TOLERANCE 2000L		// microseconds
+#define LOG_BYTES 2000		// room for a recording
+#define HEADS 3
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+static hostBoard board;
+static linesideSignal signals;
+
+// from setTrace: the LED slots and the flashes
+static unsigned long slotAt, slots, longestSlot;
+static double slotSum, slotSquares;
+static unsigned long divs, firstDiv, lastDiv;
+
+static void traceReplay(byte event, byte arg1, byte arg2)
+{
+	unsigned long now = board.now();
+
+	if (event == LSS_TRACE_SLOT) {
+		if (slotAt != 0) {
+			slots++;
+			slotSum += now - slotAt;
+			slotSquares += double(now - slotAt) * (now - slotAt);
+			if ((now - slotAt) > longestSlot) longestSlot = now - slotAt;
+		}
+		slotAt = now;
+	} else if ((event == LSS_TRACE_DIV) && (arg1 == 0)) {
+		if (firstDiv == 0) firstDiv = now;
+		else divs++;
+		lastDiv = now;
+	}
+} // traceReplay
+
+// the heads changing: each change is timed from when the head first left its old color (it
+// reads as dark while it changes), and given the color it came to
+struct headChange {
+	unsigned long t;		// microseconds from the start of the recording or replay
+	byte head;
+	byte color;
+};
+
+static std::vector<headChange> changes;
+static byte shown[HEADS + 1];
+static unsigned long leftAt[HEADS + 1];	// when it left, or 0 while it shows its color
+static unsigned long origin;			// the start of the recording or replay
+
+static void watchHeads()
+{
+	headChange change;
+	byte color;
+	int head;
+
+	for (head = 1; head <= HEADS; head++) {
+		color = signals.getHeadColor(1, head);
+		if (color == shown[head]) {
+			leftAt[head] = 0; // back as it was
+			continue;
+		}
+		if (leftAt[head] == 0) leftAt[head] = board.now();
+		if (color == LSS_DARK) continue; // on its way
+		change.t = leftAt[head] - origin;
+		change.head = head;
+		change.color = color;
+		changes.push_back(change);
+		shown[head] = color;
+		leftAt[head] = 0;
+	}
+} // watchHeads
+
+// setUp
+//
+// The ReplayExample's signals, all heads green.
+static void setUp()
+{
+	static const byte colors[3] = {LSS_GREEN, LSS_YELLOW, LSS_RED}; // lamps 1 - 3
+	int head, lamp;
+
+	board.echo = false;
+	board.use();
+	signals.setupSignal();
+	for (head = 1; head <= HEADS; head++) {
+		for (lamp = 1; lamp <= 3; lamp++) signals.addLamp(1, head, lamp, 2, (3 * head) + lamp - 1, colors[lamp - 1]);
+	}
+	signals.setTrace(traceReplay);
+} // setUp
+
+// the heads back to green, as the ReplayExample's session starts, and the counts cleared
+static void startSession()
+{
+	int head;
+
+	for (head = 1; head <= HEADS; head++) {
+		signals.setHeadColor(1, head, LSS_GREEN);
+		shown[head] = LSS_GREEN;
+		leftAt[head] = 0;
+	}
+	changes.clear();
+	slotAt = slots = longestSlot = 0;
+	slotSum = slotSquares = 0;
+	divs = firstDiv = lastDiv = 0;
+	origin = board.now();
+} // startSession
+
+// run
+//
+// Run the signals for a time, or (with replaying) until the replay is done. Returns the calls
+// of updateSignals, and the longest in *longest*.
+static unsigned long run(unsigned long time, boolean replaying, unsigned long *longest)
+{
+	unsigned long start = board.now(), began, calls = 0;
+
+	while (((board.now() - start) < time) && (!replaying || signals.isReplaying())) {
+		began = board.now();
+		signals.updateSignals();
+		calls++;
+		if ((board.now() - began) > *longest) *longest = board.now() - began;
+		watchHeads();
+		board.advance(loopTime());
+	}
+	return(calls);
+} // run
+
+// the ReplayExample's trains: every 15 s a train passes the heads, dropping each to red
+// in turn and clearing it back through yellow to green
+static byte trainHead;
+static byte trainTask = LSS_NO_TASK;
+
+static void moveTrain()
+{
+	if (trainHead > 0) signals.setHeadColor(1, trainHead, LSS_YELLOW);
+	if (trainHead > 1) signals.setHeadColor(1, trainHead - 1, LSS_GREEN);
+	if (trainHead < HEADS) {
+		trainHead++;
+		signals.setHeadColor(1, trainHead, LSS_RED);
+	} else { // gone
+		signals.setHeadColor(1, trainHead, LSS_GREEN);
+		trainHead = 0;
+		signals.cancelTask(trainTask);
+	}
+} // moveTrain
+
+static void newTrain()
+{
+	if (trainHead == 0) trainTask = signals.addTask(moveTrain, 2000L, 300);
+} // newTrain
+
+// report
+//
+// What the recording holds, and the timing of the signals while it was replayed.
+static void report(const byte *log, int len, unsigned long calls, unsigned long longest)
+{
+	long span = 0;
+	int pos, count = 0;
+	double mean;
+
+	for (pos = 0; (pos + LSS_RECORD_HEADER) <= len; pos += LSS_RECORD_HEADER + log[pos + 3]) {
+		span += (long(log[pos]) << 8) | log[pos + 1];
+		if (log[pos + 2] != LSS_RECORD_WAIT) count++;
+	}
+	printf("%d bytes, %d calls over %.1f s; %lu calls of updateSignals, the longest %lu us\n", len, count, span / 1000.0, calls, longest);
+	if (slots > 0) {
+		mean = slotSum / slots;
+		printf("%lu LED slots: %.0f us on average, the longest %lu us, jitter (standard deviation) %.0f us; flash %.1f FPM\n",
+			slots, mean, longestSlot, sqrt((slotSquares / slots) - (mean * mean)), divs ? ((60000000.0 * divs) / (lastDiv - firstDiv)) : 0.0);
+	}
+} // report
+
+// settled
+//
+// The changes of each head in turn, leaving out any the head didn't keep for TOLERANCE: calls
+// made together (in one task, say) are replayed one to a call of updateSignals, so a head set
+// twice at once can show the first color for a moment.
+static std::vector<headChange> settled(const std::vector<headChange> &list)
+{
+	std::vector<headChange> kept;
+	size_t n, next;
+	int head;
+
+	for (head = 1; head <= HEADS; head++) {
+		for (n = 0; n < list.size(); n++) {
+			if (list[n].head != head) continue;
+			for (next = n + 1; (next < list.size()) && (list[next].head != head); next++) {}
+			if ((next < list.size()) && ((list[next].t - list[n].t) <= TOLERANCE)) continue; // gone again
+			kept.push_back(list[n]);
+		}
+	}
+	return(kept);
+} // settled
+
+// selfCheck
+//
+// Record the trains, replay them while recording again, and compare.
+static int selfCheck()
+{
+	static byte recording[LOG_BYTES], again[LOG_BYTES];
+	std::vector<headChange> recorded, replayed;
+	unsigned long calls, longest = 0;
+	long worst = 0;
+	int len, againLen, n, problems = 0;
+	byte newTrainTask;
+
+	setUp();
+	startSession();
+	run(SETTLE, false, &longest);
+	startSession();
+	signals.startRecord(recording, sizeof(recording));
+	newTrainTask = signals.addTask(newTrain, 15000L, 100);
+	run(SESSION, false, &longest);
+	signals.cancelTask(newTrainTask);
+	signals.cancelTask(trainTask);
+	trainHead = 0;
+	len = signals.stopRecord();
+	recorded = settled(changes);
+
+	startSession();
+	signals.startRecord(again, sizeof(again));
+	signals.replay(recording, len);
+	longest = 0;
+	calls = run(SESSION * 2, true, &longest);
+	report(recording, len, calls, longest);
+	signals.setHeadColor(1, 1, LSS_RED); // the one call of its own
+	againLen = signals.stopRecord();
+	replayed = settled(changes);
+
+	for (n = 0; (n < int(recorded.size())) && (n < int(replayed.size())); n++) {
+		if ((recorded[n].head != replayed[n].head) || (recorded[n].color != replayed[n].color)) {
+			if (problems++ < 10) printf("FAIL: head %d went to %d at %lu us, but to %d in the replay\n",
+				recorded[n].head, recorded[n].color, recorded[n].t, replayed[n].color);
+		}
+		if (labs(long(replayed[n].t - recorded[n].t)) > worst) worst = labs(long(replayed[n].t - recorded[n].t));
+	}
+	printf("%d head changes recorded, %d replayed, each within %ld us of its time; %d bytes recorded while replaying\n",
+		int(recorded.size()), int(replayed.size()), worst, againLen);
+	if ((recorded.size() == 0) || (replayed.size() != recorded.size())) {
+		printf("FAIL: the replay didn't change the heads as the recording did\n");
+		problems++;
+	}
+	if (worst > TOLERANCE) {
+		printf("FAIL: a change was replayed more than %ld us from its time\n", TOLERANCE);
+		problems++;
+	}
+	if ((againLen != LSS_RECORD_HEADER + 4) || (again[2] != LSS_CMD_HEAD)) {
+		printf("FAIL: recording while replaying should hold just the one setHeadColor\n");
+		problems++;
+	}
+	return((problems > 0) ? 1 : 0);
+} // selfCheck
+
+int main(int argc, char **argv)
+{
+	static byte log[LOG_BYTES * 8];
+	unsigned long calls, longest = 0;
+	char line[256], *word;
+	byte bytes[128];
+	FILE *in;
+	int len = 0, n, i;
+
+	if (argc < 2) return(selfCheck());
+
+	in = (strcmp(argv[1], "-") == 0) ? stdin : fopen(argv[1], "r");
+	if (in == NULL) {
+		fprintf(stderr, "replayTool: can't read %s\n", argv[1]);
+		return(1);
+	}
+	while (fgets(line, sizeof(line), in) != NULL) { // lines of bytes in hex; any other line is passed over
+		for (n = 0, word = strtok(line, " \t\r\n"); word != NULL; word = strtok(NULL, " \t\r\n")) {
+			if ((strlen(word) != 2) || !isxdigit(word[0]) || !isxdigit(word[1])) break;
+			bytes[n++] = byte(strtoul(word, NULL, 16));
+		}
+		if (word != NULL) continue; // not all hex
+		for (i = 0; (i < n) && (len < int(sizeof(log))); i++) log[len++] = bytes[i];
+	}
+	if (in != stdin) fclose(in);
+	if (len < LSS_RECORD_HEADER) {
+		fprintf(stderr, "replayTool: no recording in %s\n", argv[1]);
+		return(1);
+	}
+
+	setUp();
+	startSession();
+	run(SETTLE, false, &longest);
+	startSession();
+	signals.replay(log, len);
+	longest = 0;
+	calls = run(0xFFFFFFFFUL, true, &longest);
+	report(log, len, calls, longest);
+	return(0);
+} // main
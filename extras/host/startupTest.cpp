@@ -0,0 +1,141 @@
+// startupTest
+//
+// How long setup takes on a simulated Uno with 45 LEDs (15 masts of three lamps, charlieplexed
+// on pins 2 - 11), and how the pins of a lamp added later are discharged.
+//
+// This prints the simulated time spent in setupSignal and the 45 calls of addLamp, in the
+// first call of updateSignals (where the pins of the lamps added in setup are grounded
+// together), and, for a lamp added on pins 12 and 13 once the signals have run for a second,
+// the time in addLamp, the longest call of updateSignals after it, how long its pins were
+// held at ground, and any time spent in delay() after setup. The test fails if setup takes
+// longer than SETUP_LIMIT, if either set of pins is grounded for less than LSS_DISCHARGE_TIME,
+// if the late lamp makes a call take longer than CALL_LIMIT or use delay(), or if it is never
+// lit.
+//
+// It uses nothing newer than setupSignal, addLamp, setHeadColor and updateSignals, so it can
+// be built against an older version with make LIBDIR=dir, to compare (that will fail the test).
+//
+// Usage: startupTest
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+
+#define MASTS 15
+#define LATE_ANODE 12
+#define LATE_CATHODE 13
+#define SETUP_LIMIT 5000UL	// microseconds for setupSignal and the addLamp calls
+#define CALL_LIMIT 1000UL	// microseconds for one updateSignals after the late lamp is added
+
+#if !defined(LSS_DISCHARGE_TIME)
+#define LSS_DISCHARGE_TIME 1	// versions before it was an option
+#endif
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// the longest time the late lamp's anode was held at ground (it is only ever an anode, so
+// only the discharge grounds it for longer than a pinMode)
+static unsigned long groundedAt;
+static unsigned long lateGround;
+
+static void watchPins(hostBoard *board, byte pin)
+{
+	if (pin != LATE_ANODE) return;
+	if ((board->mode[pin] == OUTPUT) && (board->level[pin] == LOW)) {
+		if (groundedAt == 0) groundedAt = board->now();
+	} else if (groundedAt != 0) {
+		if ((board->now() - groundedAt) > lateGround) lateGround = board->now() - groundedAt;
+		groundedAt = 0;
+	}
+} // watchPins
+
+int main()
+{
+	hostBoard board;
+	linesideSignal signals;
+	unsigned long start, setupTime, firstCall, addTime, delayedBefore, longestCall = 0, before;
+	int mast, lamp, anode, cathode;
+	boolean lateLit = false;
+	boolean failed = false;
+
+	board.echo = false;
+	board.use();
+	board.advance(10000); // the Arduino starts up
+	board.pinHook = watchPins;
+
+	start = board.now();
+	signals.setupSignal();
+	anode = 2;
+	cathode = 2;
+	for (mast = 1; mast <= MASTS; mast++) { // three LEDs each, on the next pairs of pins 2 - 11
+		for (lamp = 1; lamp <= 3; lamp++) {
+			if (++cathode == anode) cathode++;
+			if (cathode > 11) {
+				anode++;
+				cathode = (anode == 2) ? 3 : 2;
+			}
+			signals.addLamp(mast, 1, lamp, anode, cathode, (lamp == 1) ? LSS_GREEN : ((lamp == 2) ? LSS_YELLOW : LSS_RED));
+		}
+	}
+	for (mast = 1; mast <= MASTS; mast++) signals.setHeadColor(mast, 1, (mast & 1) ? LSS_GREEN : LSS_RED);
+	setupTime = board.now() - start;
+	printf("setup, %d lamps: %lu us\n", MASTS * 3, setupTime);
+	fflush(stdout); // before anything else can go wrong
+
+	start = board.now();
+	signals.updateSignals();
+	firstCall = board.now() - start;
+	board.advance(loopTime());
+
+	start = board.now();
+	while ((board.now() - start) < 1000000UL) { // run for a second
+		signals.updateSignals();
+		board.advance(loopTime());
+	}
+
+	delayedBefore = board.delayed;
+	start = board.now();
+	signals.addLamp(MASTS + 1, 1, 1, LATE_ANODE, LATE_CATHODE, LSS_GREEN);
+	signals.setHeadColor(MASTS + 1, 1, LSS_GREEN);
+	addTime = board.now() - start;
+	start = board.now();
+	while ((board.now() - start) < 3000000UL) { // and three more, as the new lamp waits for a ramp cycle to come on
+		before = board.now();
+		signals.updateSignals();
+		if ((board.now() - before) > longestCall) longestCall = board.now() - before;
+		if (board.lit(LATE_ANODE, LATE_CATHODE)) lateLit = true;
+		board.advance(loopTime());
+	}
+
+	printf("first updateSignals: %lu us (pins grounded together)\n", firstCall);
+	printf("a lamp added while running: addLamp and setHeadColor %lu us, longest updateSignals after %lu us,\n", addTime, longestCall);
+	printf("  its pins held at ground %lu us, %lu us in delay()\n", lateGround, board.delayed - delayedBefore);
+
+	if (setupTime > SETUP_LIMIT) {
+		printf("FAIL: setup longer than %lu us\n", SETUP_LIMIT);
+		failed = true;
+	}
+	if ((firstCall < LSS_DISCHARGE_TIME * 1000UL) || (lateGround < LSS_DISCHARGE_TIME * 1000UL)) {
+		printf("FAIL: pins not held at ground for %d ms\n", LSS_DISCHARGE_TIME);
+		failed = true;
+	}
+	if ((longestCall > CALL_LIMIT) || (addTime > CALL_LIMIT) || (board.delayed != delayedBefore)) {
+		printf("FAIL: the late lamp held up loop()\n");
+		failed = true;
+	}
+	if (!lateLit) {
+		printf("FAIL: the late lamp was never lit\n");
+		failed = true;
+	}
+	if (!failed) printf("ok\n");
+	return(failed ? 1 : 0);
+} // main
@@ -0,0 +1,218 @@
+// syncLoopback
+//
+// Flash synchronization between two Arduinos (setSyncMaster and setSyncFollower), measured on
+// the host. Two simulated boards run the same three-head mast, one as the sync master and the
+// other as a follower whose clock runs fast or slow by a set number of parts per million, with
+// the master's sync pin wired to the follower's. Each board runs in a process of its own (see
+// hostProcess.h) for a simulated two minutes: the master first, with the times its sync pin
+// changes kept, and then the follower, with those changes played into its sync pin at the same
+// times. The time from each ramp cycle of the master starting to the follower's nearest one
+// starting is measured.
+//
+// Once locked (after the first 20 seconds), the follower must start every ramp cycle within
+// LOCK_LIMIT microseconds of the master. A lock only to whole passes through the lit lamps
+// would be out by up to half a pass (1.25 ms here). Each board only sees the sync pin change,
+// or starts a ramp cycle, when its loop() comes round, so the error grows with the time the
+// rest of loop() takes (20 - 120 microseconds here).
+//
+// Usage: syncLoopback [-v]	(-v prints every cycle)
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include "hostProcess.h"
+#include <stdio.h>
+
+#define SYNC_PIN 12			// the sync wire, on both boards
+#define RUN_TIME 120000000L	// microseconds to run each case
+#define SETTLE_TIME 20000000L	// microseconds to allow for the follower to lock
+#define LOCK_LIMIT 1000	// microseconds the follower may be out once locked
+#define MAX_CYCLES 400
+#define MAX_EDGES (4 * MAX_CYCLES)	// changes of the sync pin kept
+
+// one case: the follower's clock error and lit lamps
+struct loopCase {
+	const char *name;
+	long skew;				// follower's clock error, parts per million
+	int followerHeads;		// heads lit on the follower (of 3), the master has all 3
+	boolean flashing;		// flash the first head on both
+};
+
+static const loopCase cases[] = {
+	{"same layout, follower +500 ppm", 500, 3, true},
+	{"same layout, follower -2000 ppm", -2000, 3, true},
+	{"follower lights 1 head, +1000 ppm", 1000, 1, false},
+	{"follower lights 2 heads, -300 ppm", -300, 2, true},
+};
+
+static long skewPpm;		// the follower's clock error, for followerClock
+static unsigned long seed = 12345;
+
+// the follower's clock: the simulated time, run fast or slow
+unsigned long followerClock()
+{
+	unsigned long t = micros();
+
+	return(t + (unsigned long)(((long long)t * skewPpm) / 1000000LL));
+} // followerClock
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// the same mast on each board: three heads of three lamps, common anode on pin 2
+static void addMast(linesideSignal &signals, int heads, boolean flashing)
+{
+	int head;
+
+	signals.setupSignal();
+	for (head = 1; head <= 3; head++) {
+		signals.addLamp(1, head, 1, 2, 3 * head, LSS_GREEN);
+		signals.addLamp(1, head, 2, 2, (3 * head) + 1, LSS_YELLOW);
+		signals.addLamp(1, head, 3, 2, (3 * head) + 2, LSS_RED);
+	}
+	for (head = 1; head <= heads; head++) signals.setHeadColor(1, head, LSS_YELLOW, flashing && (head == 1));
+} // addMast
+
+// the master's sync pin, from its pinHook: the times it changed level
+static unsigned long edges[MAX_EDGES];
+static long edgeCount;
+static byte syncLevel;
+
+static void watchSync(hostBoard *board, byte pin)
+{
+	if ((pin != SYNC_PIN) || (board->level[SYNC_PIN] == syncLevel)) return;
+	syncLevel = board->level[SYNC_PIN];
+	if (edgeCount < MAX_EDGES) edges[edgeCount++] = board->us;
+} // watchSync
+
+// runMaster
+//
+// Run the master for the case, on a board of its own in a process of its own, and take the
+// starts of its ramp cycles and the changes of its sync pin. Returns false if it ended early.
+static boolean runMaster(const loopCase &c, unsigned long *starts, int &count)
+{
+	hostProcess process;
+	hostBoard board;
+	linesideSignal master;
+
+	if (process.start()) {
+		board.echo = false;
+		board.use();
+		addMast(master, 3, c.flashing);
+		master.setSyncMaster(SYNC_PIN);
+		syncLevel = board.level[SYNC_PIN];
+		edgeCount = 0;
+		board.pinHook = watchSync;
+		count = 0;
+		while (board.us < RUN_TIME) {
+			master.updateSignals();
+			if (master.syncBoundary() && (count < MAX_CYCLES)) starts[count++] = board.us;
+			board.advance(loopTime());
+		}
+		process.send(&count, sizeof(count));
+		process.send(starts, count * sizeof(starts[0]));
+		process.send(&edgeCount, sizeof(edgeCount));
+		process.send(edges, edgeCount * sizeof(edges[0]));
+		process.finish(0);
+	}
+	if (!process.receive(&count, sizeof(count)) || !process.receive(starts, count * sizeof(starts[0]))
+		|| !process.receive(&edgeCount, sizeof(edgeCount)) || !process.receive(edges, edgeCount * sizeof(edges[0]))) return(false);
+	return(process.wait() == 0);
+} // runMaster
+
+// runFollower
+//
+// Run the follower for the case, on a board of its own in a process of its own, with the
+// master's sync pin changes played into its own, and take the starts of its ramp cycles.
+// Returns false if it ended early.
+static boolean runFollower(const loopCase &c, unsigned long *starts, int &count)
+{
+	hostProcess process;
+	hostBoard board;
+	linesideSignal follower;
+
+	if (process.start()) {
+		seed = 67890; // loop times of its own
+		skewPpm = c.skew;
+		board.echo = false;
+		board.use();
+		board.us = 3777; // not quite in step to start with
+		board.setEdges(SYNC_PIN, edges, edgeCount); // the wire
+		follower.setClock(followerClock);
+		addMast(follower, c.followerHeads, c.flashing);
+		follower.setSyncFollower(SYNC_PIN);
+		count = 0;
+		while (board.us < RUN_TIME) {
+			follower.updateSignals();
+			if (follower.syncBoundary() && (count < MAX_CYCLES)) starts[count++] = board.us;
+			board.advance(loopTime());
+		}
+		process.send(&count, sizeof(count));
+		process.send(starts, count * sizeof(starts[0]));
+		process.finish(0);
+	}
+	if (!process.receive(&count, sizeof(count)) || !process.receive(starts, count * sizeof(starts[0]))) return(false);
+	return(process.wait() == 0);
+} // runFollower
+
+// runCase
+//
+// Run one case, and return the worst time between the boards' cycles once locked (or -1 if
+// the follower never started a cycle after the settling time).
+static long runCase(const loopCase &c, boolean verbose, long &mean, int &count)
+{
+	static unsigned long masterStarts[MAX_CYCLES], followerStarts[MAX_CYCLES];
+	int masterCount = 0, followerCount = 0;
+	long gap, best, worst = -1;
+	long total = 0;
+	int i, j;
+
+	count = 0;
+	mean = 0;
+	if (!runMaster(c, masterStarts, masterCount) || !runFollower(c, followerStarts, followerCount)) return(-1);
+
+	// match each of the follower's cycles to the master's nearest
+	for (i = 0; i < followerCount; i++) {
+		best = 0x7FFFFFFFL;
+		for (j = 0; j < masterCount; j++) {
+			gap = long(followerStarts[i] - masterStarts[j]);
+			if (labs(gap) < labs(best)) best = gap;
+		}
+		if (verbose) printf("  %10.3f s: follower %+6ld us\n", followerStarts[i] / 1e6, best);
+		if ((followerStarts[i] > SETTLE_TIME) && (followerStarts[i] < (RUN_TIME - 2000000L))) {
+			if (labs(best) > worst) worst = labs(best);
+			total += labs(best);
+			count++;
+		}
+	}
+
+	mean = (count > 0) ? (total / count) : 0;
+	return(worst);
+} // runCase
+
+int main(int argc, char **argv)
+{
+	boolean verbose = (argc > 1);
+	boolean failed = false;
+	long worst, mean;
+	int count;
+	unsigned int n;
+
+	printf("follower start of each ramp cycle, from the master's (after %ld s to lock):\n", SETTLE_TIME / 1000000L);
+	for (n = 0; n < (sizeof(cases) / sizeof(cases[0])); n++) {
+		worst = runCase(cases[n], verbose, mean, count);
+		printf("  %-36s %3d cycles, mean %4ld us, worst %4ld us", cases[n].name, count, mean, worst);
+		if ((worst < 0) || (worst > LOCK_LIMIT)) {
+			printf("  FAIL (limit %d us)\n", LOCK_LIMIT);
+			failed = true;
+		} else {
+			printf("  ok\n");
+		}
+	}
+	return(failed ? 1 : 0);
+} // main
@@ -0,0 +1,57 @@
+// timebaseBench
+//
+// Counts the reads of the clock (micros() and millis()) for each call of updateSignals, on a
+// simulated Uno: three masts of three three-lamp heads (27 lamps, 9 lit, one head flashing),
+// called CALLS times with LOOP_TIME microseconds of the rest of loop() between calls. Each
+// call of micros() stops interrupts on an AVR, and takes about 4 us.
+//
+// It uses nothing newer than setupSignal, addLamp, setHeadColor and updateSignals, so it can
+// be built against an older version with make LIBDIR=dir, to compare. Versions before the loop
+// average was checked for zero divide by it on the first call, which stops the program on a PC
+// (but not on an AVR): guard that line in the older copy first.
+//
+// Usage: timebaseBench [calls]
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CALLS 1000000L
+#define LOOP_TIME 20	// microseconds
+
+int main(int argc, char **argv)
+{
+	hostBoard board;
+	linesideSignal signals;
+	long calls = CALLS, n;
+	unsigned long start, reads;
+	int mast, head, lamp;
+
+	if (argc > 1) calls = atol(argv[1]);
+	board.echo = false;
+	board.use();
+	signals.setupSignal();
+	for (mast = 1; mast <= 3; mast++) { // mast n's heads on anodes 3n - 1 to 3n + 1, cathodes 11 - 13
+		for (head = 1; head <= 3; head++) {
+			for (lamp = 1; lamp <= 3; lamp++) signals.addLamp(mast, head, lamp, (3 * mast) + head - 2, 10 + lamp, lamp);
+			signals.setHeadColor(mast, head, ((mast + head) % 3) + 1, (mast == 1) && (head == 1));
+		}
+	}
+	signals.updateSignals(); // the first call discharges the pins
+	board.advance(LOOP_TIME);
+
+	reads = board.microsCalls;
+	start = board.now();
+	for (n = 0; n < calls; n++) {
+		signals.updateSignals();
+		board.advance(LOOP_TIME);
+	}
+	reads = board.microsCalls - reads;
+
+	printf("%ld calls of updateSignals in %lu simulated ms: %lu clock reads, %.2f a call, %.1f us a call in all\n",
+		calls, (board.now() - start) / 1000UL, reads, double(reads) / calls, double(board.now() - start) / calls - LOOP_TIME);
+	return(0);
+} // main
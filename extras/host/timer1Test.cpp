@@ -0,0 +1,122 @@
+// timer1Test
+//
+// Checks the Timer1 clock (LSS_USE_TIMER1) against the simulated clock on a simulated Uno, over
+// many wraps of the 16-bit Timer1 count (one every 32.768 ms).
+//
+// The library keeps its clock in a private static member, shared by a board's instances, which
+// this program reads through a pointer taken where C++ lets it (the explicit instantiation of a
+// template). The signals (a mast of three heads, one flashing) run for SECONDS seconds with
+// 20 - 120 us loops, and every thousandth loop LONG_LOOP, just under the 32 ms the clock needs
+// reading in. After every call of updateSignals the library's clock is
+// compared with the simulated one: the difference may only move by what was spent after the
+// clock was last read in that call, so this fails if it spreads over more than SLACK
+// microseconds (the clock gaining or losing time), or if, once the signals have settled (after
+// two seconds), any second has less than half the LEDs lit of the busiest (a clock going wrong
+// holds an LED lit).
+//
+// On a PC an unsigned long has 64 bits, so the clock's own wrap after 2^32 microseconds (as
+// micros() wraps on an AVR) can't be run here.
+//
+// Usage: timer1Test
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+
+#define SECONDS 20
+#define LONG_LOOP 30000UL	// microseconds
+#define SLACK 100L			// microseconds
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// from the pins: the LEDs lit
+static unsigned long slots;
+static boolean anyLit;
+
+static void watchPins(hostBoard *board, byte pin)
+{
+	boolean lit = (board->litCount(2, 11) > 0);
+
+	if (lit && !anyLit) slots++;
+	anyLit = lit;
+} // watchPins
+
+// the library's clock, as last read: an explicit instantiation may name a private member, and
+// this one hands the member's address to timer1Clock
+unsigned long *timer1Clock();
+
+template <unsigned long *clock> struct clockAccess {
+	friend unsigned long *timer1Clock() { return(clock); }
+};
+
+template struct clockAccess<&linesideSignal::_timer1Micros>;
+
+static unsigned long libraryClock()
+{
+	return(*timer1Clock());
+} // libraryClock
+
+int main()
+{
+	hostBoard board;
+	linesideSignal signals;
+	unsigned long start, most = 0, fewest = 0xFFFFFFFFUL;
+	long offset, lowest = 0x7FFFFFFFL, highest = -0x7FFFFFFFL;
+	long calls = 0;
+	int second, problems = 0;
+
+	board.echo = false;
+	board.use();
+	signals.setupSignal();
+	signals.addLamp(1, 1, 1, 2, 3, LSS_GREEN);
+	signals.addLamp(1, 1, 2, 2, 4, LSS_YELLOW);
+	signals.addLamp(1, 1, 3, 2, 5, LSS_RED);
+	signals.addLamp(1, 2, 1, 2, 6, LSS_GREEN);
+	signals.addLamp(1, 2, 2, 2, 7, LSS_YELLOW);
+	signals.addLamp(1, 2, 3, 2, 8, LSS_RED);
+	signals.addLamp(1, 3, 1, 2, 9, LSS_GREEN);
+	signals.addLamp(1, 3, 2, 2, 10, LSS_YELLOW);
+	signals.addLamp(1, 3, 3, 2, 11, LSS_RED);
+	signals.setHeadColor(1, 1, LSS_GREEN);
+	signals.setHeadColor(1, 2, LSS_YELLOW);
+	signals.setHeadColor(1, 3, LSS_RED, true);
+	signals.updateSignals(); // the first call discharges the pins
+	board.pinHook = watchPins;
+
+	for (second = 0; second < SECONDS; second++) {
+		slots = 0;
+		start = board.now();
+		while ((board.now() - start) < 1000000UL) {
+			signals.updateSignals();
+			offset = long(board.now() - libraryClock());
+			if (offset < lowest) lowest = offset;
+			if (offset > highest) highest = offset;
+			board.advance(((++calls % 1000) == 0) ? LONG_LOOP : loopTime());
+		}
+		if (second < 2) continue; // starting up (the lamps light after about a second)
+		if (slots < fewest) fewest = slots;
+		if (slots > most) most = slots;
+	}
+	board.pinHook = NULL;
+
+	printf("%d s, %lu wraps of Timer1, %lu reads: the clocks' difference spread by %ld us; %lu - %lu LEDs lit a second\n",
+		SECONDS, (board.now() * 2UL) >> 16, board.timer1Reads, highest - lowest, fewest, most);
+	if ((highest - lowest) > SLACK) {
+		printf("FAIL: the clock didn't keep time\n");
+		problems++;
+	}
+	if ((fewest * 2UL) < most) {
+		printf("FAIL: an LED held lit\n");
+		problems++;
+	}
+	return((problems > 0) ? 1 : 0);
+} // main
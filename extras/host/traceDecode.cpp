@@ -0,0 +1,272 @@
+// traceDecode
+//
+// Decodes what dumpTrace prints (LSS_USE_SLOT_TRACE), as copied from the serial monitor of a
+// board, into a summary: the time the trace covers, the passes through the lit lamps and the
+// longest, the slots and the longest, and for each LED the slots it had and how long it was lit
+// (from its cathode turned on to the next cathode or anode turned off). Anything that isn't a
+// line of the trace is ignored, so a whole serial log can be given. A gap of 65535 is one the
+// trace couldn't hold (65 ms or more), and a HALT is shown with the entry it tripped on.
+//
+// Without a file it checks itself: the first mast of SignalExample (three heads, one of them
+// flashing) runs for RUN_TIME on a simulated Uno built with LSS_USE_SLOT_TRACE, with every LED
+// lit recorded from the pins. Then dumpTrace is called, its output decoded, and each LED the
+// trace says was lit must be the one lit on the pins, in the same order, with the same time
+// from one to the next within GAP_TOLERANCE microseconds.
+//
+// Usage: traceDecode [file]	(- for standard input)
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define RUN_TIME 4000000UL	// simulated microseconds for the check
+#define GAP_TOLERANCE 20	// microseconds
+#define MAX_LEDS 64
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+// one line of the trace
+struct traceEntry {
+	long t;
+	long delta;
+	int anode;
+	int cathode;
+	char name[16];	// mast.head.lamp, or empty
+	byte actions;	// LSS_SLOT_ bits
+};
+
+// decodeLine
+//
+// Read one line of dumpTrace into an entry. Returns false if it isn't one.
+static boolean decodeLine(const char *line, traceEntry &entry)
+{
+	static const struct { const char *word; byte bit; } words[] = {
+		{ "new", LSS_SLOT_NEW }, { "pass", LSS_SLOT_PASS }, { "div", LSS_SLOT_DIV },
+		{ "C-", LSS_SLOT_CATHODE_OFF }, { "A-", LSS_SLOT_ANODE_OFF }, { "A+", LSS_SLOT_ANODE_ON },
+		{ "C+", LSS_SLOT_CATHODE_ON }, { "HALT", LSS_SLOT_HALT }
+	};
+	char word[16];
+	int used, w;
+
+	if (sscanf(line, "t=%ld +%ld A%d C%d%n", &entry.t, &entry.delta, &entry.anode, &entry.cathode, &used) != 4) return(false);
+	entry.name[0] = '\0';
+	entry.actions = 0;
+	line += used;
+	while (sscanf(line, "%15s%n", word, &used) == 1) {
+		line += used;
+		if ((word[0] >= '0') && (word[0] <= '9')) {
+			strcpy(entry.name, word);
+			continue;
+		}
+		for (w = 0; w < int(sizeof(words) / sizeof(words[0])); w++) {
+			if (strcmp(word, words[w].word) == 0) entry.actions |= words[w].bit;
+		}
+	}
+	return(true);
+} // decodeLine
+
+// decodeText
+//
+// Read every line of the trace from some text.
+static std::vector<traceEntry> decodeText(const std::string &text)
+{
+	std::vector<traceEntry> entries;
+	traceEntry entry;
+	size_t start = 0, end;
+
+	while (start < text.size()) {
+		end = text.find('\n', start);
+		if (end == std::string::npos) end = text.size();
+		if (decodeLine(text.substr(start, end - start).c_str(), entry)) entries.push_back(entry);
+		start = end + 1;
+	}
+	return(entries);
+} // decodeText
+
+// summarize
+//
+// Print what the trace shows.
+static void summarize(const std::vector<traceEntry> &entries)
+{
+	struct { int anode, cathode; char name[16]; long slots, lit; } leds[MAX_LEDS];
+	int nLEDs = 0, led, litLED = -1;
+	long litAt = 0, lastPass = -1, lastNew = -1, passes = 0, passTime = 0, longestPass = 0, newSlots = 0, longestSlot = 0;
+	size_t i;
+	const traceEntry *e;
+
+	if (entries.empty()) {
+		printf("no trace found\n");
+		return;
+	}
+	printf("%lu entries over %ld us\n", (unsigned long)entries.size(), entries.back().t);
+	for (i = 0; i < entries.size(); i++) {
+		e = &entries[i];
+		if ((i > 0) && (e->delta == 65535L)) printf("  t=%ld: a gap of 65 ms or more before this entry\n", e->t);
+		if (e->actions & LSS_SLOT_HALT) printf("  t=%ld: HALT on A%d C%d %s\n", e->t, e->anode, e->cathode, e->name);
+
+		if ((litLED >= 0) && (e->actions & (LSS_SLOT_CATHODE_OFF | LSS_SLOT_ANODE_OFF))) { // the lit LED went dark
+			leds[litLED].lit += e->t - litAt;
+			litLED = -1;
+		}
+		for (led = 0; led < nLEDs; led++) if ((leds[led].anode == e->anode) && (leds[led].cathode == e->cathode)) break;
+		if ((led == nLEDs) && (nLEDs < MAX_LEDS)) {
+			leds[led].anode = e->anode;
+			leds[led].cathode = e->cathode;
+			strcpy(leds[led].name, e->name);
+			leds[led].slots = leds[led].lit = 0;
+			nLEDs++;
+		}
+		if ((e->actions & LSS_SLOT_CATHODE_ON) && (led < nLEDs)) {
+			leds[led].slots++;
+			litLED = led;
+			litAt = e->t;
+		}
+
+		if (e->actions & LSS_SLOT_NEW) {
+			if ((lastNew >= 0) && ((e->t - lastNew) > longestSlot)) longestSlot = e->t - lastNew;
+			if (lastNew >= 0) newSlots++;
+			lastNew = e->t;
+		}
+		if (e->actions & LSS_SLOT_PASS) {
+			if (lastPass >= 0) {
+				passes++;
+				passTime += e->t - lastPass;
+				if ((e->t - lastPass) > longestPass) longestPass = e->t - lastPass;
+			}
+			lastPass = e->t;
+		}
+	}
+	if (passes > 0) printf("%ld whole passes, %ld us each on average, the longest %ld us\n", passes, passTime / passes, longestPass);
+	if (newSlots > 0) printf("%ld whole slots, the longest %ld us\n", newSlots, longestSlot);
+	for (led = 0; led < nLEDs; led++) {
+		printf("  A%-2d C%-2d %-8s %3ld slots lit, %6ld us\n", leds[led].anode, leds[led].cathode, leds[led].name, leds[led].slots, leds[led].lit);
+	}
+} // summarize
+
+// from the pins, for the check: each LED lit, in order
+struct litEvent {
+	unsigned long t;
+	byte anode;
+	byte cathode;
+};
+static std::vector<litEvent> litLog;
+static byte litAnode, litCathode;
+
+static void watchPins(hostBoard *board, byte pin)
+{
+	byte anode, cathode;
+	litEvent lit;
+
+	for (anode = 2; anode <= 11; anode++) { // the LED lit now, if any
+		for (cathode = 2; cathode <= 11; cathode++) {
+			if ((anode != cathode) && board->lit(anode, cathode)) break;
+		}
+		if (cathode <= 11) break;
+	}
+	if (anode > 11) anode = cathode = 0;
+	if ((anode == litAnode) && (cathode == litCathode)) return;
+	litAnode = anode;
+	litCathode = cathode;
+	if (anode == 0) return;
+	lit.t = board->now();
+	lit.anode = anode;
+	lit.cathode = cathode;
+	litLog.push_back(lit);
+} // watchPins
+
+// selfCheck
+//
+// Run a mast with the trace on and compare the decoded trace with the pins.
+static int selfCheck()
+{
+	hostBoard board;
+	linesideSignal signals;
+	std::vector<traceEntry> entries, lit;
+	unsigned long start;
+	long gap, pinGap, worst = 0;
+	size_t i, first;
+	int wrong = 0;
+
+	board.echo = false;
+	board.use();
+	signals.setupSignal();
+	signals.addLamp(1, 1, 1, 2, 3, LSS_GREEN);
+	signals.addLamp(1, 1, 2, 2, 4, LSS_YELLOW);
+	signals.addLamp(1, 1, 3, 2, 5, LSS_RED);
+	signals.addLamp(1, 2, 1, 2, 6, LSS_GREEN);
+	signals.addLamp(1, 2, 2, 2, 7, LSS_YELLOW);
+	signals.addLamp(1, 2, 3, 2, 8, LSS_RED);
+	signals.addLamp(1, 3, 1, 2, 9, LSS_GREEN);
+	signals.addLamp(1, 3, 2, 2, 10, LSS_YELLOW);
+	signals.addLamp(1, 3, 3, 2, 11, LSS_RED);
+	signals.setHeadColor(1, 1, LSS_GREEN);
+	signals.setHeadColor(1, 2, LSS_YELLOW);
+	signals.setHeadColor(1, 3, LSS_RED, true);
+	board.pinHook = watchPins;
+
+	start = board.now();
+	while ((board.now() - start) < RUN_TIME) {
+		signals.updateSignals();
+		board.advance(loopTime());
+	}
+	board.pinHook = NULL;
+	board.takeOutput();
+	signals.dumpTrace();
+	entries = decodeText(board.takeOutput());
+	summarize(entries);
+
+	for (i = 0; i < entries.size(); i++) if (entries[i].actions & LSS_SLOT_CATHODE_ON) lit.push_back(entries[i]);
+	if ((entries.size() != LSS_SLOT_ENTRIES) || (lit.size() < 2) || (litLog.size() < lit.size())) {
+		printf("FAIL: %lu entries, %lu with an LED lit, %lu LEDs lit on the pins\n", (unsigned long)entries.size(), (unsigned long)lit.size(), (unsigned long)litLog.size());
+		return(1);
+	}
+	first = litLog.size() - lit.size(); // the trace holds the last ones
+	for (i = 0; i < lit.size(); i++) {
+		if ((lit[i].anode != litLog[first + i].anode) || (lit[i].cathode != litLog[first + i].cathode)) {
+			printf("FAIL: the trace lit A%d C%d at t=%ld, the pins A%d C%d\n", lit[i].anode, lit[i].cathode, lit[i].t, litLog[first + i].anode, litLog[first + i].cathode);
+			wrong++;
+		}
+		if (i == 0) continue;
+		gap = lit[i].t - lit[i - 1].t;
+		pinGap = long(litLog[first + i].t - litLog[first + i - 1].t);
+		if (labs(gap - pinGap) > worst) worst = labs(gap - pinGap);
+	}
+	printf("%lu LEDs lit in the trace, %d not the one on the pins; times from one to the next within %ld us of the pins\n", (unsigned long)lit.size(), wrong, worst);
+	if (worst > GAP_TOLERANCE) {
+		printf("FAIL: the trace's times are off by more than %d us\n", GAP_TOLERANCE);
+		wrong++;
+	}
+	return((wrong > 0) ? 1 : 0);
+} // selfCheck
+
+int main(int argc, char **argv)
+{
+	std::string text;
+	FILE *in;
+	char buffer[256];
+
+	if (argc < 2) return(selfCheck());
+
+	in = (strcmp(argv[1], "-") == 0) ? stdin : fopen(argv[1], "r");
+	if (in == NULL) {
+		fprintf(stderr, "traceDecode: can't read %s\n", argv[1]);
+		return(1);
+	}
+	while (fgets(buffer, sizeof(buffer), in) != NULL) text += buffer;
+	if (in != stdin) fclose(in);
+	summarize(decodeText(text));
+	return(0);
+} // main
@@ -0,0 +1,186 @@
+// vcdTrace
+//
+// The TraceExample as a PC program: runs its signals (the first mast of SignalExample, three
+// heads on pins 2 - 11) on a simulated Uno and writes what setTrace reports as a VCD (value
+// change dump) file, for GTKWave or a similar viewer: each anode and cathode pin (1, 0 or z),
+// the LED whose slot it is, the ramp division and the number of lamps lit.
+//
+// The capture starts 3 seconds in, just after the top head changes to green (as in the
+// example), and runs for the time given (100 ms by default). On a PC there is no buffer to
+// fill, so it can be as long as wanted.
+//
+// The trace is also checked against the simulated pins: at the end of each call of
+// updateSignals, every pin the trace reported in that call must be in the state it said
+// (LSS_PIN_HIGH an output written HIGH, LSS_PIN_GROUND an output written LOW, LSS_PIN_Z an
+// input). The count of pins that weren't goes to stderr, and the program exits non-zero if
+// there are any.
+//
+// Usage: vcdTrace [ms] [file]	(standard output without a file)
+//
+// Released into the public domain.
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FIRST_PIN 2
+#define LAST_PIN 11
+#define START_TIME 3000000UL	// simulated microseconds before the capture
+
+static unsigned long seed = 12345;
+
+// time spent in the rest of loop(), 20 - 120 microseconds
+static unsigned long loopTime()
+{
+	seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return(20 + ((seed >> 8) % 101));
+} // loopTime
+
+static FILE *vcd;
+static unsigned long captureStart;
+static unsigned long lastStamp;
+static boolean stamped;
+
+// what the trace said of each pin in this call (NOT_TRACED if nothing)
+#define NOT_TRACED 0xFF
+static byte traced[HOST_PINS];
+static unsigned long events;
+
+// the VCD identifier of a pin (a single printable character)
+static char pinId(byte pin)
+{
+	return(char('A' + pin));
+} // pinId
+
+// print a number as a VCD vector value of a marker
+static void printVector(byte value, char id)
+{
+	int bit;
+
+	fputc('b', vcd);
+	for (bit = 7; bit >= 0; bit--) fputc(((value >> bit) & 1) ? '1' : '0', vcd);
+	fprintf(vcd, " %c\n", id);
+} // printVector
+
+// writeEvent
+//
+// Write one event from setTrace, at the simulated time it happened.
+void writeEvent(byte event, byte arg1, byte arg2)
+{
+	unsigned long stamp = hostBoard::current()->now() - captureStart;
+
+	events++;
+	if (!stamped || (stamp != lastStamp)) { // a new time (events can share one)
+		fprintf(vcd, "#%lu\n", stamp);
+		lastStamp = stamp;
+		stamped = true;
+	}
+	switch (event) {
+		case LSS_TRACE_PIN:
+			fprintf(vcd, "%c%c\n", (arg2 == LSS_PIN_HIGH) ? '1' : ((arg2 == LSS_PIN_GROUND) ? '0' : 'z'), pinId(arg1));
+			traced[arg1] = arg2;
+		break;
+
+		case LSS_TRACE_SLOT:
+			printVector(arg1, '!');
+			printVector(arg2, '"');
+		break;
+
+		case LSS_TRACE_DIV:
+			printVector(arg1, '#');
+		break;
+
+		case LSS_TRACE_LAMPS:
+			printVector(arg1, '$');
+		break;
+	} // switch
+} // writeEvent
+
+// writeHeader
+//
+// The VCD definitions, with every signal unknown until its first change.
+static void writeHeader()
+{
+	byte pin;
+
+	fprintf(vcd, "$date linesideSignal capture (simulated) $end\n");
+	fprintf(vcd, "$timescale 1us $end\n");
+	fprintf(vcd, "$scope module linesideSignal $end\n");
+	for (pin = FIRST_PIN; pin <= LAST_PIN; pin++) fprintf(vcd, "$var wire 1 %c pin%d $end\n", pinId(pin), pin);
+	fprintf(vcd, "$var wire 8 ! slot_anode $end\n");
+	fprintf(vcd, "$var wire 8 \" slot_cathode $end\n");
+	fprintf(vcd, "$var wire 8 # division $end\n");
+	fprintf(vcd, "$var wire 8 $ lamps_lit $end\n");
+	fprintf(vcd, "$upscope $end\n");
+	fprintf(vcd, "$enddefinitions $end\n");
+	fprintf(vcd, "#0\n$dumpvars\n");
+	for (pin = FIRST_PIN; pin <= LAST_PIN; pin++) fprintf(vcd, "x%c\n", pinId(pin));
+	fprintf(vcd, "bx !\nbx \"\nbx #\nbx $\n$end\n");
+	stamped = true;
+	lastStamp = 0;
+} // writeHeader
+
+int main(int argc, char **argv)
+{
+	hostBoard board;
+	linesideSignal signals;
+	unsigned long captureTime = 100000UL;
+	unsigned long start;
+	long wrong = 0, checked = 0;
+	byte pin;
+	boolean right;
+
+	if (argc > 1) captureTime = strtoul(argv[1], NULL, 10) * 1000UL;
+	vcd = stdout;
+	if ((argc > 2) && ((vcd = fopen(argv[2], "w")) == NULL)) {
+		fprintf(stderr, "vcdTrace: can't write %s\n", argv[2]);
+		return(1);
+	}
+
+	board.echo = false;
+	board.use();
+	signals.setupSignal();
+	signals.addLamp(1, 1, 1, 2, 3, LSS_GREEN); // first mast, first head
+	signals.addLamp(1, 1, 2, 2, 4, LSS_YELLOW);
+	signals.addLamp(1, 1, 3, 2, 5, LSS_RED);
+	signals.addLamp(1, 2, 1, 2, 6, LSS_GREEN); // first mast, second head
+	signals.addLamp(1, 2, 2, 2, 7, LSS_YELLOW);
+	signals.addLamp(1, 2, 3, 2, 8, LSS_RED);
+	signals.addLamp(1, 3, 1, 2, 9, LSS_GREEN); // first mast, third head
+	signals.addLamp(1, 3, 2, 2, 10, LSS_YELLOW);
+	signals.addLamp(1, 3, 3, 2, 11, LSS_RED);
+	signals.setHeadColor(1, 1, LSS_RED);
+	signals.setHeadColor(1, 2, LSS_YELLOW);
+	signals.setHeadColor(1, 3, LSS_RED, true);
+
+	start = board.now();
+	while ((board.now() - start) < START_TIME) {
+		signals.updateSignals();
+		board.advance(loopTime());
+	}
+
+	for (pin = 0; pin < HOST_PINS; pin++) traced[pin] = NOT_TRACED;
+	signals.setHeadColor(1, 1, LSS_GREEN);
+	captureStart = board.now();
+	writeHeader();
+	signals.setTrace(writeEvent);
+	while ((board.now() - captureStart) < captureTime) {
+		signals.updateSignals();
+		for (pin = FIRST_PIN; pin <= LAST_PIN; pin++) { // the pins now as the trace said
+			if (traced[pin] == NOT_TRACED) continue;
+			if (traced[pin] == LSS_PIN_Z) right = (board.mode[pin] != OUTPUT);
+			else right = (board.mode[pin] == OUTPUT) && (board.level[pin] == ((traced[pin] == LSS_PIN_HIGH) ? HIGH : LOW));
+			checked++;
+			if (!right) wrong++;
+			traced[pin] = NOT_TRACED;
+		}
+		board.advance(loopTime());
+	}
+	signals.setTrace(NULL);
+	fprintf(vcd, "#%lu\n", board.now() - captureStart);
+	if (vcd != stdout) fclose(vcd);
+
+	fprintf(stderr, "vcdTrace: %lu events in %lu ms, %ld pin states checked, %ld not as traced\n", events, captureTime / 1000UL, checked, wrong);
+	return((wrong > 0) ? 1 : 0);
+} // main
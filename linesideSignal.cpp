@@ -228,16 +228,56 @@
 // These set and return booleans packed into a single byte in order to be as frugal as
 // we can in terms of SRAM use.
 
-// set the bit (0-15) identified by flag
+#if defined(LSS_USE_BITPLANES)
+// With bit planes, the flags are kept outside the lamp, one plane per flag, with one bit per lamp.
+
+// shared by all instances of the class
+byte signalLamp::_flagPlanes[LSS_SL_MAX + 1][LSS_PLANE_BYTES];
+byte signalLamp::_lampTotal = 0;
+signalLamp signalLamp::_lampPool[LSS_MAX_LAMPS + 1];
+
+// the lamp's bit in the planes is its place in the pool
+byte signalLamp::index()
+{
+	return(byte(this - _lampPool));
+} // index
+
+// set the plane bit identified by flag
 void signalLamp::setBitFlag(int flag, boolean flagVal)
 {
-	int tempFlags;
+	byte n = index();
 	
-#if defined(LSS_DEBUG_REPORTING)
-	int oldFlags;
+	if ((flag < 0) || (flag > LSS_SL_MAX)) return; // ignore invalid bits
 	
-	oldFlags = _lampFlags;
-#endif
+	if (flagVal) {
+		_flagPlanes[flag][n >> 3] |= (1 << (n & 7));
+	} else {
+		_flagPlanes[flag][n >> 3] &= ~(1 << (n & 7));
+	}
+} // setBitFlag
+
+boolean signalLamp::getBitFlag(int flag)
+{
+	byte n = index();
+	
+	if ((flag < 0) || (flag > LSS_SL_MAX)) return(false); // ignore invalid bits
+
+	return((_flagPlanes[flag][n >> 3] & (1 << (n & 7))) != 0);
+} // getBitFlag
+
+// initialize storage to zero
+void signalLamp::clearBitFlags()
+{
+	int flag;
+	
+	for (flag = 0; flag <= LSS_SL_MAX; flag++) setBitFlag(flag, false);
+} // clearBitFlags
+
+#else
+// set the bit (0-15) identified by flag
+void signalLamp::setBitFlag(int flag, boolean flagVal)
+{
+	int tempFlags;
 	
 	if (flag > 15) return; // ignore invalid bits
 	
@@ -264,6 +304,7 @@ void signalLamp::clearBitFlags()
 {
 	_lampFlags = 0;
 } // clearBitFlags
+#endif
 
 boolean signalLamp::isOn()
 {
@@ -301,8 +342,48 @@ boolean signalLamp::onHold()
 	return(getBitFlag(LSS_SL_DELAY));
 } // onHold
 
+// a lit lamp is shown unless its mast is approach lit and waiting for a train
+boolean signalLamp::isShown()
+{	
+	return(isOn() && !getBitFlag(LSS_SL_APPROACH));
+} // isShown
+
 /************************ linesideSignal class routines ******************************/
 
+// shared by all instances of the class
+int linesideSignal::_anodeCount = 0;		// safety net - count active pins
+int linesideSignal::_cathodeCount = 0;
+byte linesideSignal::_pinsToDrain[LSS_PIN_BYTES] = {0};
+boolean linesideSignal::_drainPending = false;
+boolean linesideSignal::_draining = false;
+long linesideSignal::_drainUntil = 0;
+boolean linesideSignal::_signalsRunning = false;
+boolean linesideSignal::_timingStale = false;
+#if defined(LSS_USE_SLOT_TRACE)
+signalSlot linesideSignal::_slotTrace[LSS_SLOT_ENTRIES];
+byte linesideSignal::_slotNext = 0;
+boolean linesideSignal::_slotWrapped = false;
+byte linesideSignal::_slotActions = 0;
+long linesideSignal::_slotStamp = 0;
+#endif
+#if defined(LSS_USE_TIMER1)
+uint16_t linesideSignal::_timer1Count = 0;
+byte linesideSignal::_timer1Odd = 0;
+unsigned long linesideSignal::_timer1Micros = 0;
+#endif
+#if defined(LSS_USE_EFFECTS)
+// the passes lit at each effect level, bit n for pass n of LSS_FX_PASSES, as the ramp lights them
+const unsigned int linesideSignal::_levelMasks[LSS_FX_FULL + 1] PROGMEM = {
+	0x0000,	// LSS_FX_OFF
+	0x0041,	// LSS_FX_LOW, passes 0 and 6
+	0x0111,	// LSS_FX_QUARTER, passes 0, 4 and 8
+	0x0555,	// LSS_FX_HALF, every other pass
+	0x0FFF	// LSS_FX_FULL
+};
+#endif
+linesideSignal *linesideSignal::_signalList = NULL;
+linesideSignal *linesideSignal::_activeSignal = NULL;
+
 
 // class constructor - runs before the sketch setup to initialize an instance of the class
 // Hardware and global data structures may not be initialized when this is run, put 
@@ -310,6 +391,9 @@ boolean signalLamp::onHold()
 linesideSignal::linesideSignal()
 {
   // do nothing here beyond initializing simple variables
+#if defined(LSS_USE_BITPLANES)
+	byte n;
+#endif
   
 	_setupIsDone = false;
 	
@@ -326,8 +410,110 @@ linesideSignal::linesideSignal()
 	_killSwitch = false;	// we don't need to turn anything off
 	_killAnode = false;
 	
-	_anodeCount = 0; // safety net - count active pins
-	_cathodeCount = 0;
+	_syncMode = LSS_SYNC_NONE;	// free-running until told otherwise
+	_syncPin = LSS_NOT_PIN;
+	_syncLevel = false;
+	_syncFlag = false;
+	_syncStamp = 0;
+	_syncEdgeStamp = 0;
+	_syncPeriod = 0;
+	_syncBehind = false;
+	_syncFreq = 0;
+	_syncSlip = 0;
+	_syncTrim = 0;
+	
+	_trace = NULL;			// no tracing until setTrace
+	
+#if defined(LSS_USE_TIMER1)
+	_clock = _timer1Clock;	// Timer1 (started by setupSignal)
+#else
+	_clock = micros;		// until setClock says otherwise
+#endif
+	_updateStamp = 0;
+	_ownClock = false;
+	_clockMillis = 0;
+	_clockLast = 0;
+	_clockCarry = 0;
+	
+	_approachList = NULL;	// no approach lighting until addApproach
+	_nextApproach = NULL;
+	
+#if defined(LSS_USE_EFFECTS)
+	_effectList = NULL;		// no effects until setEffect
+	_effectDue = false;
+	_effectDiv = LSS_NUM_DIV;	// no division seen yet
+#endif
+	
+#if defined(LSS_USE_MIX)
+	_mixPairs = 0;			// none until addLamp finds both halves of one
+#endif
+	
+#if defined(LSS_USE_QUEUE)
+	_queueHead = 0;			// the queue starts empty
+	_queueTail = 0;
+#endif
+	
+#if defined(LSS_USE_SNAPSHOT)
+	_snapshotLen[0] = 0;	// nothing lit yet
+	_snapshotLen[1] = 0;
+	_snapshotSeq = 0;
+	_snapshotDue = true;
+#endif
+	
+#if defined(LSS_USE_RECORD)
+	_recordBuf = NULL;		// not recording until startRecord
+	_recordSize = 0;
+	_recordLen = 0;
+	_recordStamp = 0;
+	_replayLog = NULL;		// nor replaying until replay
+	_replayLen = 0;
+	_replayPos = 0;
+	_replayDue = 0;
+	_replaying = false;
+#endif
+	
+	_taskList = NULL;		// no tasks until addTask
+	_nextTask = NULL;
+	_lastTaskId = LSS_NO_TASK;
+	_taskOverruns = 0;
+	_taskLate = 0;
+	_taskWaits = 0;
+	_maxTaskDelay = 0;
+	
+#if defined(LSS_USE_LED_DIAG)
+	_diagLamp = NULL;		// find a lamp to check once some are lit
+	_diagCount = 0;
+	_diagOpen = 0;
+	_diagShort = 0;
+	_diagTime = 0;
+	_diagPin = LSS_NOT_PIN;		// no reading in progress
+#endif
+	
+#if defined(LSS_USE_PATTERN)
+	_patternLamps[0] = 0;	// nothing to play until usePattern
+	_patternLamps[1] = 0;
+	_patternTicks[0] = 1;
+	_patternTicks[1] = 1;
+	_patternFront = 0;
+	_patternSwap = false;
+	_patternPass = 0;
+	_patternSlot = 0;
+	_patternTick = 0;
+	_patternPasses = 0;
+	_playAnode = LSS_NOT_PIN;
+	_playCathode = LSS_NOT_PIN;
+	_patternTime = 0;
+	_patternStale = false;
+#endif
+	
+#if defined(LSS_DEBUG_VERIFY)
+	_verifySlots = 0;
+	_verifyPinErrors = 0;
+	_verifyTrips = 0;
+#endif
+	
+	_nextSignal = NULL;		// not on the scheduler list until setupSignal
+	_resumeTurn = true;		// the first turn starts with the first lit lamp
 	
 	_pulseTimePerLED = 0;
 	
@@ -339,6 +525,16 @@ linesideSignal::linesideSignal()
     _minBankTime = LSS_CYCLE_TIME;
     _minCycleTime = LSS_CYCLE_TIME;
     _maxCycleTime = 0;
+    _pinTransitions = 0;
+    _cycleTransitions = 0;
+    _approachStamp = 0;
+    _approachMast = 0;
+    _approachLatency = 0;
+    _maxApproachLatency = 0;
+#if defined(LSS_USE_QUEUE)
+    _queueLatency = 0;
+    _maxQueueLatency = 0;
+#endif
 #endif
 
 #if defined(LSS_DEBUG_NOLEDS)
@@ -351,6 +547,11 @@ linesideSignal::linesideSignal()
 
 	_lampList = NULL;
 	_currentLED = NULL;
+	_litChanged = false;
+	
+#if defined(LSS_USE_BITPLANES)
+	for (n = 0; n < LSS_PLANE_BYTES; n++) _ownLamps[n] = 0; // no lamps yet
+#endif
 	
 	_cycleCount = 0;
 	
@@ -371,6 +572,16 @@ void linesideSignal::setupSignal()
 	if (_setupIsDone) return; // only do this once
 	
 	_setupIsDone = true;
+	
+	// join the shared scheduler (at the end, so instances take turns in the order they were set up)
+	if (_signalList == NULL) {
+		_signalList = this;
+		_activeSignal = this;
+	} else {
+		linesideSignal *sig = _signalList;
+		while (sig->_nextSignal != NULL) sig = sig->_nextSignal;
+		sig->_nextSignal = this;
+	}
 
 	// initialize the list of lamps with a permanently dark lamp
 	// Note that this will always be the *LAST* lamp on the list, since new ones are pushed at front.
@@ -379,6 +590,13 @@ void linesideSignal::setupSignal()
 	_currentLED->setBitFlag(LSS_SL_RAMP, false); // it will never need a ramp
 	
 	_adjCycleTime(); // make sure the cycle and pulse rate are correct (also calls setFlashRate)
+	
+#if defined(LSS_USE_TIMER1)
+	// the Arduino core sets Timer1 up for PWM, make it count freely instead (done by each instance, no harm)
+	TCCR1A = 0;				// normal mode, count up to 0xFFFF and wrap
+	TCCR1B = _BV(CS11);		// clock / 8
+	TIMSK1 = 0;				// no interrupts
+#endif
 		
 } // setupSignal
 
@@ -393,22 +611,86 @@ void linesideSignal::setupSignal()
 void linesideSignal::_lightTimerStart(long usec, long startTime)
 {
   if (startTime == 0) {
-    _lightExpirationTime = long(micros()) + usec; // if no start specified, start now
+    _lightExpirationTime = _now() + usec; // if no start specified, start now
   } else {
     _lightExpirationTime = startTime + usec;
   } 
 } // lightTimerStart
 
 // return true if the microsecond light timer has expired (note it remains expired until started again)
+// This is updateSlot's own test, against the time it started rather than the clock now, so the
+// LED it leaves lit is the one it decided on. Work fitted into the slot uses slotSlack instead.
 boolean linesideSignal::_lightTimerExpired()
 {
-  if ( (long)((long)micros()  - _lightExpirationTime) >= 0) {
+  if ( (long)(_updateStamp  - _lightExpirationTime) >= 0) {
     return ( true );
   } else {
     return( false );     
   }
 } // lightTimerExpired
 
+// slotSlack
+//
+// Return true if the LED slot has room left for work taking *cost* microseconds, read from the
+// clock now: the time left before the light timer expires, less an average loop (the slot can't
+// end before the next call of updateSignals comes round), must be at least the cost.
+boolean linesideSignal::_slotSlack(long cost)
+{
+	return((_lightExpirationTime - _now() - long(_getAverageLoop())) >= cost);
+} // slotSlack
+
+// the microsecond clock (micros(), Timer1 or whatever setClock was given)
+long linesideSignal::_now()
+{
+	return(long(_clock()));
+} // now
+
+// the millisecond clock for the longer timers: millis(), or counted from the clock setClock was
+// given, so that a simulated clock runs everything
+long linesideSignal::_millis()
+{
+	unsigned long now;
+	unsigned long elapsed;
+	
+	if (!_ownClock) return(long(millis()));
+	
+	now = _clock();
+	elapsed = (now - _clockLast) + _clockCarry;
+	_clockLast = now;
+	_clockMillis += elapsed / 1000;
+	_clockCarry = elapsed % 1000;
+	return(long(_clockMillis));
+} // millis
+
+#if defined(LSS_USE_TIMER1)
+#if F_CPU == 16000000L
+#define LSS_TIMER1_SHIFT 1	// Timer1 counts per microsecond, as a shift (2 at 16 MHz, with clock / 8)
+#elif F_CPU == 8000000L
+#define LSS_TIMER1_SHIFT 0
+#else
+#error "LSS_USE_TIMER1 needs a 16 MHz or 8 MHz clock"
+#endif
+
+// timer1Clock
+//
+// A microsecond clock made from Timer1, counting freely (see setupSignal). The counts since
+// the last read are added on, so this keeps time as long as it is read before the count wraps,
+// every 32 ms. The unsigned subtraction handles the count wrapping between reads. Reading the
+// count doesn't need interrupts stopped, as nothing else uses Timer1.
+unsigned long linesideSignal::_timer1Clock()
+{
+	uint16_t count;
+	unsigned long counts;
+	
+	count = TCNT1;
+	counts = uint16_t(count - _timer1Count) + _timer1Odd;
+	_timer1Count = count;
+	_timer1Micros += (counts >> LSS_TIMER1_SHIFT);
+	_timer1Odd = byte(counts & ((1 << LSS_TIMER1_SHIFT) - 1)); // carry part microseconds to the next read
+	return(_timer1Micros);
+} // timer1Clock
+#endif
+
 // Averaging routines: these compute an exponential running average, which is used as a
 // means of downplaying the impact of short-lived changes.  Algorithms are based on an 
 // "alpha" that is the reciprocal of a power of two (e.g., a = 1/4) to make these
@@ -484,6 +766,11 @@ int linesideSignal::_getAverageLoop()
 // Halt in an infinite loop
 void linesideSignal::_dropDead()
 {
+#if defined(LSS_USE_SLOT_TRACE)
+	_slotActions |= LSS_SLOT_HALT;
+	_recordSlot(_now());
+	dumpTrace(); // what led up to it
+#endif
 	for (int i = 0; i < 1;) {} // loop forever
 } // dropDead
 
@@ -502,12 +789,14 @@ void linesideSignal::setCycleTime(int cycle)
 	if (!_setupIsDone) return; // safety net - do nothing without setup
 
 	if ((cycle < (2*LSS_LED_MIN)) || (cycle > 20000)) return; // ignore obviously wrong numbers
+
+#if defined(LSS_USE_RECORD)
+	_record(LSS_CMD_CYCLE, 2, byte(cycle >> 8), byte(cycle));
+#endif
 	
 	_targetCycleTime = cycle; // save the new cycle for reference going forward
 	
-	if (_targetCycleTime < _cycleTime) { // if reduced, then force adjustment to avoid ramp overrunning the flash interval
-		_resetCycleTime();
-	}
+	_timingStale = true; // re-time before the next slot (this keeps our place in the ramp, so flashes carry on)
 	
 } // setCycleTime
 
@@ -520,6 +809,10 @@ void linesideSignal::setFlashRate(int rate)
 	if (!_setupIsDone) return; // safety net - do nothing without setup
 	
 	if ((rate < 1) || (rate > LSS_MAX_FLASH_RATE)) return; // Limit the user to numbers that are reasonable
+
+#if defined(LSS_USE_RECORD)
+	_record(LSS_CMD_RATE, 2, byte(rate >> 8), byte(rate));
+#endif
 	
 	_setFlashRate(rate);
 
@@ -535,6 +828,10 @@ void linesideSignal::setRamp(byte mastOrd, byte headOrd, byte lampOrd, boolean r
 	
 	if (!_setupIsDone) return; // safety net - do nothing without setup
 
+#if defined(LSS_USE_RECORD)
+	_record(LSS_CMD_RAMP, 4, mastOrd, headOrd, lampOrd, ramp);
+#endif
+
 	lamp = _lampList;
 	while (lamp != NULL) {
 		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) 
@@ -545,168 +842,876 @@ void linesideSignal::setRamp(byte mastOrd, byte headOrd, byte lampOrd, boolean r
 	} // while
 } // setRamp
 
-// addLamp
-//
-// create a new LED (i.e., an anode/cathode pair). This is the main (internal) code; what is externalized
-// as addLamp has additional checks on the input we bypass when using this for initial list setup.
+// setEffect
 //
-// Note that color here is the permanent attribute of the lamp, not a presently-lit color
-void linesideSignal::_addLamp(byte mastOrd, byte headOrd, byte lampOrd, byte anode, byte cathode, byte colorVal)
+// Give a lamp effects to play in place of the ramp (LSS_USE_EFFECTS): *rise* each time the lamp
+// lights (a new aspect, or each flash), and *fall* each time it goes out. Each is a table of
+// keyframes in PROGMEM (see LSS_FX_STEPS), or NULL to leave that to the ramp. Once an effect
+// ends, the ramp decides again. A lamp that is turned off is only lit while the ramp keeps it
+// (three divisions, or none for a lamp without the ramp), so a fall is cut short there, but a
+// flashing lamp's fall can run on into its dark time. NULL for both takes the effects off.
+// Does nothing without LSS_USE_EFFECTS.
+void linesideSignal::setEffect(byte mastOrd, byte headOrd, byte lampOrd, const byte *rise, const byte *fall)
 {
-	// allocate a structure for the LED and initialize it
-		
-	signalLamp *lamp = new signalLamp; // allocate a new lamp instance
+#if defined(LSS_USE_EFFECTS)
+	signalLamp *lamp;
+	signalEffect *fx;
 	
-	lamp->mastNum = mastOrd;
-	lamp->headNum = headOrd;
-	lamp->lampNum = lampOrd;
-	lamp->color = colorVal;		
-	lamp->anode = anode; 
-	lamp->cathode = cathode;
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) break;
+		lamp = lamp->nextLamp;  // advance
+	} // while
+	if (lamp == NULL) return; // no such lamp
 	
-	// set the flags for the lamp to default values
-	lamp->clearBitFlags();  
-	lamp->setBitFlag(LSS_SL_ISLIT, false);
-	lamp->setBitFlag(LSS_SL_ISFLASH, false);
-	lamp->setBitFlag(LSS_SL_ISALTERNATE, false);
-	lamp->setBitFlag(LSS_SL_START, false);
-	lamp->setBitFlag(LSS_SL_STOP, false);
-	lamp->setBitFlag(LSS_SL_RAMP, true);		// normal lights ramp up and down in intensity
-	lamp->setBitFlag(LSS_SL_DELAY, false);
+	fx = _effectList;
+	while ((fx != NULL) && (fx->lamp != lamp)) fx = fx->nextEffect;
 	
-#if defined(LSS_DEBUG_REPORTING)
-	Serial.print(F("addLamp: _lampFlags="));Serial.print(lamp->_lampFlags, BIN);Serial.println(F("."));
+	if (fx == NULL) {
+		if ((rise == NULL) && (fall == NULL)) return; // nothing to take off
+		fx = new signalEffect;
+		fx->lamp = lamp;
+		fx->rampLevel = _rampLevel(lamp);
+		fx->nextEffect = _effectList;
+		_effectList = fx;
+	}
+	fx->rise = rise;
+	fx->fall = fall;
+	fx->frame = NULL; // stop anything playing, the next change of the lamp starts the new ones
+	fx->steps = 0;
+	lamp->effect = LSS_FX_RAMP;
+#if defined(LSS_USE_PATTERN)
+	_patternStale = true;
+#endif
+#else
+	(void)mastOrd; (void)headOrd; (void)lampOrd; (void)rise; (void)fall; // not used without LSS_USE_EFFECTS
 #endif
+} // setEffect
 
-	// put the lamp on the linked list (for now we insert at the front)
-	lamp->nextLamp = _lampList;
-	_lampList = lamp; 
+#if defined(LSS_USE_EFFECTS)
+// stepEffects
+//
+// Play the next step of each lamp's effect, if one is due. At the start of a division, this also
+// sees which lamps the ramp has started to light or put out, and starts their rise or fall.
+// Returns true if the level of any lamp changed.
+boolean linesideSignal::_stepEffects()
+{
+	signalEffect *fx;
+	signalLamp *lamp;
+	boolean step;
+	boolean newDiv;
+	boolean changed;
+	byte level;
+	byte was;
 	
-	if ((anode == LSS_NOT_PIN) || (cathode == LSS_NOT_PIN)) { // if either is invalid, disable the lamp entry (this is used for the end-of-list entry)
-		lamp->anode = LSS_NOT_PIN;
-		lamp->cathode = LSS_NOT_PIN;
-		lamp->color = LSS_DARK;
-	} else {
-		pinMode(cathode, INPUT);	// make sure its off
-		pinMode( anode, OUTPUT);	// ground the pin to dissipate any existing charge
-		digitalWrite( anode, LOW );
-		delay(1);					// give it some time to drain any built-up charge in the circuit so we start fresh
-		pinMode( anode, INPUT);		// ensure pins are in high-resistance state to start 
-		pinMode( cathode, OUTPUT);	// ground the pin to dissipate any existing charge
-		digitalWrite( cathode, LOW );
-		delay(1);					// give it some time to drain any built-up charge in the circuit so we start fresh
-		pinMode( cathode, INPUT);	// ensure pins are in high-resistance state to start 
-	} // valid pins
-
-} // addLamp
+	step = _effectDue;
+	_effectDue = false;
+	newDiv = ((_rampDiv != _effectDiv) && (_rampDiv < LSS_NUM_DIV)); // (not the last pass of the ramp, which goes past the end)
+	if (newDiv) _effectDiv = _rampDiv;
+	changed = false;
+	
+	fx = _effectList;
+	while (fx != NULL) {
+		lamp = fx->lamp;
+		was = lamp->effect;
+		
+		if (step && (fx->frame != NULL) && (--fx->steps == 0)) fx->frame += 2; // on to the next keyframe
+		
+		if (newDiv) {
+			level = _rampLevel(lamp);
+			if ((fx->rampLevel == LSS_FX_OFF) && (level != LSS_FX_OFF) && (fx->rise != NULL)) {
+				fx->frame = fx->rise;
+				fx->steps = 0;
+			} else if ((fx->rampLevel == LSS_FX_FULL) && (level != LSS_FX_FULL) && (fx->fall != NULL)) {
+				fx->frame = fx->fall;
+				fx->steps = 0;
+			}
+			fx->rampLevel = level;
+		}
+		
+		if ((fx->frame != NULL) && (fx->steps == 0)) { // a new keyframe
+			fx->steps = pgm_read_byte(fx->frame + 1);
+			if (fx->steps == 0) {
+				fx->frame = NULL; // the end
+			} else {
+				lamp->effect = pgm_read_byte(fx->frame);
+				if (lamp->effect > LSS_FX_FULL) lamp->effect = LSS_FX_FULL;
+			}
+		}
+		if (fx->frame == NULL) lamp->effect = LSS_FX_RAMP;
+		
+		if (lamp->effect != was) changed = true;
+		fx = fx->nextEffect;
+	} // while
+	
+	return(changed);
+} // stepEffects
 
-// addLamp - this is the external version
+// rampLevel
 //
-void linesideSignal::addLamp(byte mastOrd, byte headOrd, byte lampOrd, byte anode, byte cathode, byte colorVal)
+// The ramp's level for a lamp in the current division: LSS_FX_OFF, LSS_FX_FULL, or LSS_FX_HALF for
+// any level between (only moving away from dark or full matters). Six passes are enough to tell,
+// as each level between is lit on one of them and dark on another.
+byte linesideSignal::_rampLevel(signalLamp *lamp)
 {
+	byte pass;
+	byte lit;
+	
+	lit = 0;
+	for (pass = 0; pass < 6; pass++) {
+		if (_rampEnabled(lamp, pass)) lit++;
+	}
+	
+	if (lit == 0) return(LSS_FX_OFF);
+	if (lit == 6) return(LSS_FX_FULL);
+	return(LSS_FX_HALF);
+} // rampLevel
+#endif
 
-	if (!_setupIsDone) return; // safety net - do nothing without setup
-
-	// sanity-check inputs - do nothing if bad values provided
-	if (anode == cathode) return;
-	if (!_goodPin(anode)) return;
-	if (!_goodPin(cathode)) return;
-	if (colorVal == LSS_DARK) return;	// we don't need to track a permanently dark lamp
-
-	_addLamp(mastOrd, headOrd, lampOrd, anode, cathode, colorVal);
-
-} // addLamp - external
-
-// clearHead
+// setMix
 //
-// Turn off all LEDS on a head (and clear flashing attribute)
-void linesideSignal::clearHead(byte mastOrd, byte headOrd)
+// Set how a mixed yellow's slot is split between its halves (LSS_USE_MIX): the red half is lit
+// for *redPart* and the green half for *greenPart*, so setMix(1, 1, 2, 3, 2) gives the red 3/5 of
+// the time. The halves are the two lamps with this lamp number (LSS_REDYELLOW and LSS_GREENYELLOW,
+// or LSS_REDGREENYELLOW and LSS_GREENREDYELLOW); they start out even. Green LEDs are often the
+// brighter, so a warmer yellow usually wants more red. Does nothing without LSS_USE_MIX.
+void linesideSignal::setMix(byte mastOrd, byte headOrd, byte lampOrd, byte redPart, byte greenPart)
 {
+#if defined(LSS_USE_MIX)
 	signalLamp *lamp;
+	long share;
 	
 	if (!_setupIsDone) return; // safety net - do nothing without setup
+	if ((redPart == 0) && (greenPart == 0)) return;
+
+	share = (256L * long(redPart)) / (long(redPart) + long(greenPart));
+	if (share < 1) share = 1;		// each half keeps a sliver of the slot
+	if (share > 255) share = 255;
 	
 	lamp = _lampList;
 	while (lamp != NULL) {
-		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd)) {
-			if (lamp->isOn() && lamp->isStart() && lamp->onHold()) { // it never actually started, so just clear it
-				_goDark(lamp);
-			} else if (lamp->isOn()) {
-				if (!lamp->isStop()) { // ignore a second attempt to set stop
-					lamp->setBitFlag(LSS_SL_STOP, true); // begin shutdown
-					lamp->setBitFlag(LSS_SL_START, false);
-					lamp->setBitFlag(LSS_SL_DELAY, true); // force a delay until the next cycle
-					// note that this will implicitly clear other attributes when the delay is processed
-				} // isStop
-			}  // isOn	
-		} // if mast and head match
-	
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd) &&
+			(lamp->mixLamp != NULL) && (lamp->mix != 0)) { // the red half holds the share
+			lamp->mix = byte(share);
+			break;
+		}
 		lamp = lamp->nextLamp;  // advance
 	} // while
-} // clearHead
+#else
+	(void)mastOrd; (void)headOrd; (void)lampOrd; (void)redPart; (void)greenPart; // not used without LSS_USE_MIX
+#endif
+} // setMix
 
-// setLamp 
-//
-// Turn a LED on or off and optionally set or clear the "flashing" attribute.
+#if defined(LSS_USE_MIX)
+// pairMix
 //
-// 
-void linesideSignal::setLamp(byte mastOrd, byte headOrd, byte lampOrd, boolean lit, boolean flashing)
+// See if a newly added lamp is one half of a mixed yellow whose other half is already in the list,
+// and if so pair them up, the red half taking an even share of the slot.
+void linesideSignal::_pairMix(signalLamp *lamp)
 {
-	signalLamp *lamp;
+	signalLamp *other;
+	byte otherColor;
 	
-	if (!_setupIsDone) return; // safety net - do nothing without setup
-
-	lamp = _lampList;
-	while (lamp != NULL) {
-		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) {
-			lamp->setBitFlag(LSS_SL_ISFLASH, flashing); // put this here so it will affect lamps already on
-			if (!lamp->isOn()) {
-				lamp->setBitFlag(LSS_SL_STOP, false); // begin lite-up if it wasn't already lit
-				lamp->setBitFlag(LSS_SL_START, true);
-				lamp->setBitFlag(LSS_SL_ISLIT, true);
-				lamp->setBitFlag(LSS_SL_DELAY, true); // force a delay until the next cycle
-			} // isOn
-		} // match
-		
-		lamp = lamp->nextLamp;  // advance
+	lamp->mix = 0;
+	lamp->mixLamp = NULL;
+	
+	switch (lamp->color) {
+		case LSS_GREENYELLOW:		otherColor = LSS_REDYELLOW; break;
+		case LSS_REDYELLOW:			otherColor = LSS_GREENYELLOW; break;
+		case LSS_GREENREDYELLOW:	otherColor = LSS_REDGREENYELLOW; break;
+		case LSS_REDGREENYELLOW:	otherColor = LSS_GREENREDYELLOW; break;
+		default: return; // not a half
+	} // switch
+	
+	other = _lampList;
+	while (other != NULL) {
+		if ((other->mastNum == lamp->mastNum) && (other->headNum == lamp->headNum) && (other->lampNum == lamp->lampNum) &&
+			(other->color == otherColor) && (other->mixLamp == NULL)) {
+			lamp->mixLamp = other;
+			other->mixLamp = lamp;
+			if ((lamp->color == LSS_REDYELLOW) || (lamp->color == LSS_REDGREENYELLOW)) lamp->mix = LSS_MIX_EVEN;
+			else other->mix = LSS_MIX_EVEN;
+			_mixPairs++;
+			break;
+		}
+		other = other->nextLamp;  // advance
 	} // while
-} // setLamp (full definition, five parameters)
+} // pairMix
 
-// overload definition to allow omission of flashing parameter
-void linesideSignal::setLamp(byte mastOrd, byte headOrd, byte lampOrd, boolean lit)
+// mixShown
+//
+// True if the lamp is half of a mixed yellow and both halves are being shown, so they share a slot.
+boolean linesideSignal::_mixShown(signalLamp *lamp)
 {
-	setLamp(mastOrd, headOrd, lampOrd, lit, false);
-} // setLamp (four parameters)
+	return((lamp->mixLamp != NULL) && lamp->isShown() && lamp->mixLamp->isShown());
+} // mixShown
 
-// setHeadColor
+// mixTime
 //
-// Clear all LEDs on a head and then turn on the first of a given color
-// if called with color LSS_DARK it does the first part, then fails to find any lamp to 
-// activate, so it remains dark (this could be optimized with a test, but why bother?).
-void linesideSignal::setHeadColor(byte mastOrd, byte headOrd, byte color, boolean flashing)
+// The part of a mixed yellow's pulse that goes to this half: the red half's share, and whatever
+// is left to the green half.
+long linesideSignal::_mixTime(signalLamp *lamp, long pulseTime)
 {
-	signalLamp *lamp;
+	if (lamp->mix != 0) return((pulseTime * long(lamp->mix)) >> 8);
+	return(pulseTime - ((pulseTime * long(lamp->mixLamp->mix)) >> 8));
+} // mixTime
+#endif
+
+// addApproach
+//
+// Light a mast only while a train approaches. The pin is an occupancy input (e.g., from a block
+// detector), set to INPUT_PULLUP and taken as occupied when pulled LOW. A mast can have more
+// than one input (e.g., one for each direction) and is lit while any of them is occupied, and
+// for LSS_APPROACH_HOLD after. Call after the lamps are added.
+//
+// The mast keeps its aspect while it is dark: the sketch sets the aspect as usual and it is 
+// shown when a train approaches, so only the approached masts take a share of the cycle.
+void linesideSignal::addApproach(byte mastOrd, byte pin)
+{
+	signalApproach *approach;
 	
 	if (!_setupIsDone) return; // safety net - do nothing without setup
+	if (!_goodPin(pin)) return;
 	
-	clearHead(mastOrd, headOrd); // turn off all the LEDs on this head
+	approach = new signalApproach;
+	approach->pin = pin;
+	approach->mastNum = mastOrd;
+	approach->count = 0;
+	approach->occupied = false;
+	approach->active = false;
+	approach->sampleTime = byte(_millis());
+	approach->clearTime = 0;
+#if defined(LSS_DEBUG_REPORTING)
+	approach->detectTime = 0;
+#endif
 	
-	if (color > LSS_LAST_FOR_SETCOLOR) return; // bad color value, ignore it
+	// put it on the list (at the front, as for lamps)
+	approach->nextApproach = _approachList;
+	_approachList = approach;
+	
+	pinMode(pin, INPUT_PULLUP);
+	
+	_showMast(mastOrd, _mastApproached(mastOrd)); // dark until a train is detected
+} // addApproach
 
-	lamp = _lampList;
-	while (lamp != NULL) {
-		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd)) {
-			if ((lamp->color == color) ||
-				((color == LSS_YELLOW) && ((lamp->color == LSS_GREENYELLOW) || (lamp->color == LSS_REDYELLOW)) ) ||
-				((color == LSS_GREEN)  && (lamp->color == LSS_GREENYELLOW) ) ||
-				((color == LSS_RED)    && (lamp->color == LSS_REDYELLOW) ) ||
-				((color == LSS_YELLOW) && ((lamp->color == LSS_GREENREDYELLOW) || (lamp->color == LSS_REDGREENYELLOW)) ) ||
-				((color == LSS_GREEN)  && (lamp->color == LSS_GREENREDYELLOW) ) ||
-				((color == LSS_RED)    && (lamp->color == LSS_REDGREENYELLOW) ) )
-				// do not need to list other colors - covered by first line of if
-			{
-				lamp->setBitFlag(LSS_SL_ISFLASH, flashing); // change the flashing attribute no matter what
-			
+// scanApproach
+//
+// Read the next approach input, if it is due. This is one digitalRead, and is read when the
+// lit LED's slot has LSS_APPROACH_COST to spare (slack) or, failing that, once the input is
+// well overdue.
+//
+// Each read moves a count toward the pin state, and the input changes only when the count
+// reaches either end, so a dirty wheel or a bouncing contact doesn't blink the mast.
+void linesideSignal::_scanApproach(boolean slack)
+{
+	signalApproach *approach;
+	byte now;
+	boolean active;
+	
+	approach = (_nextApproach != NULL) ? _nextApproach : _approachList;
+	_nextApproach = approach->nextApproach;
+	
+	now = byte(_millis());
+	if (byte(now - approach->sampleTime) < (slack ? LSS_APPROACH_SAMPLE : (4 * LSS_APPROACH_SAMPLE))) return; // not due
+	approach->sampleTime = now;
+	
+	if (digitalRead(approach->pin) == LOW) {
+		if (approach->count < LSS_APPROACH_DEBOUNCE) {
+#if defined(LSS_DEBUG_REPORTING)
+			if ((approach->count == 0) && !approach->occupied) approach->detectTime = _now();
+#endif
+			approach->count++;
+		}
+	} else if (approach->count > 0) {
+		approach->count--;
+	}
+	
+	if (approach->count >= LSS_APPROACH_DEBOUNCE) {
+		approach->occupied = true;
+	} else if ((approach->count == 0) && approach->occupied) {
+		approach->occupied = false;
+		approach->clearTime = _millis();
+	}
+	
+	active = approach->occupied || 
+		(approach->active && ((_millis() - approach->clearTime) < LSS_APPROACH_HOLD));
+	if (active == approach->active) return; // no change
+	
+	approach->active = active;
+	_showMast(approach->mastNum, active || _mastApproached(approach->mastNum));
+	
+#if defined(LSS_DEBUG_REPORTING)
+	if (active) { // time from detection until the first lamp is lit (see updateSlot)
+		_approachStamp = approach->detectTime;
+		if (_approachStamp == 0) _approachStamp = 1;
+		_approachMast = approach->mastNum;
+	}
+#endif
+} // scanApproach
+
+// mastApproached
+//
+// Returns true if any approach input for the mast is active.
+boolean linesideSignal::_mastApproached(byte mastOrd)
+{
+	signalApproach *approach;
+	
+	approach = _approachList;
+	while (approach != NULL) {
+		if ((approach->mastNum == mastOrd) && approach->active) return(true);
+		approach = approach->nextApproach;  // advance
+	} // while
+	
+	return(false);
+} // mastApproached
+
+// showMast
+//
+// Show or hide the lamps of an approach-lit mast. Both happen at once, without the ramp: going
+// through the start hold and ramp-up would add up to a second between detection and light.
+// Hidden lamps keep their state, and carry on ramping and flashing unseen.
+void linesideSignal::_showMast(byte mastOrd, boolean show)
+{
+	signalLamp *lamp;
+	
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->getBitFlag(LSS_SL_APPROACH) == show)) { // changing
+			lamp->setBitFlag(LSS_SL_APPROACH, !show);
+			if (!show && (lamp == _currentLED)) {
+				_killSwitch = true; // deactivate if this is the current LED
+			}
+			_litChanged = true;	// re-order the lit lamps on the next pass
+			_timingStale = true;	// and re-time the slots before the next one
+		} // changing
+		lamp = lamp->nextLamp;  // advance
+	} // while
+} // showMast
+
+// addTask
+//
+// Have updateSignals call a function (the task) for you, every interval milliseconds (or 
+// once, after interval milliseconds, with repeat=false). Cost is the longest the task takes, in 
+// microseconds: the task is only run when the lit LED has that much of its slot left (plus a
+// trip around loop), so it never makes a LED late. Returns an id for cancelTask, or 
+// LSS_NO_TASK if the task can't be added.
+//
+// Tasks must be short (well under the slot time of a lit LED, which is the cycle time divided
+// by the number of lit lamps) and must not call updateSignals or delay.
+byte linesideSignal::addTask(void (*task)(), long interval, int cost, boolean repeat)
+{
+	signalTask *entry;
+	
+	if (!_setupIsDone) return(LSS_NO_TASK); // safety net - do nothing without setup
+	if ((task == NULL) || (interval < 0) || (cost < 0)) return(LSS_NO_TASK);
+	if (repeat && (interval == 0)) return(LSS_NO_TASK); // a periodic task needs an interval
+	
+	entry = _taskList;
+	while ((entry != NULL) && (entry->run != NULL)) entry = entry->nextTask; // reuse a finished task if there is one
+	
+	if (entry == NULL) {
+		entry = new signalTask;
+		entry->run = NULL;
+		entry->nextTask = _taskList; // put it on the list (at the front, as for lamps)
+		_taskList = entry;
+	}
+	
+	_lastTaskId++;
+	if (_lastTaskId == LSS_NO_TASK) _lastTaskId++;
+	
+	entry->id = _lastTaskId;
+	entry->repeat = repeat;
+	entry->waited = false;
+	entry->interval = interval;
+	entry->due = _millis() + interval;
+	entry->cost = cost;
+	entry->run = task; // last, as this makes it live
+	
+	return(entry->id);
+} // addTask
+
+// overload definition to allow omission of repeat parameter (periodic)
+byte linesideSignal::addTask(void (*task)(), long interval, int cost)
+{
+	return(addTask(task, interval, cost, true));
+} // addTask
+
+// cancelTask
+//
+// Stop a task (a one-shot task that has already run is ignored).
+void linesideSignal::cancelTask(byte id)
+{
+	signalTask *entry;
+	
+	if (id == LSS_NO_TASK) return;
+	
+	entry = _taskList;
+	while (entry != NULL) {
+		if ((entry->id == id) && (entry->run != NULL)) {
+			entry->run = NULL;
+			return;
+		}
+		entry = entry->nextTask;  // advance
+	} // while
+} // cancelTask
+
+// getTaskOverruns
+//
+// Returns the number of times a task took longer than its declared cost. A task that does 
+// this can make a LED slot late, so its cost should be increased (or the task split up).
+unsigned int linesideSignal::getTaskOverruns()
+{
+	return(_taskOverruns);
+} // getTaskOverruns
+
+// getVerifyErrors
+//
+// Returns the number of problems found by LSS_DEBUG_VERIFY: slots with the wrong LED lit
+// (or the right one not lit), and pin safety-net trips. Always 0 without LSS_DEBUG_VERIFY.
+unsigned int linesideSignal::getVerifyErrors()
+{
+#if defined(LSS_DEBUG_VERIFY)
+	return(_verifyPinErrors + _verifyTrips);
+#else
+	return(0);
+#endif
+} // getVerifyErrors
+
+// runTask
+//
+// Run a task that is due, if the lamp now lit (by sig, the instance with the turn) has 
+// enough of its slot left for the task's cost and a trip around loop. A task that doesn't 
+// fit is tried again on a later slot, and meanwhile a smaller one that does may run.
+// At most one task is run per call.
+void linesideSignal::_runTask(linesideSignal *sig)
+{
+	signalTask *task;
+	signalTask *start;
+	void (*run)();
+	long now;
+	long began;
+	long ran;
+	int cost;
+	
+	now = _millis();
+	start = (_nextTask != NULL) ? _nextTask : _taskList;
+	task = start;
+	do {
+		if ((task->run != NULL) && ((now - task->due) >= 0)) { // due
+			if (sig->_slotSlack(long(task->cost))) {
+				_nextTask = task->nextTask; // next time, start with the one after (so all get a turn)
+				
+				if ((now - task->due) > _maxTaskDelay) _maxTaskDelay = now - task->due;
+				task->waited = false;
+				run = task->run;
+				cost = task->cost;
+				
+				if (task->repeat) {
+					task->due += task->interval;
+					if ((now - task->due) >= 0) task->due = now + task->interval; // fell behind, don't try to catch up
+				} else {
+					task->run = NULL; // done - free it first, so the task itself can add another
+				}
+				
+				began = sig->_now();
+				run();
+				ran = sig->_now() - began;
+				
+				if (ran > long(cost)) _taskOverruns++;
+				if ((sig->_now() - sig->_lightExpirationTime) > 0) _taskLate++; // the next slot starts late
+				return;
+			} else if (!task->waited) { // not enough slack in this slot
+				task->waited = true;
+				_taskWaits++;
+			}
+		} // due
+		
+		task = (task->nextTask != NULL) ? task->nextTask : _taskList;
+	} while (task != start);
+} // runTask
+
+#if defined(LSS_USE_LED_DIAG)
+// diagSample
+//
+// Start a check of the LED of the current lamp, if it is the one being checked and a sample 
+// is due. Called while the LED is lit. With the anode still high, the cathode is let go and
+// read: through a good LED it floats up to the supply less the LED's forward voltage (1.5 -
+// 3 V), through an open one it is pulled to ground (by the pull-down, see LSS_USE_LED_DIAG), 
+// and through a shorted one it goes right up to the supply.
+//
+// The pin is changed directly rather than with cathodeDisable, as the LED is still the one
+// lit as far as the rest of the library is concerned. On an AVR the ADC conversion is started
+// here and read by diagFinish on the next call, so loop() doesn't wait for it; elsewhere it is
+// read with analogRead. The LED is dark until then (about 110 usec), and this is only done if
+// that much of the slot remains. As a lamp is only sampled every LSS_DIAG_INTERVAL, the loss
+// of light is not visible.
+void linesideSignal::_diagSample()
+{
+#if defined(ADCSRA) && defined(ADSC)
+	byte channel;
+#endif
+	
+	if (_suppressLEDs) return; // debug code - the LEDs aren't really lit
+	if (_diagPin != LSS_NOT_PIN) return; // one at a time
+	if ((_millis() - _diagTime) < LSS_DIAG_INTERVAL) return; // not due
+	
+	if ((_diagLamp == NULL) || !_diagLamp->isShown()) { // nothing to check, or it went dark
+		_diagTime = _millis();
+		_diagNext();
+		return;
+	}
+	
+	if (_currentLED != _diagLamp) return; // wait for its slot
+	if ((_lightExpirationTime - _now()) < (LSS_DIAG_TIME + long(_getAverageLoop()))) return; // not enough of the slot left, wait for the next one
+	
+	_diagTime = _millis();
+	_diagPin = _currentLED->cathode;
+	_diagStamp = _now();
+	pinMode(_diagPin, INPUT); // let the cathode float
+	
+#if defined(ADCSRA) && defined(ADSC)
+	channel = _diagPin - A0;
+#if defined(MUX5)
+	ADCSRB = (ADCSRB & ~(1 << MUX5)) | (((channel >> 3) & 1) << MUX5); // channels 8 - 15 on a Mega
+#endif
+	ADMUX = (DEFAULT << 6) | (channel & 7); // the default (supply) reference, as analogRead uses
+	ADCSRA |= (1 << ADSC); // start the conversion, diagFinish reads it
+#else
+	_diagReading = analogRead(_diagPin);
+#endif
+} // diagSample
+
+// diagFinish
+//
+// Take the reading started by diagSample, ground the cathode again (so the LED is lit for the
+// rest of its slot), and lengthen the slot by the time it was dark. Once LSS_DIAG_SAMPLES 
+// readings of the lamp have been taken, its fault is set or cleared. Called at the start of
+// the next call while a reading is in progress; it waits for a later call if the conversion
+// isn't done yet.
+void linesideSignal::_diagFinish()
+{
+	int reading;
+	
+#if defined(ADCSRA) && defined(ADSC)
+	byte low;
+	
+	if (ADCSRA & (1 << ADSC)) return; // still converting
+	low = ADCL; // ADCL must be read first, it holds ADCH until that is read
+	reading = (int(ADCH) << 8) | low;
+#else
+	reading = _diagReading;
+#endif
+	
+	if (_cathodeOn && (_currentLED == _diagLamp)) { // still its slot (a drain turns it off)
+		pinMode(_diagPin, OUTPUT); // the cathode back to ground, the LED lights again
+		digitalWrite(_diagPin, LOW);
+		_lightExpirationTime += _now() - _diagStamp; // make up the time it was dark
+	}
+	_diagPin = LSS_NOT_PIN;
+	
+	if (reading < LSS_DIAG_OPEN_LEVEL) {
+		_diagOpen++;
+	} else if (reading > LSS_DIAG_SHORT_LEVEL) {
+		_diagShort++;
+	}
+	
+	if (++_diagCount < LSS_DIAG_SAMPLES) return; // keep sampling this lamp
+	
+	if (_diagOpen == _diagCount) {
+		_diagLamp->setBitFlag(LSS_SL_OPEN, true);
+		_diagLamp->setBitFlag(LSS_SL_SHORT, false);
+	} else if (_diagShort == _diagCount) {
+		_diagLamp->setBitFlag(LSS_SL_OPEN, false);
+		_diagLamp->setBitFlag(LSS_SL_SHORT, true);
+	} else if ((_diagOpen == 0) && (_diagShort == 0)) {
+		_diagLamp->setBitFlag(LSS_SL_OPEN, false);
+		_diagLamp->setBitFlag(LSS_SL_SHORT, false);
+	} // otherwise the samples disagree (e.g., a loose wire), so leave it as it was
+	
+	_diagNext();
+} // diagFinish
+
+// diagNext
+//
+// Move on to the next lit lamp that can be checked (wrapping to the start of the list), or 
+// NULL if there are none.
+void linesideSignal::_diagNext()
+{
+	signalLamp *lamp;
+	signalLamp *start;
+	
+	_diagCount = 0;
+	_diagOpen = 0;
+	_diagShort = 0;
+	
+	start = ((_diagLamp != NULL) && (_diagLamp->nextLamp != NULL)) ? _diagLamp->nextLamp : _lampList;
+	lamp = start;
+	do {
+		if (lamp == NULL) break; // no lamps at all
+		if (lamp->isShown() && _analogPin(lamp->cathode)) {
+			_diagLamp = lamp;
+			return;
+		}
+		lamp = (lamp->nextLamp != NULL) ? lamp->nextLamp : _lampList;
+	} while (lamp != start);
+	
+	_diagLamp = NULL;
+} // diagNext
+
+// analogPin
+//
+// Returns true if the pin can be read with analogRead.
+boolean linesideSignal::_analogPin(byte pin)
+{
+#if defined(NUM_ANALOG_INPUTS)
+	return((pin >= A0) && (pin < (A0 + NUM_ANALOG_INPUTS)));
+#else
+	return(false);
+#endif
+} // analogPin
+#endif
+
+// addLamp
+//
+// create a new LED (i.e., an anode/cathode pair). This is the main (internal) code; what is externalized
+// as addLamp has additional checks on the input we bypass when using this for initial list setup.
+//
+// Note that color here is the permanent attribute of the lamp, not a presently-lit color
+void linesideSignal::_addLamp(byte mastOrd, byte headOrd, byte lampOrd, byte anode, byte cathode, byte colorVal)
+{
+	// allocate a structure for the LED and initialize it
+		
+	signalLamp *lamp;
+	signalApproach *approach;
+	
+#if defined(LSS_USE_BITPLANES)
+	if ((anode == LSS_NOT_PIN) || (cathode == LSS_NOT_PIN)) {
+		lamp = &signalLamp::_lampPool[LSS_MAX_LAMPS]; // the end-of-list lamp, the same for every instance
+	} else if (signalLamp::_lampTotal >= LSS_MAX_LAMPS) { // the pool is full
+#if defined(LSS_DEBUG_REPORTING)
+		Serial.print(F("addLamp: no room for M"));Serial.print(mastOrd);Serial.print(F(", H"));Serial.print(headOrd);
+		Serial.print(F(", L"));Serial.print(lampOrd);Serial.print(F(", LSS_MAX_LAMPS="));Serial.print(LSS_MAX_LAMPS);Serial.println(F("."));
+#endif
+		return;
+	} else {
+		lamp = &signalLamp::_lampPool[signalLamp::_lampTotal++]; // the next lamp in the pool
+		_ownLamps[lamp->index() >> 3] |= (1 << (lamp->index() & 7));
+	}
+#else
+	lamp = new signalLamp; // allocate a new lamp instance
+#endif
+	
+	lamp->mastNum = mastOrd;
+	lamp->headNum = headOrd;
+	lamp->lampNum = lampOrd;
+	lamp->color = colorVal;		
+	lamp->anode = anode; 
+	lamp->cathode = cathode;
+#if defined(LSS_USE_EFFECTS)
+	lamp->effect = LSS_FX_RAMP;	// no effect playing
+#endif
+#if defined(LSS_USE_MIX)
+	_pairMix(lamp);		// before it goes on the list, so it doesn't find itself
+#endif
+	
+	// set the flags for the lamp to default values
+	lamp->clearBitFlags();  
+	lamp->setBitFlag(LSS_SL_ISLIT, false);
+	lamp->setBitFlag(LSS_SL_ISFLASH, false);
+	lamp->setBitFlag(LSS_SL_ISALTERNATE, false);
+	lamp->setBitFlag(LSS_SL_START, false);
+	lamp->setBitFlag(LSS_SL_STOP, false);
+	lamp->setBitFlag(LSS_SL_RAMP, true);		// normal lights ramp up and down in intensity
+	lamp->setBitFlag(LSS_SL_DELAY, false);
+	lamp->setBitFlag(LSS_SL_APPROACH, false);
+	
+	approach = _approachList;
+	while (approach != NULL) { // a lamp added to an approach-lit mast starts out the same as the rest of the mast
+		if (approach->mastNum == mastOrd) {
+			lamp->setBitFlag(LSS_SL_APPROACH, !_mastApproached(mastOrd));
+			break;
+		}
+		approach = approach->nextApproach;  // advance
+	} // while
+	
+#if defined(LSS_DEBUG_REPORTING)
+#if defined(LSS_USE_BITPLANES)
+	Serial.print(F("addLamp: plane bit="));Serial.print(lamp->index());Serial.println(F("."));
+#else
+	Serial.print(F("addLamp: _lampFlags="));Serial.print(lamp->_lampFlags, BIN);Serial.println(F("."));
+#endif
+#endif
+
+	// put the lamp on the linked list (for now we insert at the front)
+	lamp->nextLamp = _lampList;
+	_lampList = lamp; 
+	
+	if ((anode == LSS_NOT_PIN) || (cathode == LSS_NOT_PIN)) { // if either is invalid, disable the lamp entry (this is used for the end-of-list entry)
+		lamp->anode = LSS_NOT_PIN;
+		lamp->cathode = LSS_NOT_PIN;
+		lamp->color = LSS_DARK;
+	} else {
+		pinMode(cathode, INPUT);	// make sure its off
+		pinMode(anode, INPUT);		// ensure pins are in high-resistance state to start 
+		
+		// the pins are grounded later, all at once (see drainPins), so a pin shared by many lamps is only done once
+		_pinsToDrain[anode >> 3] |= (1 << (anode & 7));
+		_pinsToDrain[cathode >> 3] |= (1 << (cathode & 7));
+		_drainPending = true;
+	} // valid pins
+
+} // addLamp
+
+// addLamp - this is the external version
+//
+void linesideSignal::addLamp(byte mastOrd, byte headOrd, byte lampOrd, byte anode, byte cathode, byte colorVal)
+{
+
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+
+	// sanity-check inputs - do nothing if bad values provided
+	if (anode == cathode) return;
+	if (!_goodPin(anode)) return;
+	if (!_goodPin(cathode)) return;
+	if (colorVal == LSS_DARK) return;	// we don't need to track a permanently dark lamp
+
+	_addLamp(mastOrd, headOrd, lampOrd, anode, cathode, colorVal);
+
+} // addLamp - external
+
+// addLamps
+//
+// Add a number of lamps from a layout stored in PROGMEM (flash), instead of calling addLamp
+// for each one. Each lamp is LSS_LAYOUT_RECORD bytes: mast, head, lamp, anode, cathode and
+// color, as for addLamp. Adding LSS_LAYOUT_NORAMP to the anode turns off the ramp for that 
+// lamp, as for setRamp (anodes are always less than 128).
+void linesideSignal::addLamps(const byte *layout, int count)
+{
+	byte rec[LSS_LAYOUT_RECORD];
+	int n;
+	byte i;
+	
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+	
+	for (n = 0; n < count; n++) {
+		for (i = 0; i < LSS_LAYOUT_RECORD; i++) rec[i] = pgm_read_byte(layout + (n * LSS_LAYOUT_RECORD) + i);
+		
+		addLamp(rec[0], rec[1], rec[2], rec[3] & ~LSS_LAYOUT_NORAMP, rec[4], rec[5]);
+		if (rec[3] & LSS_LAYOUT_NORAMP) setRamp(rec[0], rec[1], rec[2], false);
+	} // for
+} // addLamps
+
+// clearHead
+//
+// Turn off all LEDS on a head (and clear flashing attribute)
+void linesideSignal::clearHead(byte mastOrd, byte headOrd)
+{
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+	
+#if defined(LSS_USE_RECORD)
+	_record(LSS_CMD_CLEAR, 2, mastOrd, headOrd);
+#endif
+	_clearHead(mastOrd, headOrd);
+} // clearHead
+
+// the body of clearHead, also used by setHeadColor (which records only itself)
+void linesideSignal::_clearHead(byte mastOrd, byte headOrd)
+{
+	signalLamp *lamp;
+	
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd)) {
+			if (lamp->isOn() && lamp->isStart() && lamp->onHold()) { // it never actually started, so just clear it
+				_goDark(lamp);
+			} else if (lamp->isOn()) {
+				if (!lamp->isStop()) { // ignore a second attempt to set stop
+					lamp->setBitFlag(LSS_SL_STOP, true); // begin shutdown
+					lamp->setBitFlag(LSS_SL_START, false);
+					lamp->setBitFlag(LSS_SL_DELAY, true); // force a delay until the next cycle
+					// note that this will implicitly clear other attributes when the delay is processed
+				} // isStop
+			}  // isOn	
+		} // if mast and head match
+	
+		lamp = lamp->nextLamp;  // advance
+	} // while
+} // clearHead
+
+// setLamp 
+//
+// Turn a LED on or off and optionally set or clear the "flashing" attribute.
+//
+// 
+void linesideSignal::setLamp(byte mastOrd, byte headOrd, byte lampOrd, boolean lit, boolean flashing)
+{
+	signalLamp *lamp;
+	
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+
+#if defined(LSS_USE_RECORD)
+	_record(LSS_CMD_LAMP, 5, mastOrd, headOrd, lampOrd, true, flashing); // lit or not, setLamp lights the lamp
+#endif
+
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) {
+			lamp->setBitFlag(LSS_SL_ISFLASH, flashing); // put this here so it will affect lamps already on
+			if (!lamp->isOn()) {
+				lamp->setBitFlag(LSS_SL_STOP, false); // begin lite-up if it wasn't already lit
+				lamp->setBitFlag(LSS_SL_START, true);
+				lamp->setBitFlag(LSS_SL_ISLIT, true);
+				lamp->setBitFlag(LSS_SL_DELAY, true); // force a delay until the next cycle
+				_litChanged = true;
+				_timingStale = true;	// re-time the slots before the next one
+			} // isOn
+		} // match
+		
+		lamp = lamp->nextLamp;  // advance
+	} // while
+} // setLamp (full definition, five parameters)
+
+// overload definition to allow omission of flashing parameter
+void linesideSignal::setLamp(byte mastOrd, byte headOrd, byte lampOrd, boolean lit)
+{
+	setLamp(mastOrd, headOrd, lampOrd, lit, false);
+} // setLamp (four parameters)
+
+// setHeadColor
+//
+// Clear all LEDs on a head and then turn on the first of a given color
+// if called with color LSS_DARK it does the first part, then fails to find any lamp to 
+// activate, so it remains dark (this could be optimized with a test, but why bother?).
+void linesideSignal::setHeadColor(byte mastOrd, byte headOrd, byte color, boolean flashing)
+{
+	signalLamp *lamp;
+	
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+
+#if defined(LSS_USE_RECORD)
+	_record(LSS_CMD_HEAD, 4, mastOrd, headOrd, color, flashing);
+#endif
+	
+	_clearHead(mastOrd, headOrd); // turn off all the LEDs on this head
+	
+	if (color > LSS_LAST_FOR_SETCOLOR) return; // bad color value, ignore it
+
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd)) {
+			if ((lamp->color == color) ||
+				((color == LSS_YELLOW) && ((lamp->color == LSS_GREENYELLOW) || (lamp->color == LSS_REDYELLOW)) ) ||
+				((color == LSS_GREEN)  && (lamp->color == LSS_GREENYELLOW) ) ||
+				((color == LSS_RED)    && (lamp->color == LSS_REDYELLOW) ) ||
+				((color == LSS_YELLOW) && ((lamp->color == LSS_GREENREDYELLOW) || (lamp->color == LSS_REDGREENYELLOW)) ) ||
+				((color == LSS_GREEN)  && (lamp->color == LSS_GREENREDYELLOW) ) ||
+				((color == LSS_RED)    && (lamp->color == LSS_REDGREENYELLOW) ) )
+				// do not need to list other colors - covered by first line of if
+			{
+				lamp->setBitFlag(LSS_SL_ISFLASH, flashing); // change the flashing attribute no matter what
+			
 				// check for a color change on a lit multi-color lamp
 				if (lamp->isStop() && ((lamp->color == LSS_GREENYELLOW) || (lamp->color == LSS_REDYELLOW) || 
 					(lamp->color == LSS_GREENREDYELLOW) || (lamp->color == LSS_REDGREENYELLOW) )) {
@@ -717,6 +1722,8 @@ void linesideSignal::setHeadColor(byte mastOrd, byte headOrd, byte color, boolea
 					lamp->setBitFlag(LSS_SL_ISLIT, true);
 					lamp->setBitFlag(LSS_SL_START, true);
 					lamp->setBitFlag(LSS_SL_DELAY, true); // force a delay until the next cycle
+					_litChanged = true;
+					_timingStale = true;	// re-time the slots before the next one
 				} else if ((lamp->isOn()) && (color == lamp->color)) { // change to same color gets down/up sequence
 					lamp->setBitFlag(LSS_SL_START, true);
 				}
@@ -737,105 +1744,1036 @@ void linesideSignal::setHeadColor(byte mastOrd, byte headOrd, byte color, boolea
 	} // while
 } // setHeadColor (4 params)
 
-// overload function for setHeadColor with one less parameter
-void linesideSignal::setHeadColor(byte mastOrd, byte headOrd, byte color)
+// overload function for setHeadColor with one less parameter
+void linesideSignal::setHeadColor(byte mastOrd, byte headOrd, byte color)
+{
+	setHeadColor(mastOrd, headOrd, color, false);
+} // setHeadColor (3 params)
+
+// setLampColor
+//
+// Set a lamp to one color (if it supports more than one). Can also be used to turn on a
+// single-color lamp if the right color is specified.
+void linesideSignal::setLampColor(byte mastOrd, byte headOrd, byte lampOrd, byte color, boolean flashing)
+{
+	signalLamp *lamp;
+	
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+	
+	if (color > LSS_LAST_FOR_SETCOLOR) return; // bad color value, ignore it
+
+#if defined(LSS_USE_RECORD)
+	_record(LSS_CMD_LAMPCOLOR, 5, mastOrd, headOrd, lampOrd, color, flashing);
+#endif
+
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) {
+			if ((lamp->color == color) ||
+				((color == LSS_YELLOW) && ((lamp->color == LSS_GREENYELLOW) || (lamp->color == LSS_REDYELLOW))) ||
+				((color == LSS_GREEN)  && (lamp->color == LSS_GREENYELLOW) ) ||
+				((color == LSS_RED)    && (lamp->color == LSS_REDYELLOW) ) ||
+				((color == LSS_YELLOW) && ((lamp->color == LSS_GREENREDYELLOW) || (lamp->color == LSS_REDGREENYELLOW))) ||
+				((color == LSS_GREEN)  && (lamp->color == LSS_GREENREDYELLOW) ) ||
+				((color == LSS_RED)    && (lamp->color == LSS_REDGREENYELLOW)) )
+			{
+				lamp->setBitFlag(LSS_SL_ISFLASH, flashing);
+				
+				// check for a color change on a lit multi-color lamp
+				if (lamp->isStop() && ( (lamp->color == LSS_GREENYELLOW) || (lamp->color == LSS_REDYELLOW) || 
+					(lamp->color == LSS_GREENREDYELLOW) || (lamp->color == LSS_REDGREENYELLOW) )) {
+					
+					lamp->setBitFlag(LSS_SL_START, true);	// ensure it restarts
+				} else if (!lamp->isOn()) {
+					lamp->setBitFlag(LSS_SL_STOP, false); // begin lite-up sequence
+					lamp->setBitFlag(LSS_SL_START, true);
+					lamp->setBitFlag(LSS_SL_ISLIT, true);
+					lamp->setBitFlag(LSS_SL_DELAY, true); // force a delay until the next cycle
+					_litChanged = true;
+					_timingStale = true;	// re-time the slots before the next one
+				} else if ((lamp->isOn()) && (color == lamp->color)) { // change to same color gets down/up sequence
+					lamp->setBitFlag(LSS_SL_STOP, true);
+					lamp->setBitFlag(LSS_SL_START, true);
+				}
+
+			} // same color
+			else if (lamp->isOn()) // same lamp ordinal, so turn if off unless it's already stopping (this also handles use of LSS_DARK to turn off all lamps on the head)
+			{
+				if (lamp->isStart() || !lamp->usesRamp()) { // if it's starting up or we dont need to ramp - kill it
+					_goDark(lamp);
+				} else if (!lamp->isStop()) { // set delayed off unless its already shutting down
+					lamp->setBitFlag(LSS_SL_STOP, true);
+					lamp->setBitFlag(LSS_SL_START, false);
+					lamp->setBitFlag(LSS_SL_DELAY, true); 		
+				} // if not stopping
+			} // if on and not color match
+		} // same mast, head and lamp
+		lamp = lamp->nextLamp;  // advance
+	} // while
+} // setLampColor (5 params)
+
+// overload function for setLampColor with one less parameter
+void linesideSignal::setLampColor(byte mastOrd, byte headOrd, byte lampOrd, byte color)
+{
+	setLampColor(mastOrd, headOrd, lampOrd, color, false);
+} // setLampColor (4 params)
+
+// setAlternate
+//
+// Designate this lamp as one that flashes on the other cycle from normal.  Used mainly
+// for setting up warning lights such as crossing signals.
+// For activating a two-light alternating flasher, call setAlternate for each light, specifying 
+// alternate as true or false to create pairs of alternating lights. To turn the lights off,
+// call clearHead (assuming all lights share a head).
+void linesideSignal::setAlternate(byte mastOrd, byte headOrd, byte lampOrd, boolean alternate)
+{
+	signalLamp *lamp;
+	
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+
+#if defined(LSS_USE_RECORD)
+	_record(LSS_CMD_ALTERNATE, 4, mastOrd, headOrd, lampOrd, alternate);
+#endif
+
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) 
+		{
+			lamp->setBitFlag(LSS_SL_ISLIT, true);
+			lamp->setBitFlag(LSS_SL_ISFLASH, true); 
+			lamp->setBitFlag(LSS_SL_ISALTERNATE, alternate);
+			lamp->setBitFlag(LSS_SL_STOP, false); // 
+			lamp->setBitFlag(LSS_SL_START, true);
+			lamp->setBitFlag(LSS_SL_DELAY, true); // force a delay until the next cycle
+			_litChanged = true;
+			_timingStale = true;	// re-time the slots before the next one
+		}
+		lamp = lamp->nextLamp;  // advance
+	} // while
+} // setAlternate
+
+// applyCommand
+//
+// Carry out one of the LSS_CMD_ operations, with its arguments packed into bytes. This lets
+// a sketch drive signals from a message (serial, network, etc) without decoding each one 
+// itself. Returns false if the operation is unknown or has the wrong number of arguments.
+boolean linesideSignal::applyCommand(byte op, const byte *args, byte count)
+{
+	if (!_setupIsDone) return(false); // safety net - do nothing without setup
+	
+	switch (op) {
+		case LSS_CMD_LAMP:
+			if (count != 5) return(false);
+			if (args[3]) {
+				setLamp(args[0], args[1], args[2], true, (args[4] != 0));
+			} else {
+				setLampColor(args[0], args[1], args[2], LSS_DARK); // setLamp can't turn a lamp off
+			}
+			break;
+		case LSS_CMD_HEAD:
+			if (count != 4) return(false);
+			setHeadColor(args[0], args[1], args[2], (args[3] != 0));
+			break;
+		case LSS_CMD_LAMPCOLOR:
+			if (count != 5) return(false);
+			setLampColor(args[0], args[1], args[2], args[3], (args[4] != 0));
+			break;
+		case LSS_CMD_CLEAR:
+			if (count != 2) return(false);
+			clearHead(args[0], args[1]);
+			break;
+		case LSS_CMD_ALTERNATE:
+			if (count != 4) return(false);
+			setAlternate(args[0], args[1], args[2], (args[3] != 0));
+			break;
+		case LSS_CMD_RAMP:
+			if (count != 4) return(false);
+			setRamp(args[0], args[1], args[2], (args[3] != 0));
+			break;
+		case LSS_CMD_RATE:
+			if (count != 2) return(false);
+			setFlashRate((int(args[0]) << 8) | args[1]);
+			break;
+		case LSS_CMD_CYCLE:
+			if (count != 2) return(false);
+			setCycleTime((int(args[0]) << 8) | args[1]);
+			break;
+		default:
+			return(false);
+	} // switch
+	
+	return(true);
+} // applyCommand
+
+// queueCommand
+//
+// Queue one of the LSS_CMD_ operations (as for applyCommand) for updateSignals to carry out
+// when a LED's slot has time to spare (LSS_USE_QUEUE). Unlike the lamp functions, this can be called from an
+// interrupt, or from the other core of a dual-core board, while updateSignals runs: the queue
+// has one writer and one reader, and each only moves its own end. Only one interrupt (or core)
+// may queue commands for an instance. Returns false if the command has too many arguments or
+// the queue is full (or without LSS_USE_QUEUE); the command is then dropped.
+boolean linesideSignal::queueCommand(byte op, const byte *args, byte count)
+{
+#if defined(LSS_USE_QUEUE)
+	signalQueueEntry *entry;
+	byte head;
+	byte i;
+	
+	if (count > LSS_CMD_MAX_ARGS) return(false);
+	
+	head = _queueHead;
+	if (byte(head - _queueTail) >= LSS_QUEUE_ENTRIES) return(false); // full
+	
+	entry = &_queue[head & (LSS_QUEUE_ENTRIES - 1)];
+	entry->op = op;
+	entry->count = count;
+	for (i = 0; i < count; i++) entry->args[i] = args[i];
+#if defined(LSS_DEBUG_REPORTING)
+	entry->stamp = long(micros()); // not the library's clock, which may not be safe to read from here
+#endif
+	
+	LSS_BARRIER(); // the entry is written before it is handed over
+	_queueHead = head + 1;
+	return(true);
+#else
+	(void)op; (void)args; (void)count; // not used without LSS_USE_QUEUE
+	return(false);
+#endif
+} // queueCommand
+
+#if defined(LSS_USE_QUEUE)
+// drainQueue
+//
+// Carry out up to LSS_QUEUE_PER_CALL queued commands (see queueCommand), each only if the slot
+// of the LED *sig* has lit still has LSS_COMMAND_COST left: the rest wait for a later call.
+void linesideSignal::_drainQueue(linesideSignal *sig)
+{
+	signalQueueEntry *entry;
+	byte tail;
+	byte n;
+	
+	tail = _queueTail;
+	for (n = 0; (n < LSS_QUEUE_PER_CALL) && (tail != _queueHead) && sig->_slotSlack(LSS_COMMAND_COST); n++) {
+		LSS_BARRIER(); // the entry is read after seeing it handed over
+		entry = &_queue[tail & (LSS_QUEUE_ENTRIES - 1)];
+		applyCommand(entry->op, entry->args, entry->count);
+#if defined(LSS_DEBUG_REPORTING)
+		_queueLatency = long(micros()) - entry->stamp;
+		if (_queueLatency > _maxQueueLatency) _maxQueueLatency = _queueLatency;
+#endif
+		tail++;
+		LSS_BARRIER(); // and finished with before it is handed back
+		_queueTail = tail;
+#if defined(LSS_USE_SNAPSHOT)
+		_snapshotDue = true;
+#endif
+	} // for
+} // drainQueue
+#endif
+
+// getHeadColor
+//
+// Returns the color of the first lit lamp on a head (one that is turning off doesn't count), 
+// or LSS_DARK if none. Multi-color LEDs report the color given to addLamp.
+byte linesideSignal::getHeadColor(byte mastOrd, byte headOrd)
+{
+	signalLamp *lamp;
+	
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && lamp->isOn() && !lamp->isStop()) {
+			return(lamp->color);
+		}
+		lamp = lamp->nextLamp;  // advance
+	} // while
+	
+	return(LSS_DARK);
+} // getHeadColor
+
+// isLampLit
+//
+// Returns true if the lamp is lit (including while flashing or ramping up), but not 
+// once it has been told to turn off.
+boolean linesideSignal::isLampLit(byte mastOrd, byte headOrd, byte lampOrd)
+{
+	signalLamp *lamp;
+	
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) {
+			return(lamp->isOn() && !lamp->isStop());
+		}
+		lamp = lamp->nextLamp;  // advance
+	} // while
+	
+	return(false);
+} // isLampLit
+
+// isLampFlashing
+//
+// Returns true if the lamp is lit and flashing.
+boolean linesideSignal::isLampFlashing(byte mastOrd, byte headOrd, byte lampOrd)
+{
+	signalLamp *lamp;
+	
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) {
+			return(lamp->isOn() && !lamp->isStop() && lamp->isFlash());
+		}
+		lamp = lamp->nextLamp;  // advance
+	} // while
+	
+	return(false);
+} // isLampFlashing
+
+// getLampFault
+//
+// Returns LSS_FAULT_OPEN or LSS_FAULT_SHORT if the lamp's LED was found to be faulty when it
+// was last checked, otherwise LSS_FAULT_NONE. Lamps are only checked while lit, and only if 
+// LSS_USE_LED_DIAG is defined and the lamp's cathode is an analog pin. For a lamp with more
+// than one LED (e.g., a red/green pair), a fault in either is returned.
+byte linesideSignal::getLampFault(byte mastOrd, byte headOrd, byte lampOrd)
+{
+#if defined(LSS_USE_LED_DIAG)
+	signalLamp *lamp;
+	
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) {
+			if (lamp->getBitFlag(LSS_SL_OPEN)) return(LSS_FAULT_OPEN);
+			if (lamp->getBitFlag(LSS_SL_SHORT)) return(LSS_FAULT_SHORT);
+		}
+		lamp = lamp->nextLamp;  // advance
+	} // while
+#else
+	(void)mastOrd; (void)headOrd; (void)lampOrd; // not used without LSS_USE_LED_DIAG
+#endif
+	
+	return(LSS_FAULT_NONE);
+} // getLampFault
+
+// getState
+//
+// Save the lit lamps to a buffer, LSS_STATE_RECORD bytes for each: mast, head, lamp and
+// flags (LSS_STATE_FLASH, LSS_STATE_ALT). Lamps turning off are left out. Returns the 
+// number of bytes used; lamps that don't fit are left out.
+int linesideSignal::getState(byte *buf, int size)
+{
+	signalLamp *lamp;
+	int len = 0;
+	
+	lamp = _lampList;
+	while (lamp != NULL) {
+		if (lamp->isOn() && !lamp->isStop() && (lamp->color != LSS_DARK)) {
+			if ((len + LSS_STATE_RECORD) > size) break; // no more room
+			buf[len++] = lamp->mastNum;
+			buf[len++] = lamp->headNum;
+			buf[len++] = lamp->lampNum;
+			buf[len++] = (lamp->isFlash() ? LSS_STATE_FLASH : 0) | (lamp->isReversed() ? LSS_STATE_ALT : 0);
+		}
+		lamp = lamp->nextLamp;  // advance
+	} // while
+	
+	return(len);
+} // getState
+
+// readState
+//
+// As getState, but from the copy kept for other cores (LSS_USE_SNAPSHOT), so this can be called
+// from an interrupt or the other core of a dual-core board while updateSignals runs. The copy is
+// at most a ramp division old, and holds up to LSS_SNAPSHOT_BYTES. updateSignals never waits for
+// this: if it makes a new copy while this is reading, this reads again. Without LSS_USE_SNAPSHOT
+// it is getState, and must only be called from where updateSignals is.
+int linesideSignal::readState(byte *buf, int size)
+{
+#if defined(LSS_USE_SNAPSHOT)
+	byte seq;
+	byte front;
+	int len;
+	int n;
+	
+	do {
+		seq = _snapshotSeq;
+		LSS_BARRIER(); // the copy is read after seeing which one to read
+		front = seq & 1;
+		len = _snapshotLen[front];
+		if (len > size) len = size - (size % LSS_STATE_RECORD); // whole lamps only
+		for (n = 0; n < len; n++) buf[n] = _snapshot[front][n];
+		LSS_BARRIER(); // and before seeing if another was made meanwhile
+	} while (seq != _snapshotSeq); // if so, ours may have been the one written over
+	
+	return(len);
+#else
+	return(getState(buf, size));
+#endif
+} // readState
+
+#if defined(LSS_USE_SNAPSHOT)
+// publishState
+//
+// Make a new copy of the lit lamps for readState, in the copy not being read, then hand it over.
+void linesideSignal::_publishState()
+{
+	byte back;
+	
+	back = (_snapshotSeq + 1) & 1;
+	_snapshotLen[back] = byte(getState(_snapshot[back], LSS_SNAPSHOT_BYTES));
+	LSS_BARRIER(); // the copy is made before it is handed over
+	_snapshotSeq++;
+	_snapshotDue = false;
+} // publishState
+#endif
+
+// startRecord
+//
+// Record the calls made to change the lamps (LSS_USE_RECORD) into *buf*, which has room for
+// *size* bytes, until stopRecord: setHeadColor, setLamp, setLampColor, clearHead, setAlternate,
+// setRamp, setFlashRate and setCycleTime, each with the time since the one before, as
+// LSS_CMD_ operations (see LSS_RECORD_HEADER). A call that doesn't fit ends the recording.
+// Calls made by queued commands and setState are recorded too; only the calls replay makes are
+// left out. Does nothing without LSS_USE_RECORD.
+void linesideSignal::startRecord(byte *buf, int size)
+{
+#if defined(LSS_USE_RECORD)
+	_recordBuf = buf;
+	_recordSize = size;
+	_recordLen = 0;
+	_recordStamp = _millis(); // the first call is timed from now
+#else
+	(void)buf; (void)size; // not used without LSS_USE_RECORD
+#endif
+} // startRecord
+
+// stopRecord
+//
+// Stop recording, and return the number of bytes recorded (0 without LSS_USE_RECORD). The
+// recording can be saved, or sent off to be replayed elsewhere, as it is.
+int linesideSignal::stopRecord()
+{
+#if defined(LSS_USE_RECORD)
+	_recordBuf = NULL;
+	return(_recordLen);
+#else
+	return(0);
+#endif
+} // stopRecord
+
+// replay
+//
+// Carry out the calls recorded by startRecord again (LSS_USE_RECORD), with the same timing, the
+// first one after the same time from now as it was from the start of the recording. They are
+// carried out by updateSignals, one to a call and only once the LED's slot has LSS_COMMAND_COST
+// left (as queued commands are), and aren't recorded again. *log* must stay as it is until
+// isReplaying returns false; replay again to start over, or with a length of 0 to stop. Does
+// nothing without LSS_USE_RECORD.
+void linesideSignal::replay(const byte *log, int len)
+{
+#if defined(LSS_USE_RECORD)
+	_replayLog = NULL;
+	if ((log == NULL) || (len < LSS_RECORD_HEADER)) return; // nothing to replay
+	
+	_replayLen = len;
+	_replayPos = 0;
+	_replayDue = _millis() + ((long(log[0]) << 8) | log[1]);
+	_replayLog = log;
+#else
+	(void)log; (void)len; // not used without LSS_USE_RECORD
+#endif
+} // replay
+
+// isReplaying
+//
+// True while replay has calls left to carry out.
+boolean linesideSignal::isReplaying()
+{
+#if defined(LSS_USE_RECORD)
+	return(_replayLog != NULL);
+#else
+	return(false);
+#endif
+} // isReplaying
+
+#if defined(LSS_USE_RECORD)
+// record
+//
+// Add one call to the recording, as an LSS_CMD_ operation and its arguments. A gap too long for
+// the two bytes of the time is filled with LSS_RECORD_WAIT records.
+void linesideSignal::_record(byte op, byte count, byte arg0, byte arg1, byte arg2, byte arg3, byte arg4)
+{
+	byte *rec;
+	long gap;
+	
+	if ((_recordBuf == NULL) || _replaying) return; // not recording, or the call is one being replayed
+	
+	gap = _millis() - _recordStamp;
+	while (gap > 0xFFFFL) {
+		if ((_recordLen + LSS_RECORD_HEADER) > _recordSize) { // full
+			_recordBuf = NULL;
+			return;
+		}
+		rec = _recordBuf + _recordLen;
+		rec[0] = 0xFF;
+		rec[1] = 0xFF;
+		rec[2] = LSS_RECORD_WAIT;
+		rec[3] = 0;
+		_recordLen += LSS_RECORD_HEADER;
+		_recordStamp += 0xFFFFL;
+		gap -= 0xFFFFL;
+	} // while
+	
+	if ((_recordLen + LSS_RECORD_HEADER + count) > _recordSize) { // full
+		_recordBuf = NULL;
+		return;
+	}
+	rec = _recordBuf + _recordLen;
+	rec[0] = byte(gap >> 8);
+	rec[1] = byte(gap);
+	rec[2] = op;
+	rec[3] = count;
+	if (count > 0) rec[4] = arg0;
+	if (count > 1) rec[5] = arg1;
+	if (count > 2) rec[6] = arg2;
+	if (count > 3) rec[7] = arg3;
+	if (count > 4) rec[8] = arg4;
+	_recordLen += LSS_RECORD_HEADER + count;
+	_recordStamp += gap;
+} // record
+
+// replayNext
+//
+// Carry out the next recorded call, if it is due (see replay). It isn't recorded again, so a
+// recording made while replaying has only the calls the sketch made itself.
+void linesideSignal::_replayNext()
+{
+	const byte *rec;
+	
+	if ((_millis() - _replayDue) < 0) return; // not yet
+	
+	rec = _replayLog + _replayPos;
+	if ((_replayPos + LSS_RECORD_HEADER + rec[3]) > _replayLen) { // cut short
+		_replayLog = NULL;
+		return;
+	}
+	if (rec[2] != LSS_RECORD_WAIT) {
+		_replaying = true;
+		applyCommand(rec[2], rec + LSS_RECORD_HEADER, rec[3]);
+		_replaying = false;
+	}
+	_replayPos += LSS_RECORD_HEADER + rec[3];
+	
+	if ((_replayPos + LSS_RECORD_HEADER) > _replayLen) { // that was the last
+		_replayLog = NULL;
+		return;
+	}
+	rec = _replayLog + _replayPos;
+	_replayDue += (long(rec[0]) << 8) | rec[1];
+} // replayNext
+#endif
+
+// setState
+//
+// Light the lamps saved by getState (e.g., after a reset). Other lamps are not changed.
+void linesideSignal::setState(const byte *buf, int len)
 {
-	setHeadColor(mastOrd, headOrd, color, false);
-} // setHeadColor (3 params)
+	int n;
+	
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+	
+	for (n = 0; (n + LSS_STATE_RECORD) <= len; n += LSS_STATE_RECORD) {
+		if (buf[n + 3] & LSS_STATE_ALT) {
+			setAlternate(buf[n], buf[n + 1], buf[n + 2], true);
+		} else {
+			setLamp(buf[n], buf[n + 1], buf[n + 2], true, ((buf[n + 3] & LSS_STATE_FLASH) != 0));
+		}
+	} // for
+} // setState
 
-// setLampColor
+// setTrace
 //
-// Set a lamp to one color (if it supports more than one). Can also be used to turn on a
-// single-color lamp if the right color is specified.
-void linesideSignal::setLampColor(byte mastOrd, byte headOrd, byte lampOrd, byte color, boolean flashing)
+// Have a function of the sketch called for each trace event: every change to a LED pin, the
+// start of each LED's slot, each new ramp division, and each change in the number of lit lamps.
+// See LSS_TRACE_PIN etc for the arguments passed with each. It is called from inside updateSignals,
+// so it must be very short (recording the event for later, say), and it can take its own
+// timestamp with micros(). Use NULL to stop. Each instance has its own.
+void linesideSignal::setTrace(void (*trace)(byte event, byte arg1, byte arg2))
+{
+	_trace = trace;
+} // setTrace
+
+// setClock
+//
+// Time the LEDs from another microsecond clock: a function returning microseconds that count
+// up and wrap like micros() (micros itself being the default, or Timer1 with LSS_USE_TIMER1).
+// This lets the library run on a simulated clock, for testing it away from the Arduino. It is
+// read once on each call to updateSignals (twice when a LED's slot begins), and for tasks.
+// The longer times (tasks, approach lighting, LED diagnostics) count milliseconds from it too,
+// carrying on from millis(), so a test can run hours of them in minutes. Use NULL to go back to
+// the default (and millis()). Each instance has its own, but instances sharing the LED pins must
+// use the same one.
+void linesideSignal::setClock(unsigned long (*clock)())
+{
+	if (clock == NULL) {
+#if defined(LSS_USE_TIMER1)
+		_clock = _timer1Clock;
+#else
+		_clock = micros;
+#endif
+		_ownClock = false;
+	} else {
+		_clockMillis = millis();	// the timers set so far carry on
+		_clockLast = clock();
+		_clockCarry = 0;
+		_clock = clock;
+		_ownClock = true;
+	}
+	_lightTimerStart(1L, 0); // the old expiration time means nothing on the new clock
+} // setClock
+
+// dumpTrace
+//
+// Print the slot trace (LSS_USE_SLOT_TRACE), oldest first: the time of each entry (in
+// microseconds from the first, and since the one before), the LED (anode, cathode and
+// mast.head.lamp), and what was done. This is printed automatically if the pin safety net
+// halts the program. Does nothing without LSS_USE_SLOT_TRACE.
+void linesideSignal::dumpTrace()
 {
+#if defined(LSS_USE_SLOT_TRACE)
+	byte i, n, first;
+	long t;
+	signalSlot *entry;
+	linesideSignal *sig;
 	signalLamp *lamp;
 	
-	if (!_setupIsDone) return; // safety net - do nothing without setup
+	n = (_slotWrapped ? LSS_SLOT_ENTRIES : _slotNext);
+	first = (_slotWrapped ? _slotNext : 0);
 	
-	if (color > LSS_LAST_FOR_SETCOLOR) return; // bad color value, ignore it
+	Serial.print(F("slot trace: "));Serial.print(n);Serial.println(F(" entries"));
+	t = 0;
+	for (i = 0; i < n; i++) {
+		entry = &_slotTrace[(first + i) % LSS_SLOT_ENTRIES];
+		if (i > 0) t += entry->delta; // the first entry's delta is from before the trace
+		
+		Serial.print(F("t="));Serial.print(t);
+		Serial.print(F(" +"));Serial.print(entry->delta);
+		Serial.print(F(" A"));Serial.print(entry->anode);
+		Serial.print(F(" C"));Serial.print(entry->cathode);
+		
+		// find the lamp, whichever instance it belongs to
+		sig = ((_signalList != NULL) ? _signalList : this);
+		lamp = NULL;
+		while ((sig != NULL) && (lamp == NULL)) {
+			lamp = sig->_lampList;
+			while ((lamp != NULL) && !((lamp->anode == entry->anode) && (lamp->cathode == entry->cathode) && (lamp->mastNum != LSS_NULL_SIG))) {
+				lamp = lamp->nextLamp;  // advance
+			} // while
+			sig = sig->_nextSignal;
+		} // while
+		if (lamp != NULL) {
+			Serial.print(F(" "));Serial.print(lamp->mastNum);
+			Serial.print(F("."));Serial.print(lamp->headNum);
+			Serial.print(F("."));Serial.print(lamp->lampNum);
+		}
+		
+		if (entry->actions & LSS_SLOT_NEW) Serial.print(F(" new"));
+		if (entry->actions & LSS_SLOT_PASS) Serial.print(F(" pass"));
+		if (entry->actions & LSS_SLOT_DIV) Serial.print(F(" div"));
+		if (entry->actions & LSS_SLOT_CATHODE_OFF) Serial.print(F(" C-"));
+		if (entry->actions & LSS_SLOT_ANODE_OFF) Serial.print(F(" A-"));
+		if (entry->actions & LSS_SLOT_ANODE_ON) Serial.print(F(" A+"));
+		if (entry->actions & LSS_SLOT_CATHODE_ON) Serial.print(F(" C+"));
+		if (entry->actions & LSS_SLOT_HALT) Serial.print(F(" HALT"));
+		Serial.println();
+	} // for
+#endif
+} // dumpTrace
 
-	lamp = _lampList;
-	while (lamp != NULL) {
-		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) {
-			if ((lamp->color == color) ||
-				((color == LSS_YELLOW) && ((lamp->color == LSS_GREENYELLOW) || (lamp->color == LSS_REDYELLOW))) ||
-				((color == LSS_GREEN)  && (lamp->color == LSS_GREENYELLOW) ) ||
-				((color == LSS_RED)    && (lamp->color == LSS_REDYELLOW) ) ||
-				((color == LSS_YELLOW) && ((lamp->color == LSS_GREENREDYELLOW) || (lamp->color == LSS_REDGREENYELLOW))) ||
-				((color == LSS_GREEN)  && (lamp->color == LSS_GREENREDYELLOW) ) ||
-				((color == LSS_RED)    && (lamp->color == LSS_REDGREENYELLOW)) )
-			{
-				lamp->setBitFlag(LSS_SL_ISFLASH, flashing);
-				
-				// check for a color change on a lit multi-color lamp
-				if (lamp->isStop() && ( (lamp->color == LSS_GREENYELLOW) || (lamp->color == LSS_REDYELLOW) || 
-					(lamp->color == LSS_GREENREDYELLOW) || (lamp->color == LSS_REDGREENYELLOW) )) {
-					
-					lamp->setBitFlag(LSS_SL_START, true);	// ensure it restarts
-				} else if (!lamp->isOn()) {
-					lamp->setBitFlag(LSS_SL_STOP, false); // begin lite-up sequence
-					lamp->setBitFlag(LSS_SL_START, true);
-					lamp->setBitFlag(LSS_SL_ISLIT, true);
-					lamp->setBitFlag(LSS_SL_DELAY, true); // force a delay until the next cycle
-				} else if ((lamp->isOn()) && (color == lamp->color)) { // change to same color gets down/up sequence
-					lamp->setBitFlag(LSS_SL_STOP, true);
-					lamp->setBitFlag(LSS_SL_START, true);
-				}
+#if defined(LSS_USE_SLOT_TRACE)
+// recordSlot
+//
+// Add an entry to the slot trace for the current LED, with the actions taken since the
+// last entry.
+void linesideSignal::_recordSlot(long now)
+{
+	signalSlot *entry;
+	long delta;
+	
+	delta = now - _slotStamp;
+	if ((delta > 65535L) || (delta < 0)) delta = 65535L;
+	
+	entry = &_slotTrace[_slotNext];
+	entry->delta = (unsigned int)delta;
+	entry->anode = _currentLED->anode;
+	entry->cathode = _currentLED->cathode;
+	entry->actions = _slotActions;
+	
+	_slotActions = 0;
+	_slotStamp = now;
+	_slotNext++;
+	if (_slotNext >= LSS_SLOT_ENTRIES) {
+		_slotNext = 0;
+		_slotWrapped = true;
+	}
+} // recordSlot
+#endif
 
-			} // same color
-			else if (lamp->isOn()) // same lamp ordinal, so turn if off unless it's already stopping (this also handles use of LSS_DARK to turn off all lamps on the head)
-			{
-				if (lamp->isStart() || !lamp->usesRamp()) { // if it's starting up or we dont need to ramp - kill it
-					_goDark(lamp);
-				} else if (!lamp->isStop()) { // set delayed off unless its already shutting down
-					lamp->setBitFlag(LSS_SL_STOP, true);
-					lamp->setBitFlag(LSS_SL_START, false);
-					lamp->setBitFlag(LSS_SL_DELAY, true); 		
-				} // if not stopping
-			} // if on and not color match
-		} // same mast, head and lamp
-		lamp = lamp->nextLamp;  // advance
-	} // while
-} // setLampColor (5 params)
+// usePattern
+//
+// Have the LEDs driven from a timer interrupt (LSS_USE_PATTERN), which calls playPattern every
+// tick microseconds; updateSignals still needs to be called from loop(), but only to keep the
+// pattern up to date. Set up the timer after calling this, once all the lamps are added. A tick
+// of 0 goes back to lighting the LEDs from updateSignals (stop the timer first). The tick should
+// be a fraction of the time each LED is lit: 20 - 50 microseconds is about right. Only one
+// instance can use this. Does nothing without LSS_USE_PATTERN.
+void linesideSignal::usePattern(int tick)
+{
+#if defined(LSS_USE_PATTERN)
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+	if ((_signalList != this) || (_nextSignal != NULL)) return; // not with other instances
+	if (tick < 0) return;
+	
+	// whichever was driving the pins, turn them off
+	if (_cathodeOn) {
+		_cathodeDisable((_patternTime != 0) ? _playCathode : _currentLED->cathode);
+		_cathodeOn = false;
+	}
+	if (_anodeOn) {
+		_anodeDisable((_patternTime != 0) ? _playAnode : _currentLED->anode);
+		_anodeOn = false;
+	}
+	
+	_patternTime = tick;
+	_patternLamps[0] = 0;
+	_patternLamps[1] = 0;
+	_patternFront = 0;
+	_patternSwap = false;
+	_patternSlot = 0;
+	_patternTick = 0;
+	_patternPasses = 0;
+	_playAnode = LSS_NOT_PIN;
+	_playCathode = LSS_NOT_PIN;
+	_resumeTurn = true; // if going back, start the next pass afresh
+	
+	if (tick != 0) _renderPattern();
+#else
+	(void)tick; // not used without LSS_USE_PATTERN
+#endif
+} // usePattern
 
-// overload function for setLampColor with one less parameter
-void linesideSignal::setLampColor(byte mastOrd, byte headOrd, byte lampOrd, byte color)
+// playPattern
+//
+// Play the next tick of the pattern (LSS_USE_PATTERN): called from a timer interrupt every
+// tick microseconds (see usePattern). Each slot lasts a number of ticks; at the end of one the
+// pins are changed for the next. A new pattern is picked up at the end of a pass.
+void linesideSignal::playPattern()
 {
-	setLampColor(mastOrd, headOrd, lampOrd, color, false);
-} // setLampColor (4 params)
+#if defined(LSS_USE_PATTERN)
+	signalPatternSlot *slot;
+	byte lamps;
+	
+	if (_patternTime == 0) return; // not in use
+	
+	if (_patternTick > 0) { // this slot continues
+		_patternTick--;
+		return;
+	}
+	
+	_patternSlot++;
+	if (_patternSlot >= _patternLamps[_patternFront]) { // end of the pass (or nothing played yet)
+		_patternSlot = 0;
+		if (_patternLamps[_patternFront] != 0) {
+			_patternPass++;
+			if (_patternPass >= LSS_PATTERN_PASSES) _patternPass = 0;
+			_patternPasses++; // for updateSignals to count
+		}
+		if (_patternSwap) { // the next pattern is ready
+			_patternFront ^= 1;
+			_patternSwap = false;
+		}
+		if (_patternLamps[_patternFront] == 0) return; // nothing to play yet
+	}
+	
+	lamps = _patternLamps[_patternFront];
+	slot = &_pattern[_patternFront][(_patternPass * lamps) + _patternSlot];
+	_patternTick = _patternTicks[_patternFront] - 1;
+	
+	// as updateSlot: cathode off first, then change the anode, then light the LED
+	if (_cathodeOn && (!slot->lit || (slot->cathode != _playCathode) || (slot->anode != _playAnode))) {
+		_cathodeDisable(_playCathode);
+		_cathodeOn = false;
+	}
+	if (_anodeOn && (!slot->lit || (slot->anode != _playAnode))) {
+		_anodeDisable(_playAnode);
+		_anodeOn = false;
+	}
+	_playAnode = slot->anode;
+	_playCathode = slot->cathode;
+	if (slot->lit) {
+		if (!_anodeOn) {
+			_anodeEnable(_playAnode);
+			_anodeOn = true;
+		}
+		if (!_cathodeOn) {
+			_cathodeEnable(_playCathode);
+			_cathodeOn = true;
+		}
+	}
+#endif
+} // playPattern
 
-// setAlternate
+#if defined(LSS_USE_PATTERN)
+// updatePattern
 //
-// Designate this lamp as one that flashes on the other cycle from normal.  Used mainly
-// for setting up warning lights such as crossing signals.
-// For activating a two-light alternating flasher, call setAlternate for each light, specifying 
-// alternate as true or false to create pairs of alternating lights. To turn the lights off,
-// call clearHead (assuming all lights share a head).
-void linesideSignal::setAlternate(byte mastOrd, byte headOrd, byte lampOrd, boolean alternate)
+// The body of updateSignals when playPattern drives the pins: count the passes it has played,
+// move the ramp on as updateSlot would, and work out the pattern again if anything changed.
+void linesideSignal::_updatePattern()
 {
-	signalLamp *lamp;
+	int passes;
 	
-	if (!_setupIsDone) return; // safety net - do nothing without setup
+	noInterrupts();
+	passes = _patternPasses;
+	_patternPasses = 0;
+	interrupts();
+	
+	if (_timingStale) { // lamps lit or went dark
+		_governCycle();
+		_patternStale = true;
+	}
+	if (_litChanged) _patternStale = true;
+	
+	while (passes > 0) { // keep the ramp in step with the passes played
+		_cycleCount++;
+		if (_newRampState()) {
+			_advanceDivision();
+			_patternStale = true; // the new division lights lamps differently
+		}
+#if defined(LSS_USE_EFFECTS)
+		if ((_effectList != NULL) && (_cyclesPerDiv >= LSS_FX_STEPS) && ((_cycleCount % (_cyclesPerDiv / LSS_FX_STEPS)) == 0))
+			_effectDue = true;
+		if (_effectDue || (_rampDiv != _effectDiv)) {
+			if (_stepEffects()) _patternStale = true;
+		}
+#endif
+		passes--;
+	} // while
+	
+	if (_patternStale && !_patternSwap) _renderPattern(); // once the last one has been picked up
+} // updatePattern
 
+// renderPattern
+//
+// Work out which LED is lit in every slot of the next LSS_PATTERN_PASSES passes, as updateSlot
+// would in the current division, and hand it to playPattern. Each slot lasts enough ticks that
+// a pass takes the cycle time.
+void linesideSignal::_renderPattern()
+{
+	signalLamp *lamp;
+	signalPatternSlot *slot;
+	byte back;
+	byte lamps;
+	byte i;
+	byte pass;
+	long ticks;
+	
+	if (_litChanged) _sortLamps(); // lit lamps sharing a pin are played together, as in updateSlot
+	
+	back = _patternFront ^ 1;
+	
+	lamps = 0;
 	lamp = _lampList;
-	while (lamp != NULL) {
-		if ((lamp->mastNum == mastOrd) && (lamp->headNum == headOrd) && (lamp->lampNum == lampOrd)) 
-		{
-			lamp->setBitFlag(LSS_SL_ISLIT, true);
-			lamp->setBitFlag(LSS_SL_ISFLASH, true); 
-			lamp->setBitFlag(LSS_SL_ISALTERNATE, alternate);
-			lamp->setBitFlag(LSS_SL_STOP, false); // 
-			lamp->setBitFlag(LSS_SL_START, true);
-			lamp->setBitFlag(LSS_SL_DELAY, true); // force a delay until the next cycle
-		}
+	while ((lamp != NULL) && (lamps < LSS_PATTERN_LAMPS)) {
+		if (lamp->isShown()) lamps++;
 		lamp = lamp->nextLamp;  // advance
 	} // while
-} // setAlternate
+	
+	if (lamps == 0) { // nothing lit: one dark slot, so passes (and the ramp) still take the cycle time
+		for (pass = 0; pass < LSS_PATTERN_PASSES; pass++) {
+			slot = &_pattern[back][pass];
+			slot->anode = LSS_NOT_PIN;
+			slot->cathode = LSS_NOT_PIN;
+			slot->lit = false;
+		}
+		lamps = 1;
+	} else {
+		i = 0;
+		lamp = _lampList;
+		while ((lamp != NULL) && (i < lamps)) {
+			if (lamp->isShown()) {
+				for (pass = 0; pass < LSS_PATTERN_PASSES; pass++) {
+					slot = &_pattern[back][(pass * lamps) + i];
+					slot->anode = lamp->anode;
+					slot->cathode = lamp->cathode;
+					slot->lit = _lampEnabled(lamp, pass);
+				}
+				i++;
+			}
+			lamp = lamp->nextLamp;  // advance
+		} // while
+	}
+	
+	ticks = _cycleTime / (long(lamps) * long(_patternTime));
+	if (ticks < 1) ticks = 1;
+	
+	_patternLamps[back] = lamps;
+	_patternTicks[back] = int(ticks);
+	_patternStale = false;
+	_patternSwap = true; // playPattern takes it at the end of the pass
+} // renderPattern
+#endif
+
+// setSyncMaster
+//
+// Make this Arduino the source of flash timing for others. The sync pin is driven HIGH at 
+// the start of each ramp cycle (the flash interval) and LOW halfway through. Followers 
+// watch for the rising edge. Pass LSS_NOT_PIN to use syncBoundary() (e.g., to send a serial
+// message) instead of a pin.
+void linesideSignal::setSyncMaster(byte pin)
+{
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+	
+	_syncMode = LSS_SYNC_MASTER;
+	_syncPin = LSS_NOT_PIN;
+	_syncLevel = false;
+	if (_goodPin(pin)) {
+		_syncPin = pin;
+		pinMode(_syncPin, OUTPUT);
+		digitalWrite(_syncPin, LOW);
+	}
+} // setSyncMaster
 
+// setSyncFollower
+//
+// Lock the flash timing of this Arduino to a master. The sync pin is checked on every call
+// to updateSignals, and now and then a pass through the lit lamps is repeated or skipped (never 
+// more than 1/LSS_SYNC_MAX_SLIP of them per ramp cycle) so our ramp cycle drifts into line with
+// the master's rather than jumping. The part of a pass left over is made up by lengthening or
+// shortening a few LED slots (by up to 1/LSS_SYNC_TRIM of a slot each).
+// Pass LSS_NOT_PIN to use syncPulse() (e.g., on receipt of a serial message) instead of a pin.
+void linesideSignal::setSyncFollower(byte pin)
+{
+	if (!_setupIsDone) return; // safety net - do nothing without setup
+	
+	_syncMode = LSS_SYNC_FOLLOWER;
+	_syncPin = LSS_NOT_PIN;
+	_syncBehind = false;
+	_syncFreq = 0;
+	_syncSlip = 0;
+	_syncTrim = 0;
+	if (_goodPin(pin)) {
+		_syncPin = pin;
+		pinMode(_syncPin, INPUT);
+		_syncLevel = (digitalRead(_syncPin) == HIGH);
+	}
+} // setSyncFollower
+
+// syncPulse
+//
+// For a follower, report that the master has just started a ramp cycle. This is what the
+// sync pin does, and is provided for sketches receiving the sync some other way.
+void linesideSignal::syncPulse()
+{
+	if (_syncMode != LSS_SYNC_FOLLOWER) return;
+	
+	_syncEdge(_now());
+} // syncPulse
+
+// syncBoundary
+//
+// Returns true (once) if a ramp cycle has started since the last call. A master can use this
+// to send its own sync message.
+boolean linesideSignal::syncBoundary()
+{
+	boolean wasSet = _syncFlag;
+	
+	_syncFlag = false;
+	return(wasSet);
+} // syncBoundary
 
 /************************ start internal routines here ******************************/
 
+// syncCycleStart
+//
+// Called at the start of every ramp cycle, including one restarted early by resetCycleTime. 
+// Records the time for a follower to compare with the master, and drives the sync pin on a
+// master.
+void linesideSignal::_syncCycleStart()
+{
+	_syncStamp = _now();
+	_syncFlag = true;
+	
+	if (_syncBehind) { // the master's cycle started first, now we know by how much
+		_syncBehind = false;
+		_syncCorrect(_syncEdgeStamp - _syncStamp);
+	}
+	
+	if ((_syncMode == LSS_SYNC_MASTER) && (_syncPin != LSS_NOT_PIN)) {
+		digitalWrite(_syncPin, HIGH);
+		_syncLevel = true;
+	}
+} // syncCycleStart
+
+// syncEdge
+//
+// The master started a ramp cycle at the given time. If ours started less than half a ramp
+// cycle before, we are ahead and can correct now. Otherwise we are behind, and ours is due
+// shortly: the correction waits for it (see syncCycleStart), as the gap is only known then.
+void linesideSignal::_syncEdge(long stamp)
+{
+	// the master's edges are evenly spaced, so use those to measure the length of a ramp cycle
+	if (_syncEdgeStamp != 0) _syncPeriod = stamp - _syncEdgeStamp;
+	_syncEdgeStamp = stamp;
+	_syncBehind = false;
+	
+	if ((_syncStamp == 0) || (_syncPeriod <= 0)) return; // we need one full ramp cycle to compare against
+	
+	if ((stamp - _syncStamp) > (_syncPeriod / 2)) {
+		_syncBehind = true;
+		return;
+	}
+	_syncCorrect(stamp - _syncStamp);
+} // syncEdge
+
+// syncCorrect
+//
+// Our ramp cycle started phase microseconds before the master's (after, if negative). Set how
+// many passes through the lit lamps to repeat or skip over the next ramp cycle to close the
+// gap, and how many microseconds to add to or take from the LED slots for the part of a pass
+// left over (see updateSlot).
+//
+// This is a simple phase-locked loop: half the error is corrected over the next ramp cycle, 
+// and a quarter of it is added to a running estimate of the difference between the two 
+// clocks (Arduino resonators differ by a fraction of a percent, and the cycle lengths are 
+// rounded, so without it the follower would always trail by a few passes).
+void linesideSignal::_syncCorrect(long phase)
+{
+	long passTime;
+	long correction;
+	int passes;
+	int slip;
+	int maxSlip;
+	
+	passes = _cyclesPerDiv * LSS_NUM_DIV; // passes through the lit lamps in a ramp cycle
+	passTime = _syncPeriod / passes;
+	if (passTime < 1) return;
+	
+	maxSlip = passes / LSS_SYNC_MAX_SLIP;
+	
+	correction = (phase / 2) + _syncFreq; // microseconds to make up
+	slip = int(correction / passTime);
+	if (slip > maxSlip) {
+		slip = maxSlip;
+		_syncTrim = 0;
+	} else if (slip < -maxSlip) {
+		slip = -maxSlip;
+		_syncTrim = 0;
+	} else {
+		_syncFreq += phase / 4; // only learn the rate while we are not at the limit (it would overshoot)
+		_syncTrim = correction - (long(slip) * passTime); // the slots make up the rest
+	}
+	_syncSlip = slip;
+} // syncCorrect
+
 // goDark
 //
 // clear all of the flags that need clearing when a lamp is turned off.
@@ -848,6 +2786,9 @@ void linesideSignal::_goDark(signalLamp *lamp)
 	lamp->setBitFlag(LSS_SL_ISFLASH, false);	// flash is always cleared for dark lamps
 	lamp->setBitFlag(LSS_SL_ISALTERNATE, false);// alternating is always cleared for dark lamps
 	lamp->setBitFlag(LSS_SL_DELAY, false);	// and we dont need any delay
+	
+	_litChanged = true;	// re-order the lit lamps on the next pass
+	_timingStale = true;	// and re-time the slots before the next one
 
 	if ((lamp->anode == _currentLED->anode) && (lamp->cathode == _currentLED->cathode)) {						
 		_killSwitch = true; // deactivate if this is the current LED
@@ -874,25 +2815,36 @@ int linesideSignal::_getFlashRate()
 // version, which doesn't validate input (used in setup).
 void linesideSignal::_setFlashRate(int rate)
 {
-	int cyclesPerFlash;
-	long low, high;
 
 	if ((rate < 1) || (rate > 6000)) return; // ignore obviously wrong numbers
 	
 	_flashHalfInterval = 1000L * ((60000L / rate) / 2L); // convert rate in FPM to half-cycle in usec
 
-	cyclesPerFlash = int(float(60000.0 / rate) / float(_cycleTime / 1000.0)); // should be 400 for 60 FPM and 2500 usec cycle
-	_cyclesPerDiv = cyclesPerFlash / LSS_NUM_DIV; // 40 for 60 FPM @ 2500 usec cycle 
+	_cyclesPerDiv = _divPasses(rate, _cycleTime);
+} // setFlashRate
+
+// divPasses
+//
+// Work out the passes through the lit lamps in each ramp division for a flash rate (FPM)
+// and cycle time. Shared by setFlashRate and planCapacity.
+int linesideSignal::_divPasses(int rate, long cycleTime)
+{
+	int cyclesPerFlash;
+	int cyclesPerDiv;
+	long low, high;
+
+	cyclesPerFlash = int(float(60000.0 / rate) / float(cycleTime / 1000.0)); // should be 400 for 60 FPM and 2500 usec cycle
+	cyclesPerDiv = cyclesPerFlash / LSS_NUM_DIV; // 40 for 60 FPM @ 2500 usec cycle 
 	
 	// choose the closest multiple of LSS_RAMP_CYCLES_STEPS to cyclesPerDiv as the actual cyclesPerDiv
-	low = ( _cyclesPerDiv - (_cyclesPerDiv % LSS_RAMP_CYCLES_STEP) );
-	high = ( (_cyclesPerDiv+LSS_RAMP_CYCLES_STEP) - (_cyclesPerDiv % LSS_RAMP_CYCLES_STEP) );
-	if ((_cyclesPerDiv - low) > (high - _cyclesPerDiv) ) {
-		_cyclesPerDiv = high;
+	low = ( cyclesPerDiv - (cyclesPerDiv % LSS_RAMP_CYCLES_STEP) );
+	high = ( (cyclesPerDiv+LSS_RAMP_CYCLES_STEP) - (cyclesPerDiv % LSS_RAMP_CYCLES_STEP) );
+	if ((cyclesPerDiv - low) > (high - cyclesPerDiv) ) {
+		return int(high);
 	} else {
-		_cyclesPerDiv = low;
+		return int(low);
 	}
-} // setFlashRate
+} // divPasses
 
 // resetCycleTime
 //
@@ -901,6 +2853,8 @@ void linesideSignal::_setFlashRate(int rate)
 // behing the current timers, or when the cycle gets to the end and needs to start over.
 void linesideSignal::_resetCycleTime()
 {
+	_syncCycleStart();
+	
 	_rampDiv = 0;
 	_cycleCount = 0;
 	_adjCycleTime();
@@ -908,32 +2862,66 @@ void linesideSignal::_resetCycleTime()
 
 // adjCycleTime
 //
-// This routine should only be called at the start of a new cycle (division 0) so that
-// it does not affect in-process flash ramping.
+// Called at the start of each ramp cycle (division 0) to pick up changes in the overhead.
+// Changes in the number of lit lamps are handled as they happen (see governCycle).
+void linesideSignal::_adjCycleTime()
+{
+	_retime(_sharedLampCount()); // the cycle is shared with any other instances
+} // adjCycleTime
+
+// governCycle
+//
+// Called before the next slot when a lamp has been lit or gone dark (or the cycle time was
+// changed) in any instance sharing the cycle. Every instance is re-timed at once for the new
+// number of lit lamps, rather than at the start of the next ramp cycle, and without going
+// back to the start of the ramp, so lamps that are flashing or ramping carry on smoothly.
+// Counting the lit lamps only here keeps the list scan out of each slot.
+void linesideSignal::_governCycle()
+{
+	linesideSignal *sig;
+	int numLamps;
+	
+	_timingStale = false;
+	numLamps = _sharedLampCount();
+	if (_trace != NULL) _trace(LSS_TRACE_LAMPS, byte(numLamps), 0);
+	
+	if (_signalList == NULL) { // not set up yet
+		_retime(numLamps);
+		return;
+	}
+	
+	sig = _signalList;
+	while (sig != NULL) {
+		sig->_retime(numLamps);
+		sig = sig->_nextSignal;
+	} // while
+} // governCycle
+
+// retime
 //
 // Update the cycle time to reflect the time it actually takes to pulse the LEDs, where "all"
 // is defined as the max of either the current cycle or a running average. Whenever possible,
 // use the time specified by the user (or the original default if none specified).
-// 
-// note: when the number of lit lamps increases suddenly (as in approach lighting), it takes
-// one cycle (about a second) to adapt to the change.
-void linesideSignal::_adjCycleTime()
+//
+// When this changes the number of passes per division, the count of passes is scaled to 
+// match, so the ramp stays in the same division and at about the same point in it.
+void linesideSignal::_retime(int numLamps)
 {
 	long maxCycle;
 	long pulseTimeMax;
-	int numLamps;
+	long count;
+	int oldPerDiv;
+	int div;
 	int rate;
 	
 	rate = _getFlashRate(); // save the rate for later
+	oldPerDiv = _cyclesPerDiv;
 	
-	_lastLampCount = _litLampCount();
-	
-	numLamps = _lastLampCount; // this cycles number of lit lamps (our minimum setting)
+	_lastLampCount = numLamps; // this cycles number of lit lamps (our minimum setting)
 	if (numLamps == 0) numLamps = 1;
 		
 	// determine the values based on the past cycle
-	pulseTimeMax = long(_targetCycleTime / numLamps) - long(_getOverhead());
-	if (pulseTimeMax < LSS_LED_MIN) pulseTimeMax = LSS_LED_MIN;
+	pulseTimeMax = _pulseFor(_targetCycleTime, numLamps, _getOverhead());
 	maxCycle = ((pulseTimeMax + long(_getOverhead())) * long(numLamps));
 		
 	// attempt to use the preferred cycle time, but extend it based on the running average
@@ -945,11 +2933,104 @@ void linesideSignal::_adjCycleTime()
 	
 	_setFlashRate(rate); // recompute the rate values to reflect the new cycle time
 	
-} // adjCycleTime
+	if ((oldPerDiv > 0) && (_cyclesPerDiv != oldPerDiv) && (_cycleCount > 0)) { // keep our place in the ramp
+		div = _cycleCount / oldPerDiv;
+		count = (long(_cycleCount) * long(_cyclesPerDiv)) / long(oldPerDiv);
+		if (count < (long(div) * _cyclesPerDiv)) count = long(div) * _cyclesPerDiv;
+		if (count >= (long(div + 1) * _cyclesPerDiv)) count = (long(div + 1) * _cyclesPerDiv) - 1;
+		_cycleCount = int(count);
+	}
+	
+} // retime
+
+// pulseFor
+//
+// Work out how long each LED can be lit when numLamps share the cycle, allowing for the
+// overhead of each change, but never less than LSS_LED_MIN. Shared by retime and planCapacity.
+long linesideSignal::_pulseFor(int cycle, int numLamps, int overhead)
+{
+	long pulseTimeMax;
+	
+	pulseTimeMax = long(cycle / numLamps) - long(overhead);
+	if (pulseTimeMax < LSS_LED_MIN) pulseTimeMax = LSS_LED_MIN;
+	return pulseTimeMax;
+} // pulseFor
+
+// planCapacity
+//
+// Work out what the library will do with a layout on a board, without needing the layout
+// or the board: lamps is the number of lamps added, litLamps the number lit at once, cycle
+// and rate as for setCycleTime and setFlashRate, overhead the time taken to change from one
+// LED to the next and loopTime one trip around loop() (both as printTimes reports them, in
+// microseconds). This uses the same timing code as the running signals, so the results
+// match what they would do. Nothing needs to be set up first.
+void linesideSignal::planCapacity(signalPlan &plan, int lamps, int litLamps, int cycle, int rate, int overhead, int loopTime)
+{
+	long wanted;
+	
+	if (litLamps < 1) litLamps = 1;
+	if ((rate < 1) || (rate > 6000)) rate = LSS_FLASH_FPM; // as setFlashRate, ignore obviously wrong numbers
+	
+	plan.pulseTime = _pulseFor(cycle, litLamps, overhead);
+	plan.cycleTime = (plan.pulseTime + long(overhead)) * long(litLamps);
+	plan.duty = int((plan.pulseTime * 1000L) / plan.cycleTime);
+	plan.refresh = int(1000000L / plan.cycleTime);
+	
+	plan.passesPerDiv = _divPasses(rate, plan.cycleTime);
+	plan.flashPeriod = long(plan.passesPerDiv) * long(LSS_NUM_DIV) * plan.cycleTime;
+	wanted = 60000000L / long(rate); // usec per flash
+	plan.flashError = int((plan.flashPeriod - wanted) / (wanted / 1000L));
+	
+	// the instance and each lamp (plus the end-of-list lamp) as allocated
+#if defined(LSS_USE_BITPLANES)
+	plan.sram = sizeof(linesideSignal) + sizeof(signalLamp) * (LSS_MAX_LAMPS + 1) + sizeof(signalLamp::_flagPlanes); // the pool, whatever is used
+	(void)lamps; // however many there are
+#else
+	plan.sram = sizeof(linesideSignal) + (lamps + 1) * (sizeof(signalLamp) + LSS_PLAN_HEAP_HEADER);
+#endif
+	
+	plan.warnings = LSS_PLAN_OK;
+	if (plan.cycleTime > LSS_PLAN_FLICKER_CYCLE) plan.warnings |= LSS_PLAN_FLICKER;
+	if (plan.cycleTime > long(cycle)) plan.warnings |= LSS_PLAN_STRETCHED;
+	if (plan.pulseTime < long(loopTime)) plan.warnings |= LSS_PLAN_OVERRUN;
+	if ((plan.passesPerDiv == 0) || (abs(plan.flashError) > (LSS_PLAN_FLASH_ERROR * 10))) plan.warnings |= LSS_PLAN_FLASH;
+	if (plan.cycleTime > LSS_PLAN_MAX_CYCLE) plan.warnings |= LSS_PLAN_TOO_LONG;
+} // planCapacity
 
 // litLampCount
 //
-// Returns the number of lamps in On state.
+// Returns the number of lamps in On state (not counting masts that are waiting for a train).
+#if defined(LSS_USE_BITPLANES)
+int linesideSignal::_litLampCount()
+{
+	byte n;
+	byte bits;
+	int litCount = 0;
+#if defined(LSS_USE_MIX)
+	signalLamp *lamp;
+#endif
+
+	for (n = 0; n < LSS_PLANE_BYTES; n++) {
+		bits = _ownLamps[n] & signalLamp::_flagPlanes[LSS_SL_ISLIT][n] & ~signalLamp::_flagPlanes[LSS_SL_APPROACH][n];
+		while (bits != 0) { // count the bits set
+			bits &= (bits - 1);
+			litCount++;
+		} // while
+	} // for
+	
+#if defined(LSS_USE_MIX)
+	if (_mixPairs > 0) { // a mixed yellow is one lamp, its halves share a slot
+		lamp = _lampList;
+		while (lamp != NULL) {
+			if ((lamp->mix != 0) && _mixShown(lamp)) litCount--;
+			lamp = lamp->nextLamp;  // advance
+		} // while
+	}
+#endif
+	
+	return(litCount);
+} // litLampCount
+#else
 int linesideSignal::_litLampCount()
 {
 	signalLamp *lamp;
@@ -957,17 +3038,208 @@ int linesideSignal::_litLampCount()
 
 	lamp = _lampList;
 	while (lamp != NULL) {
-		if (lamp->isOn()) litCount++;
+		if (lamp->isShown()) litCount++;
+#if defined(LSS_USE_MIX)
+		if ((lamp->mix != 0) && _mixShown(lamp)) litCount--; // a mixed yellow is one lamp, its halves share a slot
+#endif
 		
 		lamp = lamp->nextLamp;  // advance
 	} // while
 	
 	return(litCount);
 } // litLampCount
+#endif
+
+// sharedLampCount
+//
+// Returns the number of lamps in On state across all instances sharing the cycle.
+int linesideSignal::_sharedLampCount()
+{
+	linesideSignal *sig;
+	int litCount = 0;
+	
+	if (_signalList == NULL) return(_litLampCount()); // not set up yet
+	
+	sig = _signalList;
+	while (sig != NULL) {
+		litCount += sig->_litLampCount();
+		sig = sig->_nextSignal;
+	} // while
+	
+	return(litCount);
+} // sharedLampCount
+
+// passTurn
+//
+// Called at the end of our pass through the lit lamps. If another instance has lamps lit, 
+// turn off our pins and hand it the turn, returning true. If not (including the usual case
+// of a single instance), return false and carry on with our next pass.
+//
+// The instance taking over starts its first lamp on the next call to updateSignals, so only
+// one LED is ever lit no matter how many instances there are.
+boolean linesideSignal::_passTurn(byte lastAnode, byte lastCathode)
+{
+	linesideSignal *sig;
+	
+	sig = _nextSignal;
+	if (sig == NULL) sig = _signalList;
+	while ((sig != this) && (sig != NULL)) {
+		if (sig->_litLampCount() > 0) break; // found one that needs the pins
+		sig = sig->_nextSignal;
+		if (sig == NULL) sig = _signalList; // loop back to start
+	} // while
+	
+	if ((sig == this) || (sig == NULL)) return(false); // nobody else to run
+	
+	// turn off the cathode first, as on a normal change of lamps
+	if (_cathodeOn) {
+		_cathodeDisable(lastCathode);
+		_cathodeOn = false;
+	}
+	if (_anodeOn) {
+		_anodeDisable(lastAnode);
+		_anodeOn = false;
+	}
+	_killSwitch = false;
+	_killAnode = false;
+	
+	_resumeTurn = true; // our current lamp is the first of our next pass
+	
+	sig->_lightExpirationTime = _lightExpirationTime; // its turn starts where our slot ended
+	sig->_lastLoopStamp = _lastLoopStamp; // loop times carry over between instances
+	sig->_updateStamp = _updateStamp;
+	_activeSignal = sig;
+	
+	return(true);
+} // passTurn
+
+// drainPins
+//
+// Ground the pins of all the lamps added in setup to dissipate any existing charge, so they
+// start fresh. The pins are done together with one wait, on the first call to updateSignals,
+// rather than one at a time as each lamp is added (which took 2 ms per lamp, even when the
+// pins had been done already). Lamps added after that are done by drainSlack, without the wait.
+void linesideSignal::_drainPins()
+{
+	_groundPins();
+	delay(LSS_DISCHARGE_TIME);	// give it some time to drain any built-up charge in the circuit
+	_releasePins();
+} // drainPins
+
+// groundPins
+//
+// Ground the pins marked in _pinsToDrain. This must run on the instance whose turn it is, as
+// the LED it has lit is turned off first (it comes back on with its next slot).
+void linesideSignal::_groundPins()
+{
+	int pin;
+	
+	if (_cathodeOn) {
+		_cathodeDisable(_currentLED->cathode);
+		_cathodeOn = false;
+	}
+	if (_anodeOn) {
+		_anodeDisable(_currentLED->anode);
+		_anodeOn = false;
+	}
+	
+	for (pin = 0; pin < LSS_PIN_LIMIT; pin++) {
+		if (_pinsToDrain[pin >> 3] & (1 << (pin & 7))) {
+			pinMode(pin, OUTPUT);	// ground the pin to dissipate any existing charge
+			digitalWrite(pin, LOW);
+			if (_trace != NULL) _trace(LSS_TRACE_PIN, pin, LSS_PIN_GROUND);
+		}
+	} // for
+	_drainPending = false; // lamps added from here on are marked for another round
+} // groundPins
+
+// releasePins
+//
+// Put the pins grounded by groundPins back to high impedance, ready for their lamps.
+void linesideSignal::_releasePins()
+{
+	int pin;
+	
+	for (pin = 0; pin < LSS_PIN_LIMIT; pin++) {
+		if (_pinsToDrain[pin >> 3] & (1 << (pin & 7))) {
+			pinMode(pin, INPUT);	// ensure pins are in high-resistance state to start 
+			if (_trace != NULL) _trace(LSS_TRACE_PIN, pin, LSS_PIN_Z);
+		}
+	} // for
+	
+	_draining = false;
+	if (_drainPending) return; // lamps were added while the pins were held, do them all again
+	for (pin = 0; pin < LSS_PIN_BYTES; pin++) _pinsToDrain[pin] = 0;
+} // releasePins
+
+// drainSlack
+//
+// Discharge the pins of lamps added once the signals are running, without stopping loop().
+// When the slot of the instance whose turn it is ends, the pins are grounded, and they are
+// released on a later call, once LSS_DISCHARGE_TIME has passed on the _millis() clock. The
+// LEDs stay dark in between (as they did for the delay in drainPins), while the rest of the
+// sketch runs. Returns true while the pins are held, and the slots must wait.
+boolean linesideSignal::_drainSlack()
+{
+	if (_draining) {
+		if ((_millis() - _drainUntil) < 0) return(true); // not yet
+		_releasePins();
+		return(false);
+	}
+	
+	if ((_now() - _lightExpirationTime) < 0) return(false); // wait for the lit LED's slot to end
+	
+	_groundPins();
+	_draining = true;
+	_drainUntil = _millis() + LSS_DISCHARGE_TIME + 1; // a whole LSS_DISCHARGE_TIME, whenever in a millisecond it starts
+	return(true);
+} // drainSlack
 
 // anyLampsAre
 // test the list of lamps to see if any have a certain flag set (mainly needed for start/stop).
 // Note that we find starting/stopping lamps with the hold flag set, which has to be ignored elsewhere.
+#if defined(LSS_USE_BITPLANES)
+boolean linesideSignal::_anyLampsAre(int bitVec, int vecTwo, boolean useReverse, boolean reversed)
+{
+	byte n;
+	byte bits;
+	byte rev;
+	byte found = 0;
+
+	if ((bitVec < 0) || (bitVec > LSS_SL_MAX)) return(false);
+	
+	for (n = 0; n < LSS_PLANE_BYTES; n++) {
+		bits = _ownLamps[n] & signalLamp::_flagPlanes[bitVec][n];
+		rev = signalLamp::_flagPlanes[LSS_SL_ISALTERNATE][n];
+		
+		switch (bitVec) {
+		
+			case LSS_SL_START:
+			case LSS_SL_STOP:
+				if (useReverse) bits &= (reversed ? rev : ~rev);
+			break;
+			
+			case LSS_SL_DELAY:
+				bits &= ((useReverse && reversed) ? rev : ~rev); // check only reversed, or only non-reversed
+				if (vecTwo == LSS_SL_START) {
+					bits &= signalLamp::_flagPlanes[LSS_SL_START][n];
+				} else if (vecTwo != LSS_SL_IGNORE) { // assume stop
+					bits &= signalLamp::_flagPlanes[LSS_SL_STOP][n];
+				}
+			break;
+		
+			default: // as for the list version, only the above are supported
+				bits = 0;
+			break;
+	
+		} // switch
+		
+		found |= bits;
+	} // for
+	
+	return(found != 0);
+} // anyLampsAre
+#else
 boolean linesideSignal::_anyLampsAre(int bitVec, int vecTwo, boolean useReverse, boolean reversed)
 {
 	signalLamp *lamp;
@@ -1028,6 +3300,7 @@ boolean linesideSignal::_anyLampsAre(int bitVec, int vecTwo, boolean useReverse,
 	
 	return(foundOne);
 } // anyLampsAre
+#endif
 
 
 // getNextLamp
@@ -1057,11 +3330,12 @@ boolean linesideSignal::_getNextLamp(boolean &newCycle)
 	lamp = _currentLED->nextLamp; // start with the lamp after this one
 	do {
 		if (lamp == NULL) {
+			if (_litChanged) _sortLamps();	// re-order only between passes, and only if the lit set changed
 			lamp = _lampList;	// loop back to start
 			newCycle = true;	// and record that one cycle through the list has completed
 		}
 		
-		if (lamp->isOn()) { // found one, which may be the one we started from if its the only one
+		if (lamp->isShown()) { // found one, which may be the one we started from if its the only one
 			scanning = false;
 			_currentLED = lamp; // advance to the new lamp
 			break;
@@ -1075,6 +3349,116 @@ boolean linesideSignal::_getNextLamp(boolean &newCycle)
 	return(!scanning);
 } // getNextLamp
 
+// sortLamps
+//
+// Re-order the lamp list so the lit lamps come first, grouped by a shared pin. Lamps that 
+// share an anode (or a cathode) are then visited back-to-back, and moving from one to the
+// next only needs the other pin changed rather than both. 
+//
+// Whichever of anode or cathode has fewer distinct pins among the lit lamps is used as the 
+// group (common-anode masts group by anode, common-cathode masts by cathode). Dark lamps are
+// left in their existing order after the lit ones, so the null lamp remains last.
+//
+// This is only called from getNextLamp when it wraps to the start of the list, so the 
+// current lamp pointer stays valid and no lit lamp is skipped or visited twice in a pass.
+void linesideSignal::_sortLamps()
+{
+	signalLamp *lamp;
+	signalLamp *next;
+	signalLamp *litList = NULL;
+	signalLamp *darkList = NULL;
+	signalLamp **litTail = &litList;
+	signalLamp **darkTail = &darkList;
+	signalLamp **link;
+#if defined(LSS_USE_MIX)
+	signalLamp *other;
+#endif
+	byte anodeMask[LSS_PIN_BYTES];		// one bit per pin, see goodPin
+	byte cathodeMask[LSS_PIN_BYTES];
+	int anodeGroups = 0;
+	int cathodeGroups = 0;
+	boolean byAnode;
+	int key, lampKey;
+	int i;
+	
+	_litChanged = false;
+	
+	for (i = 0; i < LSS_PIN_BYTES; i++) {
+		anodeMask[i] = 0;
+		cathodeMask[i] = 0;
+	}
+	
+	// split the list into lit and dark lamps, preserving order, and count the distinct pins in use
+	lamp = _lampList;
+	while (lamp != NULL) {
+		next = lamp->nextLamp;
+		lamp->nextLamp = NULL;
+		if (lamp->isShown()) {
+			if (!(anodeMask[lamp->anode >> 3] & (1 << (lamp->anode & 7)))) {
+				anodeMask[lamp->anode >> 3] |= (1 << (lamp->anode & 7));
+				anodeGroups++;
+			}
+			if (!(cathodeMask[lamp->cathode >> 3] & (1 << (lamp->cathode & 7)))) {
+				cathodeMask[lamp->cathode >> 3] |= (1 << (lamp->cathode & 7));
+				cathodeGroups++;
+			}
+			*litTail = lamp;
+			litTail = &lamp->nextLamp;
+		} else {
+			*darkTail = lamp;
+			darkTail = &lamp->nextLamp;
+		}
+		lamp = next;
+	} // while
+	
+	byAnode = (anodeGroups <= cathodeGroups);
+	
+	// insertion sort of the lit lamps on (group pin, other pin); there are rarely more than a dozen
+	lamp = litList;
+	litList = NULL;
+	while (lamp != NULL) {
+		next = lamp->nextLamp;
+		
+		if (byAnode) lampKey = (lamp->anode << 8) | lamp->cathode;
+		else lampKey = (lamp->cathode << 8) | lamp->anode;
+		
+		link = &litList;
+		while (*link != NULL) {
+			if (byAnode) key = ((*link)->anode << 8) | (*link)->cathode;
+			else key = ((*link)->cathode << 8) | (*link)->anode;
+			if (key > lampKey) break;
+			link = &(*link)->nextLamp;
+		}
+		lamp->nextLamp = *link;
+		*link = lamp;
+		
+		lamp = next;
+	} // while
+	
+#if defined(LSS_USE_MIX)
+	// the green half of a mixed yellow goes straight after the red, so the two share one slot
+	lamp = litList;
+	while (lamp != NULL) {
+		other = lamp->mixLamp;
+		if ((lamp->mix != 0) && (other != NULL) && other->isShown() && (lamp->nextLamp != other)) {
+			link = &litList;
+			while (*link != other) link = &(*link)->nextLamp;
+			*link = other->nextLamp;	// take it out
+			other->nextLamp = lamp->nextLamp;	// and put it back after the red half
+			lamp->nextLamp = other;
+		}
+		lamp = lamp->nextLamp;  // advance
+	} // while
+#endif
+	
+	// and put the dark lamps back on the end
+	link = &litList;
+	while (*link != NULL) link = &(*link)->nextLamp;
+	*link = darkList;
+	
+	_lampList = litList;
+} // sortLamps
+
 // goodPin
 //
 // Returns true if the pin number is valid on this Arduino for wiring signals. The current code is rather 
@@ -1085,7 +3469,7 @@ boolean linesideSignal::_goodPin(int pinNum)
 {
 	boolean isGood;
 	
-	isGood = ((pinNum >= 0) && (pinNum < 70)); // need to change this to model-dependent logic
+	isGood = ((pinNum >= 0) && (pinNum < LSS_PIN_LIMIT)); // need to change this to model-dependent logic
 	
 	return(isGood);
 } // goodPin
@@ -1112,6 +3496,40 @@ boolean linesideSignal::_goodPin(int pinNum)
 // changing color.  In which case the stop is processed first, then the start.
 //
 // Note that a lamp on hold can not be advanced.
+#if defined(LSS_USE_BITPLANES)
+void linesideSignal::_advanceLamps(int toClear, boolean doAlt)
+{
+	signalLamp *lamp;
+	byte dark[LSS_PLANE_BYTES];	// stopping lamps that go dark
+	boolean anyDark = false;
+	byte n;
+	byte bits;
+	
+	for (n = 0; n < LSS_PLANE_BYTES; n++) {
+		bits = signalLamp::_flagPlanes[LSS_SL_ISALTERNATE][n];
+		if (!doAlt) bits = ~bits;
+		bits &= _ownLamps[n] & ~signalLamp::_flagPlanes[LSS_SL_DELAY][n]; // ours, the right half of the cycle, and not on hold
+		dark[n] = 0;
+		
+		if (toClear == LSS_SL_START) {
+			signalLamp::_flagPlanes[LSS_SL_START][n] &= ~bits; // clear the starting flag (ISLIT was already true)
+		} else if (toClear == LSS_SL_STOP) {
+			bits &= signalLamp::_flagPlanes[LSS_SL_STOP][n];
+			signalLamp::_flagPlanes[LSS_SL_STOP][n] &= ~(bits & signalLamp::_flagPlanes[LSS_SL_START][n]); // if restarting, then only clear the stop flag
+			dark[n] = bits & ~signalLamp::_flagPlanes[LSS_SL_START][n];
+			if (dark[n] != 0) anyDark = true;
+		}
+	} // for
+	
+	if (!anyDark) return;
+	
+	lamp = _lampList; // normal lamp shutdown, which needs the lamp itself
+	while (lamp != NULL) {
+		if (dark[lamp->index() >> 3] & (1 << (lamp->index() & 7))) _goDark(lamp);
+		lamp = lamp->nextLamp;  // advance
+	} // while
+} // advanceLamps
+#else
 void linesideSignal::_advanceLamps(int toClear, boolean doAlt)
 {
 	signalLamp *lamp;
@@ -1141,10 +3559,27 @@ void linesideSignal::_advanceLamps(int toClear, boolean doAlt)
 		lamp = lamp->nextLamp;  // advance
 	} // while
 } // advanceLamps
+#endif
 
 // releaseHold
 //
 // clear the hold flag for all lamps matching criteria.
+#if defined(LSS_USE_BITPLANES)
+void linesideSignal::_releaseHold(int toClear, boolean doAlt)
+{
+	byte n;
+	byte bits;
+
+	if ((toClear != LSS_SL_START) && (toClear != LSS_SL_STOP)) return;
+	
+	for (n = 0; n < LSS_PLANE_BYTES; n++) {
+		bits = signalLamp::_flagPlanes[LSS_SL_ISALTERNATE][n];
+		if (!doAlt) bits = ~bits;
+		bits &= _ownLamps[n] & signalLamp::_flagPlanes[toClear][n];
+		signalLamp::_flagPlanes[LSS_SL_DELAY][n] &= ~bits;
+	} // for
+} // releaseHold
+#else
 void linesideSignal::_releaseHold(int toClear, boolean doAlt)
 {
 	signalLamp *lamp;
@@ -1167,6 +3602,7 @@ void linesideSignal::_releaseHold(int toClear, boolean doAlt)
 		lamp = lamp->nextLamp;  // advance
 	} // while
 } // releaseHold
+#endif
 
 // advanceDivision
 //
@@ -1179,6 +3615,10 @@ void linesideSignal::_advanceDivision()
 {
 	boolean lampsToStop, lampsToStart, lampsToRelease, lampsToReleaseAlt;
 	boolean checkReversed;
+	
+#if defined(LSS_USE_SNAPSHOT)
+	_snapshotDue = true; // lamps may finish stopping or starting now, or have been changed by the sketch
+#endif
 		
 	// test the div here, to allow the compiler to avoid calling the list-scan function if not needed
 	checkReversed = (_rampDiv == LSS_DIV_RSTART) || (_rampDiv == LSS_DIV_RSTOP);
@@ -1263,8 +3703,17 @@ boolean linesideSignal::_newRampState()
 	} // div 0
 	
 	newDiv = (rampDiv != _rampDiv);	// if new != current then we changed
+	
+	if (newDiv && _syncLevel && (_syncMode == LSS_SYNC_MASTER) && (rampDiv == (LSS_NUM_DIV / 2))) {
+		digitalWrite(_syncPin, LOW); // end of the sync pulse
+		_syncLevel = false;
+	}
 
 	_rampDiv = rampDiv;
+	if (newDiv && (_trace != NULL)) _trace(LSS_TRACE_DIV, _rampDiv, 0);
+#if defined(LSS_USE_SLOT_TRACE)
+	if (newDiv) _slotActions |= LSS_SLOT_DIV;
+#endif
 	return(newDiv);
 } // setRampState
 
@@ -1606,20 +4055,32 @@ void linesideSignal::_anodeDisable(int anode)
 #endif
 
 	if (!_goodPin(anode)) return;
+#if defined(LSS_USE_SLOT_TRACE)
+	_slotActions |= LSS_SLOT_ANODE_OFF;
+#endif
 	
 	// safety net - ensure any code problems affecting active pins cant do harm
 	_anodeCount = _anodeCount - 1;
 	if (_anodeCount < 0) {
+#if defined(LSS_DEBUG_VERIFY)
+	_verifyTrips++; // counted and carried on from, so the run can report it
+	_anodeCount = 0;
 #if defined(LSS_DEBUG_REPORTING)
+	Serial.print(F("AD: TRIP "));Serial.println(anode);
+#endif
+#elif defined(LSS_DEBUG_REPORTING)
 	Serial.print(F("AD: HALT "));Serial.println(anode);
 	_dropDead();
 #endif
 	} // safety net
 
+	if (_trace != NULL) _trace(LSS_TRACE_PIN, anode, LSS_PIN_Z);
+
 	if (_suppressLEDs) return; // debug code - LEDs cant be on, so we dont need to turn them off
 	
 #if defined(LSS_DEBUG_REPORTING)
-  long now = long(micros());
+  _pinTransitions++;
+  long now = _now();
 #endif
 	
 #if defined(LSS_USE_FAST_WRITE)
@@ -1637,7 +4098,7 @@ void linesideSignal::_anodeDisable(int anode)
 #endif
 
 #if defined(LSS_DEBUG_REPORTING)
-  _modeTime = long(micros()) - now;
+  _modeTime = _now() - now;
 #endif
 
 } // anodeDisable
@@ -1654,21 +4115,35 @@ void linesideSignal::_cathodeDisable(int cathode)
 #endif
 
 	if (!_goodPin(cathode)) return;
+#if defined(LSS_USE_SLOT_TRACE)
+	_slotActions |= LSS_SLOT_CATHODE_OFF;
+#endif
 	
 	// safety net - ensure any code problems affecting active pins cant do harm
 	_cathodeCount = _cathodeCount - 1;
 	if (_cathodeCount < 0) {
+#if defined(LSS_DEBUG_VERIFY)
+	_verifyTrips++; // counted and carried on from, so the run can report it
+	_cathodeCount = 0;
+#if defined(LSS_DEBUG_REPORTING)
+	Serial.print(F("CD: TRIP "));Serial.println(cathode);
+#endif
+#else
 #if defined(LSS_DEBUG_REPORTING)
 	Serial.print("CD: HALT ");Serial.println(cathode);
 #endif
 
 	_dropDead();
+#endif
 	} // safety net
 
+	if (_trace != NULL) _trace(LSS_TRACE_PIN, cathode, LSS_PIN_Z);
+
 	if (_suppressLEDs) return; // debug code - LEDs cant be on, so we dont need to turn them off
 
 #if defined(LSS_DEBUG_REPORTING)
-	long now = long(micros());
+	_pinTransitions++;
+	long now = _now();
 #endif
 
 #if defined(LSS_USE_FAST_WRITE)
@@ -1686,7 +4161,7 @@ void linesideSignal::_cathodeDisable(int cathode)
 #endif
 
 #if defined(LSS_DEBUG_REPORTING)
-  _modeTime = long(micros()) - now;
+  _modeTime = _now() - now;
 #endif
 
 } // cathodeDisable
@@ -1703,21 +4178,35 @@ void linesideSignal::_anodeEnable(int anode)
 #endif
 
 	if (!_goodPin(anode)) return;
+#if defined(LSS_USE_SLOT_TRACE)
+	_slotActions |= LSS_SLOT_ANODE_ON;
+#endif
 	
 	// safety net - ensure any code problems affecting active pins cant do harm
 	_anodeCount = _anodeCount + 1;
 	if (_anodeCount > 1) {
+#if defined(LSS_DEBUG_VERIFY)
+	_verifyTrips++; // counted and carried on from, so the run can report it
+	_anodeCount = 1;
+#if defined(LSS_DEBUG_REPORTING)
+	Serial.print(F("AE: TRIP "));Serial.println(anode);
+#endif
+#else
 #if defined(LSS_DEBUG_REPORTING)
 	Serial.print(F("AE: HALT "));Serial.println(anode);
 #endif
 
 	_dropDead();
+#endif
 	} // safety net
 
+	if (_trace != NULL) _trace(LSS_TRACE_PIN, anode, LSS_PIN_HIGH);
+
 	if (_suppressLEDs) return; // debug code - LEDs cant be on
 
 #if defined(LSS_DEBUG_REPORTING)
-	long now = long(micros());
+	_pinTransitions++;
+	long now = _now();
 #endif
 
 	// need a test here to see if it is already high (keep pin state somewhere)
@@ -1732,7 +4221,7 @@ void linesideSignal::_anodeEnable(int anode)
 #endif
 
 #if defined(LSS_DEBUG_REPORTING)
-  _writeTime = long(micros()) - now;
+  _writeTime = _now() - now;
 #endif
 
 } // anodeEnable
@@ -1750,22 +4239,36 @@ void linesideSignal::_cathodeEnable(int cathode)
 #endif
 
 	if (!_goodPin(cathode)) return;
+#if defined(LSS_USE_SLOT_TRACE)
+	_slotActions |= LSS_SLOT_CATHODE_ON;
+#endif
 
 	// safety net - ensure any code problems affecting active pins cant do harm
 	_cathodeCount = _cathodeCount + 1;
 	if (_cathodeCount > 1) {
+#if defined(LSS_DEBUG_VERIFY)
+	_verifyTrips++; // counted and carried on from, so the run can report it
+	_cathodeCount = 1;
+#if defined(LSS_DEBUG_REPORTING)
+	Serial.print(F("CE: TRIP "));Serial.println(cathode);
+#endif
+#else
 #if defined(LSS_DEBUG_REPORTING)
 	Serial.print(F("CE: HALT "));Serial.println(cathode);
 #endif
 
 	_dropDead();
+#endif
 	} // safety net
 	
 
+	if (_trace != NULL) _trace(LSS_TRACE_PIN, cathode, LSS_PIN_GROUND);
+
 	if (_suppressLEDs) return; // debug code - LEDs cant be on
 
 #if defined(LSS_DEBUG_REPORTING)
-	long now = long(micros());
+	_pinTransitions++;
+	long now = _now();
 #endif
 
 #if defined(LSS_USE_FAST_WRITE)
@@ -1777,7 +4280,7 @@ void linesideSignal::_cathodeEnable(int cathode)
 #endif
 
 #if defined(LSS_DEBUG_REPORTING)
-  _writeTime = long(micros()) - now;
+  _writeTime = _now() - now;
 #endif
 
 } // cathodeEnable
@@ -1847,136 +4350,162 @@ void linesideSignal::_cathodeEnable(int cathode)
 // 
 boolean linesideSignal::_enabledLED()
 {
-	boolean eLED;
-	//boolean dbg = false;
-	
-	if (!_currentLED->isOn()) { // if it isn't on at all, skip the rest
+	if (!_currentLED->isShown()) { // if it isn't on at all (or its mast is waiting for a train), skip the rest
 		_killSwitch = true;
 		_killAnode = true;
 		return(false); 
 	} 
+	
+	return(_lampEnabled(_currentLED, _cycleCount));
+} // enabledLED
+
+// lampEnabled
+//
+// Whether a lamp is lit on the given pass through the lit lamps, in the current division. It
+// has no side effects, so it can also be used to work out passes ahead of time (see renderPattern).
+// This is the ramp's choice, unless the lamp is playing an effect: then the level of the effect
+// is looked up (the same patterns of passes as the ramp uses), with no more work per slot.
+boolean linesideSignal::_lampEnabled(signalLamp *lamp, int cycleCount)
+{
+#if defined(LSS_USE_EFFECTS)
+	if (lamp->effect != LSS_FX_RAMP) { // an effect is playing
+		if (!lamp->isShown()) return(false);
+		return(((pgm_read_word(&_levelMasks[lamp->effect]) >> (cycleCount % LSS_FX_PASSES)) & 1) != 0);
+	}
+#endif
+	return(_rampEnabled(lamp, cycleCount));
+} // lampEnabled
+
+// rampEnabled
+//
+// The ramp itself (see lampEnabled).
+boolean linesideSignal::_rampEnabled(signalLamp *lamp, int cycleCount)
+{
+	boolean eLED;
+	
+	if (!lamp->isShown()) return(false);
 		
 	eLED = false; // default;
 		
 	switch (_rampDiv) {
 		case 0:
-			if (_currentLED->onHold() && _currentLED->isStop())
+			if (lamp->onHold() && lamp->isStop())
 				eLED = true;
-			else if (_currentLED->onHold() ||
-					(!_currentLED->isReversed() && !_currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStart())))
+			else if (lamp->onHold() ||
+					(!lamp->isReversed() && !lamp->usesRamp() && (lamp->isFlash() || lamp->isStart())))
 				eLED = false;
-			else if (!_currentLED->isReversed() && _currentLED->usesRamp() && 
-						(_currentLED->isStart() || _currentLED->isFlash()))
-				eLED = ((_cycleCount % 6) == 0); // ramp up, low intensity (level 1)
+			else if (!lamp->isReversed() && lamp->usesRamp() && 
+						(lamp->isStart() || lamp->isFlash()))
+				eLED = ((cycleCount % 6) == 0); // ramp up, low intensity (level 1)
 			else
 				eLED = true;
 		break; 
      
 		case 1:
-			if (!_currentLED->isReversed() && _currentLED->onHold() && _currentLED->isStop())
+			if (!lamp->isReversed() && lamp->onHold() && lamp->isStop())
 				eLED = true;
-			else if (_currentLED->onHold() || (_currentLED->isReversed() && !_currentLED->usesRamp() && _currentLED->isFlash()))
+			else if (lamp->onHold() || (lamp->isReversed() && !lamp->usesRamp() && lamp->isFlash()))
 				eLED = false;
-			else if (!_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStart()))
-				eLED = ((_cycleCount % 4) == 0); // ramp up, quarter intensity (level 2)
-			else if (_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStop()))
-				eLED = ((_cycleCount % 2) == 1); // ramp down, half intensity (level 3)
+			else if (!lamp->isReversed() && lamp->usesRamp() && (lamp->isFlash() || lamp->isStart()))
+				eLED = ((cycleCount % 4) == 0); // ramp up, quarter intensity (level 2)
+			else if (lamp->isReversed() && lamp->usesRamp() && (lamp->isFlash() || lamp->isStop()))
+				eLED = ((cycleCount % 2) == 1); // ramp down, half intensity (level 3)
 			else
 				eLED = true; // lit
 		break;
      
 		case 2:
-			if (!_currentLED->isReversed() && _currentLED->onHold() && _currentLED->isStop())
+			if (!lamp->isReversed() && lamp->onHold() && lamp->isStop())
 				eLED = true;
-			else if (_currentLED->onHold() || (_currentLED->isReversed() && !_currentLED->usesRamp() && _currentLED->isFlash()))
+			else if (lamp->onHold() || (lamp->isReversed() && !lamp->usesRamp() && lamp->isFlash()))
 				eLED = false;
-			else if (!_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStart()))
-				eLED = ((_cycleCount % 2) == 0); // ramp up, half intensity (level 3)
-			else if (_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStop()))
-				eLED = ((_cycleCount % 4) == 3); // ramp down, quarter intensity (level 2)
+			else if (!lamp->isReversed() && lamp->usesRamp() && (lamp->isFlash() || lamp->isStart()))
+				eLED = ((cycleCount % 2) == 0); // ramp up, half intensity (level 3)
+			else if (lamp->isReversed() && lamp->usesRamp() && (lamp->isFlash() || lamp->isStop()))
+				eLED = ((cycleCount % 4) == 3); // ramp down, quarter intensity (level 2)
 			else
 				eLED = true; // lit or normal non-ramp flashing
 		break;
 		
 		case 3:
-			if (!_currentLED->isReversed() && _currentLED->onHold() && _currentLED->isStop())
+			if (!lamp->isReversed() && lamp->onHold() && lamp->isStop())
 				eLED = true;
-			else if (_currentLED->onHold() || (_currentLED->isReversed() && !_currentLED->usesRamp() && _currentLED->isFlash()))
+			else if (lamp->onHold() || (lamp->isReversed() && !lamp->usesRamp() && lamp->isFlash()))
 				eLED = false;
-			else if (_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStop()))
-				eLED = ((_cycleCount % 6) == 5); // ramp down, low intensity
+			else if (lamp->isReversed() && lamp->usesRamp() && (lamp->isFlash() || lamp->isStop()))
+				eLED = ((cycleCount % 6) == 5); // ramp down, low intensity
 			else 
 				eLED = true;
 		break;
 		
 		case 4:
-			if (_currentLED->onHold() && _currentLED->isStop())
+			if (lamp->onHold() && lamp->isStop())
 				eLED = true;
-			else if (_currentLED->onHold() || (_currentLED->isReversed() && (_currentLED->isFlash() || 
-						(_currentLED->usesRamp() && (_currentLED->isStart() || _currentLED->isStop())))))
+			else if (lamp->onHold() || (lamp->isReversed() && (lamp->isFlash() || 
+						(lamp->usesRamp() && (lamp->isStart() || lamp->isStop())))))
 				eLED = false;
 			else
 				eLED = true;
 		break;
 		
 		case 5:
-			if (_currentLED->onHold() && _currentLED->isStop())
+			if (lamp->onHold() && lamp->isStop())
 				eLED = true;
-			else if (_currentLED->onHold() || (_currentLED->isReversed() && !_currentLED->usesRamp() && _currentLED->isFlash()))
+			else if (lamp->onHold() || (lamp->isReversed() && !lamp->usesRamp() && lamp->isFlash()))
 				eLED = false;
-			else if (_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isStart() || _currentLED->isFlash()))
-				eLED = ((_cycleCount % 6) == 0); // ramp up, low intensity (level 1)
+			else if (lamp->isReversed() && lamp->usesRamp() && (lamp->isStart() || lamp->isFlash()))
+				eLED = ((cycleCount % 6) == 0); // ramp up, low intensity (level 1)
 			else
 				eLED = true;
 		break;
      
 		case (LSS_NUM_DIV - 4): // 6
-			if (_currentLED->onHold() && _currentLED->isStop())
+			if (lamp->onHold() && lamp->isStop())
 				eLED = true;
-			else if (_currentLED->onHold() || 
-						(!_currentLED->isReversed() && !_currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStart() || _currentLED->isStop())))
+			else if (lamp->onHold() || 
+						(!lamp->isReversed() && !lamp->usesRamp() && (lamp->isFlash() || lamp->isStart() || lamp->isStop())))
 				eLED = false;
-			else if (_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStart()))
-				eLED = ((_cycleCount % 4) == 0); // ramp up, quarter intensity (level 2)
-			else if (!_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStop()))
-				eLED = ((_cycleCount % 2) == 1); // ramp down, half intensity (level 3)
+			else if (lamp->isReversed() && lamp->usesRamp() && (lamp->isFlash() || lamp->isStart()))
+				eLED = ((cycleCount % 4) == 0); // ramp up, quarter intensity (level 2)
+			else if (!lamp->isReversed() && lamp->usesRamp() && (lamp->isFlash() || lamp->isStop()))
+				eLED = ((cycleCount % 2) == 1); // ramp down, half intensity (level 3)
 			else
 				eLED = true; // lit or reverse no-ramp flash			
 		break;
      
 		case (LSS_NUM_DIV - 3): // 7
-			if (_currentLED->onHold() && _currentLED->isStop())
+			if (lamp->onHold() && lamp->isStop())
 				eLED = true;
-			else if (_currentLED->onHold() || 
-						(!_currentLED->isReversed() && !_currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStart() || _currentLED->isStop())))
+			else if (lamp->onHold() || 
+						(!lamp->isReversed() && !lamp->usesRamp() && (lamp->isFlash() || lamp->isStart() || lamp->isStop())))
 				eLED = false;
-			else if (_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStart()))
-				eLED = ((_cycleCount % 2) == 0); // ramp up, half intensity (level 3)
-			else if (!_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStop()))
-				eLED = ((_cycleCount % 4) == 3); // ramp down, quarter intensity (level 2)
+			else if (lamp->isReversed() && lamp->usesRamp() && (lamp->isFlash() || lamp->isStart()))
+				eLED = ((cycleCount % 2) == 0); // ramp up, half intensity (level 3)
+			else if (!lamp->isReversed() && lamp->usesRamp() && (lamp->isFlash() || lamp->isStop()))
+				eLED = ((cycleCount % 4) == 3); // ramp down, quarter intensity (level 2)
 			else 
 				eLED = true;
 		break;
      
 		case (LSS_NUM_DIV - 2): // 8
-			if (_currentLED->onHold() && _currentLED->isStop())
+			if (lamp->onHold() && lamp->isStop())
 				eLED = true;
-			else if (_currentLED->onHold() || 
-						(!_currentLED->isReversed() && !_currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStart() || _currentLED->isStop())))
+			else if (lamp->onHold() || 
+						(!lamp->isReversed() && !lamp->usesRamp() && (lamp->isFlash() || lamp->isStart() || lamp->isStop())))
 				eLED = false;
-			else if (!_currentLED->isReversed() && _currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStop()))
-				eLED = ((_cycleCount % 6) == 5); // ramp down, low intensity (level 1)
+			else if (!lamp->isReversed() && lamp->usesRamp() && (lamp->isFlash() || lamp->isStop()))
+				eLED = ((cycleCount % 6) == 5); // ramp down, low intensity (level 1)
 			else
 				eLED = true;
 		break;
    
 		case (LSS_NUM_DIV - 1): // 9, this is the special dark cycle for flashing LEDs
-			if (_currentLED->onHold() && _currentLED->isStop())
+			if (lamp->onHold() && lamp->isStop())
 				eLED = true;
-			else if (_currentLED->onHold() || 
-					(!_currentLED->isReversed() && !_currentLED->usesRamp() && (_currentLED->isFlash() || _currentLED->isStart()|| _currentLED->isStop())) ||
-					(!_currentLED->isReversed() && (_currentLED->isFlash() || 
-						(_currentLED->usesRamp() && (_currentLED->isStart() || _currentLED->isStop())))))
+			else if (lamp->onHold() || 
+					(!lamp->isReversed() && !lamp->usesRamp() && (lamp->isFlash() || lamp->isStart()|| lamp->isStop())) ||
+					(!lamp->isReversed() && (lamp->isFlash() || 
+						(lamp->usesRamp() && (lamp->isStart() || lamp->isStop())))))
 				eLED = false;
 			else
 				eLED = true;
@@ -1987,12 +4516,32 @@ boolean linesideSignal::_enabledLED()
 		break;
 	} // switch
 	
-	if (_currentLED->onHold() && !_currentLED->isStop()) { // held LED with stop set remains lit
+	if (lamp->onHold() && !lamp->isStop()) { // held LED with stop set remains lit
 		eLED = false;
 	} // hold
 
 	return(eLED);
-} // enabledLED
+} // rampEnabled
+
+#if defined(LSS_DEBUG_VERIFY)
+// verifySlot
+//
+// Check the slot just set up by updateSlot: the safety-net pin counts must be in range, and
+// the only LED lit may be the current lamp (and only if it is shown and enabled). Counts 
+// anything wrong, for printTimes and getVerifyErrors. Whether the lamp should have been lit
+// is checked on the host, against a model of its own (extras/host/diffTest).
+void linesideSignal::_verifySlot(boolean LEDEnabled)
+{
+	_verifySlots++;
+	
+	if ((_anodeCount < 0) || (_anodeCount > 1) || (_cathodeCount < 0) || (_cathodeCount > 1))
+		_verifyPinErrors++;
+	else if (_cathodeOn && (!_anodeOn || !LEDEnabled || !_currentLED->isShown()))
+		_verifyPinErrors++; // a LED is lit that shouldn't be
+	else if (LEDEnabled && !_cathodeOn)
+		_verifyPinErrors++; // and one isn't that should be
+} // verifySlot
+#endif
 
 
 /************************ main logic updateSignals function ****************************/
@@ -2010,24 +4559,117 @@ boolean linesideSignal::_enabledLED()
 // prior one and turning on the new one. Finally, it manages the state of the LEDs as they
 // progress from off to on and on to off over multiple cycles.
 //
+// When more than one instance has been set up, they share one cycle: each in turn makes
+// a pass through its own lit lamps and then hands the pins to the next. A call to 
+// updateSignals on any instance services whichever instance currently has its turn.
 void linesideSignal::updateSignals() 
+{
+	boolean syncLevel;
+	linesideSignal *holder;
+	
+	if (_drainPending || _draining) { // lamps have been added since we last ran
+		holder = ((_activeSignal != NULL) && (_activeSignal != this)) ? _activeSignal : this;
+		if (!_signalsRunning) {
+			holder->_drainPins(); // the lamps added in setup, all at once before the first slot
+		} else if (holder->_drainSlack()) {
+			return; // pins held at ground, the slots wait until they are released
+		}
+	}
+	_signalsRunning = true;
+	
+	if ((_syncMode == LSS_SYNC_FOLLOWER) && (_syncPin != LSS_NOT_PIN)) { // watch for the master's rising edge
+		syncLevel = (digitalRead(_syncPin) == HIGH);
+		if (syncLevel && !_syncLevel) _syncEdge(_now());
+		_syncLevel = syncLevel;
+	}
+	
+#if defined(LSS_USE_PATTERN)
+	if (_patternTime != 0) { // playPattern drives the pins, just keep the pattern up to date
+		_updatePattern();
+		_lightExpirationTime = _now() + _cycleTime; // a task can't make a LED late, only the next pattern
+		_slotWork(this);
+		return;
+	}
+#endif
+	
+	if ((_activeSignal != NULL) && (_activeSignal != this)) {
+		_activeSignal->_updateSlot();
+		_slotWork(_activeSignal); // it is their slot we must not make late
+	} else {
+		_updateSlot();
+		_slotWork(this);
+	}
+} // updateSignals
+
+// slotWork
+//
+// The rest of updateSignals, fitted into the slot of the LED that *sig* (the instance with the
+// turn) has lit: queued commands, the snapshot, a replayed call, the approach inputs and the
+// tasks, each only if the slot has room left for it.
+void linesideSignal::_slotWork(linesideSignal *sig)
+{
+#if defined(LSS_USE_QUEUE)
+	if (_queueTail != _queueHead) _drainQueue(sig);
+#endif
+#if defined(LSS_USE_SNAPSHOT)
+	if (_snapshotDue && sig->_slotSlack(LSS_SNAPSHOT_COST)) _publishState();
+#endif
+#if defined(LSS_USE_RECORD)
+	if ((_replayLog != NULL) && sig->_slotSlack(LSS_COMMAND_COST)) _replayNext();
+#endif
+	if (_approachList != NULL) _scanApproach(sig->_slotSlack(LSS_APPROACH_COST));
+	if (_taskList != NULL) _runTask(sig);
+} // slotWork
+
+// updateSlot
+//
+// The body of updateSignals for the instance that has the turn.
+void linesideSignal::_updateSlot() 
 {
 	long now;
 	long startTime;
+#if defined(LSS_DEBUG_REPORTING)
 	long startBank;
+	boolean switchedBank = false;
+#endif
 	long newOverhead;
 	long errorTime;
 	long beforeTime;
+	long pulseTime;
+	long trim;
+	long slotStart;
 	byte lastAnode, lastCathode;
-	boolean switchedBank = false;
 	boolean newCycle = false;
 	boolean LEDEnabled;
 	boolean timerExp = false;
+#if defined(LSS_USE_MIX)
+	boolean mixSlot = false;
+#endif
+		
+	startTime = _now(); // the one reading of the clock on most calls, everything else is timed from it
+	_updateStamp = startTime;
+	now = startTime;
+	
+#if defined(LSS_USE_LED_DIAG)
+	if (_diagPin != LSS_NOT_PIN) _diagFinish(); // a reading of the last call, before the slot is timed
+#endif
+	
+	_lastLoopTime = startTime - _lastLoopStamp; // from one call to the next (the timer can only be seen to expire this often)
+	_lastLoopStamp = startTime; // remember the last time we were here
+	
+	if (_lastLoopTime > 1000) {
+		_averageLoop(1000); // cap it for fixed point limits (and in any case, loops > 1000 won't provide a huge error variation
+	} else {
+		_averageLoop(_lastLoopTime);
+	}
 		
-	startTime = long(micros());
+#if defined(LSS_DEBUG_REPORTING)
+	if (_lastLoopTime < _minCycleTime) _minCycleTime = _lastLoopTime;
+	if (_lastLoopTime > _maxCycleTime) _maxCycleTime = _lastLoopTime;
+#endif
 	
-	if (_litLampCount() > (_lastLampCount + 1)) { // if more than one new light turned on the timing will be wrong
-		_resetCycleTime();
+	if (_timingStale) { // lamps lit or went dark since the last slot, re-time now
+		_governCycle();
 	}
 		
 	newCycle = false;
@@ -2038,17 +4680,45 @@ void linesideSignal::updateSignals()
 	// if it's time, advance to a new LED.
 
 	if (_lightTimerExpired()) { // move to the next LED
-		startBank = long(micros());
 		timerExp = true;
 		
-  		if (_getNextLamp(newCycle))
-  			_killSwitch = false; // reset this if we find a valid LED
+		if (_resumeTurn) { // just handed the pins, start our pass with the current lamp
+			_resumeTurn = false;
+			if (!_currentLED->isShown()) _getNextLamp(newCycle); // it went dark (or this is our first turn)
+			newCycle = true;
+			_killSwitch = false;
+		} else {
+			if (_getNextLamp(newCycle))
+				_killSwitch = false; // reset this if we find a valid LED
+			
+			if (newCycle && _passTurn(lastAnode, lastCathode)) return; // end of our pass, another instance's turn
+		}
   		  		
    		// start the timer for the newly-lit LEDs
-		beforeTime = long(micros()); // set time here so we don't count the time spent changing pins
+		beforeTime = _now(); // set time here so we don't count the time spent changing pins
+
+		pulseTime = _pulseTimePerLED;
+		if (_syncTrim != 0) { // a follower lengthens or shortens a few slots, to match the master to within a loop
+			trim = pulseTime / LSS_SYNC_TRIM;
+			if (_syncTrim < trim) trim = (_syncTrim < -trim) ? -trim : _syncTrim;
+			pulseTime += trim;
+			_syncTrim -= trim;
+		}
+#if defined(LSS_USE_MIX)
+		mixSlot = _mixShown(_currentLED);
+		if (mixSlot) pulseTime = _mixTime(_currentLED, pulseTime); // half of a mixed yellow, its share of the one pulse
+#endif
 
-		errorTime = (_pulseTimePerLED %  _getAverageLoop()); // extra amount we waited after timer expired midway though last cycle
-		_lightTimerStart( (_pulseTimePerLED - errorTime + long(_getOverhead()) ), beforeTime );  
+		errorTime = (_getAverageLoop() > 0) ? (pulseTime %  _getAverageLoop()) : 0; // extra amount we waited after timer expired midway though last cycle (none known yet)
+		slotStart = beforeTime;
+		if ((_syncMode != LSS_SYNC_NONE) && ((beforeTime - _lightExpirationTime) < (2L * long(_getAverageLoop())))) {
+			slotStart = _lightExpirationTime; // in sync, time from when the last slot was due to end, so the wait to see it end doesn't add up over a ramp cycle
+			errorTime = 0;
+		}
+		
+		_lightTimerStart( (pulseTime - errorTime + long(_getOverhead()) ), slotStart );  
+		
+		if (_trace != NULL) _trace(LSS_TRACE_SLOT, _currentLED->anode, _currentLED->cathode);
 		  		
 	} // if LED usec timer expired
 		
@@ -2058,6 +4728,10 @@ void linesideSignal::updateSignals()
 	if (_newRampState())	// advance the ramp state if needed
 		_advanceDivision();	// and if we did, see if that causes any changes in lamp status
 	
+#if defined(LSS_USE_EFFECTS)
+	if (_effectDue || (_rampDiv != _effectDiv)) _stepEffects(); // after the division moved on, so lamps it lights are seen
+#endif
+	
 	if (!_killSwitch)
 		LEDEnabled = _enabledLED(); // check to see if the LED should be on or off for ramping (do after possibly advancing to new lamp)
 		
@@ -2068,7 +4742,9 @@ void linesideSignal::updateSignals()
 	// It is possible that no lamps are lit (dark signals) and we will just loop without doing
 	// anything until that changes.
 	
-	startBank = long(micros());
+#if defined(LSS_DEBUG_REPORTING)
+	startBank = _now();
+#endif
 	
 	// if we are changing cathodes or starting a new cycle, turn the old one off first thing
   	if ((_currentLED->cathode != lastCathode) || (newCycle) || _killSwitch)
@@ -2090,7 +4766,9 @@ void linesideSignal::updateSignals()
   				_anodeOn = true;
   				lastAnode = _currentLED->anode;
   			}
+#if defined(LSS_DEBUG_REPORTING)
   			switchedBank = true;
+#endif
   		}
   	} // anode off
 	
@@ -2131,44 +4809,75 @@ void linesideSignal::updateSignals()
 	}
 	_killAnode = false; // ensure this is cleared for the next cycle
 	
-	// keep a running average of how long we spend switching the pins
-	now = long(micros());
+#if defined(LSS_DEBUG_VERIFY)
+	_verifySlot(LEDEnabled);
+#endif
 	
+	// keep a running average of how long we spend switching the pins
 	if (timerExp) { // new lamp, update times
+		now = _now();
+		_updateStamp = now;
+		
 		//errorTime = (_pulseTimePerLED %  _getAverageLoop()); // extra amount we waited after timer expired midway though last cycle
 		
 		newOverhead = (now - beforeTime); // time spent processing LEDs this cycle
 		
 		_averageOverhead( newOverhead ); // keep a running average of time spent per led in addition to timer value
 		
+#if defined(LSS_USE_MIX)
+		if (mixSlot) // timed from the pins changing (less the usual lateness in seeing it end), so each half gets its whole share lit
+			_lightTimerStart((pulseTime - (_getAverageLoop() / 2)), now);
+#endif
+		
 	} // new Lamp due to timer expiration - update times
 
 #if defined(LSS_DEBUG_REPORTING)
-		//now = long(micros());
+		if (!timerExp) now = _now();
 		if (switchedBank) _lastBankTime = now - startBank;
 		if ((now - startTime) > _maxBankTime) _maxBankTime = now - startBank;
 		if ((now - startTime) < _minBankTime) _minBankTime = now - startBank;
+		
+		if (LEDEnabled && (_approachStamp != 0) && (_currentLED->mastNum == _approachMast)) { // first lamp lit for an approach
+			_approachLatency = now - _approachStamp;
+			if (_approachLatency > _maxApproachLatency) _maxApproachLatency = _approachLatency;
+			_approachStamp = 0;
+		}
 #endif
 
 	if (newCycle) {
 		_cycleCount++; // count each time we work through the list of lamps
+		
+#if defined(LSS_USE_EFFECTS)
+		if ((_effectList != NULL) && (_cyclesPerDiv >= LSS_FX_STEPS) && ((_cycleCount % (_cyclesPerDiv / LSS_FX_STEPS)) == 0))
+			_effectDue = true; // the next step is played on the next call
+#endif
+		
+		if ((_syncSlip != 0) && ((_cycleCount & 1) == 0)) { // a follower repeats or skips a pass now and then to track the master
+			if (_syncSlip > 0) {
+				_cycleCount--;
+				_syncSlip--;
+			} else {
+				_cycleCount++;
+				_syncSlip++;
+			}
+		}
+#if defined(LSS_DEBUG_REPORTING)
+		_cycleTransitions = _pinTransitions;
+		_pinTransitions = 0;
+#endif
 	}
 	
-	_lastLoopTime = startTime - _lastLoopStamp;
-	_lastLoopStamp = long(micros()); // remember the last time we were here
+#if defined(LSS_USE_SLOT_TRACE)
+	if (timerExp) _slotActions |= LSS_SLOT_NEW;
+	if (newCycle) _slotActions |= LSS_SLOT_PASS;
+	if (_slotActions != 0) _recordSlot(now); // only when something happened
+#endif
 	
-	if (_lastLoopTime > 1000) {
-		_averageLoop(1000); // cap it for fixed point limits (and in any case, loops > 1000 won't provide a huge error variation
-	} else {
-		_averageLoop(_lastLoopTime);
-	}
-		
-	#if defined(LSS_DEBUG_REPORTING)
-		if (_lastLoopTime < _minCycleTime) _minCycleTime = _lastLoopTime;
-		if (_lastLoopTime > _maxCycleTime) _maxCycleTime = _lastLoopTime;
-	#endif
+#if defined(LSS_USE_LED_DIAG)
+	if (LEDEnabled && _cathodeOn) _diagSample(); // uses time left in this lamp's slot, if there is enough
+#endif
 
-} // updateSignals
+} // updateSlot
 
 /************************ debugging utility functions ****************************/
 
@@ -2254,6 +4963,10 @@ void linesideSignal::printSignals()
 		if (lamp->isStop()) Serial.print(F("v"));
 		if (lamp->usesRamp()) Serial.print(F("R"));
 		if (lamp->onHold()) Serial.print(F("H"));
+#if defined(LSS_USE_LED_DIAG)
+		if (lamp->getBitFlag(LSS_SL_OPEN)) Serial.print(F("o"));
+		if (lamp->getBitFlag(LSS_SL_SHORT)) Serial.print(F("s"));
+#endif
 		
 		if (i >= 6) {
 			Serial.println(F(" /"));
@@ -2302,13 +5015,34 @@ void linesideSignal::printTimes()
 	Serial.print(F(", _minCycleTime="));Serial.print(_minCycleTime);	
 	Serial.print(F(", _maxCycleTime="));Serial.print(_maxCycleTime);	
 	Serial.print(F(", overhead="));Serial.print(_getOverhead());	
-	Serial.print(F(", avgloop="));Serial.println(_getAverageLoop());	
+	Serial.print(F(", avgloop="));Serial.print(_getAverageLoop());	
+	Serial.print(F(", pin changes/cycle="));Serial.print(_cycleTransitions);	
+	Serial.print(F(", approach latency="));Serial.print(_approachLatency);	
+	Serial.print(F(", max approach latency="));Serial.print(_maxApproachLatency);	
+#if defined(LSS_USE_QUEUE)
+	Serial.print(F(", queue latency="));Serial.print(_queueLatency);	
+	Serial.print(F(", max queue latency="));Serial.print(_maxQueueLatency);	
+#endif
+	Serial.print(F(", task overruns="));Serial.print(_taskOverruns);	
+	Serial.print(F(", late slots="));Serial.print(_taskLate);	
+	Serial.print(F(", task waits="));Serial.print(_taskWaits);	
+	Serial.print(F(", max task delay="));Serial.println(_maxTaskDelay);	
+#if defined(LSS_DEBUG_VERIFY)
+	Serial.print(F("verify: checks="));Serial.print(_verifySlots);
+	Serial.print(F(", pin errors="));Serial.print(_verifyPinErrors);
+	Serial.print(F(", safety trips="));Serial.println(_verifyTrips);
+#endif
 	
 	_lastBankTime = 0;
     _maxBankTime = 0;
     _minBankTime = _cycleTime;
     _maxCycleTime = 0;
     _minCycleTime = _cycleTime;
+    _maxApproachLatency = 0;
+#if defined(LSS_USE_QUEUE)
+    _maxQueueLatency = 0;
+#endif
+    _maxTaskDelay = 0;
 
 
 #endif
@@ -22,10 +22,111 @@
 //#define LSS_DEBUG_VERBOSE
 //#define LSS_DEBUG_NOLEDS
 
+// uncomment to check every LED slot as it is set up: at most one LED may be lit, and only the
+// current lamp's when it is enabled, and the pin safety net must never trip (a trip is counted
+// and the signals carry on, rather than halting). Anything else is counted (see 
+// getVerifyErrors, and printTimes). Use it when changing the ramp, the lamp flags or the order
+// lamps are visited in, with extras/host/diffTest, which checks which LED is lit in each slot
+// against a model of its own. It takes time from every slot, so don't leave it on.
+//#define LSS_DEBUG_VERIFY
+
+// uncomment to keep the lamp flags as bit planes: one bit per lamp for each LSS_SL_ flag, with
+// the lamps of every instance sharing the planes. The checks made at each ramp division then
+// look at 8 lamps per operation rather than walking the lamp list, which is worth having with
+// a large number of lamps. The lamps are then taken from a fixed pool of LSS_MAX_LAMPS (shared
+// by all instances) rather than allocated one at a time, and a lamp's place in the pool is its
+// bit in the planes, so it carries no flags or index of its own and has no heap header. Lamps
+// added once the pool is full are left out (with LSS_DEBUG_REPORTING, addLamp says so). The
+// end-of-list lamp is shared by all instances and doesn't count.
+//#define LSS_USE_BITPLANES
+
+// LSS_MAX_LAMPS = number of lamps the pool and the bit planes have room for. The pool takes
+// this many lamps of SRAM, whether or not they are added, so set it to the number of lamps used
+// (at most 254).
+#define LSS_MAX_LAMPS 64
+#define LSS_PLANE_BYTES ((LSS_MAX_LAMPS / 8) + 1)	// one bit per lamp, and the end-of-list lamp
+
+// uncomment to check the LEDs of lit lamps for an open or short circuit (see getLampFault).
+// Only lamps whose cathode is on an analog pin can be checked. An open LED leaves its cathode
+// floating, so to read as open it needs a pull-down of about 100k or more on the cathode pin
+// (weak enough not to matter to the lamps that share the pin).
+//#define LSS_USE_LED_DIAG
+
+// uncomment to keep a record of the last LSS_SLOT_ENTRIES LED slots (all instances), with the
+// pins changed in each, which dumpTrace prints. It is printed automatically if the pin safety
+// net halts the program (Serial must have been started). Each entry takes 5 bytes.
+//#define LSS_USE_SLOT_TRACE
+#define LSS_SLOT_ENTRIES 32
+
+// uncomment to let a timer interrupt drive the LEDs (see usePattern), for boards with the memory
+// to spare (32-bit boards). updateSignals then works out ahead of time which LED is lit in each
+// slot, a ramp division at a time, and playPattern plays that out from the interrupt, so the LED
+// timing no longer depends on how often loop() gets round. The pattern is only worked out again
+// when a division ends or lamps change.
+//#define LSS_USE_PATTERN
+
+// LSS_PATTERN_LAMPS = most lit lamps shown with LSS_USE_PATTERN (more are not lit). The two
+// pattern buffers take 2 x LSS_PATTERN_PASSES x LSS_PATTERN_LAMPS x 3 bytes (1152 for 16).
+#define LSS_PATTERN_LAMPS 16
+
+// uncomment to time the LEDs from Timer1 of an AVR (Uno, Nano, Pro Mini, Mega) rather than
+// micros(), which has to stop interrupts on every call. Timer1 is set to count freely at
+// 2 counts per microsecond (1 at 8 MHz), and read as a microsecond clock that wraps just as
+// micros() does. It must be read at least every 32 milliseconds to keep time, which calling
+// updateSignals each time around loop() does (if loop() takes longer, the clock loses time
+// rather than going wrong). Timer1 can't then be used for anything else: analogWrite on pins
+// 9 and 10 and the Servo library use it.
+//#define LSS_USE_TIMER1
+
+// uncomment to let lamps play keyframe effects in place of the ramp as they light and go out (see
+// setEffect): a searchlight's roundel bouncing, an incandescent bulb warming up and cooling down,
+// or the flicker of a flasher relay. Each lamp takes a byte more, and each lamp given effects 12.
+//#define LSS_USE_EFFECTS
+
+// uncomment to light the two halves of a mixed yellow (LSS_GREENYELLOW and LSS_REDYELLOW, or
+// LSS_GREENREDYELLOW and LSS_REDGREENYELLOW, with the same lamp number) as one lamp: the red half
+// then the green, back to back in the one slot, split by a ratio that stays the same however many
+// other lamps are lit (see setMix). Each lamp takes 3 bytes more.
+//#define LSS_USE_MIX
+
+// uncomment to let commands be queued from an interrupt, or from the other core of a dual-core
+// board (see queueCommand), to be carried out by updateSignals in the time left in a LED's slot. The lamp
+// functions (setHeadColor and the rest) must otherwise only be called from the same place as
+// updateSignals. The queue holds LSS_QUEUE_ENTRIES commands, 7 bytes each.
+//#define LSS_USE_QUEUE
+
+// LSS_QUEUE_ENTRIES = commands the queue holds (a power of 2, up to 128)
+// LSS_QUEUE_PER_CALL = most commands carried out on each call to updateSignals
+// LSS_COMMAND_COST = microseconds a command takes (about as long as the lamp function it calls,
+// on a 16 MHz AVR): one is only carried out if at least this much of the LED's slot is left (and
+// a loop), so that a burst of them can't make a LED late
+#define LSS_QUEUE_ENTRIES 8
+#define LSS_QUEUE_PER_CALL 1
+#define LSS_COMMAND_COST 50
+
+// uncomment to keep a copy of the lit lamps (as getState gives them) that readState can read from
+// an interrupt, or from the other core of a dual-core board, while updateSignals runs. With
+// LSS_USE_QUEUE to send changes the other way, one core can be given over to the LEDs and the
+// other to the rest of the sketch, and neither ever waits for the other. The copy is made again
+// after queued commands are carried out, and at each ramp division. It takes two copies of
+// LSS_SNAPSHOT_BYTES (LSS_STATE_RECORD bytes for each lit lamp). A copy is only made if at least
+// LSS_SNAPSHOT_COST microseconds (about what making one takes on a 16 MHz AVR) of the LED's slot
+// are left, and a loop, so it can't make the LED late.
+//#define LSS_USE_SNAPSHOT
+#define LSS_SNAPSHOT_BYTES 64
+#define LSS_SNAPSHOT_COST 80
+
+// uncomment to be able to record the calls a sketch makes to change the lamps, with their timing,
+// and replay them later (see startRecord and replay): an operating session, say, to be repeated
+// exactly while trying out changes to the sketch or the library. Replayed calls are carried out
+// as queued commands are, each only if LSS_COMMAND_COST of the LED's slot is left.
+//#define LSS_USE_RECORD
+
 // LSS_FLASH_FPM = rate of flashing signals in full cycles per minute (flashes per min)
 // Note: Arduino clocks aren't exact, so "60 FPM" may end up slightly faster or slower, but 
 // then so do real signals. For best results, all flashers at one grade crossing should 
-// operate from a single Auduino to ensure synchronization. This isn't necessarily true of all
+// operate from a single Auduino to ensure synchronization (or, if that isn't possible, use 
+// setSyncMaster and setSyncFollower to lock them together). This isn't necessarily true of all
 // signals at one location, as each prototype signal will have it's own relays, so flashes 
 // are not likely to be synchronized anyway.
 //
@@ -66,12 +167,153 @@
 // This should be adjusted when running at 8 MHz.
 #define LSS_LED_MIN 200
 
+// LSS_DISCHARGE_TIME = milliseconds to hold the pins of newly-added lamps at ground, to drain
+// any charge left in the circuit. The pins of lamps added in setup are done together, once, on
+// the first call to updateSignals (rather than each pin as each lamp is added). Pins of lamps
+// added later are done when a slot ends, and held while loop() carries on, with no delay().
+#define LSS_DISCHARGE_TIME 1
+
 // LSS_DRAIN_TIME = microseconds to hold cathode at ground before turning off
 // the drain time is only applied if LSS_DRAIN_ON is true
 // This appears to be unnecessary and is presently disabled.  It may be removed in the future.
 #define LSS_DRAIN_TIME 100
 #define LSS_DRAIN_ON false
 
+// approach lighting (see addApproach)
+// LSS_APPROACH_SAMPLE = milliseconds between reads of each approach input
+// LSS_APPROACH_DEBOUNCE = net reads one way or the other before an input is taken as changed
+// LSS_APPROACH_HOLD = milliseconds a mast stays lit after its inputs clear (covers gaps in detection)
+// LSS_APPROACH_COST = microseconds a read takes (and lighting or darkening the mast, if it changes):
+// an input is read on time only if this much of the LED's slot is left, and a loop, and otherwise
+// waits until it is 4 times LSS_APPROACH_SAMPLE overdue
+#define LSS_APPROACH_SAMPLE 2
+#define LSS_APPROACH_DEBOUNCE 5
+#define LSS_APPROACH_HOLD 1000
+#define LSS_APPROACH_COST 30
+
+// LED diagnostics (LSS_USE_LED_DIAG)
+// LSS_DIAG_INTERVAL = milliseconds between samples (each lit lamp is sampled in turn)
+// LSS_DIAG_SAMPLES = samples of a lamp that must agree before its fault is set or cleared
+// LSS_DIAG_OPEN_LEVEL = a cathode reading (0 - 1023) below this means no current path: an open LED
+// LSS_DIAG_SHORT_LEVEL = a reading above this means no voltage across the LED: a short
+// LSS_DIAG_TIME = microseconds a sample takes (an ADC conversion, about 104 on a 16 MHz AVR),
+// during which the LED is dark. A sample is only started if at least this much of the lamp's
+// slot is left (and a loop), so it is done before the slot ends. The slot is then lengthened
+// by the time the LED was dark, so the lamp gets its full share of light.
+#define LSS_DIAG_INTERVAL 20
+#define LSS_DIAG_SAMPLES 3
+#define LSS_DIAG_OPEN_LEVEL 150
+#define LSS_DIAG_SHORT_LEVEL 960
+#define LSS_DIAG_TIME 120
+
+// tasks (see addTask)
+#define LSS_NO_TASK 0			// returned by addTask when the task can't be added; never a valid task id
+
+// capacity planning (see planCapacity)
+// LSS_PLAN_FLICKER_CYCLE = cycle time above which solidly-lit LEDs may appear to flicker
+// LSS_PLAN_MAX_CYCLE = the longest cycle time the library allows (see setCycleTime)
+// LSS_PLAN_FLASH_ERROR = percent the actual flash rate may differ from the rate set before it is flagged
+// LSS_PLAN_HEAP_HEADER = bytes malloc adds to each block (2 on AVR)
+#define LSS_PLAN_FLICKER_CYCLE 8000
+#define LSS_PLAN_MAX_CYCLE 20000
+#define LSS_PLAN_FLASH_ERROR 10
+#define LSS_PLAN_HEAP_HEADER 2
+
+// capacity warnings (signalPlan.warnings), any combination of
+#define LSS_PLAN_OK 0x00		// nothing to worry about
+#define LSS_PLAN_FLICKER 0x01	// cycle is over LSS_PLAN_FLICKER_CYCLE
+#define LSS_PLAN_STRETCHED 0x02	// LEDs are down to LSS_LED_MIN and the cycle is longer than the one asked for
+#define LSS_PLAN_OVERRUN 0x04	// LED time is under one trip around loop(), so slots (and flash timing) will run late
+#define LSS_PLAN_FLASH 0x08		// flash rate is off by more than LSS_PLAN_FLASH_ERROR, or too fast to ramp
+#define LSS_PLAN_TOO_LONG 0x10	// cycle is over LSS_PLAN_MAX_CYCLE
+
+// trace events (see setTrace), with the two byte arguments passed for each
+#define LSS_TRACE_PIN 1			// a LED pin changed: pin, new state (LSS_PIN_GROUND, LSS_PIN_HIGH or LSS_PIN_Z)
+#define LSS_TRACE_SLOT 2		// a LED's slot started: anode, cathode
+#define LSS_TRACE_DIV 3			// a ramp division started: division (0 - 9), 0
+#define LSS_TRACE_LAMPS 4		// lamps were lit or went dark: lamps now lit (all instances), 0
+
+// slot trace actions (LSS_USE_SLOT_TRACE), any combination of
+#define LSS_SLOT_CATHODE_OFF 0x01	// a cathode was turned off
+#define LSS_SLOT_ANODE_OFF 0x02		// an anode was turned off
+#define LSS_SLOT_ANODE_ON 0x04		// an anode was turned on
+#define LSS_SLOT_CATHODE_ON 0x08	// a cathode was turned on (lighting the LED)
+#define LSS_SLOT_NEW 0x10			// a new LED's slot started
+#define LSS_SLOT_PASS 0x20			// a new pass through the lit lamps started
+#define LSS_SLOT_DIV 0x40			// a new ramp division started
+#define LSS_SLOT_HALT 0x80			// the pin safety net halted the program
+
+// keyframe effects (LSS_USE_EFFECTS, see setEffect)
+// An effect is a table in PROGMEM of keyframes, two bytes each: a level (LSS_FX_OFF to LSS_FX_FULL)
+// and the number of steps to hold it, ending with LSS_FX_END. A step is 1/LSS_FX_STEPS of a ramp
+// division (25 ms at 60 FPM). The levels are those the ramp itself uses.
+#define LSS_FX_STEPS 4			// effect steps per ramp division
+#define LSS_FX_OFF 0			// dark
+#define LSS_FX_LOW 1			// lit one pass in 6 (the lowest level of the ramp)
+#define LSS_FX_QUARTER 2		// lit one pass in 4
+#define LSS_FX_HALF 3			// lit one pass in 2
+#define LSS_FX_FULL 4			// lit every pass
+#define LSS_FX_END 0, 0			// ends an effect's table (a keyframe of no steps)
+#define LSS_FX_RAMP 0xFF		// signalLamp.effect when no effect is playing, so the ramp decides
+#define LSS_FX_PASSES 12		// passes after which every level's pattern repeats
+
+// mixed yellows (LSS_USE_MIX, see setMix)
+#define LSS_MIX_EVEN 128		// the red half's share of the slot (in 256ths) until setMix changes it
+
+// lamp faults (getLampFault)
+#define LSS_FAULT_NONE 0		// no fault found (or the lamp can't be checked)
+#define LSS_FAULT_OPEN 1		// LED open (burned out, or a broken wire)
+#define LSS_FAULT_SHORT 2		// LED shorted (or wired across the resistor)
+
+// flash synchronization between Arduinos (see setSyncMaster and setSyncFollower)
+// LSS_SYNC_MAX_SLIP = largest correction a follower makes in one ramp cycle, as a fraction (1/N) of
+// the passes through the lit lamps. The flash rates of two Arduinos can differ by several percent 
+// (cycles per division are rounded to LSS_RAMP_CYCLES_STEP), so this must allow for more than that.
+// LSS_SYNC_TRIM = most a follower lengthens or shortens one LED slot, as a fraction (1/N) of the
+// slot, to make up the part of a pass that whole passes can't. A slot a quarter longer or shorter
+// now and then doesn't show.
+#define LSS_SYNC_NONE 0
+#define LSS_SYNC_MASTER 1
+#define LSS_SYNC_FOLLOWER 2
+#define LSS_SYNC_MAX_SLIP 8
+#define LSS_SYNC_TRIM 4
+
+// command opcodes for applyCommand (see also signalCommand.h)
+// Each takes byte arguments, in the order listed. Rates and times are sent high byte first.
+#define LSS_CMD_LAMP 1			// mast, head, lamp, lit, flashing
+#define LSS_CMD_HEAD 2			// mast, head, color, flashing
+#define LSS_CMD_LAMPCOLOR 3		// mast, head, lamp, color, flashing
+#define LSS_CMD_CLEAR 4			// mast, head
+#define LSS_CMD_ALTERNATE 5		// mast, head, lamp, alternate
+#define LSS_CMD_RAMP 6			// mast, head, lamp, ramp
+#define LSS_CMD_RATE 7			// flash rate (high, low)
+#define LSS_CMD_CYCLE 8			// cycle time (high, low)
+#define LSS_CMD_MAX_ARGS 5		// most arguments taken by any command
+
+// recorded calls (LSS_USE_RECORD, see startRecord): each is the milliseconds since the one before
+// (high byte first), the LSS_CMD_ operation, the number of arguments, then the arguments
+#define LSS_RECORD_HEADER 4		// bytes before the arguments
+#define LSS_RECORD_WAIT 0		// an operation that does nothing, filling a gap of over 65535 milliseconds
+
+// the command queue (LSS_USE_QUEUE) is shared without locks: queueCommand only moves the head,
+// updateSignals only the tail. The barrier keeps an entry's bytes in memory before the index
+// that hands it over (and in the right order on boards with two cores).
+#if defined(__AVR__)
+#define LSS_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+#else
+#define LSS_BARRIER() __sync_synchronize()
+#endif
+
+// compact layouts for addLamps: one record per lamp of mast, head, lamp, anode, cathode, color
+// add LSS_LAYOUT_NORAMP to the anode for a lamp that doesn't ramp (as for setRamp false)
+#define LSS_LAYOUT_RECORD 6
+#define LSS_LAYOUT_NORAMP 0x80
+
+// saved lamp state for getState/setState: one record per lit lamp of mast, head, lamp, flags
+#define LSS_STATE_RECORD 4
+#define LSS_STATE_FLASH 0x01	// flags: lamp is flashing
+#define LSS_STATE_ALT 0x02		// flags: lamp flashes on the alternate half of the cycle
+
 // pin state (LOW, HIGH, Z)
 #define LSS_PIN_GROUND 0
 #define LSS_PIN_HIGH 1
@@ -110,6 +352,8 @@
 #define LSS_REDGREENYELLOW 199	// bi-color LED that can be yellow with alternating voltage
 
 #define LSS_NOT_PIN 255	// used to indicate that a pin is not valid
+#define LSS_PIN_LIMIT 70	// LEDs can be on pins 0 up to this (not included), as on a Mega (see goodPin)
+#define LSS_PIN_BYTES ((LSS_PIN_LIMIT + 7) / 8)	// one bit for each of those pins
 #define LSS_NULL_SIG 0	// the mast, head and lamp values for the null signal (code assumes 0)
 
 // the following ramp-related defines can not be changed without modifying code
@@ -120,6 +364,10 @@
 // number of divisions for ramping LED intensity (0 - (N-1))
 #define LSS_NUM_DIV 10
 
+// passes through the lit lamps in one pattern (LSS_USE_PATTERN): the ramp lights a lamp on every
+// 2nd, 4th or 6th pass, so every division repeats itself each 12 passes
+#define LSS_PATTERN_PASSES 12
+
 // Identify the ramp divisions where things have to happen
 // assumes LSS_NUM_DIV of 10, with a 3-up, 3-lit, 3-down, 1-dark 0-9 progression
 // the "ALT" versions are for alternating flashers and are a half-cycle offset
@@ -135,7 +383,8 @@
 // store booleans as packed bits in a byte to reduce memory per lamp
 //
 // Note: ISLIT is set for any illuminated lamp, including those starting and stopping.
-// _lampFlags is a byte - extend if more bits needed
+// _lampFlags is a byte - extend if more bits needed (with LSS_USE_BITPLANES, each new bit
+// also adds a plane of LSS_PLANE_BYTES)
 
 #define LSS_SL_ISLIT 0			// 0 = set (true) if lamp lit or in a ramping state (isOn) - lamps w/o this set are ignored
 #define LSS_SL_ISFLASH 1		// 1 = set (true) if lamp flashing (isFlashing)
@@ -144,14 +393,23 @@
 #define LSS_SL_STOP 4			// 4 = set (true) if lamp was just turned off and is darkening (not used when flashing)
 #define LSS_SL_RAMP 5			// 5 = set (true) if lamp does not use the ramp-up/ramp-down and instead goes fully it/dark with no delay
 #define LSS_SL_DELAY 6			// 6 = set (true) if we are holding a pending "turn on" or "turn off" action until the next cycle
-#define LSS_SL_MAX 6			// highest valid value
+#define LSS_SL_APPROACH 7		// 7 = set (true) if lamp is held dark because its mast is approach lit and nothing is approaching
+#if defined(LSS_USE_LED_DIAG)
+#define LSS_SL_OPEN 8			// 8 = set (true) if the LED was found to be open (LSS_USE_LED_DIAG only)
+#define LSS_SL_SHORT 9			// 9 = set (true) if the LED was found to be shorted (LSS_USE_LED_DIAG only)
+#define LSS_SL_MAX 9			// highest valid value
+#else
+#define LSS_SL_MAX 7			// highest valid value
+#endif
 #define LSS_SL_IGNORE (LSS_SL_MAX+1)	// special value to be ignored
 
 // signalLamp
 // Describes the characteristics of one LED.
 //
 // These are dynamically allocated for each LED and occupy 12 bytes each.
-// A typical 3-head, 9-light mast thus requires 9x12=108 bytes of SRAM.
+// A typical 3-head, 9-light mast thus requires 9x12=108 bytes of SRAM. With LSS_USE_BITPLANES
+// they come from a pool instead, with the flags in the planes: 8 bytes each, plus one bit per
+// flag (9 bytes for the mast).
 //
 // The signalLamp class is used internal to linesideSignal, do not attempt to manipulate directly.
 //
@@ -163,13 +421,27 @@ class signalLamp
 	// See definition of LSS_SL_ constants above for bit use.
 	
 	public:
+#if defined(LSS_USE_BITPLANES)
+	static byte _flagPlanes[LSS_SL_MAX + 1][LSS_PLANE_BYTES];	// one bit per lamp for each flag (shared by all instances)
+	static byte _lampTotal;	// lamps taken from the pool so far (all instances)
+	static signalLamp _lampPool[LSS_MAX_LAMPS + 1];	// the lamps, with the end-of-list lamp last
+	byte index();	// this lamp's bit in the flag planes (its place in the pool)
+#else
 	int _lampFlags; // make this an int to avoid memory overwrite problems when using byte
+#endif
 	byte mastNum;	// the ordinal of the signal 
 	byte headNum;	// the head (collection of lamps) within the mast (number is relative to mast)
 	byte lampNum;	// ordinal of this lamp on the head (number is relative to head)
 	byte color;		// lamp color
 	byte anode;		// voltage source pin wired to LED anode
 	byte cathode;	// ground (enable) pin wired to LED cathode
+#if defined(LSS_USE_EFFECTS)
+	byte effect;	// level of the effect playing (LSS_FX_OFF - LSS_FX_FULL), or LSS_FX_RAMP for none
+#endif
+#if defined(LSS_USE_MIX)
+	byte mix;		// the red half of a mixed yellow: its share of the slot in 256ths (0 for the green half)
+	signalLamp *mixLamp;	// the other half of a mixed yellow, or NULL
+#endif
 
     // functions to manipulate the bit vector
     void setBitFlag(int flag, boolean flagVal);
@@ -182,10 +454,137 @@ class signalLamp
 	boolean isStop();
 	boolean usesRamp();
 	boolean onHold();
+	boolean isShown();
 	
 	signalLamp *nextLamp; // linked list pointer to next, or NULL
 }; // signalLamp
 
+// signalApproach
+// Describes one occupancy input used to light a mast (see addApproach).
+//
+// These are dynamically allocated by addApproach, as lamps are.
+//
+// The signalApproach class is used internal to linesideSignal, do not attempt to manipulate directly.
+//
+class signalApproach
+{
+	public:
+	byte pin;			// occupancy input (INPUT_PULLUP, occupied when LOW)
+	byte mastNum;		// the mast lit while this input is occupied
+	byte count;			// debounce count: 0 = clear, up to LSS_APPROACH_DEBOUNCE = occupied
+	boolean occupied;	// debounced state of the input
+	boolean active;		// occupied, or cleared less than LSS_APPROACH_HOLD ago
+	byte sampleTime;	// low byte of millis() when the input was last read
+	long clearTime;		// millis() when the input last cleared
+#if defined(LSS_DEBUG_REPORTING)
+	long detectTime;	// micros() of the first read that found the input occupied
+#endif
+	
+	signalApproach *nextApproach; // linked list pointer to next, or NULL
+}; // signalApproach
+
+// signalTask
+// Describes one task run by updateSignals (see addTask).
+//
+// These are dynamically allocated by addTask, as lamps are, and reused once a task is done.
+//
+// The signalTask class is used internal to linesideSignal, do not attempt to manipulate directly.
+//
+class signalTask
+{
+	public:
+	void (*run)();		// the function to call, or NULL if this entry is free
+	byte id;			// the id returned by addTask
+	boolean repeat;		// true for a periodic task, false to run once
+	boolean waited;		// a wait for slack has been counted since it was last due
+	long interval;		// milliseconds between runs (or until the run, for a one-shot task)
+	long due;			// millis() when it is next due
+	int cost;			// microseconds the task is declared to take (at most)
+	
+	signalTask *nextTask; // linked list pointer to next, or NULL
+}; // signalTask
+
+// signalPlan
+// What the library will do with a given layout on a given board (see planCapacity).
+// All times are in microseconds.
+//
+class signalPlan
+{
+	public:
+	long cycleTime;		// one pass through all the lit LEDs
+	long pulseTime;		// time each LED is lit in each pass
+	int duty;			// share of the time each lit LED is on, in tenths of a percent
+	int refresh;		// passes per second (Hz), i.e. how often each LED is lit
+	int passesPerDiv;	// passes in each ramp division (0 if the flash is too fast to ramp)
+	long flashPeriod;	// the actual length of one flash
+	int flashError;		// flashPeriod less the period asked for, in tenths of a percent (+ = slow)
+	int sram;			// bytes of SRAM taken by the instance and its lamps
+	byte warnings;		// LSS_PLAN_ bits, or LSS_PLAN_OK
+}; // signalPlan
+
+// signalSlot
+// One entry in the slot trace (LSS_USE_SLOT_TRACE).
+//
+// The signalSlot class is used internal to linesideSignal, do not attempt to manipulate directly.
+//
+class signalSlot
+{
+	public:
+	unsigned int delta;	// microseconds since the previous entry (at most 65535)
+	byte anode;			// the current LED
+	byte cathode;
+	byte actions;		// LSS_SLOT_ bits
+}; // signalSlot
+
+// signalPatternSlot
+// One LED slot of a pattern (LSS_USE_PATTERN).
+//
+// The signalPatternSlot class is used internal to linesideSignal, do not attempt to manipulate directly.
+//
+class signalPatternSlot
+{
+	public:
+	byte anode;		// the LED for the slot (LSS_NOT_PIN for a dark slot with no lamp)
+	byte cathode;
+	boolean lit;	// true if it is lit in this slot (the ramp leaves some dark)
+}; // signalPatternSlot
+
+// signalEffect
+// The effects given to one lamp (LSS_USE_EFFECTS, see setEffect), and the one playing.
+//
+// These are dynamically allocated by setEffect, as lamps are.
+//
+// The signalEffect class is used internal to linesideSignal, do not attempt to manipulate directly.
+//
+class signalEffect
+{
+	public:
+	signalLamp *lamp;		// the lamp it plays on
+	const byte *rise;		// keyframes played as the lamp lights (PROGMEM), or NULL for the ramp
+	const byte *fall;		// keyframes played as the lamp goes out (PROGMEM), or NULL for the ramp
+	const byte *frame;		// the keyframe playing, or NULL when neither is
+	byte steps;				// steps left in that keyframe
+	byte rampLevel;			// the ramp's level for the lamp in the last division (LSS_FX_OFF - LSS_FX_FULL)
+	
+	signalEffect *nextEffect; // linked list pointer to next, or NULL
+}; // signalEffect
+
+// signalQueueEntry
+// One command waiting in the queue (LSS_USE_QUEUE, see queueCommand).
+//
+// The signalQueueEntry class is used internal to linesideSignal, do not attempt to manipulate directly.
+//
+class signalQueueEntry
+{
+	public:
+	byte op;						// LSS_CMD_ operation
+	byte count;						// number of arguments
+	byte args[LSS_CMD_MAX_ARGS];	// and the arguments, as for applyCommand
+#if defined(LSS_DEBUG_REPORTING)
+	long stamp;						// micros() when it was queued
+#endif
+}; // signalQueueEntry
+
 class linesideSignal
 {
   private:
@@ -194,6 +593,9 @@ class linesideSignal
     long _lightExpirationTime;	// absolute microsecond timestamp for expiration of light activation timer
 
     signalLamp *_lampList;		// the list of LEDs
+#if defined(LSS_USE_BITPLANES)
+    byte _ownLamps[LSS_PLANE_BYTES];	// bits in the flag planes of our own lamps
+#endif
     
     long _cycleTime;			// microseconds to cycle through all lit LEDs (can we make this an int?)
     int _targetCycleTime;		// the user-set cycle time for deferred application, or 0 for none
@@ -207,6 +609,7 @@ class linesideSignal
     byte _rampDiv;				// current division of the ramp cycle for flashing lamps
     
     signalLamp *_currentLED;	// The LED being processed at this time
+    boolean _litChanged;		// set when a lamp is lit or goes dark, so the list is re-ordered on the next pass
     
     boolean _setupIsDone;
     boolean _suppressLEDs;		// internal flag used for debugging
@@ -215,14 +618,152 @@ class linesideSignal
     boolean _killAnode;			// ensure the anode if off if we are not using  it
     boolean _anodeOn;			// true if we have a powered Anode
     boolean _cathodeOn;			// true if we have a powered Cathode
-    int _anodeCount;			// safety-net: count active anodes, must be 0 or 1
-    int _cathodeCount;			// safety-net: count active cathodes, must be 0 or 1
+    static int _anodeCount;		// safety-net: count active anodes, must be 0 or 1 (shared by all instances)
+    static int _cathodeCount;	// safety-net: count active cathodes, must be 0 or 1 (shared by all instances)
+    static byte _pinsToDrain[LSS_PIN_BYTES];	// pins of new lamps still to be discharged, one bit per pin (see goodPin)
+    static boolean _drainPending;	// true if any bit is set in _pinsToDrain
+    static boolean _draining;		// the pins in _pinsToDrain are grounded, until _drainUntil
+    static long _drainUntil;		// _millis() when they may be released
+    static boolean _signalsRunning;	// updateSignals has been called (setup is over)
+    static boolean _timingStale;	// the number of lit lamps (or the cycle time) changed since the last re-time
+#if defined(LSS_USE_SLOT_TRACE)
+    static signalSlot _slotTrace[LSS_SLOT_ENTRIES];	// the last slots (shared by all instances)
+    static byte _slotNext;			// the entry to write next (the oldest, once it has wrapped)
+    static boolean _slotWrapped;	// true once every entry has been written
+    static byte _slotActions;		// LSS_SLOT_ bits for the entry being built
+    static long _slotStamp;			// micros() of the last entry
+#endif
+    
+    // shared scheduler - instances take turns, one pass through their lit lamps each
+    static linesideSignal *_signalList;		// every instance that has been set up, in setup order
+    static linesideSignal *_activeSignal;	// the instance whose turn it is to use the LED pins
+    linesideSignal *_nextSignal;	// linked list pointer to the next instance, or NULL
+    boolean _resumeTurn;		// true when we were just handed the pins and have not yet lit a lamp
         
     long _pulseTimePerLED;		// time to leave the LED lit (in usec)
 	long _lastLoopTime;	// time between calls to updateSignals (including time spent in that function)
     
     // used in loop() processing of flashing lamps
     long _flashHalfInterval;	// microseconds during which a flashing lamp is lit (where we store the flash rate)
+    
+    // flash synchronization with other Arduinos
+    byte _syncMode;				// LSS_SYNC_NONE, LSS_SYNC_MASTER or LSS_SYNC_FOLLOWER
+    byte _syncPin;				// pin used for the sync signal, or LSS_NOT_PIN
+    boolean _syncLevel;			// last state of the sync pin (read or written)
+    boolean _syncFlag;			// set at each ramp-cycle boundary, cleared by syncBoundary()
+    long _syncStamp;			// absolute microsecond time of our last ramp-cycle boundary (0 = none yet)
+    long _syncEdgeStamp;		// absolute microsecond time of the master's last ramp-cycle boundary (0 = none yet)
+    long _syncPeriod;			// measured microseconds between the master's ramp-cycle boundaries
+    boolean _syncBehind;		// the master's boundary came first, ours is due shortly (see syncEdge)
+    long _syncFreq;				// learned rate difference from the master, microseconds per ramp cycle
+    int _syncSlip;				// passes still to repeat (positive) or skip (negative) to match the master
+    long _syncTrim;				// microseconds still to add to (positive) or take from the LED slots, for the part of a pass left
+    
+    // approach lighting
+    signalApproach *_approachList;	// occupancy inputs, or NULL if no masts are approach lit
+    signalApproach *_nextApproach;	// the input to read next
+    
+    void (*_trace)(byte event, byte arg1, byte arg2);	// called for each trace event, or NULL (see setTrace)
+    
+    // timebase
+    unsigned long (*_clock)();	// the microsecond clock (see setClock)
+    long _updateStamp;			// the clock when the slot was last updated (the timer is checked against this)
+    boolean _ownClock;			// setClock gave a clock, and the longer timers count milliseconds from it too
+    unsigned long _clockMillis;	// the milliseconds counted from it
+    unsigned long _clockLast;	// its reading when they were last counted
+    unsigned int _clockCarry;	// and the microseconds left over
+#if defined(LSS_USE_TIMER1)
+    static uint16_t _timer1Count;		// Timer1 count when last read
+    static byte _timer1Odd;				// counts left over from the last read (less than a microsecond)
+    static unsigned long _timer1Micros;	// the clock built from Timer1
+#endif
+    
+#if defined(LSS_USE_EFFECTS)
+    // keyframe effects
+    signalEffect *_effectList;	// lamps given effects by setEffect, or NULL
+    boolean _effectDue;			// a step has passed, play the next one (see stepEffects)
+    byte _effectDiv;			// the ramp division stepEffects last saw
+    static const unsigned int _levelMasks[LSS_FX_FULL + 1];	// passes lit at each level, one bit per pass (PROGMEM)
+#endif
+    
+#if defined(LSS_USE_MIX)
+    byte _mixPairs;				// mixed yellows found by addLamp
+#endif
+    
+#if defined(LSS_USE_QUEUE)
+    // commands queued from interrupts
+    signalQueueEntry _queue[LSS_QUEUE_ENTRIES];	// the commands, used round and round
+    volatile byte _queueHead;	// count of commands put in the queue (only queueCommand changes this)
+    volatile byte _queueTail;	// count of commands taken out (only drainQueue changes this)
+#endif
+    
+#if defined(LSS_USE_SNAPSHOT)
+    // the lit lamps, for readState
+    byte _snapshot[2][LSS_SNAPSHOT_BYTES];	// two copies: one to read, the other being made
+    byte _snapshotLen[2];		// bytes in each
+    volatile byte _snapshotSeq;	// copies made so far (the low bit is the one to read)
+    boolean _snapshotDue;		// lamps may have changed, make a new copy in the next slack time
+#endif
+    
+#if defined(LSS_USE_RECORD)
+    // record and replay
+    byte *_recordBuf;			// where calls are being recorded (see startRecord), or NULL
+    int _recordSize;			// room there
+    int _recordLen;				// bytes recorded so far
+    long _recordStamp;			// _millis() at the last one
+    const byte *_replayLog;		// the calls being replayed (see replay), or NULL
+    int _replayLen;				// bytes of them
+    int _replayPos;				// where the next one starts
+    long _replayDue;			// _millis() when it is due
+    boolean _replaying;			// a recorded call is being carried out, so isn't recorded again
+#endif
+    
+    // tasks run in slack time
+    signalTask *_taskList;		// tasks added by addTask, or NULL
+    signalTask *_nextTask;		// where to start looking for a task to run
+    byte _lastTaskId;			// id given to the last task added
+    unsigned int _taskOverruns;	// runs that took longer than the task's declared cost
+    unsigned int _taskLate;		// runs that overran far enough to make a LED slot late
+    unsigned int _taskWaits;	// times a due task had to wait for enough slack
+    long _maxTaskDelay;			// longest time (ms) from a task being due to it running
+    
+#if defined(LSS_USE_LED_DIAG)
+    // LED diagnostics
+    signalLamp *_diagLamp;		// the lamp being checked, or NULL to find one
+    byte _diagCount;			// samples taken of it so far
+    byte _diagOpen;				// how many of those read as open
+    byte _diagShort;			// and how many as shorted
+    long _diagTime;				// millis() of the last sample
+    byte _diagPin;				// the cathode being read, left floating until diagFinish, or LSS_NOT_PIN
+    long _diagStamp;			// micros() when it was let go
+#if !(defined(ADCSRA) && defined(ADSC))
+    int _diagReading;			// the reading, on boards where the conversion isn't started directly
+#endif
+#endif
+    
+#if defined(LSS_USE_PATTERN)
+    // interrupt-driven output
+    signalPatternSlot _pattern[2][LSS_PATTERN_PASSES * LSS_PATTERN_LAMPS];	// the pattern being played, and the next
+    byte _patternLamps[2];			// slots in each pass of each pattern (0 = nothing rendered)
+    int _patternTicks[2];			// calls to playPattern per slot, for each pattern
+    volatile byte _patternFront;	// the pattern being played
+    volatile boolean _patternSwap;	// the other pattern is ready, play it from the next pass
+    volatile byte _patternPass;		// the pass being played (0 - LSS_PATTERN_PASSES-1)
+    volatile byte _patternSlot;		// the slot being played in that pass
+    volatile int _patternTick;		// calls to playPattern left in that slot
+    volatile int _patternPasses;	// passes played but not yet counted by updateSignals
+    byte _playAnode;				// pins of the slot being played
+    byte _playCathode;
+    int _patternTime;				// microseconds between calls to playPattern, or 0 when not in use
+    boolean _patternStale;			// the pattern has to be worked out again
+#endif
+    
+#if defined(LSS_DEBUG_VERIFY)
+    // slot checks
+    long _verifySlots;				// updates checked (each call to updateSignals, not just each new LED)
+    unsigned int _verifyPinErrors;	// slots with a LED lit that shouldn't be (or not lit that should be)
+    unsigned int _verifyTrips;		// times the pin safety net found more than one pin on (or fewer than none)
+#endif
 	    
 #if defined(LSS_DEBUG_REPORTING)
     // used to record times for reporting
@@ -234,30 +775,104 @@ class linesideSignal
     long _minBankTime;		// maximum time spent in core portion of updateSignals (cleared when reported)
     long _maxCycleTime;
     long _minCycleTime;
+    int _pinTransitions;	// pin mode changes so far in the current pass through the lit lamps
+    int _cycleTransitions;	// pin mode changes in the last complete pass (reported by printTimes)
+    long _approachStamp;	// micros() when the mast now being lit was detected, or 0 for none
+    byte _approachMast;		// the mast now being lit
+    long _approachLatency;	// microseconds from detection to the first lamp lit, for the last approach
+    long _maxApproachLatency;	// longest of those (cleared when reported)
+#if defined(LSS_USE_QUEUE)
+    long _queueLatency;		// microseconds from queueCommand to the command being carried out, for the last one
+    long _maxQueueLatency;	// longest of those (cleared when reported)
+#endif
 #endif
     
     // internal functions
     void _lightTimerStart(long usec, long startTime);
     boolean _lightTimerExpired();
+    boolean _slotSlack(long cost);
+    long _now();
+    long _millis();
+#if defined(LSS_USE_TIMER1)
+    static unsigned long _timer1Clock();
+#endif
     void _dropDead();
     void _addLamp(byte mastOrd, byte headOrd, byte lampOrd, byte anode, byte cathode, byte colorVal);
     boolean _getNextLamp(boolean &newCycle);
+    void _sortLamps();
     void _setFlashRate(int rate);
     int _getFlashRate();
     void _resetCycleTime();
     void _adjCycleTime();
+    void _governCycle();
+    void _retime(int numLamps);
+    static long _pulseFor(int cycle, int numLamps, int overhead);
+    static int _divPasses(int rate, long cycleTime);
     boolean _enabledLED();
+    boolean _lampEnabled(signalLamp *lamp, int cycleCount);
+    boolean _rampEnabled(signalLamp *lamp, int cycleCount);
     boolean _newRampState();
     void _advanceLamps(int toClear, boolean doAlt);
     boolean _anyLampsAre(int bitVec, int vecTwo, boolean useReverse, boolean reversed);
     int _litLampCount();
+    int _sharedLampCount();
+    boolean _passTurn(byte lastAnode, byte lastCathode);
+    void _drainPins();
+    void _groundPins();
+    void _releasePins();
+    boolean _drainSlack();
+    void _updateSlot();
     void _averageOverhead(int newVal);
     int _getOverhead();
     void _averageLoop(int newVal);
     int _getAverageLoop();
     void _advanceDivision();
+    void _syncCycleStart();
+    void _syncEdge(long stamp);
+    void _syncCorrect(long phase);
     void _releaseHold(int toClear, boolean doAlt);
     void _goDark(signalLamp *lamp);
+    void _clearHead(byte mastOrd, byte headOrd);
+    void _scanApproach(boolean slack);
+    boolean _mastApproached(byte mastOrd);
+    void _showMast(byte mastOrd, boolean show);
+    void _runTask(linesideSignal *sig);
+    void _slotWork(linesideSignal *sig);
+#if defined(LSS_USE_SLOT_TRACE)
+    void _recordSlot(long now);
+#endif
+#if defined(LSS_USE_PATTERN)
+    void _updatePattern();
+    void _renderPattern();
+#endif
+#if defined(LSS_USE_EFFECTS)
+    boolean _stepEffects();
+    byte _rampLevel(signalLamp *lamp);
+#endif
+#if defined(LSS_USE_QUEUE)
+    void _drainQueue(linesideSignal *sig);
+#endif
+#if defined(LSS_USE_SNAPSHOT)
+    void _publishState();
+#endif
+#if defined(LSS_USE_RECORD)
+    void _record(byte op, byte count, byte arg0, byte arg1 = 0, byte arg2 = 0, byte arg3 = 0, byte arg4 = 0);
+    void _replayNext();
+#endif
+#if defined(LSS_USE_MIX)
+    void _pairMix(signalLamp *lamp);
+    boolean _mixShown(signalLamp *lamp);
+    long _mixTime(signalLamp *lamp, long pulseTime);
+#endif
+#if defined(LSS_USE_LED_DIAG)
+    void _diagSample();
+    void _diagFinish();
+    void _diagNext();
+    boolean _analogPin(byte pin);
+#endif
+#if defined(LSS_DEBUG_VERIFY)
+    void _verifySlot(boolean LEDEnabled);
+#endif
     
     void _writeLEDPin(int pin, int state);
     void _setLEDMode(int pin, int mode);
@@ -277,6 +892,7 @@ class linesideSignal
 	linesideSignal(); // constructor
 	void setupSignal();
 	void addLamp(byte mastOrd, byte headOrd, byte lampOrd, byte anode, byte cathode, byte colorVal);
+	void addLamps(const byte *layout, int count);
 	void updateSignals();
 	void setLamp(byte mastOrd, byte headOrd, byte lampOrd, boolean lit, boolean flashing);
 	void setLamp(byte mastOrd, byte headOrd, byte lampOrd, boolean lit);
@@ -289,6 +905,37 @@ class linesideSignal
 	void setLampColor(byte mastOrd, byte headOrd, byte lampOrd, byte color);
 	void setAlternate(byte mastOrd, byte headOrd, byte lampOrd, boolean alternate);
 	void setRamp(byte mastOrd, byte headOrd, byte lampOrd, boolean ramp);
+	void addApproach(byte mastOrd, byte pin);
+	void setEffect(byte mastOrd, byte headOrd, byte lampOrd, const byte *rise, const byte *fall);
+	void setMix(byte mastOrd, byte headOrd, byte lampOrd, byte redPart, byte greenPart);
+	byte addTask(void (*task)(), long interval, int cost, boolean repeat);
+	byte addTask(void (*task)(), long interval, int cost);
+	void cancelTask(byte id);
+	unsigned int getTaskOverruns();
+	unsigned int getVerifyErrors();
+	void setTrace(void (*trace)(byte event, byte arg1, byte arg2));
+	void setClock(unsigned long (*clock)());
+	void dumpTrace();
+	void usePattern(int tick);
+	void playPattern();
+	void setSyncMaster(byte pin);
+	void setSyncFollower(byte pin);
+	void syncPulse();
+	boolean syncBoundary();
+	boolean applyCommand(byte op, const byte *args, byte count);
+	boolean queueCommand(byte op, const byte *args, byte count);
+	byte getHeadColor(byte mastOrd, byte headOrd);
+	boolean isLampLit(byte mastOrd, byte headOrd, byte lampOrd);
+	boolean isLampFlashing(byte mastOrd, byte headOrd, byte lampOrd);
+	byte getLampFault(byte mastOrd, byte headOrd, byte lampOrd);
+	static void planCapacity(signalPlan &plan, int lamps, int litLamps, int cycle, int rate, int overhead, int loopTime);
+	int getState(byte *buf, int size);
+	int readState(byte *buf, int size);
+	void startRecord(byte *buf, int size);
+	int stopRecord();
+	void replay(const byte *log, int len);
+	boolean isReplaying();
+	void setState(const byte *buf, int len);
 	
 	// debugging routines called externally - code is empty unless LSS_DEBUG_REPORTING is defined
 	// but calls are public so external code doesnt need to be modified when changing that flag in the library.
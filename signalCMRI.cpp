@@ -0,0 +1,294 @@
+/*  signalCMRI.cpp
+	Make an Arduino running linesideSignal a C/MRI node (e.g., for JMRI).
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    Released into the public domain.
+
+    The node looks like an SMINI to the host: define it in JMRI as an SMINI with the same node
+    address, on the serial port the Arduino is connected to. Output bits are mapped to lamps
+    (mapLamp) or head colors (mapHead), and input bits to pins (mapInput) or set by the sketch
+    (setInput).
+
+    Messages are framed as SYN SYN STX UA type data ETX, where UA is the node address plus
+    65 and any data byte that looks like STX, ETX or DLE is sent after a DLE. The host sends
+    I (initialize, ignored here as the size is fixed), T (transmit output bits) and P (poll),
+    and the node answers a poll with R (receive input bits).
+
+    Typical use:
+
+    	linesideSignal signals;
+    	signalCMRI cmri(signals, Serial, 0);
+
+    	void setup() {
+    		Serial.begin(19200);
+    		signals.setupSignal();
+    		... addLamp calls ...
+    		cmri.mapHead(0, 1, 1, LSS_GREEN); // output bits 0-2 are mast 1 head 1
+    		cmri.mapHead(1, 1, 1, LSS_YELLOW);
+    		cmri.mapHead(2, 1, 1, LSS_RED);
+    		cmri.mapInput(0, A0); // input bit 0 is the block detector on A0
+    	}
+
+    	void loop() {
+    		signals.updateSignals();
+    		cmri.update();
+    	}
+*/
+
+#include "Arduino.h"
+#include "signalCMRI.h"
+
+// class constructor - as with linesideSignal, don't touch the hardware here
+signalCMRI::signalCMRI(linesideSignal &signal, Stream &port, byte address)
+{
+	byte n;
+
+	_signal = &signal;
+	_port = &port;
+	_address = address;
+	_mapList = NULL;
+
+	_state = LSS_CMRI_WAIT;
+	_escape = false;
+	_forUs = false;
+	_type = 0;
+	_count = 0;
+
+	for (n = 0; n < LSS_CMRI_OUT_BYTES; n++) {
+		_outBuf[n] = 0;
+		_outBits[n] = 0;
+		_outDone[n] = 0;
+	}
+	for (n = 0; n < LSS_CMRI_IN_BYTES; n++) _inBits[n] = 0;
+	for (n = 0; n < (LSS_CMRI_IN_BYTES * 8); n++) _inPins[n] = LSS_NOT_PIN;
+	_nextIn = 0;
+	_nextOut = 0;
+} // constructor
+
+// mapLamp
+//
+// Light a lamp while an output bit is set.
+void signalCMRI::mapLamp(byte outBit, byte mastOrd, byte headOrd, byte lampOrd)
+{
+	_addMap(outBit, LSS_CMRI_LAMP, mastOrd, headOrd, lampOrd);
+} // mapLamp
+
+// mapHead
+//
+// Show a color on a head while an output bit is set. Map one bit for each color the head
+// can show; when the bit for the color being shown is cleared, the head goes dark.
+void signalCMRI::mapHead(byte outBit, byte mastOrd, byte headOrd, byte color)
+{
+	if (color > LSS_LAST_FOR_SETCOLOR) return; // bad color value, ignore it
+
+	_addMap(outBit, LSS_CMRI_HEAD, mastOrd, headOrd, color);
+} // mapHead
+
+// addMap
+//
+// Put a new output bit on the list (at the front, as for lamps).
+void signalCMRI::_addMap(byte outBit, byte mapType, byte mastOrd, byte headOrd, byte lampOrd)
+{
+	signalCMRIMap *map;
+
+	if (outBit >= (LSS_CMRI_OUT_BYTES * 8)) return; // no such bit
+
+	map = new signalCMRIMap;
+	map->outBit = outBit;
+	map->mapType = mapType;
+	map->mastNum = mastOrd;
+	map->headNum = headOrd;
+	map->lampNum = lampOrd;
+
+	map->nextMap = _mapList;
+	_mapList = map;
+} // addMap
+
+// mapInput
+//
+// Report a pin as an input bit. The pin is set to INPUT_PULLUP and reported as 1 when it is
+// pulled LOW, as most block detectors and switches do.
+void signalCMRI::mapInput(byte inBit, byte pin)
+{
+	if (inBit >= (LSS_CMRI_IN_BYTES * 8)) return; // no such bit
+
+	_inPins[inBit] = pin;
+	pinMode(pin, INPUT_PULLUP);
+} // mapInput
+
+// setInput
+//
+// Set an input bit from the sketch (for bits without a pin).
+void signalCMRI::setInput(byte inBit, boolean value)
+{
+	if (inBit >= (LSS_CMRI_IN_BYTES * 8)) return; // no such bit
+
+	if (value) {
+		_inBits[inBit >> 3] |= (1 << (inBit & 7));
+	} else {
+		_inBits[inBit >> 3] &= ~(1 << (inBit & 7));
+	}
+} // setInput
+
+// update
+//
+// Call from loop(). Reads a few bytes from the port, reads one input pin and acts on at
+// most one changed output bit.
+void signalCMRI::update()
+{
+	byte n;
+
+	for (n = 0; n < LSS_CMRI_BYTES_PER_CALL; n++) {
+		if (_port->available() <= 0) break;
+		_byteIn(byte(_port->read()));
+	} // for
+
+	_scanInput();
+	_applyOutput();
+} // update
+
+// byteIn
+//
+// Parse one byte from the host.
+void signalCMRI::_byteIn(byte c)
+{
+	switch (_state) {
+		case LSS_CMRI_WAIT:
+			if (c == LSS_CMRI_SYN) _state = LSS_CMRI_SYNC;
+			break;
+		case LSS_CMRI_SYNC:
+			_state = (c == LSS_CMRI_SYN) ? LSS_CMRI_START : LSS_CMRI_WAIT;
+			break;
+		case LSS_CMRI_START:
+			if (c == LSS_CMRI_STX) {
+				_state = LSS_CMRI_UA;
+			} else if (c != LSS_CMRI_SYN) {
+				_state = LSS_CMRI_WAIT;
+			}
+			break;
+		case LSS_CMRI_UA:
+			_forUs = (c == (_address + LSS_CMRI_ADDR));
+			_state = LSS_CMRI_TYPE;
+			break;
+		case LSS_CMRI_TYPE:
+			_type = c;
+			_count = 0;
+			_escape = false;
+			_state = LSS_CMRI_DATA;
+			break;
+		case LSS_CMRI_DATA:
+			if (!_escape && (c == LSS_CMRI_DLE)) { // next byte is data, whatever it looks like
+				_escape = true;
+			} else if (!_escape && (c == LSS_CMRI_ETX)) {
+				_state = LSS_CMRI_WAIT;
+				if (_forUs) _endMessage();
+			} else {
+				_escape = false;
+				if (_forUs && (_type == 'T') && (_count < LSS_CMRI_OUT_BYTES)) _outBuf[_count] = c;
+				if (_count < 255) _count++;
+			}
+			break;
+		default:
+			_state = LSS_CMRI_WAIT;
+			break;
+	} // switch
+} // byteIn
+
+// endMessage
+//
+// A complete message for this node has arrived.
+void signalCMRI::_endMessage()
+{
+	byte n;
+
+	if (_type == 'P') {
+		_sendInputs();
+	} else if (_type == 'T') { // take the new outputs only once we know the message is complete
+		for (n = 0; (n < _count) && (n < LSS_CMRI_OUT_BYTES); n++) _outBits[n] = _outBuf[n];
+	}
+	// 'I' (initialize) needs nothing, as our size is fixed
+} // endMessage
+
+// sendInputs
+//
+// Answer a poll. This fits in the serial transmit buffer, so it doesn't wait.
+void signalCMRI::_sendInputs()
+{
+	byte n;
+
+	_port->write(byte(LSS_CMRI_SYN));
+	_port->write(byte(LSS_CMRI_SYN));
+	_port->write(byte(LSS_CMRI_STX));
+	_port->write(byte(_address + LSS_CMRI_ADDR));
+	_port->write(byte('R'));
+	for (n = 0; n < LSS_CMRI_IN_BYTES; n++) _sendByte(_inBits[n]);
+	_port->write(byte(LSS_CMRI_ETX));
+} // sendInputs
+
+// sendByte
+//
+// Send a data byte, escaping it if it looks like a control byte.
+void signalCMRI::_sendByte(byte c)
+{
+	if ((c == LSS_CMRI_STX) || (c == LSS_CMRI_ETX) || (c == LSS_CMRI_DLE)) _port->write(byte(LSS_CMRI_DLE));
+	_port->write(c);
+} // sendByte
+
+// scanInput
+//
+// Read the next input pin.
+void signalCMRI::_scanInput()
+{
+	byte pin;
+
+	pin = _inPins[_nextIn];
+	if (pin != LSS_NOT_PIN) setInput(_nextIn, (digitalRead(pin) == LOW));
+
+	if (++_nextIn >= (LSS_CMRI_IN_BYTES * 8)) _nextIn = 0;
+} // scanInput
+
+// applyOutput
+//
+// Look through the next byte of output bits for one that has changed, and act on it.
+void signalCMRI::_applyOutput()
+{
+	signalCMRIMap *map;
+	byte n;
+	byte outBit;
+	byte mask;
+	boolean isSet;
+
+	for (n = 0; n < 8; n++) {
+		outBit = _nextOut;
+		if (++_nextOut >= (LSS_CMRI_OUT_BYTES * 8)) _nextOut = 0;
+
+		mask = (1 << (outBit & 7));
+		if (((_outBits[outBit >> 3] ^ _outDone[outBit >> 3]) & mask) == 0) continue; // no change
+
+		isSet = ((_outBits[outBit >> 3] & mask) != 0);
+		_outDone[outBit >> 3] ^= mask;
+
+		map = _mapList;
+		while (map != NULL) {
+			if (map->outBit == outBit) {
+				if (map->mapType == LSS_CMRI_LAMP) {
+					if (isSet) {
+						_signal->setLamp(map->mastNum, map->headNum, map->lampNum, true);
+					} else {
+						_signal->setLampColor(map->mastNum, map->headNum, map->lampNum, LSS_DARK); // setLamp can't turn a lamp off
+					}
+				} else if (isSet) {
+					_signal->setHeadColor(map->mastNum, map->headNum, map->lampNum);
+				} else if (_signal->getHeadColor(map->mastNum, map->headNum) == map->lampNum) { // leave it if another bit has already changed it
+					_signal->clearHead(map->mastNum, map->headNum);
+				}
+			}
+			map = map->nextMap;  // advance
+		} // while
+
+		return; // one change per call
+	} // for
+} // applyOutput
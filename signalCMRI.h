@@ -0,0 +1,110 @@
+/*  signalCMRI.h
+	Make an Arduino running linesideSignal a C/MRI node (e.g., for JMRI).
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    Released into the public domain.
+*/
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+
+#ifndef	signalCMRI_h
+#define signalCMRI_h
+
+// node size, as an SMINI: 48 output bits (6 bytes) and 24 input bits (3 bytes)
+#define LSS_CMRI_OUT_BYTES 6
+#define LSS_CMRI_IN_BYTES 3
+
+// LSS_CMRI_BYTES_PER_CALL = most bytes taken from the port on each call to update
+// (a whole transmit packet for an SMINI is under 20 bytes)
+#define LSS_CMRI_BYTES_PER_CALL 8
+
+// protocol bytes
+#define LSS_CMRI_SYN 0xFF
+#define LSS_CMRI_STX 0x02
+#define LSS_CMRI_ETX 0x03
+#define LSS_CMRI_DLE 0x10
+#define LSS_CMRI_ADDR 65		// added to the node address on the wire
+
+// parser states
+#define LSS_CMRI_WAIT 0			// waiting for the first SYN
+#define LSS_CMRI_SYNC 1			// waiting for the second SYN
+#define LSS_CMRI_START 2		// waiting for STX (more SYNs are allowed)
+#define LSS_CMRI_UA 3			// waiting for the node address
+#define LSS_CMRI_TYPE 4			// waiting for the message type
+#define LSS_CMRI_DATA 5			// reading data up to ETX
+
+// what an output bit controls
+#define LSS_CMRI_LAMP 0			// lamp lit while the bit is set
+#define LSS_CMRI_HEAD 1			// head shows the color while the bit is set
+
+// signalCMRIMap
+// Connects one output bit to a lamp or a head color.
+//
+// These are dynamically allocated by mapLamp and mapHead, as lamps are.
+//
+// The signalCMRIMap class is used internal to signalCMRI, do not attempt to manipulate directly.
+//
+class signalCMRIMap
+{
+  public:
+	byte outBit;			// output bit number (0 - 47)
+	byte mapType;			// LSS_CMRI_LAMP or LSS_CMRI_HEAD
+	byte mastNum;
+	byte headNum;
+	byte lampNum;			// lamp (LSS_CMRI_LAMP) or color (LSS_CMRI_HEAD)
+
+	signalCMRIMap *nextMap;	// linked list pointer to next, or NULL
+}; // signalCMRIMap
+
+// signalCMRI
+// A C/MRI node that reads a few bytes per call, so polling never holds up an LED slot.
+//
+// Output bits from a transmit (T) message are compared with the last ones, and the changed
+// bits are acted on one per call to update. Input pins are read one per call to update,
+// so a poll (P) is answered with a receive (R) message straight away, from bits that are
+// never more than a few loops old.
+class signalCMRI
+{
+  private:
+	linesideSignal *_signal;	// where outputs are sent
+	Stream *_port;				// the C/MRI serial line
+	byte _address;				// our node address (0 - 127)
+	signalCMRIMap *_mapList;	// output bits we act on
+
+	byte _state;				// LSS_CMRI_ parser state
+	boolean _escape;			// last byte was DLE
+	boolean _forUs;				// message is addressed to this node
+	byte _type;					// message type
+	byte _count;				// data bytes read
+
+	byte _outBuf[LSS_CMRI_OUT_BYTES];	// output bits being read
+	byte _outBits[LSS_CMRI_OUT_BYTES];	// output bits last received
+	byte _outDone[LSS_CMRI_OUT_BYTES];	// output bits as last acted on
+	byte _inBits[LSS_CMRI_IN_BYTES];	// input bits to report
+	byte _inPins[LSS_CMRI_IN_BYTES * 8];	// pin for each input bit, or LSS_NOT_PIN
+	byte _nextIn;				// next input bit to read
+	byte _nextOut;				// next output bit to check for a change
+
+	void _byteIn(byte c);
+	void _endMessage();
+	void _sendInputs();
+	void _sendByte(byte c);
+	void _scanInput();
+	void _applyOutput();
+	void _addMap(byte outBit, byte mapType, byte mastOrd, byte headOrd, byte lampOrd);
+
+  public:
+	signalCMRI(linesideSignal &signal, Stream &port, byte address); // constructor
+	void mapLamp(byte outBit, byte mastOrd, byte headOrd, byte lampOrd);
+	void mapHead(byte outBit, byte mastOrd, byte headOrd, byte color);
+	void mapInput(byte inBit, byte pin);
+	void setInput(byte inBit, boolean value);
+	void update();
+
+}; // signalCMRI
+
+#endif
@@ -0,0 +1,270 @@
+/*  signalCommand.cpp
+	Accept commands for linesideSignal from a serial port (or any other Stream).
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    Released into the public domain.
+
+    Hand-written parsers in loop() tend to wait for a whole command (or worse, use
+    Serial.parseInt, which waits for a timeout), and while they wait the signal lamps are
+    not being updated. This one takes at most LSS_CMD_BYTES_PER_CALL bytes each time it is
+    called and remembers where it was, so it can be called every time through loop() along
+    with updateSignals. Anything not yet read stays in the port's receive buffer.
+
+    Typical use:
+
+    	linesideSignal signals;
+    	signalCommand commands(signals, Serial);
+
+    	void loop() {
+    		signals.updateSignals();
+    		commands.update();
+    	}
+*/
+
+#include "Arduino.h"
+#include "signalCommand.h"
+
+// class constructor - as with linesideSignal, don't touch the hardware here
+signalCommand::signalCommand(linesideSignal &signal, Stream &port)
+{
+	_signal = &signal;
+	_port = &port;
+	_state = LSS_CMD_IDLE;
+	_op = 0;
+	_count = 0;
+	_argNum = 0;
+	_check = 0;
+	_inNumber = false;
+} // constructor
+
+// update
+//
+// Call from loop(). Parses whatever has arrived, a few bytes at a time.
+void signalCommand::update()
+{
+	byte n;
+
+	for (n = 0; n < LSS_CMD_BYTES_PER_CALL; n++) {
+		if (_port->available() <= 0) return;
+		feed(byte(_port->read()));
+	} // for
+} // update
+
+// feed
+//
+// Parse one byte. This is what update does with each byte it reads, and can be used
+// directly to take commands from somewhere other than the port (replies still go to the port).
+void signalCommand::feed(byte c)
+{
+	switch (_state) {
+		case LSS_CMD_IDLE:
+			if (c == LSS_CMD_FRAME) {
+				_state = LSS_CMD_BIN_OP;
+			} else if ((c > ' ') && (c < 127)) { // ignore blank lines and stray control characters
+				_op = c;
+				_count = 0;
+				_inNumber = false;
+				_state = LSS_CMD_TEXT;
+			}
+			break;
+		case LSS_CMD_TEXT:
+			_textChar(c);
+			break;
+		case LSS_CMD_SKIP:
+			if ((c == '\r') || (c == '\n')) _state = LSS_CMD_IDLE;
+			break;
+		default:
+			_binaryByte(c);
+			break;
+	} // switch
+} // feed
+
+// textChar
+//
+// Handle one character of a text line after the command letter.
+void signalCommand::_textChar(byte c)
+{
+	if ((c >= '0') && (c <= '9')) {
+		if (!_inNumber) { // start a new number
+			if (_count >= LSS_CMD_LINE_MAX) { // too many
+				_port->println(F("E"));
+				_state = LSS_CMD_SKIP;
+				return;
+			}
+			_values[_count++] = 0;
+			_inNumber = true;
+		}
+		if (_values[_count - 1] >= 6553) { // would overflow
+			_port->println(F("E"));
+			_state = LSS_CMD_SKIP;
+			return;
+		}
+		_values[_count - 1] = (_values[_count - 1] * 10) + (c - '0');
+	} else if ((c == ' ') || (c == ',') || (c == '\t')) {
+		_inNumber = false;
+	} else if ((c == '\r') || (c == '\n')) {
+		_state = LSS_CMD_IDLE;
+		_textLine();
+	} else {
+		_port->println(F("E"));
+		_state = LSS_CMD_SKIP;
+	}
+} // textChar
+
+// textLine
+//
+// A complete text line has been read; convert it to a command and run it.
+void signalCommand::_textLine()
+{
+	byte need;	// numbers required
+	byte extra;	// optional numbers allowed (flashing)
+	byte n;
+	boolean wide = false; // single number that is too big for a byte
+
+	extra = 0;
+	switch (_op) {
+		case 'L': case 'l': _op = LSS_CMD_LAMP; need = 4; extra = 1; break;
+		case 'H': case 'h': _op = LSS_CMD_HEAD; need = 3; extra = 1; break;
+		case 'C': case 'c': _op = LSS_CMD_LAMPCOLOR; need = 4; extra = 1; break;
+		case 'D': case 'd': _op = LSS_CMD_CLEAR; need = 2; break;
+		case 'A': case 'a': _op = LSS_CMD_ALTERNATE; need = 4; break;
+		case 'R': case 'r': _op = LSS_CMD_RAMP; need = 4; break;
+		case 'F': case 'f': _op = LSS_CMD_RATE; need = 1; wide = true; break;
+		case 'T': case 't': _op = LSS_CMD_CYCLE; need = 1; wide = true; break;
+		case 'Q': case 'q': _op = LSS_CMD_QHEAD; need = 2; break;
+		case '?': _op = LSS_CMD_QLAMP; need = 3; break;
+		default:
+			_port->println(F("E"));
+			return;
+	} // switch
+
+	if ((_count < need) || (_count > (need + extra))) {
+		_port->println(F("E"));
+		return;
+	}
+
+	if (wide) { // rate and cycle time are sent high byte first
+		_args[0] = byte(_values[0] >> 8);
+		_args[1] = byte(_values[0] & 0xFF);
+		_count = 2;
+	} else {
+		for (n = 0; n < (need + extra); n++) {
+			if (n >= _count) {
+				_args[n] = 0; // optional flashing parameter defaults to false
+			} else if (_values[n] > 255) {
+				_port->println(F("E"));
+				return;
+			} else {
+				_args[n] = byte(_values[n]);
+			}
+		} // for
+		_count = need + extra;
+	}
+
+	if (!_runCommand(false)) _port->println(F("E"));
+} // textLine
+
+// binaryByte
+//
+// Handle one byte of a binary frame after the frame byte.
+void signalCommand::_binaryByte(byte c)
+{
+	switch (_state) {
+		case LSS_CMD_BIN_OP:
+			_op = c;
+			_check = c;
+			_state = LSS_CMD_BIN_COUNT;
+			break;
+		case LSS_CMD_BIN_COUNT:
+			if (c > LSS_CMD_MAX_ARGS) { // can't be right, so look for the next frame
+				_state = LSS_CMD_IDLE;
+				break;
+			}
+			_count = c;
+			_argNum = 0;
+			_check ^= c;
+			_state = (_count > 0) ? LSS_CMD_BIN_ARGS : LSS_CMD_BIN_CHECK;
+			break;
+		case LSS_CMD_BIN_ARGS:
+			_args[_argNum++] = c;
+			_check ^= c;
+			if (_argNum >= _count) _state = LSS_CMD_BIN_CHECK;
+			break;
+		case LSS_CMD_BIN_CHECK:
+			_state = LSS_CMD_IDLE;
+			if (c == _check) _runCommand(true); // a damaged frame is dropped without a reply
+			break;
+		default:
+			_state = LSS_CMD_IDLE;
+			break;
+	} // switch
+} // binaryByte
+
+// runCommand
+//
+// Run the command in _op/_args, answering queries in the same form they were asked.
+// Returns false if the command was not accepted.
+boolean signalCommand::_runCommand(boolean binary)
+{
+	byte reply[5];
+
+	if (_op == LSS_CMD_QHEAD) {
+		if (_count != 2) return(false);
+		reply[0] = _args[0];
+		reply[1] = _args[1];
+		reply[2] = _signal->getHeadColor(_args[0], _args[1]);
+		if (binary) {
+			_sendFrame(_op, reply, 3);
+		} else {
+			_port->print(F("H "));
+			_port->print(reply[0]); _port->print(' ');
+			_port->print(reply[1]); _port->print(' ');
+			_port->println(reply[2]);
+		}
+		return(true);
+	}
+
+	if (_op == LSS_CMD_QLAMP) {
+		if (_count != 3) return(false);
+		reply[0] = _args[0];
+		reply[1] = _args[1];
+		reply[2] = _args[2];
+		reply[3] = _signal->isLampLit(_args[0], _args[1], _args[2]);
+		reply[4] = _signal->isLampFlashing(_args[0], _args[1], _args[2]);
+		if (binary) {
+			_sendFrame(_op, reply, 5);
+		} else {
+			_port->print(F("L "));
+			_port->print(reply[0]); _port->print(' ');
+			_port->print(reply[1]); _port->print(' ');
+			_port->print(reply[2]); _port->print(' ');
+			_port->print(reply[3]); _port->print(' ');
+			_port->println(reply[4]);
+		}
+		return(true);
+	}
+
+	return(_signal->applyCommand(_op, _args, _count));
+} // runCommand
+
+// sendFrame
+//
+// Send a binary reply.
+void signalCommand::_sendFrame(byte op, const byte *args, byte count)
+{
+	byte check;
+	byte n;
+
+	check = op ^ count;
+	_port->write(byte(LSS_CMD_FRAME));
+	_port->write(op);
+	_port->write(count);
+	for (n = 0; n < count; n++) {
+		_port->write(args[n]);
+		check ^= args[n];
+	} // for
+	_port->write(check);
+} // sendFrame
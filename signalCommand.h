@@ -0,0 +1,85 @@
+/*  signalCommand.h
+	Accept commands for linesideSignal from a serial port (or any other Stream).
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    Released into the public domain.
+*/
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+
+#ifndef	signalCommand_h
+#define signalCommand_h
+
+// LSS_CMD_BYTES_PER_CALL = most bytes taken from the port on each call to update.
+// Bytes arriving faster than this wait in the port's own receive buffer, so keep it small
+// enough that update never delays an LED slot (a byte takes a few microseconds to parse).
+#define LSS_CMD_BYTES_PER_CALL 4
+
+// LSS_CMD_LINE_MAX = most numbers accepted on one text command line
+#define LSS_CMD_LINE_MAX 5
+
+// Binary commands are framed as: LSS_CMD_FRAME, op, count, count bytes of arguments, check
+// where check is the exclusive-or of op, count and the arguments. Replies to queries use
+// the same frame, with the query op. The frame byte can never start a text command.
+#define LSS_CMD_FRAME 0xA5
+
+// query opcodes (in addition to the LSS_CMD_ operations in linesideSignal.h)
+#define LSS_CMD_QHEAD 16		// mast, head - reply is mast, head, color
+#define LSS_CMD_QLAMP 17		// mast, head, lamp - reply is mast, head, lamp, lit, flashing
+
+// parser states
+#define LSS_CMD_IDLE 0			// waiting for the start of a command
+#define LSS_CMD_TEXT 1			// reading a text line
+#define LSS_CMD_SKIP 2			// discarding the rest of a bad text line
+#define LSS_CMD_BIN_OP 3		// binary frame, waiting for op
+#define LSS_CMD_BIN_COUNT 4		// binary frame, waiting for count
+#define LSS_CMD_BIN_ARGS 5		// binary frame, reading arguments
+#define LSS_CMD_BIN_CHECK 6		// binary frame, waiting for check byte
+
+// signalCommand
+// Reads commands a few bytes at a time and hands them to a linesideSignal.
+//
+// Text commands are a letter followed by numbers separated by spaces (or commas), ending with
+// a carriage return or line feed:
+//	L mast head lamp lit [flashing]		H mast head color [flashing]
+//	C mast head lamp color [flashing]	D mast head (dark)
+//	A mast head lamp alternate			R mast head lamp ramp
+//	F rate								T cycle time
+//	Q mast head (reply: H mast head color)
+//	? mast head lamp (reply: L mast head lamp lit flashing)
+// A bad line gets the reply "E".
+//
+// Nothing is allocated; the parser holds at most one command at a time.
+class signalCommand
+{
+  private:
+	linesideSignal *_signal;	// where commands are sent
+	Stream *_port;				// where they come from (and replies go)
+
+	byte _state;				// LSS_CMD_ parser state
+	byte _op;					// command being read
+	byte _count;				// number of arguments expected (binary) or read so far (text)
+	byte _argNum;				// binary argument being read
+	byte _check;				// running check byte (binary)
+	boolean _inNumber;			// true while reading digits (text)
+	unsigned int _values[LSS_CMD_LINE_MAX];	// numbers read from a text line
+	byte _args[LSS_CMD_MAX_ARGS];			// arguments for the command
+
+	void _textChar(byte c);
+	void _textLine();
+	void _binaryByte(byte c);
+	boolean _runCommand(boolean binary);
+	void _sendFrame(byte op, const byte *args, byte count);
+
+  public:
+	signalCommand(linesideSignal &signal, Stream &port); // constructor
+	void update();
+	void feed(byte c);
+
+}; // signalCommand
+
+#endif
@@ -0,0 +1,292 @@
+/*  signalDCC.cpp
+	Set linesideSignal aspects from DCC accessory commands.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    Released into the public domain.
+
+    The track signal (through an opto-isolator) goes to a pin that supports attachInterrupt
+    (2 or 3 on an Uno). The interrupt routine runs on every edge, a few microseconds at a
+    time, and does no more than classify the time since the last edge as half of a 1 or a 0
+    and assemble the bits into packets.
+
+    Basic accessory packets (10AAAAAA 1AAACDDD) set a head to one of two colors, depending
+    on the direction (closed or thrown). Extended accessory packets (10AAAAAA 0AAA0AA1
+    000XXXXX) are intended for signals: the aspect is the color to show (LSS_RED etc),
+    plus LSS_DCC_FLASH to flash it. Both use the output address as shown by JMRI and most
+    command stations (1 = first output of decoder board 1).
+
+    Typical use:
+
+    	linesideSignal signals;
+    	signalDCC dcc(signals);
+
+    	void setup() {
+    		signals.setupSignal();
+    		... addLamp calls ...
+    		dcc.setupDCC(2);
+    		dcc.addAspect(101, 1, 1); // mast 1 head 1 follows signal address 101
+    	}
+
+    	void loop() {
+    		signals.updateSignals();
+    		dcc.update();
+    	}
+*/
+
+#include "Arduino.h"
+#include "signalDCC.h"
+
+// shared by all instances of the class
+signalDCC *signalDCC::_decoder = NULL;
+
+// class constructor - as with linesideSignal, don't touch the hardware here
+signalDCC::signalDCC(linesideSignal &signal)
+{
+	_signal = &signal;
+	_mapList = NULL;
+	_pin = LSS_NOT_PIN;
+
+	_lastEdge = 0;
+	_halfBit = LSS_NOT_PIN;
+	_state = LSS_DCC_SEEK;
+	_ones = 0;
+	_bitCount = 0;
+	_byteCount = 0;
+
+	_queueHead = 0;
+	_queueTail = 0;
+} // constructor
+
+// setupDCC
+//
+// Start decoding DCC on the given pin. Call from setup().
+void signalDCC::setupDCC(byte pin)
+{
+	if (digitalPinToInterrupt(pin) < 0) return; // not an interrupt pin
+
+	_pin = pin;
+	_decoder = this;
+	pinMode(_pin, INPUT);
+	_lastEdge = micros();
+	attachInterrupt(digitalPinToInterrupt(_pin), _isr, CHANGE);
+} // setupDCC
+
+// addAccessory
+//
+// Set a head from a basic accessory (turnout) address: closedColor when closed, thrownColor
+// when thrown.
+void signalDCC::addAccessory(unsigned int address, byte mastOrd, byte headOrd, byte closedColor, byte thrownColor)
+{
+	if ((closedColor > LSS_LAST_FOR_SETCOLOR) || (thrownColor > LSS_LAST_FOR_SETCOLOR)) return; // bad color value, ignore it
+
+	_addMap(address, mastOrd, headOrd, closedColor, thrownColor);
+} // addAccessory
+
+// addAspect
+//
+// Set a head from an extended accessory (signal) address.
+void signalDCC::addAspect(unsigned int address, byte mastOrd, byte headOrd)
+{
+	_addMap(address, mastOrd, headOrd, LSS_NOT_PIN, LSS_NOT_PIN);
+} // addAspect
+
+// addMap
+//
+// Put a new address on the list (at the front, as for lamps).
+void signalDCC::_addMap(unsigned int address, byte mastOrd, byte headOrd, byte closedColor, byte thrownColor)
+{
+	signalDCCMap *map;
+
+	if ((address < 1) || (address > 2044)) return; // not an accessory output address
+
+	map = new signalDCCMap;
+	map->address = address;
+	map->mastNum = mastOrd;
+	map->headNum = headOrd;
+	map->closedColor = closedColor;
+	map->thrownColor = thrownColor;
+	map->lastAspect = LSS_NOT_PIN;
+
+	map->nextMap = _mapList;
+	_mapList = map;
+} // addMap
+
+// update
+//
+// Call from loop(). Acts on at most one packet from the queue.
+void signalDCC::update()
+{
+	byte tail;
+
+	tail = _queueTail;
+	if (tail == _queueHead) return; // nothing waiting
+
+	_packetIn(_queue[tail], _queueLen[tail]);
+
+	_queueTail = (tail + 1) & (LSS_DCC_QUEUE - 1); // only now is the slot free for the interrupt routine
+} // update
+
+// packetIn
+//
+// Decode a packet taken from the queue. Anything other than an accessory packet is ignored.
+void signalDCC::_packetIn(const byte *packet, byte len)
+{
+	unsigned int board;
+	unsigned int address;
+
+	if ((packet[0] & 0xC0) != 0x80) return; // not an accessory packet
+
+	board = (packet[0] & 0x3F) | (((~packet[1]) & 0x70) << 2);
+	if ((board == 0) || (board == 0x1FF)) return; // board 0 has no output address, 0x1FF is broadcast
+
+	address = ((board - 1) * 4) + ((packet[1] >> 1) & 0x03) + 1;
+
+	if ((len == 3) && (packet[1] & 0x80)) { // basic: 1AAACDDD
+		if (!(packet[1] & 0x08)) return; // deactivate - nothing to do for a signal
+		_setAspect(address, packet[1] & 0x01, false);
+	} else if ((len == 4) && ((packet[1] & 0x89) == 0x01)) { // extended: 0AAA0AA1 000XXXXX
+		_setAspect(address, packet[2] & 0x1F, true);
+	}
+} // packetIn
+
+// setAspect
+//
+// Set every head listening to the address. DCC repeats each packet several times, so only
+// act on a change, or the head would restart its ramp with every repeat.
+void signalDCC::_setAspect(unsigned int address, byte aspect, boolean extended)
+{
+	signalDCCMap *map;
+	byte color;
+
+	map = _mapList;
+	while (map != NULL) {
+		if ((map->address == address) && ((map->closedColor == LSS_NOT_PIN) == extended) && (map->lastAspect != aspect)) {
+			map->lastAspect = aspect;
+			if (extended) {
+				_signal->setHeadColor(map->mastNum, map->headNum, aspect & 0x0F, ((aspect & LSS_DCC_FLASH) != 0));
+			} else {
+				color = (aspect ? map->closedColor : map->thrownColor);
+				_signal->setHeadColor(map->mastNum, map->headNum, color);
+			}
+		}
+		map = map->nextMap;  // advance
+	} // while
+} // setAspect
+
+/************************ interrupt routines ******************************/
+
+// isr
+//
+// Called on every edge of the DCC signal.
+void signalDCC::_isr()
+{
+	if (_decoder != NULL) _decoder->_edge(micros());
+} // isr
+
+// edge
+//
+// Classify the time since the last edge. Two halves of the same kind make a bit; a half that
+// doesn't match the one before is taken as the first half of the next bit, which is how we
+// find the bit boundaries to start with.
+void signalDCC::_edge(unsigned long now)
+{
+	unsigned long width;
+	byte half;
+
+	width = now - _lastEdge;
+	_lastEdge = now;
+
+	if ((width >= LSS_DCC_ONE_MIN) && (width <= LSS_DCC_ONE_MAX)) {
+		half = 1;
+	} else if ((width >= LSS_DCC_ZERO_MIN) && (width <= LSS_DCC_ZERO_MAX)) {
+		half = 0;
+	} else { // noise, or a gap in the signal - start over
+		_halfBit = LSS_NOT_PIN;
+		_state = LSS_DCC_SEEK;
+		_ones = 0;
+		return;
+	}
+
+	if (_halfBit != half) { // first half of a bit
+		_halfBit = half;
+		return;
+	}
+
+	_halfBit = LSS_NOT_PIN;
+	_bit(half);
+} // edge
+
+// bit
+//
+// Assemble bits into a packet.
+void signalDCC::_bit(byte bitVal)
+{
+	switch (_state) {
+		case LSS_DCC_SEEK:
+			if (bitVal) {
+				if (_ones < 255) _ones++;
+			} else {
+				if (_ones >= LSS_DCC_PREAMBLE) { // this is the start bit of the first byte
+					_byteCount = 0;
+					_bitCount = 0;
+					_packet[0] = 0;
+					_state = LSS_DCC_DATA;
+				}
+				_ones = 0;
+			}
+			break;
+		case LSS_DCC_DATA:
+			_packet[_byteCount] = (_packet[_byteCount] << 1) | bitVal;
+			if (++_bitCount >= 8) {
+				_byteCount++;
+				_state = LSS_DCC_END;
+			}
+			break;
+		case LSS_DCC_END:
+			if (bitVal) { // end of packet (this 1 also counts toward the next preamble)
+				_endPacket();
+				_ones = 1;
+				_state = LSS_DCC_SEEK;
+			} else if (_byteCount >= LSS_DCC_MAX_BYTES) { // too long for us, so can't be an accessory packet
+				_ones = 0;
+				_state = LSS_DCC_SEEK;
+			} else { // this 0 is the start bit of another byte
+				_bitCount = 0;
+				_packet[_byteCount] = 0;
+				_state = LSS_DCC_DATA;
+			}
+			break;
+		default:
+			_state = LSS_DCC_SEEK;
+			break;
+	} // switch
+} // bit
+
+// endPacket
+//
+// Check a complete packet and put it on the queue (if there's room; if not it is dropped,
+// and as DCC repeats packets we'll most likely get another copy).
+void signalDCC::_endPacket()
+{
+	byte check = 0;
+	byte head;
+	byte next;
+	byte n;
+
+	if (_byteCount < 3) return; // too short for an accessory packet
+
+	for (n = 0; n < _byteCount; n++) check ^= _packet[n];
+	if (check != 0) return; // damaged
+
+	head = _queueHead;
+	next = (head + 1) & (LSS_DCC_QUEUE - 1);
+	if (next == _queueTail) return; // full
+
+	for (n = 0; n < _byteCount; n++) _queue[head][n] = _packet[n];
+	_queueLen[head] = _byteCount;
+
+	_queueHead = next; // only now can update see it
+} // endPacket
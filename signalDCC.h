@@ -0,0 +1,111 @@
+/*  signalDCC.h
+	Set linesideSignal aspects from DCC accessory commands.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    Released into the public domain.
+*/
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+
+#ifndef	signalDCC_h
+#define signalDCC_h
+
+// DCC half-bit timing in microseconds (NMRA S-9.1 decoder tolerances)
+#define LSS_DCC_ONE_MIN 52
+#define LSS_DCC_ONE_MAX 64
+#define LSS_DCC_ZERO_MIN 90
+#define LSS_DCC_ZERO_MAX 10000
+
+// LSS_DCC_PREAMBLE = one bits needed before a packet
+#define LSS_DCC_PREAMBLE 10
+
+// LSS_DCC_MAX_BYTES = longest packet kept (accessory packets are 3 or 4 bytes with the check byte)
+#define LSS_DCC_MAX_BYTES 6
+
+// LSS_DCC_QUEUE = packets waiting for update (must be a power of 2, at most 128). Packets arrive
+// about every 6 ms at most, and update takes one per call, so a few are plenty.
+#define LSS_DCC_QUEUE 8
+
+// Extended accessory (signal) aspects: the low 4 bits are the color to show, plus this to flash
+#define LSS_DCC_FLASH 0x10
+
+// decoder states (in the interrupt routine)
+#define LSS_DCC_SEEK 0			// counting preamble bits
+#define LSS_DCC_DATA 1			// reading the 8 bits of a byte
+#define LSS_DCC_END 2			// waiting for the bit after a byte (0 = another byte, 1 = start of the next preamble)
+
+// signalDCCMap
+// Connects one accessory address to one signal head.
+//
+// These are dynamically allocated by addAccessory and addAspect, as lamps are.
+//
+// The signalDCCMap class is used internal to signalDCC, do not attempt to manipulate directly.
+//
+class signalDCCMap
+{
+  public:
+	unsigned int address;	// accessory output address (1 - 2044)
+	byte mastNum;			// head to set
+	byte headNum;
+	byte closedColor;		// color for "closed" (basic accessory), or LSS_NOT_PIN for an extended address
+	byte thrownColor;		// color for "thrown" (basic accessory)
+	byte lastAspect;		// last aspect set, so repeated packets don't restart the ramp (LSS_NOT_PIN = none yet)
+
+	signalDCCMap *nextMap;	// linked list pointer to next, or NULL
+}; // signalDCCMap
+
+// signalDCC
+// Decodes DCC in an interrupt routine and sets signal heads from the main loop.
+//
+// The interrupt routine only times the edges and assembles packets; it puts each complete
+// packet (with a good check byte) on a small queue that needs no locking, as only the
+// interrupt routine adds to it and only update takes from it. update takes at most one
+// packet per call, so DCC traffic never holds up an LED slot.
+//
+// Only one signalDCC can be in use (there is one interrupt routine).
+class signalDCC
+{
+  private:
+	linesideSignal *_signal;	// where aspects are sent
+	signalDCCMap *_mapList;		// addresses we respond to
+	byte _pin;					// DCC input pin (must support attachInterrupt)
+
+	// used only in the interrupt routine
+	unsigned long _lastEdge;	// micros() at the last edge
+	byte _halfBit;				// first half of the bit in progress: 0, 1, or LSS_NOT_PIN for none
+	byte _state;				// LSS_DCC_ decoder state
+	byte _ones;					// preamble bits seen
+	byte _bitCount;				// bits read of the current byte
+	byte _byteCount;			// bytes read of the current packet
+	byte _packet[LSS_DCC_MAX_BYTES];	// packet being read
+
+	// the queue between the interrupt routine and update
+	volatile byte _queueHead;	// next slot to fill (changed only by the interrupt routine)
+	volatile byte _queueTail;	// next slot to read (changed only by update)
+	byte _queueLen[LSS_DCC_QUEUE];
+	byte _queue[LSS_DCC_QUEUE][LSS_DCC_MAX_BYTES];
+
+	static signalDCC *_decoder;	// the instance the interrupt routine feeds
+
+	static void _isr();
+	void _edge(unsigned long now);
+	void _bit(byte bitVal);
+	void _endPacket();
+	void _packetIn(const byte *packet, byte len);
+	void _setAspect(unsigned int address, byte aspect, boolean extended);
+	void _addMap(unsigned int address, byte mastOrd, byte headOrd, byte closedColor, byte thrownColor);
+
+  public:
+	signalDCC(linesideSignal &signal); // constructor
+	void setupDCC(byte pin);
+	void addAccessory(unsigned int address, byte mastOrd, byte headOrd, byte closedColor, byte thrownColor);
+	void addAspect(unsigned int address, byte mastOrd, byte headOrd);
+	void update();
+
+}; // signalDCC
+
+#endif
@@ -0,0 +1,245 @@
+/*  signalStore.cpp
+	Keep linesideSignal layouts and lamp state in EEPROM.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    Released into the public domain.
+
+    Without this, every signal comes back dark after a reset (or a brownout) until the sketch
+    (or whatever controls it) sets it again. With it, the lamps lit before the reset are lit
+    again on the first ramp cycle.
+
+    Typical use, with 8 slots of 32 bytes (7 lit lamps each) at EEPROM address 0:
+
+    	linesideSignal signals;
+    	signalStore store(signals, 0, 8, 32);
+
+    	void setup() {
+    		signals.setupSignal();
+    		... addLamp calls ...
+    		if (!store.restore()) {
+    			... set the starting aspects ...
+    		}
+    	}
+
+    	void loop() {
+    		signals.updateSignals();
+    		store.update();
+    	}
+*/
+
+#include "Arduino.h"
+#include <EEPROM.h>
+#include "signalStore.h"
+
+// class constructor - as with linesideSignal, don't touch the hardware here
+signalStore::signalStore(linesideSignal &signal, int address, byte slots, byte slotSize)
+{
+	_signal = &signal;
+	_address = address;
+	_slots = (slots > 0) ? slots : 1;
+	_slotSize = (slotSize > LSS_STORE_MAX) ? LSS_STORE_MAX : slotSize;
+	if (_slotSize < (LSS_STORE_HEADER + LSS_STATE_RECORD)) _slotSize = LSS_STORE_HEADER + LSS_STATE_RECORD;
+
+	_len = 0;
+	_next = 0;
+	_slot = _slots - 1; // so the first save goes in slot 0
+	_seq = 0;
+	_checkTime = 0;
+	_writeTime = 0;
+} // constructor
+
+// restore
+//
+// Find the most recent complete save and light its lamps. Call from setup() after the lamps
+// have been added. Returns false if nothing has been saved.
+boolean signalStore::restore()
+{
+	byte slot;
+	byte best = 0;
+	byte bestSeq = 0;
+	boolean found = false;
+	byte len;
+	byte i;
+	int addr;
+
+	for (slot = 0; slot < _slots; slot++) {
+		addr = _slotAddress(slot);
+		len = EEPROM.read(addr + 1);
+		if (len > (_slotSize - LSS_STORE_HEADER)) continue; // never written (or damaged)
+
+		_buf[0] = EEPROM.read(addr);
+		_buf[1] = len;
+		for (i = 0; i < len; i++) _buf[LSS_STORE_HEADER + i] = EEPROM.read(addr + LSS_STORE_HEADER + i);
+		if (EEPROM.read(addr + 2) != _check(_buf, len)) continue; // incomplete
+
+		if (!found || ((signed char)(_buf[0] - bestSeq) > 0)) { // newer (allowing for the sequence wrapping around)
+			best = slot;
+			bestSeq = _buf[0];
+			found = true;
+		}
+	} // for
+
+	if (!found) return(false);
+
+	_slot = best;
+	_seq = bestSeq;
+
+	addr = _slotAddress(best);
+	len = EEPROM.read(addr + 1);
+	for (i = 0; i < len; i++) _buf[LSS_STORE_HEADER + i] = EEPROM.read(addr + LSS_STORE_HEADER + i);
+	_signal->setState(&_buf[LSS_STORE_HEADER], len);
+
+	return(true);
+} // restore
+
+// save
+//
+// Start saving the current state, if it differs from the last one saved. The bytes are written
+// by update. This is called by update every LSS_STORE_INTERVAL ms, so there is normally no need
+// to call it, except to save a change sooner. Returns false, and saves nothing, if more lamps
+// are lit than a slot holds ((slotSize - LSS_STORE_HEADER) / LSS_STATE_RECORD), rather than
+// saving some of them; the last state saved is kept. Returns true otherwise (including when
+// nothing has changed, or the last save is still being written and this one has to wait).
+boolean signalStore::save()
+{
+	int len;
+
+	if (_len > 0) return(true); // still writing the last one
+
+	// ask for one lamp more than the slot holds, to see if any are left out
+	len = _signal->getState(&_buf[LSS_STORE_HEADER], _slotSize - LSS_STORE_HEADER + LSS_STATE_RECORD);
+	if (len > (_slotSize - LSS_STORE_HEADER)) {
+#if defined(LSS_DEBUG_REPORTING)
+		Serial.print(F("save: more lamps lit than a slot of "));Serial.print(_slotSize);Serial.println(F(" bytes holds."));
+#endif
+		return(false);
+	}
+	if (_sameAsSlot(len)) return(true); // no change
+
+	_slot = (_slot + 1) % _slots; // the next slot in the ring
+	_seq++;
+	_buf[0] = _seq;
+	_buf[1] = byte(len);
+	_buf[2] = _check(_buf, len);
+
+	_len = LSS_STORE_HEADER + len;
+	_next = 0;
+	return(true);
+} // save
+
+// update
+//
+// Call from loop(). Writes at most one byte, and looks for a change every LSS_STORE_INTERVAL ms.
+void signalStore::update()
+{
+	long now;
+
+	now = long(millis());
+
+	if (_len > 0) { // a save is in progress
+		if ((now - _writeTime) >= LSS_STORE_WRITE_TIME) { // the last byte has finished writing
+			_writeNext();
+			_writeTime = now;
+		}
+		return;
+	}
+
+	if ((now - _checkTime) >= LSS_STORE_INTERVAL) {
+		_checkTime = now;
+		save();
+	}
+} // update
+
+// loadLayout
+//
+// Add lamps from a layout stored in EEPROM: a count, followed by that many records in the
+// same form as for addLamps (LSS_LAYOUT_RECORD bytes each). Returns the number of lamps added.
+int signalStore::loadLayout(int address)
+{
+	byte rec[LSS_LAYOUT_RECORD];
+	byte count;
+	byte n;
+	byte i;
+
+	count = EEPROM.read(address);
+	if (count == 0xFF) return(0); // never written
+
+	for (n = 0; n < count; n++) {
+		for (i = 0; i < LSS_LAYOUT_RECORD; i++) rec[i] = EEPROM.read(address + 1 + (n * LSS_LAYOUT_RECORD) + i);
+
+		_signal->addLamp(rec[0], rec[1], rec[2], rec[3] & ~LSS_LAYOUT_NORAMP, rec[4], rec[5]);
+		if (rec[3] & LSS_LAYOUT_NORAMP) _signal->setRamp(rec[0], rec[1], rec[2], false);
+	} // for
+
+	return(count);
+} // loadLayout
+
+/************************ internal routines ******************************/
+
+// check
+//
+// Check byte for a slot: covers the sequence, length and state, and can't match an erased
+// (all 0xFF) or cleared (all 0) slot.
+byte signalStore::_check(const byte *buf, byte len)
+{
+	byte sum = 0x5A;
+	byte i;
+
+	sum += buf[0];
+	sum += len;
+	for (i = 0; i < len; i++) sum += buf[LSS_STORE_HEADER + i];
+
+	return(~sum);
+} // check
+
+// slotAddress
+//
+// EEPROM address of a slot.
+int signalStore::_slotAddress(byte slot)
+{
+	return(_address + (slot * _slotSize));
+} // slotAddress
+
+// sameAsSlot
+//
+// Returns true if the state in _buf matches the last slot written.
+boolean signalStore::_sameAsSlot(byte len)
+{
+	int addr;
+	byte i;
+
+	addr = _slotAddress(_slot);
+	if (EEPROM.read(addr + 1) != len) return(false);
+	for (i = 0; i < len; i++) {
+		if (EEPROM.read(addr + LSS_STORE_HEADER + i) != _buf[LSS_STORE_HEADER + i]) return(false);
+	}
+	return(true);
+} // sameAsSlot
+
+// writeNext
+//
+// Write the next byte of the slot: the state first, then the length and sequence, and the
+// check byte last of all, so the slot only becomes valid once it is complete.
+void signalStore::_writeNext()
+{
+	byte dataLen;
+	byte pos;
+
+	dataLen = _len - LSS_STORE_HEADER;
+	if (_next < dataLen) {
+		pos = LSS_STORE_HEADER + _next;
+	} else if (_next == dataLen) {
+		pos = 1; // length
+	} else if (_next == (dataLen + 1)) {
+		pos = 0; // sequence
+	} else {
+		pos = 2; // check
+	}
+
+	EEPROM.update(_slotAddress(_slot) + pos, _buf[pos]); // only written if different
+
+	if (++_next >= _len) _len = 0; // all done
+} // writeNext
@@ -0,0 +1,71 @@
+/*  signalStore.h
+	Keep linesideSignal layouts and lamp state in EEPROM.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+    Released into the public domain.
+*/
+
+#include "Arduino.h"
+#include "linesideSignal.h"
+
+#ifndef	signalStore_h
+#define signalStore_h
+
+// LSS_STORE_MAX = largest slot, in bytes (including the 3-byte slot header); this is also the
+// size of the buffer used to compare states, so keep it modest. A slot of slotSize bytes holds
+// (slotSize - LSS_STORE_HEADER) / LSS_STATE_RECORD lit lamps.
+#define LSS_STORE_MAX 64
+
+// LSS_STORE_HEADER = bytes at the start of each slot: sequence, length, check
+#define LSS_STORE_HEADER 3
+
+// LSS_STORE_INTERVAL = milliseconds between checks for a changed state. A signal that changes
+// more often than this is only saved once it settles.
+#define LSS_STORE_INTERVAL 2000
+
+// LSS_STORE_WRITE_TIME = milliseconds to allow for each EEPROM byte write (3.3 on AVR)
+#define LSS_STORE_WRITE_TIME 4
+
+// signalStore
+// Saves the lit lamps of a linesideSignal to EEPROM when they change, and restores them after a
+// reset. It can also load a layout (the addLamp definitions) from EEPROM.
+//
+// The state is written to a ring of slots in turn, so each slot is written only once for every
+// "slots" changes, and only bytes that differ are written. A write takes about 3.3 ms per byte, so
+// update writes at most one byte per call, and the lamps keep running while a save is in progress.
+// Each slot has a sequence number and a check byte, written last, so a save cut short by a reset
+// is ignored and the previous one is used.
+class signalStore
+{
+  private:
+	linesideSignal *_signal;	// the signals being saved
+	int _address;				// EEPROM address of the first slot
+	byte _slots;				// number of slots
+	byte _slotSize;				// bytes per slot
+
+	byte _buf[LSS_STORE_MAX + LSS_STATE_RECORD];	// slot being written (header and state), and room to see one lamp too many
+	byte _len;					// bytes in _buf, or 0 if nothing is being written
+	byte _next;					// next byte of _buf to write
+	byte _slot;					// slot being (or last) written
+	byte _seq;					// sequence number of the last slot written
+	long _checkTime;			// millis() when we last looked for a change
+	long _writeTime;			// millis() of the last byte written
+
+	byte _check(const byte *buf, byte len);
+	int _slotAddress(byte slot);
+	boolean _sameAsSlot(byte len);
+	void _writeNext();
+
+  public:
+	signalStore(linesideSignal &signal, int address, byte slots, byte slotSize); // constructor
+	boolean restore();
+	boolean save();
+	void update();
+	int loadLayout(int address);
+
+}; // signalStore
+
+#endif